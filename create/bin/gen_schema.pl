@@ -21,9 +21,10 @@ use File::Basename;
 
 my $file = dirname($0)."/../src/schema.tmpl";	# name the file
 
-my ($state, %output, $eol, $fk_bol, $fk_eol, $ltab, $pkey, $table_name);
-my ($szcol1, $szcol2, $szcol3, $szcol4, $sequences, $sql_suffix);
+my ($state, %output, $eol, $fk_bol, $fk_eol, $ltab, $pkey, $table_name, $table_key);
+my ($szcol1, $szcol2, $szcol3, $szcol4, $sequences, $sql_suffix, $changelog);
 my ($fkeys, $fkeys_prefix, $fkeys_suffix, $uniq);
+my @changelog_fields;
 
 my %c = (
 	"type"		=>	"code",
@@ -210,6 +211,8 @@ sub process_table
 	newstate("table");
 
 	($table_name, $pkey, $flags) = split(/\|/, $line, 3);
+	$table_key = $pkey;
+	@changelog_fields = ();
 
 	if ($output{"type"} eq "code")
 	{
@@ -269,6 +272,8 @@ sub process_field
 	($name, $type, $default, $null, $flags, $relN, $fk_table, $fk_field, $fk_flags) = split(/\|/, $line, 9);
 	my ($type_short, $length) = split(/\(/, $type, 2);
 
+	push(@changelog_fields, $name) if ($name ne $table_key);
+
 	if ($output{"type"} eq "code")
 	{
 		$type = $output{$type_short};
@@ -401,7 +406,7 @@ sub process_field
 				$sequences = "${sequences}BEFORE INSERT ON ${table_name}${eol}\n";
 				$sequences = "${sequences}FOR EACH ROW${eol}\n";
 				$sequences = "${sequences}BEGIN${eol}\n";
-				$sequences = "${sequences}SELECT ${table_name}_seq.nextval INTO :new.id FROM dual;${eol}\n";
+				$sequences = "${sequences}SELECT ${table_name}_seq.nextval INTO :new.${name} FROM dual;${eol}\n";
 				$sequences = "${sequences}END;${eol}\n/${eol}\n";
 			}
 		}
@@ -601,6 +606,81 @@ sub process_row
 	print "INSERT INTO $table_name VALUES $values;${eol}\n";
 }
 
+sub process_changelog
+{
+	my ($object, $runtime_fields) = split(/\|/, $_[0], 2);
+	my %operations = ("insert" => 1, "update" => 2, "delete" => 3);
+
+	# changes are tracked by database triggers, which are not used with SQLite
+	return if ($output{"type"} eq "code" || $output{"database"} eq "sqlite3");
+
+	foreach my $op ("insert", "update", "delete")
+	{
+		my $ref = ($op eq "delete" ? "old" : "new");
+		my $trigger = "${table_name}_${op}";
+		my $event = $op;
+		my $condition = "";
+
+		# updates of fields written by server at runtime are not configuration changes
+		if ($op eq "update" && $runtime_fields)
+		{
+			my %runtime = map { $_ => 1 } split(/,/, $runtime_fields);
+			my @fields = grep { not exists $runtime{$_} } @changelog_fields;
+
+			if ($output{"database"} eq "mysql")
+			{
+				$condition = " from dual where not (" . join(" and ", map { "old.$_<=>new.$_" } @fields) . ")";
+			}
+			else
+			{
+				$event = "update of " . join(",", @fields);
+			}
+		}
+
+		if ($output{"database"} eq "postgresql")
+		{
+			$changelog .= "create or replace function changelog_${trigger}() returns trigger as \$\$${eol}\n" .
+					"begin${eol}\n" .
+					"${ltab}insert into changelog (object,objectid,operation,clock)${eol}\n" .
+					"${ltab}${ltab}values (${object},${ref}.${table_key},$operations{$op}," .
+						"cast(extract(epoch from now()) as int));${eol}\n" .
+					"${ltab}return ${ref};${eol}\n" .
+					"end;${eol}\n" .
+					"\$\$ language plpgsql;${eol}\n";
+			$changelog .= "create trigger ${trigger} after ${event} on ${table_name}${eol}\n" .
+					"for each row execute procedure changelog_${trigger}();${eol}\n";
+		}
+		elsif ($output{"database"} eq "mysql")
+		{
+			if ($condition ne "")
+			{
+				$changelog .= "create trigger ${trigger} after ${event} on ${table_name}${eol}\n" .
+						"for each row${eol}\n" .
+						"insert into changelog (object,objectid,operation,clock)${eol}\n" .
+						"select ${object},${ref}.${table_key},$operations{$op},unix_timestamp()" .
+							"${condition};${eol}\n";
+			}
+			else
+			{
+				$changelog .= "create trigger ${trigger} after ${event} on ${table_name}${eol}\n" .
+						"for each row${eol}\n" .
+						"insert into changelog (object,objectid,operation,clock)${eol}\n" .
+						"values (${object},${ref}.${table_key},$operations{$op},unix_timestamp());${eol}\n";
+			}
+		}
+		elsif ($output{"database"} eq "oracle")
+		{
+			$changelog .= "create trigger ${trigger} after ${event} on ${table_name}${eol}\n" .
+					"for each row${eol}\n" .
+					"begin${eol}\n" .
+					"${ltab}insert into changelog (object,objectid,operation,clock)${eol}\n" .
+					"${ltab}${ltab}values (${object},:${ref}.${table_key},$operations{$op}," .
+						"(cast(sys_extract_utc(systimestamp) as date)-date'1970-01-01')*86400);${eol}\n" .
+					"end;${eol}\n/${eol}\n";
+		}
+	}
+}
+
 sub timescaledb
 {
 	print<<EOF
@@ -704,6 +784,7 @@ sub process
 	$state = "bof";
 	$fkeys = "";
 	$sequences = "";
+	$changelog = "";
 	$uniq = "";
 	my ($type, $line);
 
@@ -725,6 +806,7 @@ sub process
 			elsif ($type eq 'TABLE')	{ process_table($line); }
 			elsif ($type eq 'UNIQUE')	{ process_index($line, 1); }
 			elsif ($type eq 'ROW' && $output{"type"} ne "code")		{ process_row($line); }
+			elsif ($type eq 'CHANGELOG')	{ process_changelog($line); }
 		}
 	}
 
@@ -732,6 +814,7 @@ sub process
 
 	print $sequences.$sql_suffix;
 	print $fkeys_prefix.$fkeys.$fkeys_suffix;
+	print $changelog;
 	print $output{"after"};
 }
 
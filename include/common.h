@@ -572,7 +572,10 @@ const char	*get_program_type_string(unsigned char program_type);
 #define ZBX_PROCESS_TYPE_SERVICEMAN		35
 #define ZBX_PROCESS_TYPE_TRIGGERHOUSEKEEPER	36
 #define ZBX_PROCESS_TYPE_ODBCPOLLER		37
-#define ZBX_PROCESS_TYPE_COUNT			38	/* number of process types */
+#define ZBX_PROCESS_TYPE_AGENT_POLLER		38
+#define ZBX_PROCESS_TYPE_SNMP_POLLER		39
+#define ZBX_PROCESS_TYPE_HTTPAGENT_POLLER	40
+#define ZBX_PROCESS_TYPE_COUNT			41	/* number of process types */
 
 /* special processes that are not present worker list */
 #define ZBX_PROCESS_TYPE_EXT_FIRST		126
@@ -1163,6 +1166,7 @@ int	zbx_interval_preproc(const char *interval_str, int *simple_interval, zbx_cus
 		char **error);
 int	zbx_validate_interval(const char *str, char **error);
 int	zbx_custom_interval_is_scheduling(const zbx_custom_interval_t *custom_intervals);
+int	zbx_custom_interval_is_flexible(const zbx_custom_interval_t *custom_intervals);
 void	zbx_custom_interval_free(zbx_custom_interval_t *custom_intervals);
 int	calculate_item_nextcheck(zbx_uint64_t seed, int item_type, int simple_interval,
 		const zbx_custom_interval_t *custom_intervals, time_t now);
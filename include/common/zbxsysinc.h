@@ -244,6 +244,10 @@
 #	include <sys/disk.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#	include <sys/epoll.h>
+#endif
+
 #ifdef HAVE_SYS_SOCKET_H
 #	include <sys/socket.h>
 #endif
@@ -442,4 +446,8 @@
 #	include <float.h>
 #endif
 
+#ifdef HAVE_POLL_H
+#	include <poll.h>
+#endif
+
 #endif
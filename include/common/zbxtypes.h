@@ -25,13 +25,11 @@
 #if defined(_WINDOWS)
 #	define ZBX_THREAD_LOCAL __declspec(thread)
 #else
-/* for non windows build thread local storage is required only for agent2 */
-#	if defined(ZBX_BUILD_AGENT2)
-#		if defined(HAVE_THREAD_LOCAL) && (defined(__GNUC__) || defined(__clang__) || defined(__MINGW32__))
-#			define ZBX_THREAD_LOCAL __thread
-#		else
-#			error "C compiler is not compatible with agent2 assembly"
-#		endif
+/* for non windows build thread local storage is required by agent2 and by database worker threads */
+#	if defined(HAVE_THREAD_LOCAL) && (defined(__GNUC__) || defined(__clang__) || defined(__MINGW32__))
+#		define ZBX_THREAD_LOCAL __thread
+#	elif defined(ZBX_BUILD_AGENT2)
+#		error "C compiler is not compatible with agent2 assembly"
 #	endif
 #	if !defined(ZBX_THREAD_LOCAL)
 #		define ZBX_THREAD_LOCAL
@@ -30,6 +30,11 @@
 #define ZBX_SYNC_DONE		0
 #define	ZBX_SYNC_MORE		1
 
+/* history synchronization stages */
+#define ZBX_SYNC_STAGE_HISTORY	0x01	/* write values to history storage */
+#define ZBX_SYNC_STAGE_TRIGGERS	0x02	/* recalculate triggers of written values */
+#define ZBX_SYNC_STAGE_ALL	(ZBX_SYNC_STAGE_HISTORY | ZBX_SYNC_STAGE_TRIGGERS)
+
 #define	ZBX_NO_POLLER			255
 #define	ZBX_POLLER_TYPE_NORMAL		0
 #define	ZBX_POLLER_TYPE_UNREACHABLE	1
@@ -38,7 +43,10 @@
 #define	ZBX_POLLER_TYPE_JAVA		4
 #define	ZBX_POLLER_TYPE_HISTORY		5
 #define	ZBX_POLLER_TYPE_ODBC		6
-#define	ZBX_POLLER_TYPE_COUNT		7	/* number of poller types */
+#define	ZBX_POLLER_TYPE_AGENT		7
+#define	ZBX_POLLER_TYPE_SNMP		8
+#define	ZBX_POLLER_TYPE_HTTPAGENT	9
+#define	ZBX_POLLER_TYPE_COUNT		10	/* number of poller types */
 
 #define MAX_JAVA_ITEMS		32
 #define MAX_SNMP_ITEMS		128
@@ -69,6 +77,12 @@ extern zbx_uint64_t	CONFIG_CONF_CACHE_SIZE;
 extern zbx_uint64_t	CONFIG_HISTORY_CACHE_SIZE;
 extern zbx_uint64_t	CONFIG_HISTORY_INDEX_CACHE_SIZE;
 extern zbx_uint64_t	CONFIG_TRENDS_CACHE_SIZE;
+extern int	CONFIG_TRENDS_FLUSH_PERIOD;
+extern int	CONFIG_CONFSYNCER_FULL_FREQUENCY;
+extern int	CONFIG_CONFSYNCER_WORKERS;
+
+extern int	CONFIG_HISTORY_CACHE_SHARDS;
+extern int	CONFIG_HISTORY_WRITERS;
 
 extern int	CONFIG_POLLER_FORKS;
 extern int	CONFIG_UNREACHABLE_POLLER_FORKS;
@@ -81,6 +95,9 @@ extern int	CONFIG_PROXYCONFIG_FREQUENCY;
 extern int	CONFIG_PROXYDATA_FREQUENCY;
 extern int	CONFIG_HISTORYPOLLER_FORKS;
 extern int	CONFIG_ODBCPOLLER_FORKS;
+extern int	CONFIG_AGENTPOLLER_FORKS;
+extern int	CONFIG_SNMPPOLLER_FORKS;
+extern int	CONFIG_HTTPAGENTPOLLER_FORKS;
 
 typedef struct
 {
@@ -617,7 +634,7 @@ int	in_maintenance_without_data_collection(unsigned char maintenance_status, uns
 void	dc_add_history(zbx_uint64_t itemid, unsigned char item_value_type, unsigned char item_flags,
 		AGENT_RESULT *result, const zbx_timespec_t *ts, unsigned char state, const char *error);
 void	dc_flush_history(void);
-void	zbx_sync_history_cache(int *values_num, int *triggers_num, int *more);
+void	zbx_sync_history_cache(unsigned char stages, int *values_num, int *triggers_num, int *more);
 void	zbx_log_sync_history_cache_progress(void);
 
 #define ZBX_SYNC_NONE	0
@@ -691,10 +708,16 @@ zbx_synced_new_config_t;
 #define ZBX_ITEM_GET_PROCESS		(ZBX_ITEM_GET_MAINTENANCE|ZBX_ITEM_GET_MISC|ZBX_ITEM_GET_LOGTIMEFMT)
 
 void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced);
+void	DCsync_workers_stop(void);
 void	DCsync_kvs_paths(const struct zbx_json_parse *jp_kvs_paths);
 int	init_configuration_cache(char **error);
 void	free_configuration_cache(void);
 
+typedef int	(*zbx_dc_snapshot_validate_func_t)(int saved);
+
+int	zbx_dc_save_snapshot(const char *path, char **error);
+int	zbx_dc_load_snapshot(const char *path, zbx_dc_snapshot_validate_func_t validate_cb, char **error);
+
 void	DCconfig_get_triggers_by_triggerids(DC_TRIGGER *triggers, const zbx_uint64_t *triggerids, int *errcode,
 		size_t num);
 void	DCconfig_clean_items(DC_ITEM *items, int *errcodes, size_t num);
@@ -706,6 +729,7 @@ void	DCconfig_get_items_by_keys(DC_ITEM *items, zbx_host_key_t *keys, int *errco
 void	DCconfig_get_items_by_itemids(DC_ITEM *items, const zbx_uint64_t *itemids, int *errcodes, size_t num);
 void	DCconfig_get_items_by_itemids_partial(DC_ITEM *items, const zbx_uint64_t *itemids, int *errcodes, size_t num,
 		unsigned int mode);
+void	zbx_dc_get_item_value_types(const zbx_uint64_t *itemids, unsigned char *value_types, int *errcodes, int num);
 void	DCconfig_get_preprocessable_items(zbx_hashset_t *items, int *timestamp);
 void	DCconfig_get_functions_by_functionids(DC_FUNCTION *functions,
 		zbx_uint64_t *functionids, int *errcodes, size_t num);
@@ -725,6 +749,9 @@ int	DCconfig_get_interface_by_type(DC_INTERFACE *interface, zbx_uint64_t hostid,
 int	DCconfig_get_interface(DC_INTERFACE *interface, zbx_uint64_t hostid, zbx_uint64_t itemid);
 int	DCconfig_get_poller_nextcheck(unsigned char poller_type);
 int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items);
+int	DCconfig_get_agent_poller_items(DC_ITEM *items, int max_items);
+int	DCconfig_get_snmp_poller_items(DC_ITEM *items, int max_items);
+int	DCconfig_get_httpagent_poller_items(DC_ITEM *items, int max_items);
 int	DCconfig_get_ipmi_poller_items(int now, DC_ITEM *items, int items_num, int *nextcheck);
 int	DCconfig_get_snmp_interfaceids_by_addr(const char *addr, zbx_uint64_t **interfaceids);
 size_t	DCconfig_get_snmp_items_by_interfaceid(zbx_uint64_t interfaceid, DC_ITEM **items);
@@ -860,6 +887,9 @@ void	zbx_dc_get_hostids_by_group_name(const char *name, zbx_vector_uint64_t *hos
 #define ZBX_HC_ITEM_STATUS_NORMAL	0
 #define ZBX_HC_ITEM_STATUS_BUSY		1
 
+#define ZBX_HC_ITEM_STAGE_HISTORY	0	/* the oldest value is waiting to be written to history */
+#define ZBX_HC_ITEM_STAGE_TRIGGERS	1	/* the oldest value is written, waiting for triggers    */
+
 #define ZBX_DC_FLAG_META	0x01	/* contains meta information (lastlogsize and mtime) */
 #define ZBX_DC_FLAG_NOVALUE	0x02	/* entry contains no value */
 #define ZBX_DC_FLAG_LLD		0x04	/* low-level discovery value */
@@ -885,6 +915,7 @@ typedef struct
 {
 	zbx_uint64_t	itemid;
 	unsigned char	status;
+	unsigned char	stage;
 	int		values_num;
 
 	zbx_hc_data_t	*tail;
@@ -278,6 +278,49 @@ void			zbx_binary_heap_remove_direct(zbx_binary_heap_t *heap, zbx_uint64_t key);
 
 void			zbx_binary_heap_clear(zbx_binary_heap_t *heap);
 
+/* hierarchical timing wheel */
+
+/* Elements are scheduled at time in seconds. Elements scheduled after the time the wheel was advanced */
+/* to are kept in wheel slot lists, providing constant time insert, update and remove operations.     */
+/* When the wheel is advanced the elements that became due are moved to the due heap in batches of    */
+/* slot lists, where they are ordered by the specified compare function.                              */
+
+#define ZBX_TIMING_WHEEL_LEVELS		5
+#define ZBX_TIMING_WHEEL_SLOT_BITS	6
+#define ZBX_TIMING_WHEEL_SLOTS		(1 << ZBX_TIMING_WHEEL_SLOT_BITS)
+
+typedef struct zbx_timing_wheel_node zbx_timing_wheel_node_t;
+
+typedef struct
+{
+	zbx_hashset_t		nodes;
+	zbx_binary_heap_t	due;
+	zbx_timing_wheel_node_t	*slots[ZBX_TIMING_WHEEL_LEVELS][ZBX_TIMING_WHEEL_SLOTS];
+	zbx_uint64_t		slots_used[ZBX_TIMING_WHEEL_LEVELS];	/* bitmaps of non-empty slots */
+	int			time;		/* the first second not processed yet */
+	int			wheel_num;	/* number of elements in slot lists */
+}
+zbx_timing_wheel_t;
+
+void			zbx_timing_wheel_create(zbx_timing_wheel_t *wheel, zbx_compare_func_t compare_func, int now);
+void			zbx_timing_wheel_create_ext(zbx_timing_wheel_t *wheel, zbx_compare_func_t compare_func,
+							int now, zbx_mem_malloc_func_t mem_malloc_func,
+							zbx_mem_realloc_func_t mem_realloc_func,
+							zbx_mem_free_func_t mem_free_func);
+void			zbx_timing_wheel_destroy(zbx_timing_wheel_t *wheel);
+
+int			zbx_timing_wheel_num(const zbx_timing_wheel_t *wheel);
+void			zbx_timing_wheel_insert(zbx_timing_wheel_t *wheel, zbx_uint64_t key, const void *data,
+							int time);
+void			zbx_timing_wheel_update(zbx_timing_wheel_t *wheel, zbx_uint64_t key, int time);
+void			zbx_timing_wheel_remove(zbx_timing_wheel_t *wheel, zbx_uint64_t key);
+void			zbx_timing_wheel_advance(zbx_timing_wheel_t *wheel, int now);
+zbx_binary_heap_elem_t	*zbx_timing_wheel_find_due(zbx_timing_wheel_t *wheel);
+void			zbx_timing_wheel_remove_due(zbx_timing_wheel_t *wheel);
+int			zbx_timing_wheel_get_nexttime(zbx_timing_wheel_t *wheel, int *time);
+
+void			zbx_timing_wheel_clear(zbx_timing_wheel_t *wheel, int now);
+
 /* vector implementation start */
 
 #define ZBX_VECTOR_DECL(__id, __type)										\
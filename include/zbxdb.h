@@ -84,6 +84,7 @@ int	zbx_db_init(const char *dbname, const char *const dbschema, char **error);
 void	zbx_db_deinit(void);
 
 void	zbx_db_init_autoincrement_options(void);
+void	zbx_db_init_worker_options(void);
 
 int	zbx_db_connect(char *host, char *user, char *password, char *dbname, char *dbschema, char *dbsocket, int port,
 			char *tls_connect, char *cert, char *key, char *ca, char *cipher, char *cipher_13);
@@ -60,6 +60,18 @@ int	zbx_history_add_values(const zbx_vector_ptr_t *history, int *ret_flush);
 int	zbx_history_get_values(zbx_uint64_t itemid, int value_type, int start, int count, int end,
 		zbx_vector_history_record_t *values);
 
+/* the request of item history values within ]start,end] period */
+typedef struct
+{
+	zbx_uint64_t			itemid;
+	int				start;
+	int				end;
+	zbx_vector_history_record_t	values;
+}
+zbx_history_request_t;
+
+int	zbx_history_get_values_multi(int value_type, zbx_vector_ptr_t *requests);
+
 int	zbx_history_requires_trends(int value_type);
 void	zbx_history_check_version(struct zbx_json *json);
 
@@ -31,6 +31,9 @@
 typedef wchar_t * zbx_mutex_name_t;
 typedef HANDLE zbx_mutex_t;
 #else	/* not _WINDOWS */
+/* the maximum number of history cache shards, each shard is protected by its own mutex */
+#define ZBX_HC_SHARDS_MAX	16
+
 typedef enum
 {
 	ZBX_MUTEX_LOG = 0,
@@ -50,6 +53,9 @@ typedef enum
 #endif
 	ZBX_MUTEX_MODBUS,
 	ZBX_MUTEX_TREND_FUNC,
+	/* history cache shards 1..(ZBX_HC_SHARDS_MAX - 1), the first shard uses ZBX_MUTEX_CACHE */
+	ZBX_MUTEX_CACHE_SHARD,
+	ZBX_MUTEX_CACHE_SHARD_LAST = ZBX_MUTEX_CACHE_SHARD + ZBX_HC_SHARDS_MAX - 2,
 	/* NOTE: Do not forget to sync changes here with mutex names in diag_add_locks_info()! */
 	ZBX_MUTEX_COUNT
 }
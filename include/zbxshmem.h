@@ -28,6 +28,13 @@
 #define SHMEM_MAX_BUCKET_SIZE		256 /* starting from this size all free chunks are put into the same bucket */
 #define ZBX_SHMEM_BUCKET_COUNT		((SHMEM_MAX_BUCKET_SIZE - ZBX_SHMEM_MIN_BUCKET_SIZE) / 8 + 1)
 
+/* NUMA memory policies of shared memory segments */
+#define ZBX_SHMEM_NUMA_DEFAULT		0
+#define ZBX_SHMEM_NUMA_INTERLEAVE	1
+#define ZBX_SHMEM_NUMA_BIND		2
+
+#define ZBX_SHMEM_NUMA_MAX_NODES	64
+
 typedef struct
 {
 	void		*base;
@@ -47,6 +54,13 @@ typedef struct
 
 	const char	*mem_descr;
 	const char	*mem_param;
+
+	/* size of the pages backing shared memory segment */
+	zbx_uint64_t	page_size;
+
+	/* NUMA memory policy and the bitmask of nodes it was applied with */
+	unsigned char	numa_policy;
+	zbx_uint64_t	numa_nodes;
 }
 zbx_shmem_info_t;
 
@@ -60,6 +74,11 @@ typedef struct
 	unsigned int	chunks_num[ZBX_SHMEM_BUCKET_COUNT];
 	unsigned int	free_chunks;
 	unsigned int	used_chunks;
+	zbx_uint64_t	page_size;
+	unsigned char	numa_policy;
+	zbx_uint64_t	numa_nodes;
+	/* number of sampled resident pages per NUMA node */
+	unsigned int	numa_pages[ZBX_SHMEM_NUMA_MAX_NODES];
 }
 zbx_shmem_stats_t;
 
@@ -90,6 +109,11 @@ void	zbx_shmem_dump_stats(int level, zbx_shmem_info_t *info);
 size_t		zbx_shmem_required_size(int chunks_num, const char *descr, const char *param);
 zbx_uint64_t	zbx_shmem_required_chunk_size(zbx_uint64_t size);
 
+void	zbx_shmem_write_image(const zbx_shmem_info_t *info, FILE *file);
+int	zbx_shmem_create_from_image(zbx_shmem_info_t **info, const void *data, size_t size, const char *descr,
+		const char *param, char **error);
+const char	*zbx_shmem_numa_policy_string(unsigned char policy);
+
 #define ZBX_SHMEM_FUNC1_DECL_MALLOC(__prefix)				\
 static void	*__prefix ## _shmem_malloc_func(void *old, size_t size)
 #define ZBX_SHMEM_FUNC1_DECL_REALLOC(__prefix)				\
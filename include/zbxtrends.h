@@ -51,6 +51,11 @@ void	zbx_tfc_destroy(void);
 int	zbx_tfc_get_stats(zbx_tfc_stats_t *stats, char **error);
 void	zbx_tfc_invalidate_trends(ZBX_DC_TREND *trends, int trends_num);
 
+typedef int	(*zbx_tfc_snapshot_validate_func_t)(int saved);
+
+int	zbx_tfc_save_snapshot(const char *path, char **error);
+int	zbx_tfc_load_snapshot(const char *path, zbx_tfc_snapshot_validate_func_t validate_cb, char **error);
+
 int	zbx_baseline_get_data(zbx_uint64_t itemid, unsigned char value_type, time_t now, const char *period,
 		int season_num, zbx_time_unit_t season_unit, int skip, zbx_vector_dbl_t *values,
 		zbx_vector_uint64_t *index, char **error);
@@ -0,0 +1,455 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxalgo.h"
+
+#include "common.h"
+#include "log.h"
+
+/*
+ * The wheel consists of ZBX_TIMING_WHEEL_LEVELS levels of ZBX_TIMING_WHEEL_SLOTS slots. A slot of level N
+ * covers ZBX_TIMING_WHEEL_SLOTS^N seconds, so an element scheduled within ZBX_TIMING_WHEEL_SLOTS^(N+1)
+ * seconds from the wheel time is stored in level N slot selected by the corresponding bits of its time.
+ *
+ * When the wheel time enters a new level N slot period, elements of that level N slot are redistributed
+ * (cascaded) to lower levels. Elements of level 0 slot are moved to the due heap when the wheel time
+ * reaches the slot second.
+ */
+
+#define ZBX_TIMING_WHEEL_SLOT_MASK	(ZBX_TIMING_WHEEL_SLOTS - 1)
+#define ZBX_TIMING_WHEEL_DUE		-1
+
+struct zbx_timing_wheel_node
+{
+	zbx_uint64_t		key;
+	const void		*data;
+	int			time;
+	int			slot;	/* level * ZBX_TIMING_WHEEL_SLOTS + slot index or ZBX_TIMING_WHEEL_DUE */
+	zbx_timing_wheel_node_t	*prev;
+	zbx_timing_wheel_node_t	*next;
+};
+
+/* private timing wheel functions */
+
+static void	timing_wheel_unlink(zbx_timing_wheel_t *wheel, zbx_timing_wheel_node_t *node)
+{
+	int	level = node->slot >> ZBX_TIMING_WHEEL_SLOT_BITS, index = node->slot & ZBX_TIMING_WHEEL_SLOT_MASK;
+
+	if (NULL != node->prev)
+		node->prev->next = node->next;
+	else
+		wheel->slots[level][index] = node->next;
+
+	if (NULL != node->next)
+		node->next->prev = node->prev;
+
+	if (NULL == wheel->slots[level][index])
+		wheel->slots_used[level] &= ~((zbx_uint64_t)1 << index);
+
+	wheel->wheel_num--;
+}
+
+static void	timing_wheel_place(zbx_timing_wheel_t *wheel, zbx_timing_wheel_node_t *node)
+{
+	zbx_binary_heap_elem_t	elem;
+	zbx_uint64_t		delta;
+	int			level, index;
+
+	if (node->time < wheel->time)
+	{
+		node->slot = ZBX_TIMING_WHEEL_DUE;
+
+		elem.key = node->key;
+		elem.data = node->data;
+		zbx_binary_heap_insert(&wheel->due, &elem);
+
+		return;
+	}
+
+	delta = (zbx_uint64_t)(node->time - wheel->time);
+
+	for (level = 0; level < ZBX_TIMING_WHEEL_LEVELS - 1; level++)
+	{
+		if (delta < (zbx_uint64_t)1 << ((level + 1) * ZBX_TIMING_WHEEL_SLOT_BITS))
+			break;
+	}
+
+	index = (node->time >> (level * ZBX_TIMING_WHEEL_SLOT_BITS)) & ZBX_TIMING_WHEEL_SLOT_MASK;
+
+	node->slot = (level << ZBX_TIMING_WHEEL_SLOT_BITS) | index;
+	node->prev = NULL;
+	node->next = wheel->slots[level][index];
+
+	if (NULL != node->next)
+		node->next->prev = node;
+
+	wheel->slots[level][index] = node;
+	wheel->slots_used[level] |= (zbx_uint64_t)1 << index;
+	wheel->wheel_num++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: redistributes elements of the specified slot according to the    *
+ *          current wheel time                                                *
+ *                                                                            *
+ * Comments: Elements scheduled beyond the wheel range can be placed back     *
+ *           into the same top level slot, so the slot list is detached       *
+ *           before processing.                                               *
+ *                                                                            *
+ ******************************************************************************/
+static void	timing_wheel_cascade(zbx_timing_wheel_t *wheel, int level, int index)
+{
+	zbx_timing_wheel_node_t	*node, *next;
+
+	if (NULL == (node = wheel->slots[level][index]))
+		return;
+
+	wheel->slots[level][index] = NULL;
+	wheel->slots_used[level] &= ~((zbx_uint64_t)1 << index);
+
+	for (; NULL != node; node = next)
+	{
+		next = node->next;
+		wheel->wheel_num--;
+		timing_wheel_place(wheel, node);
+	}
+}
+
+static zbx_timing_wheel_node_t	*timing_wheel_get_node(zbx_timing_wheel_t *wheel, zbx_uint64_t key)
+{
+	zbx_timing_wheel_node_t	*node;
+
+	if (NULL == (node = (zbx_timing_wheel_node_t *)zbx_hashset_search(&wheel->nodes, &key)))
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		exit(EXIT_FAILURE);
+	}
+
+	return node;
+}
+
+/* public timing wheel interface */
+
+void	zbx_timing_wheel_create(zbx_timing_wheel_t *wheel, zbx_compare_func_t compare_func, int now)
+{
+	zbx_timing_wheel_create_ext(wheel, compare_func, now,
+					ZBX_DEFAULT_MEM_MALLOC_FUNC,
+					ZBX_DEFAULT_MEM_REALLOC_FUNC,
+					ZBX_DEFAULT_MEM_FREE_FUNC);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: creates timing wheel                                              *
+ *                                                                            *
+ * Parameters: wheel           - [OUT] the timing wheel                       *
+ *             compare_func    - [IN] the function to order due elements,     *
+ *                                    called with zbx_binary_heap_elem_t      *
+ *                                    pointers                                *
+ *             now             - [IN] the initial wheel time                  *
+ *             mem_*_func      - [IN] the memory management functions         *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_timing_wheel_create_ext(zbx_timing_wheel_t *wheel, zbx_compare_func_t compare_func, int now,
+		zbx_mem_malloc_func_t mem_malloc_func, zbx_mem_realloc_func_t mem_realloc_func,
+		zbx_mem_free_func_t mem_free_func)
+{
+	zbx_hashset_create_ext(&wheel->nodes, 0, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC,
+			NULL, mem_malloc_func, mem_realloc_func, mem_free_func);
+	zbx_binary_heap_create_ext(&wheel->due, compare_func, ZBX_BINARY_HEAP_OPTION_DIRECT, mem_malloc_func,
+			mem_realloc_func, mem_free_func);
+
+	memset(wheel->slots, 0, sizeof(wheel->slots));
+	memset(wheel->slots_used, 0, sizeof(wheel->slots_used));
+	wheel->time = now;
+	wheel->wheel_num = 0;
+}
+
+void	zbx_timing_wheel_destroy(zbx_timing_wheel_t *wheel)
+{
+	zbx_binary_heap_destroy(&wheel->due);
+	zbx_hashset_destroy(&wheel->nodes);
+	wheel->wheel_num = 0;
+}
+
+int	zbx_timing_wheel_num(const zbx_timing_wheel_t *wheel)
+{
+	return wheel->nodes.num_data;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: schedules new element                                             *
+ *                                                                            *
+ * Parameters: wheel - [IN] the timing wheel                                  *
+ *             key   - [IN] the element key, must be unique                   *
+ *             data  - [IN] the element data                                  *
+ *             time  - [IN] the scheduled time                                *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_timing_wheel_insert(zbx_timing_wheel_t *wheel, zbx_uint64_t key, const void *data, int time)
+{
+	zbx_timing_wheel_node_t	node_local, *node;
+
+	if (NULL != zbx_hashset_search(&wheel->nodes, &key))
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		exit(EXIT_FAILURE);
+	}
+
+	node_local.key = key;
+	node_local.data = data;
+	node_local.time = time;
+
+	node = (zbx_timing_wheel_node_t *)zbx_hashset_insert(&wheel->nodes, &node_local, sizeof(node_local));
+	timing_wheel_place(wheel, node);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reschedules element                                               *
+ *                                                                            *
+ * Parameters: wheel - [IN] the timing wheel                                  *
+ *             key   - [IN] the element key                                   *
+ *             time  - [IN] the new scheduled time                            *
+ *                                                                            *
+ * Comments: Due elements are also reordered, as their ordering data might    *
+ *           have changed.                                                    *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_timing_wheel_update(zbx_timing_wheel_t *wheel, zbx_uint64_t key, int time)
+{
+	zbx_timing_wheel_node_t	*node;
+
+	node = timing_wheel_get_node(wheel, key);
+
+	if (ZBX_TIMING_WHEEL_DUE == node->slot)
+	{
+		node->time = time;
+
+		if (time < wheel->time)
+		{
+			zbx_binary_heap_elem_t	elem = {node->key, node->data};
+
+			zbx_binary_heap_update_direct(&wheel->due, &elem);
+			return;
+		}
+
+		zbx_binary_heap_remove_direct(&wheel->due, key);
+	}
+	else
+	{
+		timing_wheel_unlink(wheel, node);
+		node->time = time;
+	}
+
+	timing_wheel_place(wheel, node);
+}
+
+void	zbx_timing_wheel_remove(zbx_timing_wheel_t *wheel, zbx_uint64_t key)
+{
+	zbx_timing_wheel_node_t	*node;
+
+	node = timing_wheel_get_node(wheel, key);
+
+	if (ZBX_TIMING_WHEEL_DUE == node->slot)
+		zbx_binary_heap_remove_direct(&wheel->due, key);
+	else
+		timing_wheel_unlink(wheel, node);
+
+	zbx_hashset_remove_direct(&wheel->nodes, node);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: moves elements scheduled at or before the specified time to the   *
+ *          due heap                                                          *
+ *                                                                            *
+ * Parameters: wheel - [IN] the timing wheel                                  *
+ *             now   - [IN] the current time                                  *
+ *                                                                            *
+ * Comments: The remaining seconds of level 0 slot period are skipped when    *
+ *           there are no elements scheduled in them.                         *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_timing_wheel_advance(zbx_timing_wheel_t *wheel, int now)
+{
+	while (wheel->time <= now)
+	{
+		int			index, level, next;
+		zbx_timing_wheel_node_t	*node, *node_next;
+
+		if (0 == wheel->wheel_num)
+		{
+			wheel->time = now + 1;
+			break;
+		}
+
+		index = wheel->time & ZBX_TIMING_WHEEL_SLOT_MASK;
+
+		/* cascade higher level slots when entering their periods */
+		for (level = 1; 0 == ((wheel->time >> ((level - 1) * ZBX_TIMING_WHEEL_SLOT_BITS)) &
+				ZBX_TIMING_WHEEL_SLOT_MASK) && level < ZBX_TIMING_WHEEL_LEVELS; level++)
+		{
+			timing_wheel_cascade(wheel, level, (wheel->time >> (level * ZBX_TIMING_WHEEL_SLOT_BITS)) &
+					ZBX_TIMING_WHEEL_SLOT_MASK);
+		}
+
+		if (NULL != (node = wheel->slots[0][index]))
+		{
+			zbx_binary_heap_elem_t	elem;
+
+			wheel->slots[0][index] = NULL;
+			wheel->slots_used[0] &= ~((zbx_uint64_t)1 << index);
+
+			for (; NULL != node; node = node_next)
+			{
+				node_next = node->next;
+				node->slot = ZBX_TIMING_WHEEL_DUE;
+				wheel->wheel_num--;
+
+				elem.key = node->key;
+				elem.data = node->data;
+				zbx_binary_heap_insert(&wheel->due, &elem);
+			}
+		}
+
+		wheel->time++;
+
+		/* skip to the next level 0 period if there are no elements left in the current period */
+		if (0 != (wheel->time & ZBX_TIMING_WHEEL_SLOT_MASK) &&
+				0 == (wheel->slots_used[0] >> (wheel->time & ZBX_TIMING_WHEEL_SLOT_MASK)))
+		{
+			next = (wheel->time | ZBX_TIMING_WHEEL_SLOT_MASK) + 1;
+			wheel->time = MIN(next, now + 1);
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns the first due element without removing it                 *
+ *                                                                            *
+ * Return value: the due element or NULL if there are no due elements         *
+ *                                                                            *
+ * Comments: Only elements moved to the due heap by the last                  *
+ *           zbx_timing_wheel_advance() call or scheduled before the wheel    *
+ *           time are returned.                                               *
+ *                                                                            *
+ ******************************************************************************/
+zbx_binary_heap_elem_t	*zbx_timing_wheel_find_due(zbx_timing_wheel_t *wheel)
+{
+	if (SUCCEED == zbx_binary_heap_empty(&wheel->due))
+		return NULL;
+
+	return zbx_binary_heap_find_min(&wheel->due);
+}
+
+void	zbx_timing_wheel_remove_due(zbx_timing_wheel_t *wheel)
+{
+	zbx_binary_heap_elem_t	*elem;
+	zbx_timing_wheel_node_t	*node;
+
+	elem = zbx_binary_heap_find_min(&wheel->due);
+	node = timing_wheel_get_node(wheel, elem->key);
+
+	zbx_binary_heap_remove_min(&wheel->due);
+	zbx_hashset_remove_direct(&wheel->nodes, node);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets time when the next element becomes due                       *
+ *                                                                            *
+ * Parameters: wheel - [IN] the timing wheel                                  *
+ *             time  - [OUT] the next element time                            *
+ *                                                                            *
+ * Return value: SUCCEED - the time was returned                              *
+ *               FAIL    - the wheel is empty                                 *
+ *                                                                            *
+ * Comments: The exact time is returned for due elements and elements         *
+ *           scheduled within the current level 0 period. Otherwise the start *
+ *           of the next level 0 period is returned, which is the earliest    *
+ *           time elements from higher levels can become due. The wheel time  *
+ *           itself is returned when it starts a period of higher level slot  *
+ *           that still must be cascaded.                                     *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_timing_wheel_get_nexttime(zbx_timing_wheel_t *wheel, int *time)
+{
+	int		index, shift, level;
+	zbx_uint64_t	used;
+
+	if (FAIL == zbx_binary_heap_empty(&wheel->due))
+	{
+		*time = timing_wheel_get_node(wheel, zbx_binary_heap_find_min(&wheel->due)->key)->time;
+		return SUCCEED;
+	}
+
+	if (0 == wheel->wheel_num)
+		return FAIL;
+
+	/* level 0 slot periods from the wheel time up to the end of the current level 0 period */
+	index = wheel->time & ZBX_TIMING_WHEEL_SLOT_MASK;
+
+	/* higher level slots of periods starting at the wheel time are cascaded only when it is processed */
+	for (level = 1; 0 == ((wheel->time >> ((level - 1) * ZBX_TIMING_WHEEL_SLOT_BITS)) &
+			ZBX_TIMING_WHEEL_SLOT_MASK) && level < ZBX_TIMING_WHEEL_LEVELS; level++)
+	{
+		if (0 != (wheel->slots_used[level] & ((zbx_uint64_t)1 << ((wheel->time >>
+				(level * ZBX_TIMING_WHEEL_SLOT_BITS)) & ZBX_TIMING_WHEEL_SLOT_MASK))))
+		{
+			*time = wheel->time;
+			return SUCCEED;
+		}
+	}
+
+	if (0 != (used = wheel->slots_used[0] >> index))
+	{
+		for (shift = 0; 0 == (used & 1); shift++)
+			used >>= 1;
+
+		*time = wheel->time + shift;
+		return SUCCEED;
+	}
+
+	*time = (wheel->time | ZBX_TIMING_WHEEL_SLOT_MASK) + 1;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes all elements and resets the wheel time                    *
+ *                                                                            *
+ * Parameters: wheel - [IN] the timing wheel                                  *
+ *             now   - [IN] the new wheel time                                *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_timing_wheel_clear(zbx_timing_wheel_t *wheel, int now)
+{
+	zbx_binary_heap_clear(&wheel->due);
+	zbx_hashset_clear(&wheel->nodes);
+
+	memset(wheel->slots, 0, sizeof(wheel->slots));
+	memset(wheel->slots_used, 0, sizeof(wheel->slots_used));
+	wheel->time = now;
+	wheel->wheel_num = 0;
+}
@@ -2095,7 +2095,22 @@ fail:
  ******************************************************************************/
 int	zbx_custom_interval_is_scheduling(const zbx_custom_interval_t *custom_intervals)
 {
-	return NULL == custom_intervals->scheduling ? FAIL : SUCCEED;
+	return NULL == custom_intervals || NULL == custom_intervals->scheduling ? FAIL : SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: check if custom interval contains flexible interval               *
+ *                                                                            *
+ * Parameters: custom_intervals - [IN] custom intervals                       *
+ *                                                                            *
+ * Return value: SUCCEED if custom interval contains flexible interval        *
+ *               FAIL otherwise                                               *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_custom_interval_is_flexible(const zbx_custom_interval_t *custom_intervals)
+{
+	return NULL == custom_intervals || NULL == custom_intervals->flexible ? FAIL : SUCCEED;
 }
 
 /******************************************************************************
@@ -1317,6 +1317,12 @@ const char	*get_process_type_string(unsigned char proc_type)
 			return "ha manager";
 		case ZBX_PROCESS_TYPE_ODBCPOLLER:
 			return "odbc poller";
+		case ZBX_PROCESS_TYPE_AGENT_POLLER:
+			return "agent poller";
+		case ZBX_PROCESS_TYPE_SNMP_POLLER:
+			return "snmp poller";
+		case ZBX_PROCESS_TYPE_HTTPAGENT_POLLER:
+			return "http agent poller";
 		case ZBX_PROCESS_TYPE_MAIN:
 			return "main";
 	}
@@ -64,18 +64,22 @@ struct zbx_db_result
 #endif
 };
 
-static int	txn_level = 0;	/* transaction level, nested transactions are not supported */
-static int	txn_error = ZBX_DB_OK;	/* failed transaction */
-static int	txn_end_error = ZBX_DB_OK;	/* transaction result */
+/* connection state is kept per thread to allow additional connections from worker threads */
+static ZBX_THREAD_LOCAL int	txn_level = 0;	/* transaction level, nested transactions are not supported */
+static ZBX_THREAD_LOCAL int	txn_error = ZBX_DB_OK;	/* failed transaction */
+static ZBX_THREAD_LOCAL int	txn_end_error = ZBX_DB_OK;	/* transaction result */
 
-static char	*last_db_strerror = NULL;	/* last database error message */
+static ZBX_THREAD_LOCAL char	*last_db_strerror = NULL;	/* last database error message */
 
 extern int	CONFIG_LOG_SLOW_QUERIES;
 
 static int	db_auto_increment;
 
+/* worker threads reuse database settings detected by the main connection of the process */
+static ZBX_THREAD_LOCAL int	db_worker_thread = 0;
+
 #if defined(HAVE_MYSQL)
-static MYSQL			*conn = NULL;
+static ZBX_THREAD_LOCAL MYSQL	*conn = NULL;
 static zbx_uint32_t		ZBX_MYSQL_SVERSION = ZBX_DBVERSION_UNDEFINED;
 static int			ZBX_MARIADB_SFORK = OFF;
 static char			*ZBX_CHARSET = NULL;
@@ -102,7 +106,7 @@ static ub4	OCI_DBserver_status(void);
 #define ORA_ERR_UNIQ_CONSTRAINT	-1
 
 #elif defined(HAVE_POSTGRESQL)
-static PGconn			*conn = NULL;
+static ZBX_THREAD_LOCAL PGconn	*conn = NULL;
 static unsigned int		ZBX_PG_BYTEAOID = 0;
 static int			ZBX_TSDB_VERSION = -1;
 static zbx_uint32_t		ZBX_PG_SVERSION = ZBX_DBVERSION_UNDEFINED;
@@ -116,7 +120,7 @@ static zbx_mutex_t		sqlite_access = ZBX_MUTEX_NULL;
 static void	OCI_DBclean_result(DB_RESULT result);
 #endif
 
-static zbx_err_codes_t last_db_errcode;
+static ZBX_THREAD_LOCAL zbx_err_codes_t	last_db_errcode;
 
 static void	zbx_db_errlog(zbx_err_codes_t zbx_errno, int db_errno, const char *db_error, const char *context)
 {
@@ -366,6 +370,20 @@ void	zbx_db_init_autoincrement_options(void)
 	db_auto_increment = 1;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: marks the calling thread as worker thread of a process which has  *
+ *          already connected to the database                                 *
+ *                                                                            *
+ * Comments: Database settings shared by all connections of the process are   *
+ *           detected by the main connection and are only read by workers.    *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_db_init_worker_options(void)
+{
+	db_worker_thread = 1;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: connect to the database                                           *
@@ -794,17 +812,20 @@ int	zbx_db_connect(char *host, char *user, char *password, char *dbname, char *d
 	if (ZBX_DB_FAIL == ret || ZBX_DB_DOWN == ret)
 		goto out;
 
-	result = zbx_db_select("select oid from pg_type where typname='bytea'");
-
-	if ((DB_RESULT)ZBX_DB_DOWN == result || NULL == result)
+	if (0 == db_worker_thread)
 	{
-		ret = (NULL == result) ? ZBX_DB_FAIL : ZBX_DB_DOWN;
-		goto out;
-	}
+		result = zbx_db_select("select oid from pg_type where typname='bytea'");
 
-	if (NULL != (row = zbx_db_fetch(result)))
-		ZBX_PG_BYTEAOID = atoi(row[0]);
-	DBfree_result(result);
+		if ((DB_RESULT)ZBX_DB_DOWN == result || NULL == result)
+		{
+			ret = (NULL == result) ? ZBX_DB_FAIL : ZBX_DB_DOWN;
+			goto out;
+		}
+
+		if (NULL != (row = zbx_db_fetch(result)))
+			ZBX_PG_BYTEAOID = atoi(row[0]);
+		DBfree_result(result);
+	}
 
 	/* disable "nonstandard use of \' in a string literal" warning */
 	if (0 < (ret = zbx_db_execute("set escape_string_warning to off")))
@@ -820,17 +841,20 @@ int	zbx_db_connect(char *host, char *user, char *password, char *dbname, char *d
 	if (ZBX_DB_OK != ret)
 		goto out;
 
-	result = zbx_db_select("show standard_conforming_strings");
-
-	if ((DB_RESULT)ZBX_DB_DOWN == result || NULL == result)
+	if (0 == db_worker_thread)
 	{
-		ret = (NULL == result) ? ZBX_DB_FAIL : ZBX_DB_DOWN;
-		goto out;
-	}
+		result = zbx_db_select("show standard_conforming_strings");
 
-	if (NULL != (row = zbx_db_fetch(result)))
-		ZBX_PG_ESCAPE_BACKSLASH = (0 == strcmp(row[0], "off"));
-	DBfree_result(result);
+		if ((DB_RESULT)ZBX_DB_DOWN == result || NULL == result)
+		{
+			ret = (NULL == result) ? ZBX_DB_FAIL : ZBX_DB_DOWN;
+			goto out;
+		}
+
+		if (NULL != (row = zbx_db_fetch(result)))
+			ZBX_PG_ESCAPE_BACKSLASH = (0 == strcmp(row[0], "off"));
+		DBfree_result(result);
+	}
 
 	if (90000 <= ZBX_PG_SVERSION)
 	{
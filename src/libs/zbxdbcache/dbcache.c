@@ -33,18 +33,24 @@
 #include "zbxavailability.h"
 #include "zbxtrends.h"
 
+/* History cache is partitioned by itemid into shards. Each shard has its own lock and memory */
+/* segments. The hc_mem and hc_index_mem point to the memory segments of the locked shard.    */
 static zbx_shmem_info_t	*hc_index_mem = NULL;
 static zbx_shmem_info_t	*hc_mem = NULL;
 static zbx_shmem_info_t	*trend_mem = NULL;
 
-#define	LOCK_CACHE	zbx_mutex_lock(cache_lock)
-#define	UNLOCK_CACHE	zbx_mutex_unlock(cache_lock)
+static zbx_shmem_info_t	*hc_shard_index_mem[ZBX_HC_SHARDS_MAX];
+static zbx_shmem_info_t	*hc_shard_mem[ZBX_HC_SHARDS_MAX];
+static zbx_mutex_t	hc_shard_lock[ZBX_HC_SHARDS_MAX];
+
+/* the first shard lock also protects the cache wide data */
+#define	LOCK_CACHE	hc_lock_shard(0)
+#define	UNLOCK_CACHE	hc_unlock_shard(0)
 #define	LOCK_TRENDS	zbx_mutex_lock(trends_lock)
 #define	UNLOCK_TRENDS	zbx_mutex_unlock(trends_lock)
 #define	LOCK_CACHE_IDS		zbx_mutex_lock(cache_ids_lock)
 #define	UNLOCK_CACHE_IDS	zbx_mutex_unlock(cache_ids_lock)
 
-static zbx_mutex_t	cache_lock = ZBX_MUTEX_NULL;
 static zbx_mutex_t	trends_lock = ZBX_MUTEX_NULL;
 static zbx_mutex_t	cache_ids_lock = ZBX_MUTEX_NULL;
 
@@ -61,6 +67,12 @@ extern char		*CONFIG_EXPORT_DIR;
 
 #define ZBX_TRENDS_CLEANUP_TIME	((SEC_PER_HOUR * 55) / 60)
 
+/* the maximum number of trends written by one upsert statement */
+#define ZBX_TRENDS_UPSERT_MAX	1000
+
+/* the minimum free trend cache percentage to keep trends of closed hours for gradual flushing */
+#define ZBX_TRENDS_CLOSED_FREE_PCNT	10
+
 /* the maximum time spent synchronizing history */
 #define ZBX_HC_SYNC_TIME_MAX	10
 
@@ -108,15 +120,27 @@ zbx_hc_proxyqueue_t;
 
 typedef struct
 {
-	zbx_hashset_t		trends;
-	ZBX_DC_STATS		stats;
-
 	zbx_hashset_t		history_items;
 	zbx_binary_heap_t	history_queue;
-
+	zbx_binary_heap_t	trigger_queue;	/* items with written values waiting for trigger recalculation */
+	ZBX_DC_STATS		stats;
 	int			history_num;
+}
+zbx_hc_shard_t;
+
+typedef struct
+{
+	zbx_hashset_t		trends;
+
+	/* trends of closed hours waiting to be flushed during TrendFlushPeriod */
+	zbx_hashset_t		trends_closed;
+
+	zbx_hc_shard_t		*shards[ZBX_HC_SHARDS_MAX];
+	int			shards_num;
+
 	int			trends_num;
 	int			trends_last_cleanup_hour;
+	int			trends_last_flush;
 	int			history_num_total;
 	int			history_progress_ts;
 
@@ -172,14 +196,19 @@ static size_t		string_values_alloc = 0, string_values_offset = 0;
 static dc_item_value_t	*item_values = NULL;
 static size_t		item_values_alloc = 0, item_values_num = 0;
 
+static void	hc_lock_shard(int shard);
+static void	hc_unlock_shard(int shard);
 static void	hc_add_item_values(dc_item_value_t *values, int values_num);
-static void	hc_pop_items(zbx_vector_ptr_t *history_items);
+static void	hc_pop_items(zbx_vector_ptr_t *history_items, unsigned char stage);
 static void	hc_get_item_values(ZBX_DC_HISTORY *history, zbx_vector_ptr_t *history_items);
-static void	hc_push_items(zbx_vector_ptr_t *history_items);
+static void	hc_set_item_flags(const ZBX_DC_HISTORY *history, zbx_vector_ptr_t *history_items);
+static void	hc_push_items(zbx_vector_ptr_t *history_items, unsigned char stages);
 static void	hc_free_item_values(ZBX_DC_HISTORY *history, int history_num);
-static void	hc_queue_item(zbx_hc_item_t *item);
+static void	hc_queue_item(zbx_hc_shard_t *shard, zbx_hc_item_t *item);
 static int	hc_queue_elem_compare_func(const void *d1, const void *d2);
 static int	hc_queue_get_size(void);
+static int	hc_trigger_queue_get_size(void);
+static int	hc_get_history_num(void);
 static int	hc_get_history_compression_age(void);
 
 ZBX_PTR_VECTOR_DECL(item_tag, zbx_tag_t)
@@ -187,30 +216,59 @@ ZBX_PTR_VECTOR_IMPL(item_tag, zbx_tag_t)
 
 ZBX_PTR_VECTOR_IMPL(tags, zbx_tag_t*)
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds history cache shard statistics to the total statistics       *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_stats_add(ZBX_DC_STATS *total, const ZBX_DC_STATS *stats)
+{
+	total->history_counter += stats->history_counter;
+	total->history_float_counter += stats->history_float_counter;
+	total->history_uint_counter += stats->history_uint_counter;
+	total->history_str_counter += stats->history_str_counter;
+	total->history_log_counter += stats->history_log_counter;
+	total->history_text_counter += stats->history_text_counter;
+	total->notsupported_counter += stats->notsupported_counter;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: retrieves all internal metrics of the database cache              *
  *                                                                            *
  * Parameters: stats - [OUT] write cache metrics                              *
  *                                                                            *
+ * Comments: History cache metrics are aggregated from all shards.            *
+ *                                                                            *
  ******************************************************************************/
 void	DCget_stats_all(zbx_wcache_info_t *wcache_info)
 {
-	LOCK_CACHE;
+	int	i;
 
-	wcache_info->stats = cache->stats;
-	wcache_info->history_free = hc_mem->free_size;
-	wcache_info->history_total = hc_mem->total_size;
-	wcache_info->index_free = hc_index_mem->free_size;
-	wcache_info->index_total = hc_index_mem->total_size;
+	memset(wcache_info, 0, sizeof(zbx_wcache_info_t));
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		hc_lock_shard(i);
+
+		hc_stats_add(&wcache_info->stats, &cache->shards[i]->stats);
+		wcache_info->history_free += hc_mem->free_size;
+		wcache_info->history_total += hc_mem->total_size;
+		wcache_info->index_free += hc_index_mem->free_size;
+		wcache_info->index_total += hc_index_mem->total_size;
+
+		hc_unlock_shard(i);
+	}
 
 	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
 	{
+		LOCK_TRENDS;
+
 		wcache_info->trend_free = trend_mem->free_size;
 		wcache_info->trend_total = trend_mem->orig_size;
-	}
 
-	UNLOCK_CACHE;
+		UNLOCK_TRENDS;
+	}
 }
 
 /******************************************************************************
@@ -223,107 +281,107 @@ void	*DCget_stats(int request)
 	static zbx_uint64_t	value_uint;
 	static double		value_double;
 	void			*ret;
+	zbx_wcache_info_t	wcache_info;
 
-	LOCK_CACHE;
+	DCget_stats_all(&wcache_info);
 
 	switch (request)
 	{
 		case ZBX_STATS_HISTORY_COUNTER:
-			value_uint = cache->stats.history_counter;
+			value_uint = wcache_info.stats.history_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_FLOAT_COUNTER:
-			value_uint = cache->stats.history_float_counter;
+			value_uint = wcache_info.stats.history_float_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_UINT_COUNTER:
-			value_uint = cache->stats.history_uint_counter;
+			value_uint = wcache_info.stats.history_uint_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_STR_COUNTER:
-			value_uint = cache->stats.history_str_counter;
+			value_uint = wcache_info.stats.history_str_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_LOG_COUNTER:
-			value_uint = cache->stats.history_log_counter;
+			value_uint = wcache_info.stats.history_log_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_TEXT_COUNTER:
-			value_uint = cache->stats.history_text_counter;
+			value_uint = wcache_info.stats.history_text_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_NOTSUPPORTED_COUNTER:
-			value_uint = cache->stats.notsupported_counter;
+			value_uint = wcache_info.stats.notsupported_counter;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_TOTAL:
-			value_uint = hc_mem->total_size;
+			value_uint = wcache_info.history_total;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_USED:
-			value_uint = hc_mem->total_size - hc_mem->free_size;
+			value_uint = wcache_info.history_total - wcache_info.history_free;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_FREE:
-			value_uint = hc_mem->free_size;
+			value_uint = wcache_info.history_free;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_PUSED:
-			value_double = 100 * (double)(hc_mem->total_size - hc_mem->free_size) / hc_mem->total_size;
+			value_double = 100 * (double)(wcache_info.history_total - wcache_info.history_free) /
+					wcache_info.history_total;
 			ret = (void *)&value_double;
 			break;
 		case ZBX_STATS_HISTORY_PFREE:
-			value_double = 100 * (double)hc_mem->free_size / hc_mem->total_size;
+			value_double = 100 * (double)wcache_info.history_free / wcache_info.history_total;
 			ret = (void *)&value_double;
 			break;
 		case ZBX_STATS_TREND_TOTAL:
-			value_uint = trend_mem->orig_size;
+			value_uint = wcache_info.trend_total;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_TREND_USED:
-			value_uint = trend_mem->orig_size - trend_mem->free_size;
+			value_uint = wcache_info.trend_total - wcache_info.trend_free;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_TREND_FREE:
-			value_uint = trend_mem->free_size;
+			value_uint = wcache_info.trend_free;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_TREND_PUSED:
-			value_double = 100 * (double)(trend_mem->orig_size - trend_mem->free_size) /
-					trend_mem->orig_size;
+			value_double = 100 * (double)(wcache_info.trend_total - wcache_info.trend_free) /
+					wcache_info.trend_total;
 			ret = (void *)&value_double;
 			break;
 		case ZBX_STATS_TREND_PFREE:
-			value_double = 100 * (double)trend_mem->free_size / trend_mem->orig_size;
+			value_double = 100 * (double)wcache_info.trend_free / wcache_info.trend_total;
 			ret = (void *)&value_double;
 			break;
 		case ZBX_STATS_HISTORY_INDEX_TOTAL:
-			value_uint = hc_index_mem->total_size;
+			value_uint = wcache_info.index_total;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_INDEX_USED:
-			value_uint = hc_index_mem->total_size - hc_index_mem->free_size;
+			value_uint = wcache_info.index_total - wcache_info.index_free;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_INDEX_FREE:
-			value_uint = hc_index_mem->free_size;
+			value_uint = wcache_info.index_free;
 			ret = (void *)&value_uint;
 			break;
 		case ZBX_STATS_HISTORY_INDEX_PUSED:
-			value_double = 100 * (double)(hc_index_mem->total_size - hc_index_mem->free_size) /
-					hc_index_mem->total_size;
+			value_double = 100 * (double)(wcache_info.index_total - wcache_info.index_free) /
+					wcache_info.index_total;
 			ret = (void *)&value_double;
 			break;
 		case ZBX_STATS_HISTORY_INDEX_PFREE:
-			value_double = 100 * (double)hc_index_mem->free_size / hc_index_mem->total_size;
+			value_double = 100 * (double)wcache_info.index_free / wcache_info.index_total;
 			ret = (void *)&value_double;
 			break;
 		default:
 			ret = NULL;
 	}
 
-	UNLOCK_CACHE;
-
 	return ret;
 }
 
@@ -637,6 +695,105 @@ static void	dc_trends_fetch_and_update(ZBX_DC_TREND *trends, int trends_num, zbx
 		DBexecute("%s", sql);
 }
 
+#if defined(HAVE_POSTGRESQL) || defined(HAVE_MYSQL)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: insert trends into database, merging them with existing trends of *
+ *          the same hour                                                     *
+ *                                                                            *
+ * Parameters: trends     - [IN] the trends sorted by itemid, clock           *
+ *             trends_num - [IN] the number of trends                         *
+ *             value_type - [IN] the value type of trends to write            *
+ *             table_name - [IN] the trends table name                        *
+ *                                                                            *
+ * Comments: Uses native upsert statements instead of reading existing trends *
+ *           and updating them with separate statements.                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_upsert_trends_in_db(const ZBX_DC_TREND *trends, int trends_num, unsigned char value_type,
+		const char *table_name)
+{
+	const ZBX_DC_TREND	*trend, *last = NULL;
+	int			i, rows_num = 0;
+	size_t			sql_offset = 0;
+	char			*sql_update = NULL;
+	size_t			sql_update_alloc = 0, sql_update_offset = 0;
+
+#if defined(HAVE_POSTGRESQL)
+	zbx_snprintf_alloc(&sql_update, &sql_update_alloc, &sql_update_offset,
+			" on conflict (itemid,clock) do update set"
+			" value_min=least(%s.value_min,excluded.value_min),"
+			"value_avg=(%s.value_avg*%s.num+excluded.value_avg*excluded.num)/(%s.num+excluded.num),"
+			"value_max=greatest(%s.value_max,excluded.value_max),"
+			"num=%s.num+excluded.num",
+			table_name, table_name, table_name, table_name, table_name, table_name);
+#else
+	/* the columns are updated in the specified order, so the number of values must be updated last */
+	zbx_snprintf_alloc(&sql_update, &sql_update_alloc, &sql_update_offset,
+			" on duplicate key update"
+			" value_min=least(value_min,values(value_min)),"
+			"value_avg=(%s*num+values(value_avg)*values(num))/(num+values(num)),"
+			"value_max=greatest(value_max,values(value_max)),"
+			"num=num+values(num)",
+			ITEM_VALUE_TYPE_FLOAT == value_type ? "value_avg" : "cast(value_avg as decimal(20,0))");
+#endif
+	for (i = 0; i < trends_num; i++)
+	{
+		trend = &trends[i];
+
+		if (value_type != trend->value_type)
+			continue;
+
+		/* the same row cannot be updated twice by one statement */
+		if (ZBX_TRENDS_UPSERT_MAX == rows_num || (NULL != last && last->itemid == trend->itemid &&
+				last->clock == trend->clock))
+		{
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, sql_update);
+			DBexecute("%s", sql);
+			rows_num = 0;
+		}
+
+		if (0 == rows_num)
+		{
+			sql_offset = 0;
+			zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "insert into %s"
+					" (itemid,clock,num,value_min,value_avg,value_max) values ", table_name);
+		}
+		else
+			zbx_chrcpy_alloc(&sql, &sql_alloc, &sql_offset, ',');
+
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+		{
+			zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "(" ZBX_FS_UI64 ",%d,%d," ZBX_FS_DBL64_SQL ","
+					ZBX_FS_DBL64_SQL "," ZBX_FS_DBL64_SQL ")", trend->itemid, trend->clock,
+					trend->num, trend->value_min.dbl, trend->value_avg.dbl, trend->value_max.dbl);
+		}
+		else
+		{
+			zbx_uint128_t	avg;
+
+			/* calculate the trend average value */
+			zbx_udiv128_64(&avg, &trend->value_avg.ui64, trend->num);
+
+			zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "(" ZBX_FS_UI64 ",%d,%d," ZBX_FS_UI64 ","
+					ZBX_FS_UI64 "," ZBX_FS_UI64 ")", trend->itemid, trend->clock, trend->num,
+					trend->value_min.ui64, avg.lo, trend->value_max.ui64);
+		}
+
+		last = trend;
+		rows_num++;
+	}
+
+	if (0 != rows_num)
+	{
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, sql_update);
+		DBexecute("%s", sql);
+	}
+
+	zbx_free(sql_update);
+}
+#endif
+
 /******************************************************************************
  *                                                                            *
  * Purpose: flush trend to the database                                       *
@@ -757,6 +914,20 @@ static void	DBflush_trends(ZBX_DC_TREND *trends, int *trends_num, zbx_vector_uin
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reset trend values                                                *
+ *                                                                            *
+ ******************************************************************************/
+static void	DCreset_trend(ZBX_DC_TREND *trend)
+{
+	trend->clock = 0;
+	trend->num = 0;
+	memset(&trend->value_min, 0, sizeof(history_value_t));
+	memset(&trend->value_avg, 0, sizeof(value_avg_t));
+	memset(&trend->value_max, 0, sizeof(history_value_t));
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: move trend to the array of trends for flushing to DB              *
@@ -773,11 +944,88 @@ static void	DCflush_trend(ZBX_DC_TREND *trend, ZBX_DC_TREND **trends, int *trend
 	memcpy(&(*trends)[*trends_num], trend, sizeof(ZBX_DC_TREND));
 	(*trends_num)++;
 
-	trend->clock = 0;
-	trend->num = 0;
-	memset(&trend->value_min, 0, sizeof(history_value_t));
-	memset(&trend->value_avg, 0, sizeof(value_avg_t));
-	memset(&trend->value_max, 0, sizeof(history_value_t));
+	DCreset_trend(trend);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: move trend of closed hour to the closed trends to be flushed      *
+ *          gradually during TrendFlushPeriod                                 *
+ *                                                                            *
+ * Comments: The trend is moved to the array of trends for flushing to DB if  *
+ *           gradual flushing is disabled or trend cache is running low on    *
+ *           free memory. The previous closed trend of the same item is moved *
+ *           to the array of trends for flushing to DB.                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	DCclose_trend(ZBX_DC_TREND *trend, ZBX_DC_TREND **trends, int *trends_alloc, int *trends_num)
+{
+	ZBX_DC_TREND	*closed;
+
+	if (0 == CONFIG_TRENDS_FLUSH_PERIOD ||
+			trend_mem->free_size * 100 < trend_mem->orig_size * ZBX_TRENDS_CLOSED_FREE_PCNT)
+	{
+		DCflush_trend(trend, trends, trends_alloc, trends_num);
+		return;
+	}
+
+	if (NULL == (closed = (ZBX_DC_TREND *)zbx_hashset_search(&cache->trends_closed, &trend->itemid)))
+		closed = (ZBX_DC_TREND *)zbx_hashset_insert(&cache->trends_closed, trend, sizeof(ZBX_DC_TREND));
+	else
+		DCflush_trend(closed, trends, trends_alloc, trends_num);
+
+	memcpy(closed, trend, sizeof(ZBX_DC_TREND));
+	DCreset_trend(trend);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: move part of closed trends to the array of trends for flushing to *
+ *          DB so that all closed trends are flushed until TrendFlushPeriod   *
+ *          seconds past the hour                                             *
+ *                                                                            *
+ * Parameters: now          - [IN] the current time                           *
+ *             trends       - [IN/OUT] the array of trends to flush           *
+ *             trends_alloc - [IN/OUT] the allocated size of trends array     *
+ *             trends_num   - [IN/OUT] the number of trends to flush          *
+ *                                                                            *
+ * Comments: The number of flushed trends is proportional to the time passed  *
+ *           since the last flush, spreading the remaining closed trends      *
+ *           evenly over the remaining flush period.                          *
+ *                                                                            *
+ ******************************************************************************/
+static void	DCflush_closed_trends(int now, ZBX_DC_TREND **trends, int *trends_alloc, int *trends_num)
+{
+	zbx_hashset_iter_t	iter;
+	ZBX_DC_TREND		*trend;
+	int			hour, flush_end, last_flush, num;
+
+	hour = now - now % SEC_PER_HOUR;
+	flush_end = hour + CONFIG_TRENDS_FLUSH_PERIOD;
+
+	if (now < flush_end)
+	{
+		if ((last_flush = cache->trends_last_flush) < hour)
+			last_flush = hour;
+
+		num = (int)((zbx_uint64_t)cache->trends_closed.num_data * (zbx_uint64_t)(now - last_flush) /
+				(zbx_uint64_t)(flush_end - last_flush));
+	}
+	else
+		num = cache->trends_closed.num_data;
+
+	if (0 == num)
+		return;
+
+	cache->trends_last_flush = now;
+
+	zbx_hashset_iter_reset(&cache->trends_closed, &iter);
+
+	while (0 < num-- && NULL != (trend = (ZBX_DC_TREND *)zbx_hashset_iter_next(&iter)))
+	{
+		DCflush_trend(trend, trends, trends_alloc, trends_num);
+		zbx_hashset_iter_remove(&iter);
+	}
 }
 
 /******************************************************************************
@@ -797,7 +1045,7 @@ static void	DCadd_trend(const ZBX_DC_HISTORY *history, ZBX_DC_TREND **trends, in
 	if (trend->num > 0 && (trend->clock != hour || trend->value_type != history->value_type) &&
 			SUCCEED == zbx_history_requires_trends(trend->value_type))
 	{
-		DCflush_trend(trend, trends, trends_alloc, trends_num);
+		DCclose_trend(trend, trends, trends_alloc, trends_num);
 	}
 
 	trend->value_type = history->value_type;
@@ -891,6 +1139,9 @@ static void	DCmass_update_trends(const ZBX_DC_HISTORY *history, int history_num,
 		cache->trends_last_cleanup_hour = hour;
 	}
 
+	if (0 != cache->trends_closed.num_data)
+		DCflush_closed_trends(ts.sec, trends, &trends_alloc, trends_num);
+
 	UNLOCK_TRENDS;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
@@ -927,6 +1178,14 @@ static void	DBmass_update_trends(const ZBX_DC_TREND *trends, int trends_num,
 		memcpy(trends_tmp, trends, trends_num * sizeof(ZBX_DC_TREND));
 		qsort(trends_tmp, trends_num, sizeof(ZBX_DC_TREND), zbx_trend_compare);
 
+#if defined(HAVE_POSTGRESQL) || defined(HAVE_MYSQL)
+		if (0 != CONFIG_TRENDS_FLUSH_PERIOD)
+		{
+			dc_upsert_trends_in_db(trends_tmp, trends_num, ITEM_VALUE_TYPE_FLOAT, "trends");
+			dc_upsert_trends_in_db(trends_tmp, trends_num, ITEM_VALUE_TYPE_UINT64, "trends_uint");
+			trends_num = 0;
+		}
+#endif
 		while (0 < trends_num)
 			DBflush_trends(trends_tmp, &trends_num, trends_diff);
 
@@ -1510,6 +1769,16 @@ static void	DCsync_trends(void)
 			DCflush_trend(trend, &trends, &trends_alloc, &trends_num);
 	}
 
+	zbx_hashset_iter_reset(&cache->trends_closed, &iter);
+
+	while (NULL != (trend = (ZBX_DC_TREND *)zbx_hashset_iter_next(&iter)))
+	{
+		if (trend->clock >= compression_age)
+			DCflush_trend(trend, &trends, &trends_alloc, &trends_num);
+
+		zbx_hashset_iter_remove(&iter);
+	}
+
 	UNLOCK_TRENDS;
 
 	if (SUCCEED == zbx_is_export_enabled(ZBX_FLAG_EXPTYPE_TRENDS) && 0 != trends_num)
@@ -2998,13 +3267,10 @@ static void	sync_proxy_history(int *total_num, int *more)
 	{
 		*more = ZBX_SYNC_DONE;
 
-		LOCK_CACHE;
-
-		hc_pop_items(&history_items);		/* select and take items out of history cache */
+		/* select and take items out of history cache */
+		hc_pop_items(&history_items, ZBX_HC_ITEM_STAGE_HISTORY);
 		history_num = history_items.values_num;
 
-		UNLOCK_CACHE;
-
 		if (0 == history_num)
 			break;
 
@@ -3022,31 +3288,22 @@ static void	sync_proxy_history(int *total_num, int *more)
 		}
 		while (ZBX_DB_DOWN == (txn_rc = DBcommit()));
 
-		LOCK_CACHE;
-
-		hc_push_items(&history_items);	/* return items to history cache */
+		hc_push_items(&history_items, ZBX_SYNC_STAGE_ALL);	/* return items to history cache */
 
 		if (ZBX_DB_FAIL != txn_rc)
 		{
 			if (0 != item_diff.values_num)
 				DCconfig_items_apply_changes(&item_diff);
 
-			cache->history_num -= history_num;
-
 			if (0 != hc_queue_get_size())
 				*more = ZBX_SYNC_MORE;
 
-			UNLOCK_CACHE;
-
 			*total_num += history_num;
 
 			hc_free_item_values(history, history_num);
 		}
 		else
-		{
 			*more = ZBX_SYNC_MORE;
-			UNLOCK_CACHE;
-		}
 
 		zbx_vector_ptr_clear(&history_items);
 		zbx_vector_ptr_clear_ext(&item_diff, zbx_default_mem_free_func);
@@ -3066,8 +3323,15 @@ static void	sync_proxy_history(int *total_num, int *more)
  * Purpose: flush history cache to database, process triggers of flushed      *
  *          and timer triggers from timer queue                               *
  *                                                                            *
- * Parameters: sync_timeout - [IN] the timeout in seconds                     *
- *             values_num   - [IN/OUT] the number of synced values            *
+ * Parameters: stages       - [IN] the synchronization stages to perform:     *
+ *                               ZBX_SYNC_STAGE_HISTORY  - write values to    *
+ *                                     history storage                        *
+ *                               ZBX_SYNC_STAGE_TRIGGERS - recalculate        *
+ *                                     triggers of written values and timer   *
+ *                                     triggers                               *
+ *                               ZBX_SYNC_STAGE_ALL      - both stages        *
+ *             values_num   - [IN/OUT] the number of values written to        *
+ *                                     history storage                        *
  *             triggers_num - [IN/OUT] the number of processed timers         *
  *             more         - [OUT] a flag indicating the cache emptiness:    *
  *                               ZBX_SYNC_DONE - nothing to sync, go idle     *
@@ -3075,6 +3339,13 @@ static void	sync_proxy_history(int *total_num, int *more)
  *                                                                            *
  * Comments: This function loops syncing history values by 1k batches and     *
  *           processing timer triggers by batches of 500 triggers.            *
+ *           In pipelined mode the history stage and triggers stage are done  *
+ *           by different history syncers. Values written by the history     *
+ *           stage are passed to the triggers stage through the history cache *
+ *           trigger queue, so while one syncer waits for history storage to  *
+ *           write a batch, other syncers recalculate triggers of previously  *
+ *           written batches. An item is held by one stage at a time, keeping *
+ *           its values written and processed by triggers in order.           *
  *           Unless full sync is being done the loop is aborted if either     *
  *           timeout has passed or there are no more data to process.         *
  *           The last is assumed when the following is true:                  *
@@ -3083,7 +3354,7 @@ static void	sync_proxy_history(int *total_num, int *more)
  *            b) less than 500 (full batch) timer triggers were processed     *
  *                                                                            *
  ******************************************************************************/
-static void	sync_server_history(int *values_num, int *triggers_num, int *more)
+static void	sync_server_history(unsigned char stages, int *values_num, int *triggers_num, int *more)
 {
 	static ZBX_HISTORY_FLOAT	*history_float;
 	static ZBX_HISTORY_INTEGER	*history_integer;
@@ -3161,17 +3432,21 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 
 		*more = ZBX_SYNC_DONE;
 
-		LOCK_CACHE;
-		hc_pop_items(&history_items);		/* select and take items out of history cache */
-		UNLOCK_CACHE;
+		/* select and take items out of history cache */
+		hc_pop_items(&history_items, 0 != (stages & ZBX_SYNC_STAGE_HISTORY) ? ZBX_HC_ITEM_STAGE_HISTORY :
+				ZBX_HC_ITEM_STAGE_TRIGGERS);
 
 		if (0 != history_items.values_num)
 		{
-			if (0 == (history_num = DCconfig_lock_triggers_by_history_items(&history_items, &triggerids)))
+			/* triggers are not locked when only writing history, all items are available */
+			if (0 == (stages & ZBX_SYNC_STAGE_TRIGGERS))
 			{
-				LOCK_CACHE;
-				hc_push_items(&history_items);
-				UNLOCK_CACHE;
+				history_num = history_items.values_num;
+			}
+			else if (0 == (history_num = DCconfig_lock_triggers_by_history_items(&history_items,
+					&triggerids)))
+			{
+				hc_push_items(&history_items, stages);
 				zbx_vector_ptr_clear(&history_items);
 			}
 		}
@@ -3194,10 +3469,17 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 
 			DCconfig_get_items_by_itemids_partial(items, itemids.values, errcodes, history_num,
 					item_retrieve_mode);
+		}
 
+		if (0 != history_num && 0 != (stages & ZBX_SYNC_STAGE_HISTORY))
+		{
 			DCmass_prepare_history(history, &itemids, items, errcodes, history_num, &item_diff,
 					&inventory_values, compression_age, &proxy_subscribtions);
 
+			/* keep undefined and no history flags for recalculating triggers in the triggers stage */
+			if (0 == (stages & ZBX_SYNC_STAGE_TRIGGERS))
+				hc_set_item_flags(history, &history_items);
+
 			if (FAIL != (ret = DBmass_add_history(history, history_num)))
 			{
 				DCconfig_items_apply_changes(&item_diff);
@@ -3232,7 +3514,7 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 			zbx_vector_ptr_clear_ext(&item_diff, (zbx_clean_func_t)zbx_ptr_free);
 		}
 
-		if (FAIL != ret)
+		if (FAIL != ret && 0 != (stages & ZBX_SYNC_STAGE_TRIGGERS))
 		{
 			/* don't process trigger timers when server is shutting down */
 			if (ZBX_IS_RUNNING())
@@ -3304,9 +3586,8 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 
 		if (0 != history_num)
 		{
-			LOCK_CACHE;
-			hc_push_items(&history_items);	/* return items to history cache */
-			cache->history_num -= history_num;
+			/* values that failed to be written are dropped without recalculating triggers */
+			hc_push_items(&history_items, FAIL == ret ? ZBX_SYNC_STAGE_ALL : stages);
 
 			if (0 != hc_queue_get_size())
 			{
@@ -3319,14 +3600,14 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
 					*more = ZBX_SYNC_MORE;
 			}
 
-			UNLOCK_CACHE;
-
-			*values_num += history_num;
+			/* values are counted once, when written to history storage */
+			if (0 != (stages & ZBX_SYNC_STAGE_HISTORY))
+				*values_num += history_num;
 		}
 
 		if (FAIL != ret)
 		{
-			if (0 != history_num)
+			if (0 != history_num && 0 != (stages & ZBX_SYNC_STAGE_HISTORY))
 			{
 				const ZBX_DC_HISTORY	*phistory = NULL;
 				const ZBX_DC_TREND	*ptrends = NULL;
@@ -3408,16 +3689,16 @@ static void	sync_server_history(int *values_num, int *triggers_num, int *more)
  ******************************************************************************/
 static void	sync_history_cache_full(void)
 {
-	int			values_num = 0, triggers_num = 0, more;
+	int			i, values_num = 0, triggers_num = 0, more;
 	zbx_hashset_iter_t	iter;
 	zbx_hc_item_t		*item;
-	zbx_binary_heap_t	tmp_history_queue;
+	zbx_binary_heap_t	tmp_history_queue[ZBX_HC_SHARDS_MAX], tmp_trigger_queue[ZBX_HC_SHARDS_MAX];
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() history_num:%d", __func__, cache->history_num);
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() history_num:%d", __func__, hc_get_history_num());
 
 	/* History index cache might be full without any space left for queueing items from history index to  */
-	/* history queue. The solution: replace the shared-memory history queue with heap-allocated one. Add  */
-	/* all items from history index to the new history queue.                                             */
+	/* history queue. The solution: replace the shared-memory history queues of all shards with           */
+	/* heap-allocated ones. Add all items from history index to the new history queues.                   */
 	/*                                                                                                    */
 	/* Assertions that must be true.                                                                      */
 	/*   * This is the main server or proxy process,                                                      */
@@ -3432,18 +3713,27 @@ static void	sync_history_cache_full(void)
 		DCconfig_unlock_all_triggers();
 	}
 
-	tmp_history_queue = cache->history_queue;
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_hc_shard_t	*shard = cache->shards[i];
 
-	zbx_binary_heap_create(&cache->history_queue, hc_queue_elem_compare_func, ZBX_BINARY_HEAP_OPTION_EMPTY);
-	zbx_hashset_iter_reset(&cache->history_items, &iter);
+		tmp_history_queue[i] = shard->history_queue;
+		tmp_trigger_queue[i] = shard->trigger_queue;
 
-	/* add all items from history index to the new history queue */
-	while (NULL != (item = (zbx_hc_item_t *)zbx_hashset_iter_next(&iter)))
-	{
-		if (NULL != item->tail)
+		zbx_binary_heap_create(&shard->history_queue, hc_queue_elem_compare_func,
+				ZBX_BINARY_HEAP_OPTION_EMPTY);
+		zbx_binary_heap_create(&shard->trigger_queue, hc_queue_elem_compare_func,
+				ZBX_BINARY_HEAP_OPTION_EMPTY);
+		zbx_hashset_iter_reset(&shard->history_items, &iter);
+
+		/* add all items from history index to the new history and trigger queues */
+		while (NULL != (item = (zbx_hc_item_t *)zbx_hashset_iter_next(&iter)))
 		{
-			item->status = ZBX_HC_ITEM_STATUS_NORMAL;
-			hc_queue_item(item);
+			if (NULL != item->tail)
+			{
+				item->status = ZBX_HC_ITEM_STATUS_NORMAL;
+				hc_queue_item(shard, item);
+			}
 		}
 	}
 
@@ -3454,20 +3744,31 @@ static void	sync_history_cache_full(void)
 		do
 		{
 			if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
-				sync_server_history(&values_num, &triggers_num, &more);
+			{
+				/* finish values already written by pipelined history sync before syncing the rest */
+				if (0 != hc_trigger_queue_get_size())
+					sync_server_history(ZBX_SYNC_STAGE_TRIGGERS, &values_num, &triggers_num, &more);
+				else
+					sync_server_history(ZBX_SYNC_STAGE_ALL, &values_num, &triggers_num, &more);
+			}
 			else
 				sync_proxy_history(&values_num, &more);
 
 			zabbix_log(LOG_LEVEL_WARNING, "syncing history data... " ZBX_FS_DBL "%%",
-					(double)values_num / (cache->history_num + values_num) * 100);
+					(double)values_num / (hc_get_history_num() + values_num) * 100);
 		}
 		while (0 != hc_queue_get_size());
 
 		zabbix_log(LOG_LEVEL_WARNING, "syncing history data done");
 	}
 
-	zbx_binary_heap_destroy(&cache->history_queue);
-	cache->history_queue = tmp_history_queue;
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		zbx_binary_heap_destroy(&cache->shards[i]->history_queue);
+		cache->shards[i]->history_queue = tmp_history_queue[i];
+		zbx_binary_heap_destroy(&cache->shards[i]->trigger_queue);
+		cache->shards[i]->trigger_queue = tmp_trigger_queue[i];
+	}
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
@@ -3480,7 +3781,9 @@ static void	sync_history_cache_full(void)
 void	zbx_log_sync_history_cache_progress(void)
 {
 	double		pcnt = -1.0;
-	int		ts_last, ts_next, sec;
+	int		ts_last, ts_next, sec, history_num;
+
+	history_num = hc_get_history_num();
 
 	LOCK_CACHE;
 
@@ -3495,16 +3798,16 @@ void	zbx_log_sync_history_cache_progress(void)
 
 	if (0 == cache->history_progress_ts)
 	{
-		cache->history_num_total = cache->history_num;
+		cache->history_num_total = history_num;
 		cache->history_progress_ts = sec;
 	}
 
-	if (ZBX_HC_SYNC_TIME_MAX <= sec - cache->history_progress_ts || 0 == cache->history_num)
+	if (ZBX_HC_SYNC_TIME_MAX <= sec - cache->history_progress_ts || 0 == history_num)
 	{
 		if (0 != cache->history_num_total)
-			pcnt = 100 * (double)(cache->history_num_total - cache->history_num) / cache->history_num_total;
+			pcnt = 100 * (double)(cache->history_num_total - history_num) / cache->history_num_total;
 
-		cache->history_progress_ts = (0 == cache->history_num ? INT_MAX : sec);
+		cache->history_progress_ts = (0 == history_num ? INT_MAX : sec);
 	}
 
 	ts_next = cache->history_progress_ts;
@@ -3525,21 +3828,23 @@ void	zbx_log_sync_history_cache_progress(void)
  *                                                                            *
  * Purpose: writes updates and new data from history cache to database        *
  *                                                                            *
- * Parameters: values_num - [OUT] the number of synced values                  *
- *             more      - [OUT] a flag indicating the cache emptiness:       *
+ * Parameters: stages     - [IN] the synchronization stages to perform (see   *
+ *                               ZBX_SYNC_STAGE_* defines), ignored by proxy  *
+ *             values_num - [OUT] the number of synced values                 *
+ *             more       - [OUT] a flag indicating the cache emptiness:      *
  *                                ZBX_SYNC_DONE - nothing to sync, go idle    *
  *                                ZBX_SYNC_MORE - more data to sync           *
  *                                                                            *
  ******************************************************************************/
-void	zbx_sync_history_cache(int *values_num, int *triggers_num, int *more)
+void	zbx_sync_history_cache(unsigned char stages, int *values_num, int *triggers_num, int *more)
 {
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() history_num:%d", __func__, cache->history_num);
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() stages:0x%x", __func__, (unsigned int)stages);
 
 	*values_num = 0;
 	*triggers_num = 0;
 
 	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
-		sync_server_history(values_num, triggers_num, more);
+		sync_server_history(stages, values_num, triggers_num, more);
 	else
 		sync_proxy_history(values_num, more);
 }
@@ -3897,14 +4202,8 @@ void	dc_flush_history(void)
 	if (0 == item_values_num)
 		return;
 
-	LOCK_CACHE;
-
 	hc_add_item_values(item_values, item_values_num);
 
-	cache->history_num += item_values_num;
-
-	UNLOCK_CACHE;
-
 	item_values_num = 0;
 	string_values_offset = 0;
 }
@@ -3917,6 +4216,50 @@ void	dc_flush_history(void)
 ZBX_SHMEM_FUNC_IMPL(__hc_index, hc_index_mem)
 ZBX_SHMEM_FUNC_IMPL(__hc, hc_mem)
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: locks history cache shard and selects its memory for allocations  *
+ *                                                                            *
+ * Parameters: shard - [IN] the shard index                                   *
+ *                                                                            *
+ * Comments: History cache shard locks must not be nested.                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_lock_shard(int shard)
+{
+	zbx_mutex_lock(hc_shard_lock[shard]);
+
+	hc_mem = hc_shard_mem[shard];
+	hc_index_mem = hc_shard_index_mem[shard];
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: unlocks history cache shard                                       *
+ *                                                                            *
+ * Parameters: shard - [IN] the shard index                                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_unlock_shard(int shard)
+{
+	zbx_mutex_unlock(hc_shard_lock[shard]);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns index of the history cache shard owning the item          *
+ *                                                                            *
+ * Parameters: itemid - [IN] the item id                                      *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_get_shard(zbx_uint64_t itemid)
+{
+	if (1 == cache->shards_num)
+		return 0;
+
+	return (int)(ZBX_DEFAULT_UINT64_HASH_FUNC(&itemid) % (zbx_hash_t)cache->shards_num);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: compares history queue elements                                   *
@@ -3974,48 +4317,65 @@ static void	hc_free_data(zbx_hc_data_t *data)
 
 /******************************************************************************
  *                                                                            *
- * Purpose: put back item into history queue                                  *
+ * Purpose: returns history cache shard queue of the specified sync stage     *
  *                                                                            *
- * Parameters: data - [IN] history item data                                  *
+ * Parameters: shard - [IN] the history cache shard                           *
+ *             stage - [IN] the item sync stage (ZBX_HC_ITEM_STAGE_*)         *
  *                                                                            *
  ******************************************************************************/
-static void	hc_queue_item(zbx_hc_item_t *item)
+static zbx_binary_heap_t	*hc_get_queue(zbx_hc_shard_t *shard, unsigned char stage)
+{
+	return ZBX_HC_ITEM_STAGE_TRIGGERS == stage ? &shard->trigger_queue : &shard->history_queue;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: put back item into history or trigger queue depending on its      *
+ *          sync stage                                                        *
+ *                                                                            *
+ * Parameters: shard - [IN] the history cache shard                           *
+ *             item  - [IN] history item                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_queue_item(zbx_hc_shard_t *shard, zbx_hc_item_t *item)
 {
 	zbx_binary_heap_elem_t	elem = {item->itemid, (const void *)item};
 
-	zbx_binary_heap_insert(&cache->history_queue, &elem);
+	zbx_binary_heap_insert(hc_get_queue(shard, item->stage), &elem);
 }
 
 /******************************************************************************
  *                                                                            *
  * Purpose: returns history item by itemid                                    *
  *                                                                            *
- * Parameters: itemid - [IN] the item id                                      *
+ * Parameters: shard  - [IN] the history cache shard                          *
+ *             itemid - [IN] the item id                                      *
  *                                                                            *
  * Return value: the history item or NULL if the requested item is not in     *
  *               history cache                                                *
  *                                                                            *
  ******************************************************************************/
-static zbx_hc_item_t	*hc_get_item(zbx_uint64_t itemid)
+static zbx_hc_item_t	*hc_get_item(zbx_hc_shard_t *shard, zbx_uint64_t itemid)
 {
-	return (zbx_hc_item_t *)zbx_hashset_search(&cache->history_items, &itemid);
+	return (zbx_hc_item_t *)zbx_hashset_search(&shard->history_items, &itemid);
 }
 
 /******************************************************************************
  *                                                                            *
  * Purpose: adds a new item to history cache                                  *
  *                                                                            *
- * Parameters: itemid - [IN] the item id                                      *
- *                      [IN] the item data                                    *
+ * Parameters: shard  - [IN] the history cache shard                          *
+ *             itemid - [IN] the item id                                      *
+ *             data   - [IN] the item data                                    *
  *                                                                            *
  * Return value: the added history item                                       *
  *                                                                            *
  ******************************************************************************/
-static zbx_hc_item_t	*hc_add_item(zbx_uint64_t itemid, zbx_hc_data_t *data)
+static zbx_hc_item_t	*hc_add_item(zbx_hc_shard_t *shard, zbx_uint64_t itemid, zbx_hc_data_t *data)
 {
-	zbx_hc_item_t	item_local = {itemid, ZBX_HC_ITEM_STATUS_NORMAL, 0, data, data};
+	zbx_hc_item_t	item_local = {itemid, ZBX_HC_ITEM_STATUS_NORMAL, ZBX_HC_ITEM_STAGE_HISTORY, 0, data, data};
 
-	return (zbx_hc_item_t *)zbx_hashset_insert(&cache->history_items, &item_local, sizeof(item_local));
+	return (zbx_hc_item_t *)zbx_hashset_insert(&shard->history_items, &item_local, sizeof(item_local));
 }
 
 /******************************************************************************
@@ -4112,7 +4472,8 @@ static int	hc_clone_history_log_data(zbx_log_value_t **dst, const dc_item_value_
  *                                                                            *
  * Purpose: clones item value from local cache into history cache             *
  *                                                                            *
- * Parameters: data       - [IN/OUT] a reference to the cloned value          *
+ * Parameters: stats      - [IN/OUT] the history cache shard statistics       *
+ *             data       - [IN/OUT] a reference to the cloned value          *
  *             item_value - [IN] the item value                               *
  *                                                                            *
  * Return value: SUCCESS - the item value was cloned successfully             *
@@ -4122,7 +4483,7 @@ static int	hc_clone_history_log_data(zbx_log_value_t **dst, const dc_item_value_
  *           until it finishes cloning item value.                            *
  *                                                                            *
  ******************************************************************************/
-static int	hc_clone_history_data(zbx_hc_data_t **data, const dc_item_value_t *item_value)
+static int	hc_clone_history_data(ZBX_DC_STATS *stats, zbx_hc_data_t **data, const dc_item_value_t *item_value)
 {
 	if (NULL == *data)
 	{
@@ -4148,7 +4509,7 @@ static int	hc_clone_history_data(zbx_hc_data_t **data, const dc_item_value_t *it
 			return FAIL;
 
 		(*data)->value_type = item_value->value_type;
-		cache->stats.notsupported_counter++;
+		stats->notsupported_counter++;
 
 		return SUCCEED;
 	}
@@ -4160,8 +4521,8 @@ static int	hc_clone_history_data(zbx_hc_data_t **data, const dc_item_value_t *it
 
 		(*data)->value_type = ITEM_VALUE_TYPE_TEXT;
 
-		cache->stats.history_text_counter++;
-		cache->stats.history_counter++;
+		stats->history_text_counter++;
+		stats->history_counter++;
 
 		return SUCCEED;
 	}
@@ -4199,23 +4560,23 @@ static int	hc_clone_history_data(zbx_hc_data_t **data, const dc_item_value_t *it
 		switch (item_value->item_value_type)
 		{
 			case ITEM_VALUE_TYPE_FLOAT:
-				cache->stats.history_float_counter++;
+				stats->history_float_counter++;
 				break;
 			case ITEM_VALUE_TYPE_UINT64:
-				cache->stats.history_uint_counter++;
+				stats->history_uint_counter++;
 				break;
 			case ITEM_VALUE_TYPE_STR:
-				cache->stats.history_str_counter++;
+				stats->history_str_counter++;
 				break;
 			case ITEM_VALUE_TYPE_TEXT:
-				cache->stats.history_text_counter++;
+				stats->history_text_counter++;
 				break;
 			case ITEM_VALUE_TYPE_LOG:
-				cache->stats.history_log_counter++;
+				stats->history_log_counter++;
 				break;
 		}
 
-		cache->stats.history_counter++;
+		stats->history_counter++;
 	}
 
 	(*data)->value_type = item_value->value_type;
@@ -4225,21 +4586,24 @@ static int	hc_clone_history_data(zbx_hc_data_t **data, const dc_item_value_t *it
 
 /******************************************************************************
  *                                                                            *
- * Purpose: adds item values to the history cache                             *
+ * Purpose: adds item values to the history cache shard                       *
  *                                                                            *
- * Parameters: values     - [IN] the item values to add                       *
- *             values_num - [IN] the number of item values to add             *
+ * Parameters: shard_index - [IN] the history cache shard index               *
+ *             values      - [IN] the item values                             *
+ *             values_num  - [IN] the number of item values                   *
  *                                                                            *
- * Comments: If the history cache is full this function will wait until       *
- *           history syncers processes values freeing enough space to store   *
- *           the new value.                                                   *
+ * Comments: Only values of items belonging to the specified shard are added. *
+ *           The shard must be locked. If the shard is full this function     *
+ *           will wait until history syncers processes values freeing enough *
+ *           space to store the new value.                                    *
  *                                                                            *
  ******************************************************************************/
-static void	hc_add_item_values(dc_item_value_t *values, int values_num)
+static void	hc_add_shard_item_values(int shard_index, dc_item_value_t *values, int values_num)
 {
 	dc_item_value_t	*item_value;
 	int		i;
 	zbx_hc_item_t	*item;
+	zbx_hc_shard_t	*shard = cache->shards[shard_index];
 
 	for (i = 0; i < values_num; i++)
 	{
@@ -4247,9 +4611,12 @@ static void	hc_add_item_values(dc_item_value_t *values, int values_num)
 
 		item_value = &values[i];
 
+		if (shard_index != hc_get_shard(item_value->itemid))
+			continue;
+
 		/* a record with metadata and no value can be dropped if  */
 		/* the metadata update is copied to the last queued value */
-		if (NULL != (item = hc_get_item(item_value->itemid)) &&
+		if (NULL != (item = hc_get_item(shard, item_value->itemid)) &&
 				0 != (item_value->flags & ZBX_DC_FLAG_NOVALUE) &&
 				0 != (item_value->flags & ZBX_DC_FLAG_META))
 		{
@@ -4264,26 +4631,26 @@ static void	hc_add_item_values(dc_item_value_t *values, int values_num)
 			}
 		}
 
-		if (SUCCEED != hc_clone_history_data(&data, item_value))
+		if (SUCCEED != hc_clone_history_data(&shard->stats, &data, item_value))
 		{
 			do
 			{
-				UNLOCK_CACHE;
+				hc_unlock_shard(shard_index);
 
 				zabbix_log(LOG_LEVEL_DEBUG, "History cache is full. Sleeping for 1 second.");
 				sleep(1);
 
-				LOCK_CACHE;
+				hc_lock_shard(shard_index);
 			}
-			while (SUCCEED != hc_clone_history_data(&data, item_value));
+			while (SUCCEED != hc_clone_history_data(&shard->stats, &data, item_value));
 
-			item = hc_get_item(item_value->itemid);
+			item = hc_get_item(shard, item_value->itemid);
 		}
 
 		if (NULL == item)
 		{
-			item = hc_add_item(item_value->itemid, data);
-			hc_queue_item(item);
+			item = hc_add_item(shard, item_value->itemid, data);
+			hc_queue_item(shard, item);
 		}
 		else
 		{
@@ -4291,6 +4658,49 @@ static void	hc_add_item_values(dc_item_value_t *values, int values_num)
 			item->head = data;
 		}
 		item->values_num++;
+		shard->history_num++;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds item values to the history cache                             *
+ *                                                                            *
+ * Parameters: values     - [IN] the item values to add                       *
+ *             values_num - [IN] the number of item values to add             *
+ *                                                                            *
+ * Comments: Values are distributed between history cache shards by itemid,  *
+ *           locking one shard at a time. The order of values of the same     *
+ *           item is preserved.                                               *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_add_item_values(dc_item_value_t *values, int values_num)
+{
+	int	i, shard;
+
+	if (1 == cache->shards_num)
+	{
+		LOCK_CACHE;
+		hc_add_shard_item_values(0, values, values_num);
+		UNLOCK_CACHE;
+
+		return;
+	}
+
+	for (shard = 0; shard < cache->shards_num; shard++)
+	{
+		for (i = 0; i < values_num; i++)
+		{
+			if (shard == hc_get_shard(values[i].itemid))
+				break;
+		}
+
+		if (i == values_num)
+			continue;
+
+		hc_lock_shard(shard);
+		hc_add_shard_item_values(shard, values + i, values_num - i);
+		hc_unlock_shard(shard);
 	}
 }
 
@@ -4358,27 +4768,88 @@ static void	hc_copy_history_data(ZBX_DC_HISTORY *history, zbx_uint64_t itemid, z
 
 /******************************************************************************
  *                                                                            *
- * Purpose: pops the next batch of history items from cache for processing    *
+ * Purpose: pops history items from history cache shard queue                 *
  *                                                                            *
- * Parameters: history_items - [OUT] the locked history items                 *
+ * Parameters: queue         - [IN] the history cache shard queue             *
+ *             history_items - [OUT] the locked history items                 *
+ *             items_max     - [IN] the maximum number of history items       *
  *                                                                            *
- * Comments: The history_items must be returned back to history cache with    *
- *           hc_push_items() function after they have been processed.         *
+ * Return value: SUCCEED - the shard queue has more items                     *
+ *               FAIL    - the shard queue is empty                           *
  *                                                                            *
  ******************************************************************************/
-static void	hc_pop_items(zbx_vector_ptr_t *history_items)
+static int	hc_pop_shard_items(zbx_binary_heap_t *queue, zbx_vector_ptr_t *history_items, int items_max)
 {
 	zbx_binary_heap_elem_t	*elem;
 	zbx_hc_item_t		*item;
 
-	while (ZBX_HC_SYNC_MAX > history_items->values_num && FAIL == zbx_binary_heap_empty(&cache->history_queue))
+	while (items_max > history_items->values_num && FAIL == zbx_binary_heap_empty(queue))
 	{
-		elem = zbx_binary_heap_find_min(&cache->history_queue);
+		elem = zbx_binary_heap_find_min(queue);
 		item = (zbx_hc_item_t *)elem->data;
 		zbx_vector_ptr_append(history_items, item);
 
-		zbx_binary_heap_remove_min(&cache->history_queue);
+		zbx_binary_heap_remove_min(queue);
+	}
+
+	return FAIL == zbx_binary_heap_empty(queue) ? SUCCEED : FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: pops the next batch of history items from cache for processing    *
+ *                                                                            *
+ * Parameters: history_items - [OUT] the locked history items                 *
+ *             stage         - [IN] the sync stage of items to pop:           *
+ *                                  ZBX_HC_ITEM_STAGE_HISTORY  - items with   *
+ *                                        values to write                     *
+ *                                  ZBX_HC_ITEM_STAGE_TRIGGERS - items with   *
+ *                                        written values to process triggers  *
+ *                                                                            *
+ * Comments: The history_items must be returned back to history cache with    *
+ *           hc_push_items() function after they have been processed.         *
+ *           To keep shards evenly synced the batch is first filled with the  *
+ *           oldest items of every shard, starting from a different shard at  *
+ *           each call, and then completed from shards having more items.     *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_pop_items(zbx_vector_ptr_t *history_items, unsigned char stage)
+{
+	static int	shard_first;
+	int		i, shard, items_max, more = FAIL;
+
+	if (1 == cache->shards_num)
+	{
+		LOCK_CACHE;
+		hc_pop_shard_items(hc_get_queue(cache->shards[0], stage), history_items, ZBX_HC_SYNC_MAX);
+		UNLOCK_CACHE;
+
+		return;
+	}
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		shard = (shard_first + i) % cache->shards_num;
+		items_max = history_items->values_num + ZBX_HC_SYNC_MAX / cache->shards_num;
+
+		hc_lock_shard(shard);
+
+		if (SUCCEED == hc_pop_shard_items(hc_get_queue(cache->shards[shard], stage), history_items, items_max))
+			more = SUCCEED;
+
+		hc_unlock_shard(shard);
+	}
+
+	for (i = 0; SUCCEED == more && i < cache->shards_num && ZBX_HC_SYNC_MAX > history_items->values_num; i++)
+	{
+		shard = (shard_first + i) % cache->shards_num;
+
+		hc_lock_shard(shard);
+		hc_pop_shard_items(hc_get_queue(cache->shards[shard], stage), history_items, ZBX_HC_SYNC_MAX);
+		hc_unlock_shard(shard);
 	}
+
+	shard_first = (shard_first + 1) % cache->shards_num;
 }
 
 /******************************************************************************
@@ -4409,44 +4880,133 @@ static void	hc_get_item_values(ZBX_DC_HISTORY *history, zbx_vector_ptr_t *histor
 
 /******************************************************************************
  *                                                                            *
- * Purpose: push back the processed history items into history cache          *
+ * Purpose: stores prepared flags of item history values in history cache     *
  *                                                                            *
- * Parameters: history_items - [IN] the history items containing processed    *
+ * Parameters: history       - [IN] the history values                        *
+ *             history_items - [IN] the history items                         *
+ *                                                                            *
+ * Comments: The history values must be retrieved from the same history items *
+ *           with hc_get_item_values() function. This way the flags set when  *
+ *           preparing values for the history stage are kept for the triggers *
+ *           stage.                                                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_set_item_flags(const ZBX_DC_HISTORY *history, zbx_vector_ptr_t *history_items)
+{
+	int		i, history_num = 0;
+	zbx_hc_item_t	*item;
+
+	/* we don't need to lock history cache because no other processes can  */
+	/* change item's history data until it is pushed back to history queue */
+	for (i = 0; i < history_items->values_num; i++)
+	{
+		item = (zbx_hc_item_t *)history_items->values[i];
+
+		if (ZBX_HC_ITEM_STATUS_BUSY == item->status)
+			continue;
+
+		item->tail->flags = history[history_num++].flags;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: push back the processed history items into history cache shard    *
+ *                                                                            *
+ * Parameters: shard_index   - [IN] the history cache shard index             *
+ *             history_items - [IN] the history items containing processed    *
  *                                  (available) and busy items                *
+ *             offset        - [IN] the first history item of the shard       *
+ *             stages        - [IN] the sync stages performed on the values   *
  *                                                                            *
  * Comments: This function removes processed value from history cache.        *
  *           If there is no more data for this item, then the item itself is  *
  *           removed from history index.                                      *
+ *           Values that were only written to history are kept in cache and   *
+ *           their items are passed to the trigger queue instead.             *
  *                                                                            *
  ******************************************************************************/
-void	hc_push_items(zbx_vector_ptr_t *history_items)
+static void	hc_push_shard_items(int shard_index, zbx_vector_ptr_t *history_items, int offset,
+		unsigned char stages)
 {
 	int		i;
 	zbx_hc_item_t	*item;
 	zbx_hc_data_t	*data_free;
+	zbx_hc_shard_t	*shard = cache->shards[shard_index];
 
-	for (i = 0; i < history_items->values_num; i++)
+	for (i = offset; i < history_items->values_num; i++)
 	{
 		item = (zbx_hc_item_t *)history_items->values[i];
 
+		if (shard_index != hc_get_shard(item->itemid))
+			continue;
+
 		switch (item->status)
 		{
 			case ZBX_HC_ITEM_STATUS_BUSY:
 				/* reset item status before returning it to queue */
 				item->status = ZBX_HC_ITEM_STATUS_NORMAL;
-				hc_queue_item(item);
+				hc_queue_item(shard, item);
 				break;
 			case ZBX_HC_ITEM_STATUS_NORMAL:
+				if (0 == (stages & ZBX_SYNC_STAGE_TRIGGERS))
+				{
+					item->stage = ZBX_HC_ITEM_STAGE_TRIGGERS;
+					hc_queue_item(shard, item);
+					break;
+				}
+
+				item->stage = ZBX_HC_ITEM_STAGE_HISTORY;
 				item->values_num--;
+				shard->history_num--;
 				data_free = item->tail;
 				item->tail = item->tail->next;
 				hc_free_data(data_free);
 				if (NULL == item->tail)
-					zbx_hashset_remove(&cache->history_items, item);
+					zbx_hashset_remove(&shard->history_items, item);
 				else
-					hc_queue_item(item);
+					hc_queue_item(shard, item);
+				break;
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: push back the processed history items into history cache          *
+ *                                                                            *
+ * Parameters: history_items - [IN] the history items containing processed    *
+ *                                  (available) and busy items                *
+ *             stages        - [IN] the sync stages performed on the values   *
+ *                                                                            *
+ ******************************************************************************/
+void	hc_push_items(zbx_vector_ptr_t *history_items, unsigned char stages)
+{
+	int	i, shard;
+
+	if (1 == cache->shards_num)
+	{
+		LOCK_CACHE;
+		hc_push_shard_items(0, history_items, 0, stages);
+		UNLOCK_CACHE;
+
+		return;
+	}
+
+	for (shard = 0; shard < cache->shards_num; shard++)
+	{
+		for (i = 0; i < history_items->values_num; i++)
+		{
+			if (shard == hc_get_shard(((zbx_hc_item_t *)history_items->values[i])->itemid))
 				break;
 		}
+
+		if (i == history_items->values_num)
+			continue;
+
+		hc_lock_shard(shard);
+		hc_push_shard_items(shard, history_items, i, stages);
+		hc_unlock_shard(shard);
 	}
 }
 
@@ -4454,10 +5014,60 @@ void	hc_push_items(zbx_vector_ptr_t *history_items)
  *                                                                            *
  * Purpose: retrieve the size of history queue                                *
  *                                                                            *
+ * Comments: Items waiting for trigger recalculation are included.            *
+ *                                                                            *
  ******************************************************************************/
 int	hc_queue_get_size(void)
 {
-	return cache->history_queue.elems_num;
+	int	i, size = 0;
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		hc_lock_shard(i);
+		size += cache->shards[i]->history_queue.elems_num + cache->shards[i]->trigger_queue.elems_num;
+		hc_unlock_shard(i);
+	}
+
+	return size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: retrieve the number of items with written values waiting for      *
+ *          trigger recalculation                                             *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_trigger_queue_get_size(void)
+{
+	int	i, size = 0;
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		hc_lock_shard(i);
+		size += cache->shards[i]->trigger_queue.elems_num;
+		hc_unlock_shard(i);
+	}
+
+	return size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: retrieve the number of values in history cache                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_get_history_num(void)
+{
+	int	i, history_num = 0;
+
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		hc_lock_shard(i);
+		history_num += cache->shards[i]->history_num;
+		hc_unlock_shard(i);
+	}
+
+	return history_num;
 }
 
 int	hc_get_history_compression_age(void)
@@ -4512,6 +5122,7 @@ static int	init_trend_cache(char **error)
 
 	cache->trends_num = 0;
 	cache->trends_last_cleanup_hour = 0;
+	cache->trends_last_flush = 0;
 
 #define INIT_HASHSET_SIZE	100	/* Should be calculated dynamically based on trends size? */
 					/* Still does not make sense to have it more than initial */
@@ -4521,6 +5132,10 @@ static int	init_trend_cache(char **error)
 			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL,
 			__trend_shmem_malloc_func, __trend_shmem_realloc_func, __trend_shmem_free_func);
 
+	zbx_hashset_create_ext(&cache->trends_closed, INIT_HASHSET_SIZE,
+			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL,
+			__trend_shmem_malloc_func, __trend_shmem_realloc_func, __trend_shmem_free_func);
+
 #undef INIT_HASHSET_SIZE
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
@@ -4535,7 +5150,8 @@ out:
  ******************************************************************************/
 int	init_database_cache(char **error)
 {
-	int	ret;
+	int		i, ret;
+	zbx_hc_shard_t	*shard;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -4545,36 +5161,65 @@ int	init_database_cache(char **error)
 		goto out;
 	}
 
-	if (SUCCEED != (ret = zbx_mutex_create(&cache_lock, ZBX_MUTEX_CACHE, error)))
-		goto out;
-
 	if (SUCCEED != (ret = zbx_mutex_create(&cache_ids_lock, ZBX_MUTEX_CACHE_IDS, error)))
 		goto out;
 
-	if (SUCCEED != (ret = zbx_shmem_create(&hc_mem, CONFIG_HISTORY_CACHE_SIZE, "history cache",
-			"HistoryCacheSize", 1, error)))
+	for (i = 0; i < CONFIG_HISTORY_CACHE_SHARDS; i++)
 	{
-		goto out;
-	}
+		if (SUCCEED != (ret = zbx_mutex_create(&hc_shard_lock[i], 0 == i ? ZBX_MUTEX_CACHE :
+				ZBX_MUTEX_CACHE_SHARD + i - 1, error)))
+		{
+			goto out;
+		}
 
-	if (SUCCEED != (ret = zbx_shmem_create(&hc_index_mem, CONFIG_HISTORY_INDEX_CACHE_SIZE, "history index cache",
-			"HistoryIndexCacheSize", 0, error)))
-	{
-		goto out;
-	}
+		if (SUCCEED != (ret = zbx_shmem_create(&hc_shard_mem[i],
+				CONFIG_HISTORY_CACHE_SIZE / (zbx_uint64_t)CONFIG_HISTORY_CACHE_SHARDS, "history cache",
+				"HistoryCacheSize", 1, error)))
+		{
+			goto out;
+		}
+
+		if (SUCCEED != (ret = zbx_shmem_create(&hc_shard_index_mem[i],
+				CONFIG_HISTORY_INDEX_CACHE_SIZE / (zbx_uint64_t)CONFIG_HISTORY_CACHE_SHARDS,
+				"history index cache", "HistoryIndexCacheSize", 0, error)))
+		{
+			goto out;
+		}
 
-	cache = (ZBX_DC_CACHE *)__hc_index_shmem_malloc_func(NULL, sizeof(ZBX_DC_CACHE));
-	memset(cache, 0, sizeof(ZBX_DC_CACHE));
+		hc_mem = hc_shard_mem[i];
+		hc_index_mem = hc_shard_index_mem[i];
 
-	ids = (ZBX_DC_IDS *)__hc_index_shmem_malloc_func(NULL, sizeof(ZBX_DC_IDS));
-	memset(ids, 0, sizeof(ZBX_DC_IDS));
+		/* the cache wide data is stored in the first shard index */
+		if (0 == i)
+		{
+			cache = (ZBX_DC_CACHE *)__hc_index_shmem_malloc_func(NULL, sizeof(ZBX_DC_CACHE));
+			memset(cache, 0, sizeof(ZBX_DC_CACHE));
 
-	zbx_hashset_create_ext(&cache->history_items, ZBX_HC_ITEMS_INIT_SIZE,
-			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL,
-			__hc_index_shmem_malloc_func, __hc_index_shmem_realloc_func, __hc_index_shmem_free_func);
+			ids = (ZBX_DC_IDS *)__hc_index_shmem_malloc_func(NULL, sizeof(ZBX_DC_IDS));
+			memset(ids, 0, sizeof(ZBX_DC_IDS));
+		}
 
-	zbx_binary_heap_create_ext(&cache->history_queue, hc_queue_elem_compare_func, ZBX_BINARY_HEAP_OPTION_EMPTY,
-			__hc_index_shmem_malloc_func, __hc_index_shmem_realloc_func, __hc_index_shmem_free_func);
+		shard = (zbx_hc_shard_t *)__hc_index_shmem_malloc_func(NULL, sizeof(zbx_hc_shard_t));
+		memset(shard, 0, sizeof(zbx_hc_shard_t));
+
+		zbx_hashset_create_ext(&shard->history_items, ZBX_HC_ITEMS_INIT_SIZE,
+				ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL,
+				__hc_index_shmem_malloc_func, __hc_index_shmem_realloc_func, __hc_index_shmem_free_func);
+
+		zbx_binary_heap_create_ext(&shard->history_queue, hc_queue_elem_compare_func,
+				ZBX_BINARY_HEAP_OPTION_EMPTY, __hc_index_shmem_malloc_func, __hc_index_shmem_realloc_func,
+				__hc_index_shmem_free_func);
+
+		zbx_binary_heap_create_ext(&shard->trigger_queue, hc_queue_elem_compare_func,
+				ZBX_BINARY_HEAP_OPTION_EMPTY, __hc_index_shmem_malloc_func, __hc_index_shmem_realloc_func,
+				__hc_index_shmem_free_func);
+
+		cache->shards[cache->shards_num++] = shard;
+	}
+
+	/* cache wide data is allocated from the first shard index */
+	hc_mem = hc_shard_mem[0];
+	hc_index_mem = hc_shard_index_mem[0];
 
 	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
 	{
@@ -4672,6 +5317,8 @@ static void	DCsync_all(void)
  ******************************************************************************/
 void	free_database_cache(int sync)
 {
+	int	i;
+
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
 	if (ZBX_SYNC_ALL == sync)
@@ -4679,12 +5326,18 @@ void	free_database_cache(int sync)
 
 	cache = NULL;
 
-	zbx_shmem_destroy(hc_mem);
+	for (i = 0; i < CONFIG_HISTORY_CACHE_SHARDS; i++)
+	{
+		zbx_shmem_destroy(hc_shard_mem[i]);
+		hc_shard_mem[i] = NULL;
+		zbx_shmem_destroy(hc_shard_index_mem[i]);
+		hc_shard_index_mem[i] = NULL;
+		zbx_mutex_destroy(&hc_shard_lock[i]);
+	}
+
 	hc_mem = NULL;
-	zbx_shmem_destroy(hc_index_mem);
 	hc_index_mem = NULL;
 
-	zbx_mutex_destroy(&cache_lock);
 	zbx_mutex_destroy(&cache_ids_lock);
 
 	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
@@ -4805,12 +5458,51 @@ out:
  ******************************************************************************/
 void	zbx_hc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num)
 {
-	LOCK_CACHE;
+	int	i;
 
-	*values_num = cache->history_num;
-	*items_num = cache->history_items.num_data;
+	*values_num = 0;
+	*items_num = 0;
 
-	UNLOCK_CACHE;
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		hc_lock_shard(i);
+
+		*values_num += cache->shards[i]->history_num;
+		*items_num += cache->shards[i]->history_items.num_data;
+
+		hc_unlock_shard(i);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds history cache shard allocator statistics to the total        *
+ *          statistics                                                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_shmem_stats_add(zbx_shmem_stats_t *total, const zbx_shmem_stats_t *stats)
+{
+	int	i;
+
+	total->free_size += stats->free_size;
+	total->used_size += stats->used_size;
+	total->overhead += stats->overhead;
+	total->free_chunks += stats->free_chunks;
+	total->used_chunks += stats->used_chunks;
+
+	if (total->min_chunk_size > stats->min_chunk_size)
+		total->min_chunk_size = stats->min_chunk_size;
+
+	if (total->max_chunk_size < stats->max_chunk_size)
+		total->max_chunk_size = stats->max_chunk_size;
+
+	for (i = 0; i < ZBX_SHMEM_BUCKET_COUNT; i++)
+		total->chunks_num[i] += stats->chunks_num[i];
+
+	for (i = 0; i < ZBX_SHMEM_NUMA_MAX_NODES; i++)
+		total->numa_pages[i] += stats->numa_pages[i];
+
+	total->numa_nodes |= stats->numa_nodes;
 }
 
 /******************************************************************************
@@ -4820,15 +5512,31 @@ void	zbx_hc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num)
  ******************************************************************************/
 void	zbx_hc_get_mem_stats(zbx_shmem_stats_t *data, zbx_shmem_stats_t *index)
 {
-	LOCK_CACHE;
+	int			i;
+	zbx_shmem_stats_t	stats;
 
-	if (NULL != data)
-		zbx_shmem_get_stats(hc_mem, data);
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		hc_lock_shard(i);
 
-	if (NULL != index)
-		zbx_shmem_get_stats(hc_index_mem, index);
+		if (NULL != data)
+		{
+			zbx_shmem_get_stats(hc_mem, 0 == i ? data : &stats);
 
-	UNLOCK_CACHE;
+			if (0 != i)
+				hc_shmem_stats_add(data, &stats);
+		}
+
+		if (NULL != index)
+		{
+			zbx_shmem_get_stats(hc_index_mem, 0 == i ? index : &stats);
+
+			if (0 != i)
+				hc_shmem_stats_add(index, &stats);
+		}
+
+		hc_unlock_shard(i);
+	}
 }
 
 /******************************************************************************
@@ -4838,21 +5546,25 @@ void	zbx_hc_get_mem_stats(zbx_shmem_stats_t *data, zbx_shmem_stats_t *index)
  ******************************************************************************/
 void	zbx_hc_get_items(zbx_vector_uint64_pair_t *items)
 {
+	int			i;
 	zbx_hashset_iter_t	iter;
 	zbx_hc_item_t		*item;
 
-	LOCK_CACHE;
+	for (i = 0; i < cache->shards_num; i++)
+	{
+		hc_lock_shard(i);
 
-	zbx_vector_uint64_pair_reserve(items, cache->history_items.num_data);
+		zbx_vector_uint64_pair_reserve(items, items->values_num + cache->shards[i]->history_items.num_data);
 
-	zbx_hashset_iter_reset(&cache->history_items, &iter);
-	while (NULL != (item = (zbx_hc_item_t *)zbx_hashset_iter_next(&iter)))
-	{
-		zbx_uint64_pair_t	pair = {item->itemid, item->values_num};
-		zbx_vector_uint64_pair_append_ptr(items, &pair);
-	}
+		zbx_hashset_iter_reset(&cache->shards[i]->history_items, &iter);
+		while (NULL != (item = (zbx_hc_item_t *)zbx_hashset_iter_next(&iter)))
+		{
+			zbx_uint64_pair_t	pair = {item->itemid, item->values_num};
+			zbx_vector_uint64_pair_append_ptr(items, &pair);
+		}
 
-	UNLOCK_CACHE;
+		hc_unlock_shard(i);
+	}
 }
 
 /******************************************************************************
@@ -4965,14 +5677,16 @@ static void	zbx_hc_proxyqueue_clear(void)
  ******************************************************************************/
 int	zbx_hc_check_proxy(zbx_uint64_t proxyid)
 {
-	double	hc_pused;
-	int	ret;
+	double			hc_pused;
+	int			ret;
+	zbx_wcache_info_t	wcache_info;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() proxyid:"ZBX_FS_UI64, __func__, proxyid);
 
-	LOCK_CACHE;
+	DCget_stats_all(&wcache_info);
+	hc_pused = 100 * (double)(wcache_info.history_total - wcache_info.history_free) / wcache_info.history_total;
 
-	hc_pused = 100 * (double)(hc_mem->total_size - hc_mem->free_size) / hc_mem->total_size;
+	LOCK_CACHE;
 
 	if (20 >= hc_pused)
 	{
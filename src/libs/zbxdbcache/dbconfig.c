@@ -31,11 +31,14 @@
 #include "base64.h"
 #include "db.h"
 #include "dbsync.h"
+#include "dbsync_prefetch.h"
 #include "actions.h"
 #include "zbxtrends.h"
 #include "zbxserialize.h"
 #include "zbxavailability.h"
 
+#include <sys/mman.h>
+
 int	sync_in_progress = 0;
 
 #define START_SYNC	WRLOCK_CACHE; sync_in_progress = 1
@@ -57,6 +60,11 @@ int	sync_in_progress = 0;
 #define ZBX_TRIGGER_TIMER_UNKNOWN	0
 #define ZBX_TRIGGER_TIMER_QUEUE		1
 
+/* item update interval parsing state */
+#define ZBX_DC_DELAY_UNKNOWN		0	/* not parsed yet or invalid */
+#define ZBX_DC_DELAY_SIMPLE		1	/* only simple update interval is defined */
+#define ZBX_DC_DELAY_CUSTOM		2	/* flexible or scheduling intervals are defined */
+
 /* item priority in poller queue */
 #define ZBX_QUEUE_PRIORITY_HIGH		0
 #define ZBX_QUEUE_PRIORITY_NORMAL	1
@@ -89,6 +97,7 @@ static zbx_shmem_info_t	*config_mem;
 
 extern unsigned char	program_type;
 extern int		CONFIG_TIMER_FORKS;
+extern int		CONFIG_SCHEDULER_SMOOTHING_WINDOW;
 
 ZBX_SHMEM_FUNC_IMPL(__config, config_mem)
 
@@ -193,6 +202,14 @@ static unsigned char	poller_by_item(unsigned char type, const char *key)
 {
 	switch (type)
 	{
+		case ITEM_TYPE_ZABBIX:
+			if (0 != CONFIG_AGENTPOLLER_FORKS)
+				return ZBX_POLLER_TYPE_AGENT;
+
+			if (0 == CONFIG_POLLER_FORKS)
+				break;
+
+			return ZBX_POLLER_TYPE_NORMAL;
 		case ITEM_TYPE_SIMPLE:
 			if (SUCCEED == cmp_key_id(key, SERVER_ICMPPING_KEY) ||
 					SUCCEED == cmp_key_id(key, SERVER_ICMPPINGSEC_KEY) ||
@@ -204,17 +221,23 @@ static unsigned char	poller_by_item(unsigned char type, const char *key)
 				return ZBX_POLLER_TYPE_PINGER;
 			}
 			ZBX_FALLTHROUGH;
-		case ITEM_TYPE_ZABBIX:
 		case ITEM_TYPE_SNMP:
 		case ITEM_TYPE_EXTERNAL:
 		case ITEM_TYPE_SSH:
 		case ITEM_TYPE_TELNET:
-		case ITEM_TYPE_HTTPAGENT:
 		case ITEM_TYPE_SCRIPT:
 		case ITEM_TYPE_INTERNAL:
 			if (0 == CONFIG_POLLER_FORKS)
 				break;
 
+			return ZBX_POLLER_TYPE_NORMAL;
+		case ITEM_TYPE_HTTPAGENT:
+			if (0 != CONFIG_HTTPAGENTPOLLER_FORKS)
+				return ZBX_POLLER_TYPE_HTTPAGENT;
+
+			if (0 == CONFIG_POLLER_FORKS)
+				break;
+
 			return ZBX_POLLER_TYPE_NORMAL;
 		case ITEM_TYPE_DB_MONITOR:
 			if (0 == CONFIG_ODBCPOLLER_FORKS)
@@ -336,14 +359,284 @@ static int	DCget_disable_until(const ZBX_DC_ITEM *item, const ZBX_DC_INTERFACE *
 	}
 }
 
+/* number of seconds tracked by item load histograms, must be power of 2 */
+#define ZBX_DC_ITEM_LOAD_SLOTS		4096
+#define ZBX_DC_ITEM_LOAD_INDEX(poller_type, nextcheck)							\
+		((poller_type) * ZBX_DC_ITEM_LOAD_SLOTS + ((nextcheck) & (ZBX_DC_ITEM_LOAD_SLOTS - 1)))
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: updates number of queued item checks scheduled at the seconds     *
+ *          of item checks                                                    *
+ *                                                                            *
+ * Parameters: item        - [IN] the item                                    *
+ *             poller_type - [IN] the item poller type                        *
+ *             nextcheck   - [IN] the item nextcheck                          *
+ *             value       - [IN] 1 to add checks, -1 to remove checks        *
+ *                                                                            *
+ * Comments: Histograms are kept only when scheduler smoothing is enabled.    *
+ *           Nextcheck values are mapped to slots modulo the histogram size.  *
+ *                                                                            *
+ *           Items with simple update interval are counted at every check     *
+ *           within the histogram size starting with nextcheck, so that the   *
+ *           histogram shows the number of checks performed each second       *
+ *           rather than the number of next checks. Otherwise an item with    *
+ *           10 second interval would weigh as much as an item with 1 hour    *
+ *           interval. Items with custom intervals are counted only at        *
+ *           nextcheck as the time of the following checks is not known.      *
+ *                                                                            *
+ *           The interval is stored in item when checks are added, because    *
+ *           item update interval can change before they are removed.         *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_item_load_update(ZBX_DC_ITEM *item, unsigned char poller_type, int nextcheck, int value)
+{
+	unsigned int	*load;
+	int		slot, offset = 0;
+
+	if (NULL == config->item_load || ZBX_NO_POLLER == poller_type || ZBX_JAN_2038 == nextcheck)
+		return;
+
+	if (0 < value)
+	{
+		item->load_delay = (ZBX_DC_DELAY_SIMPLE == item->delay_type && 0 < item->simple_interval ?
+				(unsigned short)MIN(item->simple_interval, ZBX_DC_ITEM_LOAD_SLOTS) : 0);
+	}
+
+	load = &config->item_load[ZBX_DC_ITEM_LOAD_INDEX(poller_type, 0)];
+	slot = nextcheck & (ZBX_DC_ITEM_LOAD_SLOTS - 1);
+
+	do
+	{
+		if (0 < value)
+			load[slot]++;
+		else if (0 != load[slot])
+			load[slot]--;
+
+		if (0 == item->load_delay)
+			break;
+
+		slot = (slot + item->load_delay) & (ZBX_DC_ITEM_LOAD_SLOTS - 1);
+	}
+	while (ZBX_DC_ITEM_LOAD_SLOTS > (offset += item->load_delay));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: finds the least loaded second to schedule item checks             *
+ *                                                                            *
+ * Parameters: item            - [IN] the item                                *
+ *             nextcheck       - [IN] the nextcheck calculated without shift  *
+ *             simple_interval - [IN] the item update interval                *
+ *                                                                            *
+ * Return value: the shift in seconds from the calculated nextcheck           *
+ *                                                                            *
+ * Comments: The first second with the least number of checks of the same     *
+ *           poller type within the smoothing window is selected, so items    *
+ *           spread over quiet seconds instead of piling up where the hash    *
+ *           based seed placed them. Only the first check of the item is      *
+ *           compared, as the histogram already accounts for the following    *
+ *           checks of the other items.                                       *
+ *                                                                            *
+ ******************************************************************************/
+static int	dc_item_load_get_shift(const ZBX_DC_ITEM *item, int nextcheck, int simple_interval)
+{
+	int		window, shift, min_shift = 0;
+	unsigned int	min_load = UINT_MAX;
+
+	window = MIN(CONFIG_SCHEDULER_SMOOTHING_WINDOW, simple_interval - 1);
+
+	for (shift = 0; shift <= window; shift++)
+	{
+		unsigned int	load;
+
+		if (min_load > (load = config->item_load[ZBX_DC_ITEM_LOAD_INDEX(item->poller_type, nextcheck + shift)]))
+		{
+			min_load = load;
+			min_shift = shift;
+
+			if (0 == load)
+				break;
+		}
+	}
+
+	return min_shift;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: allocates item load histograms if scheduler smoothing is enabled  *
+ *                                                                            *
+ * Comments: Histograms must be reset together with poller queues.            *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_item_load_init(void)
+{
+	size_t	size = sizeof(unsigned int) * ZBX_POLLER_TYPE_COUNT * ZBX_DC_ITEM_LOAD_SLOTS;
+
+	if (NULL != config->item_load)
+	{
+		__config_shmem_free_func(config->item_load);
+		config->item_load = NULL;
+	}
+
+	if (0 == CONFIG_SCHEDULER_SMOOTHING_WINDOW)
+		return;
+
+	config->item_load = (unsigned int *)__config_shmem_malloc_func(NULL, size);
+	memset(config->item_load, 0, size);
+}
+
+/* parsed custom update intervals, cached locally by each process */
+typedef struct
+{
+	char			*delay;
+	int			simple_interval;
+	zbx_custom_interval_t	*custom_intervals;
+}
+zbx_dc_interval_t;
+
+#define ZBX_DC_INTERVALS_MAX	4096
+
+static zbx_hashset_t	dc_intervals;
+
+static zbx_hash_t	dc_interval_hash(const void *data)
+{
+	const zbx_dc_interval_t	*interval = (const zbx_dc_interval_t *)data;
+
+	return ZBX_DEFAULT_STRING_HASH_FUNC(interval->delay);
+}
+
+static int	dc_interval_compare(const void *d1, const void *d2)
+{
+	const zbx_dc_interval_t	*interval1 = (const zbx_dc_interval_t *)d1;
+	const zbx_dc_interval_t	*interval2 = (const zbx_dc_interval_t *)d2;
+
+	return strcmp(interval1->delay, interval2->delay);
+}
+
+static void	dc_interval_clean(void *data)
+{
+	zbx_dc_interval_t	*interval = (zbx_dc_interval_t *)data;
+
+	zbx_free(interval->delay);
+	zbx_custom_interval_free(interval->custom_intervals);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets parsed update intervals of an item                           *
+ *                                                                            *
+ * Parameters: item             - [IN/OUT] the item                           *
+ *             simple_interval  - [OUT] the simple update interval            *
+ *             custom_intervals - [OUT] the flexible and scheduling intervals *
+ *                                      or NULL if item has only simple       *
+ *                                      update interval                       *
+ *             error            - [OUT] the error message                     *
+ *                                                                            *
+ * Return value: SUCCEED - the intervals were returned                        *
+ *               FAIL    - the update interval is invalid                     *
+ *                                                                            *
+ * Comments: Simple update interval is stored with the item in configuration  *
+ *           cache. Custom intervals are parsed into process heap memory, so  *
+ *           they are cached by each process locally using the item delay     *
+ *           with expanded macros as a key. Changes of delay or macros used   *
+ *           in it reset the item parsing state during configuration sync.    *
+ *           The returned custom intervals must not be freed.                 *
+ *                                                                            *
+ ******************************************************************************/
+static int	dc_item_get_intervals(ZBX_DC_ITEM *item, int *simple_interval,
+		const zbx_custom_interval_t **custom_intervals, char **error)
+{
+	zbx_dc_interval_t	interval_local, *interval;
+
+	if (ZBX_DC_DELAY_SIMPLE == item->delay_type)
+	{
+		*simple_interval = item->simple_interval;
+		*custom_intervals = NULL;
+		return SUCCEED;
+	}
+
+	if (0 == dc_intervals.num_slots)
+	{
+		zbx_hashset_create_ext(&dc_intervals, 100, dc_interval_hash, dc_interval_compare, dc_interval_clean,
+				ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
+	}
+
+	if (ZBX_DC_DELAY_CUSTOM == item->delay_type)
+	{
+		interval_local.delay = (char *)item->delay;
+
+		if (NULL != (interval = (zbx_dc_interval_t *)zbx_hashset_search(&dc_intervals, &interval_local)))
+		{
+			*simple_interval = interval->simple_interval;
+			*custom_intervals = interval->custom_intervals;
+			return SUCCEED;
+		}
+	}
+
+	if (SUCCEED != zbx_interval_preproc(item->delay, &interval_local.simple_interval,
+			&interval_local.custom_intervals, error))
+	{
+		item->delay_type = ZBX_DC_DELAY_UNKNOWN;
+		return FAIL;
+	}
+
+	item->simple_interval = interval_local.simple_interval;
+	*simple_interval = interval_local.simple_interval;
+
+	if (FAIL == zbx_custom_interval_is_scheduling(interval_local.custom_intervals) &&
+			FAIL == zbx_custom_interval_is_flexible(interval_local.custom_intervals))
+	{
+		zbx_custom_interval_free(interval_local.custom_intervals);
+		item->delay_type = ZBX_DC_DELAY_SIMPLE;
+		*custom_intervals = NULL;
+		return SUCCEED;
+	}
+
+	item->delay_type = ZBX_DC_DELAY_CUSTOM;
+
+	/* delays with expanded macros can be unique per item, so keep the cache bounded */
+	if (ZBX_DC_INTERVALS_MAX <= dc_intervals.num_data)
+		zbx_hashset_clear(&dc_intervals);
+
+	interval_local.delay = zbx_strdup(NULL, item->delay);
+	interval = (zbx_dc_interval_t *)zbx_hashset_insert(&dc_intervals, &interval_local, sizeof(interval_local));
+	*custom_intervals = interval->custom_intervals;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets simple update interval of an item                            *
+ *                                                                            *
+ * Parameters: item  - [IN] the item                                          *
+ *             delay - [OUT] the simple update interval                       *
+ *                                                                            *
+ * Return value: SUCCEED - the interval was returned                          *
+ *               FAIL    - the update interval is invalid                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	dc_item_get_simple_interval(const ZBX_DC_ITEM *item, int *delay)
+{
+	if (ZBX_DC_DELAY_UNKNOWN != item->delay_type)
+	{
+		*delay = item->simple_interval;
+		return SUCCEED;
+	}
+
+	return zbx_interval_preproc(item->delay, delay, NULL, NULL);
+}
+
 static int	DCitem_nextcheck_update(ZBX_DC_ITEM *item, const ZBX_DC_INTERFACE *interface, int flags, int now,
 		char **error)
 {
 #define ZBX_DEFAULT_ITEM_UPDATE_INTERVAL	60
-	zbx_uint64_t		seed;
-	int			simple_interval;
-	zbx_custom_interval_t	*custom_intervals;
-	int			disable_until;
+	zbx_uint64_t			seed;
+	int				simple_interval, interval, reschedule = 0;
+	const zbx_custom_interval_t	*custom_intervals;
+	int				disable_until;
 
 	if (0 == (flags & ZBX_ITEM_COLLECTED) && 0 != item->nextcheck &&
 			0 == (flags & ZBX_ITEM_KEY_CHANGED) && 0 == (flags & ZBX_ITEM_TYPE_CHANGED) &&
@@ -352,9 +645,19 @@ static int	DCitem_nextcheck_update(ZBX_DC_ITEM *item, const ZBX_DC_INTERFACE *in
 		return SUCCEED;	/* avoid unnecessary nextcheck updates when syncing items in cache */
 	}
 
-	seed = get_item_nextcheck_seed(item->itemid, item->interfaceid, item->type, item->key);
+	/* item schedule is created or its scheduling properties have changed */
+	if (0 == item->nextcheck ||
+			0 != (flags & (ZBX_ITEM_NEW | ZBX_ITEM_KEY_CHANGED | ZBX_ITEM_TYPE_CHANGED | ZBX_ITEM_DELAY_CHANGED)))
+	{
+		item->nextcheck_shift = 0;
+		reschedule = 1;
+	}
+
+	/* items sharing seed are polled in batches, shifting them individually would split batches */
+	if (item->itemid == (seed = get_item_nextcheck_seed(item->itemid, item->interfaceid, item->type, item->key)))
+		seed += item->nextcheck_shift;
 
-	if (SUCCEED != zbx_interval_preproc(item->delay, &simple_interval, &custom_intervals, error))
+	if (SUCCEED != dc_item_get_intervals(item, &simple_interval, &custom_intervals, error))
 	{
 		/* Polling items with invalid update intervals repeatedly does not make sense because they */
 		/* can only be healed by editing configuration (either update interval or macros involved) */
@@ -374,24 +677,41 @@ static int	DCitem_nextcheck_update(ZBX_DC_ITEM *item, const ZBX_DC_INTERFACE *in
 	}
 	else
 	{
+		const zbx_custom_interval_t	*intervals;
+
 		if (0 != (flags & ZBX_ITEM_NEW) &&
 				FAIL == zbx_custom_interval_is_scheduling(custom_intervals) &&
 				ITEM_TYPE_ZABBIX_ACTIVE != item->type &&
 				ZBX_DEFAULT_ITEM_UPDATE_INTERVAL < simple_interval)
 		{
-			item->nextcheck = calculate_item_nextcheck(seed, item->type, ZBX_DEFAULT_ITEM_UPDATE_INTERVAL,
-					NULL, now);
+			interval = ZBX_DEFAULT_ITEM_UPDATE_INTERVAL;
+			intervals = NULL;
 		}
 		else
 		{
 			/* supported items and items that could not have been scheduled previously, but had */
 			/* their update interval fixed, should be scheduled using their update intervals */
-			item->nextcheck = calculate_item_nextcheck(seed, item->type, simple_interval, custom_intervals,
-					now);
+			interval = simple_interval;
+			intervals = custom_intervals;
 		}
-	}
 
-	zbx_custom_interval_free(custom_intervals);
+		item->nextcheck = calculate_item_nextcheck(seed, item->type, interval, intervals, now);
+
+		/* move item checks to less loaded seconds when item schedule is created */
+		if (0 != reschedule && NULL != config->item_load && item->itemid == seed &&
+				ZBX_NO_POLLER != item->poller_type && 1 < interval &&
+				FAIL == zbx_custom_interval_is_scheduling(custom_intervals))
+		{
+			int	shift;
+
+			if (0 != (shift = dc_item_load_get_shift(item, item->nextcheck, interval)))
+			{
+				item->nextcheck_shift = (unsigned short)shift;
+				item->nextcheck = calculate_item_nextcheck(seed + item->nextcheck_shift, item->type,
+						interval, intervals, now);
+			}
+		}
+	}
 
 	item->schedulable = 1;
 #undef ZBX_DEFAULT_ITEM_UPDATE_INTERVAL
@@ -410,10 +730,33 @@ static void	DCitem_poller_type_update(ZBX_DC_ITEM *dc_item, const ZBX_DC_HOST *d
 
 	poller_type = poller_by_item(dc_item->type, dc_item->key);
 
+	/* agent pollers multiplex plain TCP connections, TLS handshakes are left to normal pollers */
+	if (ZBX_POLLER_TYPE_AGENT == poller_type && ZBX_TCP_SEC_UNENCRYPTED != dc_host->tls_connect &&
+			0 != CONFIG_POLLER_FORKS)
+	{
+		poller_type = ZBX_POLLER_TYPE_NORMAL;
+	}
+
+	/* SNMP pollers query plain OIDs only, dynamic index and walk items need synchronous requests */
+	if (ZBX_POLLER_TYPE_NORMAL == poller_type && ITEM_TYPE_SNMP == dc_item->type &&
+			0 != CONFIG_SNMPPOLLER_FORKS && 0 == (ZBX_FLAG_DISCOVERY_RULE & dc_item->flags))
+	{
+		const ZBX_DC_SNMPITEM	*snmpitem;
+
+		if (NULL != (snmpitem = (const ZBX_DC_SNMPITEM *)zbx_hashset_search(&config->snmpitems,
+				&dc_item->itemid)) && ZBX_SNMP_OID_TYPE_NORMAL == snmpitem->snmp_oid_type)
+		{
+			poller_type = ZBX_POLLER_TYPE_SNMP;
+		}
+	}
+
 	if (0 != (flags & ZBX_HOST_UNREACHABLE))
 	{
-		if (ZBX_POLLER_TYPE_NORMAL == poller_type || ZBX_POLLER_TYPE_JAVA == poller_type)
+		if (ZBX_POLLER_TYPE_NORMAL == poller_type || ZBX_POLLER_TYPE_AGENT == poller_type ||
+				ZBX_POLLER_TYPE_SNMP == poller_type || ZBX_POLLER_TYPE_JAVA == poller_type)
+		{
 			poller_type = ZBX_POLLER_TYPE_UNREACHABLE;
+		}
 
 		dc_item->poller_type = poller_type;
 		return;
@@ -425,8 +768,9 @@ static void	DCitem_poller_type_update(ZBX_DC_ITEM *dc_item, const ZBX_DC_HOST *d
 		return;
 	}
 
-	if (ZBX_POLLER_TYPE_UNREACHABLE != dc_item->poller_type ||
-			(ZBX_POLLER_TYPE_NORMAL != poller_type && ZBX_POLLER_TYPE_JAVA != poller_type))
+	if (ZBX_POLLER_TYPE_UNREACHABLE != dc_item->poller_type || (ZBX_POLLER_TYPE_NORMAL != poller_type &&
+			ZBX_POLLER_TYPE_AGENT != poller_type && ZBX_POLLER_TYPE_SNMP != poller_type &&
+			ZBX_POLLER_TYPE_JAVA != poller_type))
 	{
 		dc_item->poller_type = poller_type;
 	}
@@ -590,15 +934,14 @@ int	DCstrpool_replace(int found, const char **curr, const char *new_str)
 
 static void	DCupdate_item_queue(ZBX_DC_ITEM *item, unsigned char old_poller_type, int old_nextcheck)
 {
-	zbx_binary_heap_elem_t	elem;
-
 	if (ZBX_LOC_POLLER == item->location)
 		return;
 
 	if (ZBX_LOC_QUEUE == item->location && old_poller_type != item->poller_type)
 	{
 		item->location = ZBX_LOC_NOWHERE;
-		zbx_binary_heap_remove_direct(&config->queues[old_poller_type], item->itemid);
+		zbx_timing_wheel_remove(&config->queues[old_poller_type], item->itemid);
+		dc_item_load_update(item, old_poller_type, old_nextcheck, -1);
 	}
 
 	if (item->poller_type == ZBX_NO_POLLER)
@@ -607,22 +950,22 @@ static void	DCupdate_item_queue(ZBX_DC_ITEM *item, unsigned char old_poller_type
 	if (ZBX_LOC_QUEUE == item->location && old_nextcheck == item->nextcheck)
 		return;
 
-	elem.key = item->itemid;
-	elem.data = (const void *)item;
-
 	if (ZBX_LOC_QUEUE != item->location)
 	{
 		item->location = ZBX_LOC_QUEUE;
-		zbx_binary_heap_insert(&config->queues[item->poller_type], &elem);
+		zbx_timing_wheel_insert(&config->queues[item->poller_type], item->itemid, item, item->nextcheck);
 	}
 	else
-		zbx_binary_heap_update_direct(&config->queues[item->poller_type], &elem);
+	{
+		zbx_timing_wheel_update(&config->queues[item->poller_type], item->itemid, item->nextcheck);
+		dc_item_load_update(item, item->poller_type, old_nextcheck, -1);
+	}
+
+	dc_item_load_update(item, item->poller_type, item->nextcheck, 1);
 }
 
 static void	DCupdate_proxy_queue(ZBX_DC_PROXY *proxy)
 {
-	zbx_binary_heap_elem_t	elem;
-
 	if (ZBX_LOC_POLLER == proxy->location)
 		return;
 
@@ -632,16 +975,13 @@ static void	DCupdate_proxy_queue(ZBX_DC_PROXY *proxy)
 	if (proxy->proxy_config_nextcheck < proxy->nextcheck)
 		proxy->nextcheck = proxy->proxy_config_nextcheck;
 
-	elem.key = proxy->hostid;
-	elem.data = (const void *)proxy;
-
 	if (ZBX_LOC_QUEUE != proxy->location)
 	{
 		proxy->location = ZBX_LOC_QUEUE;
-		zbx_binary_heap_insert(&config->pqueue, &elem);
+		zbx_timing_wheel_insert(&config->pqueue, proxy->hostid, proxy, proxy->nextcheck);
 	}
 	else
-		zbx_binary_heap_update_direct(&config->pqueue, &elem);
+		zbx_timing_wheel_update(&config->pqueue, proxy->hostid, proxy->nextcheck);
 }
 
 /******************************************************************************
@@ -1119,7 +1459,7 @@ static void	DCsync_proxy_remove(ZBX_DC_PROXY *proxy)
 {
 	if (ZBX_LOC_QUEUE == proxy->location)
 	{
-		zbx_binary_heap_remove_direct(&config->pqueue, proxy->hostid);
+		zbx_timing_wheel_remove(&config->pqueue, proxy->hostid);
 		proxy->location = ZBX_LOC_NOWHERE;
 	}
 
@@ -1439,6 +1779,7 @@ done:
 			host->maintenance_from = atoi(row[9]);
 			host->data_expected_from = now;
 			host->update_items = 0;
+			host->um_revision = config->um_revision;
 
 			zbx_vector_ptr_create_ext(&host->interfaces_v, __config_shmem_malloc_func,
 					__config_shmem_realloc_func, __config_shmem_free_func);
@@ -1557,7 +1898,7 @@ done:
 			}
 			else if (HOST_STATUS_PROXY_ACTIVE == status && ZBX_LOC_QUEUE == proxy->location)
 			{
-				zbx_binary_heap_remove_direct(&config->pqueue, proxy->hostid);
+				zbx_timing_wheel_remove(&config->pqueue, proxy->hostid);
 				proxy->location = ZBX_LOC_NOWHERE;
 			}
 			proxy->last_version_error_time = time(NULL);
@@ -1728,7 +2069,7 @@ static void	DCsync_host_inventory(zbx_dbsync_t *sync)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
-static void	DCsync_htmpls(zbx_dbsync_t *sync)
+static void	DCsync_htmpls(zbx_dbsync_t *sync, zbx_vector_uint64_t *um_hostids)
 {
 	char			**row;
 	zbx_uint64_t		rowid;
@@ -1772,6 +2113,7 @@ static void	DCsync_htmpls(zbx_dbsync_t *sync)
 		}
 
 		zbx_vector_uint64_append(&htmpl->templateids, templateid);
+		zbx_vector_uint64_append(um_hostids, hostid);
 	}
 
 	/* remove deleted host templates from cache */
@@ -1782,6 +2124,8 @@ static void	DCsync_htmpls(zbx_dbsync_t *sync)
 		if (NULL == (htmpl = (ZBX_DC_HTMPL *)zbx_hashset_search(&config->htmpls, &hostid)))
 			continue;
 
+		zbx_vector_uint64_append(um_hostids, hostid);
+
 		ZBX_STR2UINT64(templateid, row[1]);
 
 		if (-1 == (index = zbx_vector_uint64_search(&htmpl->templateids, templateid,
@@ -1974,7 +2318,7 @@ static void	DCsync_gmacros(zbx_dbsync_t *sync)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
-static void	DCsync_hmacros(zbx_dbsync_t *sync)
+static void	DCsync_hmacros(zbx_dbsync_t *sync, zbx_vector_uint64_t *um_hostids)
 {
 	char			**row;
 	zbx_uint64_t		rowid;
@@ -2042,11 +2386,14 @@ static void	DCsync_hmacros(zbx_dbsync_t *sync)
 			{
 				hmacro_hm = config_hmacro_remove_index(&config->hmacros_hm, hmacro);
 				zbx_vector_ptr_append(&indexes, hmacro_hm);
+				zbx_vector_uint64_append(um_hostids, hmacro->hostid);
 			}
 
 			update_index = 1;
 		}
 
+		zbx_vector_uint64_append(um_hostids, hostid);
+
 		if (0 != found && NULL != hmacro->kv)
 			config_kvs_path_remove(hmacro->value, hmacro->kv);
 
@@ -2092,6 +2439,8 @@ static void	DCsync_hmacros(zbx_dbsync_t *sync)
 		if (NULL == (hmacro = (ZBX_DC_HMACRO *)zbx_hashset_search(&config->hmacros, &rowid)))
 			continue;
 
+		zbx_vector_uint64_append(um_hostids, hmacro->hostid);
+
 		if (NULL != hmacro->kv)
 			config_kvs_path_remove(hmacro->value, hmacro->kv);
 
@@ -2132,6 +2481,65 @@ static void	DCsync_hmacros(zbx_dbsync_t *sync)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: updates user macro revision of hosts affected by host macro and   *
+ *          template linkage changes                                          *
+ *                                                                            *
+ * Parameters: um_hostids - [IN/OUT] identifiers of hosts and templates with  *
+ *                                   changed macros or linked templates       *
+ *                                                                            *
+ * Comments: The changes are propagated to all hosts linking the changed      *
+ *           templates directly or through other templates.                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_um_update_revisions(zbx_vector_uint64_t *um_hostids)
+{
+	int			i, num;
+	zbx_hashset_iter_t	iter;
+	const ZBX_DC_HTMPL	*htmpl;
+	ZBX_DC_HOST		*host;
+
+	if (0 == um_hostids->values_num)
+		return;
+
+	zbx_vector_uint64_sort(um_hostids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_vector_uint64_uniq(um_hostids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	do
+	{
+		num = um_hostids->values_num;
+
+		zbx_hashset_iter_reset(&config->htmpls, &iter);
+		while (NULL != (htmpl = (const ZBX_DC_HTMPL *)zbx_hashset_iter_next(&iter)))
+		{
+			if (FAIL != zbx_vector_uint64_bsearch(um_hostids, htmpl->hostid, ZBX_DEFAULT_UINT64_COMPARE_FUNC))
+				continue;
+
+			for (i = 0; i < htmpl->templateids.values_num; i++)
+			{
+				if (FAIL != zbx_vector_uint64_bsearch(um_hostids, htmpl->templateids.values[i],
+						ZBX_DEFAULT_UINT64_COMPARE_FUNC))
+				{
+					zbx_vector_uint64_append(um_hostids, htmpl->hostid);
+					break;
+				}
+			}
+		}
+
+		zbx_vector_uint64_sort(um_hostids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	}
+	while (num != um_hostids->values_num);
+
+	config->um_revision++;
+
+	for (i = 0; i < um_hostids->values_num; i++)
+	{
+		if (NULL != (host = (ZBX_DC_HOST *)zbx_hashset_search(&config->hosts, &um_hostids->values[i])))
+			host->um_revision = config->um_revision;
+	}
+}
+
 void	DCsync_kvs_paths(const struct zbx_json_parse *jp_kvs_paths)
 {
 	zbx_dc_kvs_path_t	*dc_kvs_path;
@@ -2212,6 +2620,8 @@ void	DCsync_kvs_paths(const struct zbx_json_parse *jp_kvs_paths)
 				dc_kv->value = NULL;
 			}
 
+			config->um_global_revision = ++config->um_revision;
+
 			FINISH_SYNC;
 		}
 
@@ -2869,6 +3279,7 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags, zbx_synced_new_config_t
 			item->poller_type = ZBX_NO_POLLER;
 			item->queue_priority = ZBX_QUEUE_PRIORITY_NORMAL;
 			item->schedulable = 1;
+			item->nextcheck_shift = 0;
 
 			if (ZBX_SYNCED_NEW_CONFIG_YES == synced && 0 == host->proxy_hostid)
 				flags |= ZBX_ITEM_NEW;
@@ -2918,7 +3329,10 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags, zbx_synced_new_config_t
 		/* process item intervals and update item nextcheck */
 
 		if (SUCCEED == DCstrpool_replace(found, &item->delay, row[8]))
+		{
+			item->delay_type = ZBX_DC_DELAY_UNKNOWN;
 			flags |= ZBX_ITEM_DELAY_CHANGED;
+		}
 
 		/* numeric items */
 
@@ -3539,7 +3953,10 @@ static void	DCsync_items(zbx_dbsync_t *sync, int flags, zbx_synced_new_config_t
 		}
 
 		if (ZBX_LOC_QUEUE == item->location)
-			zbx_binary_heap_remove_direct(&config->queues[item->poller_type], item->itemid);
+		{
+			zbx_timing_wheel_remove(&config->queues[item->poller_type], item->itemid);
+			dc_item_load_update(item, item->poller_type, item->nextcheck, -1);
+		}
 
 		zbx_strpool_release(item->key);
 		zbx_strpool_release(item->error);
@@ -6024,6 +6441,13 @@ static void	zbx_dbsync_process_active_avail_diff(zbx_vector_uint64_t *diff)
  *                                                                            *
  * Purpose: Synchronize configuration data from database                      *
  *                                                                            *
+ * Comments: The database tables are compared without locking the cache.      *
+ *           The changes are then applied in several stages, each under the   *
+ *           configuration cache write lock, which is released between the    *
+ *           stages. Readers (pollers, trappers, history syncers) still block *
+ *           while a stage is applied - there are no read snapshots, so the   *
+ *           lock splitting only bounds the time of a single wait.            *
+ *                                                                            *
  ******************************************************************************/
 void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced)
 {
@@ -6049,13 +6473,27 @@ void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced)
 	zbx_uint64_t	update_flags = 0;
 
 	zbx_hashset_t			trend_queue;
-	zbx_vector_uint64_t		active_avail_diff;
+	zbx_vector_uint64_t		active_avail_diff, um_hostids;
+	int				changelog = FAIL, synced_all = FAIL;
+	unsigned char			sync_mode = mode;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
 	config->sync_start_ts = time(NULL);
 
 	zbx_dbsync_init_env(config);
+	zbx_vector_uint64_create(&um_hostids);
+
+	/* configuration cache restored from snapshot only has to catch up with database changes */
+	if (ZBX_DBSYNC_INIT == mode && 0 != config->restored)
+		sync_mode = ZBX_DBSYNC_UPDATE;
+
+	/* between periodic full comparisons sync tracked objects only from the recorded changes */
+	if (ZBX_DBSYNC_UPDATE == sync_mode && 0 != CONFIG_CONFSYNCER_FULL_FREQUENCY &&
+			config->sync_start_ts - config->full_sync_ts < CONFIG_CONFSYNCER_FULL_FREQUENCY)
+	{
+		changelog = SUCCEED;
+	}
 
 	if (ZBX_DBSYNC_INIT == mode)
 	{
@@ -6065,45 +6503,48 @@ void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced)
 
 	/* global configuration must be synchronized directly with database */
 	zbx_dbsync_init(&config_sync, ZBX_DBSYNC_INIT);
-	zbx_dbsync_init(&autoreg_config_sync, mode);
-	zbx_dbsync_init(&hosts_sync, mode);
-	zbx_dbsync_init(&hi_sync, mode);
-	zbx_dbsync_init(&htmpl_sync, mode);
-	zbx_dbsync_init(&gmacro_sync, mode);
-	zbx_dbsync_init(&hmacro_sync, mode);
-	zbx_dbsync_init(&if_sync, mode);
-	zbx_dbsync_init(&items_sync, mode);
-	zbx_dbsync_init(&template_items_sync, mode);
-	zbx_dbsync_init(&prototype_items_sync, mode);
-	zbx_dbsync_init(&item_discovery_sync, mode);
-	zbx_dbsync_init(&triggers_sync, mode);
-	zbx_dbsync_init(&tdep_sync, mode);
-	zbx_dbsync_init(&func_sync, mode);
-	zbx_dbsync_init(&expr_sync, mode);
-	zbx_dbsync_init(&action_sync, mode);
+	zbx_dbsync_init(&autoreg_config_sync, sync_mode);
+	zbx_dbsync_init(&hosts_sync, sync_mode);
+	zbx_dbsync_init(&hi_sync, sync_mode);
+	zbx_dbsync_init(&htmpl_sync, sync_mode);
+	zbx_dbsync_init(&gmacro_sync, sync_mode);
+	zbx_dbsync_init(&hmacro_sync, sync_mode);
+	zbx_dbsync_init(&if_sync, sync_mode);
+	zbx_dbsync_init(&items_sync, sync_mode);
+	zbx_dbsync_init(&template_items_sync, sync_mode);
+	zbx_dbsync_init(&prototype_items_sync, sync_mode);
+	zbx_dbsync_init(&item_discovery_sync, sync_mode);
+	zbx_dbsync_init(&triggers_sync, sync_mode);
+	zbx_dbsync_init(&tdep_sync, sync_mode);
+	zbx_dbsync_init(&func_sync, sync_mode);
+	zbx_dbsync_init(&expr_sync, sync_mode);
+	zbx_dbsync_init(&action_sync, sync_mode);
 
 	/* Action operation sync produces virtual rows with two columns - actionid, opflags. */
 	/* Because of this it cannot return the original database select and must always be  */
 	/* initialized in update mode.                                                       */
 	zbx_dbsync_init(&action_op_sync, ZBX_DBSYNC_UPDATE);
 
-	zbx_dbsync_init(&action_condition_sync, mode);
-	zbx_dbsync_init(&trigger_tag_sync, mode);
-	zbx_dbsync_init(&item_tag_sync, mode);
-	zbx_dbsync_init(&host_tag_sync, mode);
-	zbx_dbsync_init(&correlation_sync, mode);
-	zbx_dbsync_init(&corr_condition_sync, mode);
-	zbx_dbsync_init(&corr_operation_sync, mode);
-	zbx_dbsync_init(&hgroups_sync, mode);
-	zbx_dbsync_init(&hgroup_host_sync, mode);
-	zbx_dbsync_init(&itempp_sync, mode);
-	zbx_dbsync_init(&itemscrp_sync, mode);
-
-	zbx_dbsync_init(&maintenance_sync, mode);
-	zbx_dbsync_init(&maintenance_period_sync, mode);
-	zbx_dbsync_init(&maintenance_tag_sync, mode);
-	zbx_dbsync_init(&maintenance_group_sync, mode);
-	zbx_dbsync_init(&maintenance_host_sync, mode);
+	zbx_dbsync_init(&action_condition_sync, sync_mode);
+	zbx_dbsync_init(&trigger_tag_sync, sync_mode);
+	zbx_dbsync_init(&item_tag_sync, sync_mode);
+	zbx_dbsync_init(&host_tag_sync, sync_mode);
+	zbx_dbsync_init(&correlation_sync, sync_mode);
+	zbx_dbsync_init(&corr_condition_sync, sync_mode);
+	zbx_dbsync_init(&corr_operation_sync, sync_mode);
+	zbx_dbsync_init(&hgroups_sync, sync_mode);
+	zbx_dbsync_init(&hgroup_host_sync, sync_mode);
+	zbx_dbsync_init(&itempp_sync, sync_mode);
+	zbx_dbsync_init(&itemscrp_sync, sync_mode);
+
+	zbx_dbsync_init(&maintenance_sync, sync_mode);
+	zbx_dbsync_init(&maintenance_period_sync, sync_mode);
+	zbx_dbsync_init(&maintenance_tag_sync, sync_mode);
+	zbx_dbsync_init(&maintenance_group_sync, sync_mode);
+	zbx_dbsync_init(&maintenance_host_sync, sync_mode);
+
+	if (FAIL == zbx_dbsync_env_prepare(sync_mode, changelog))
+		goto out;
 
 	sec = zbx_time();
 	if (FAIL == zbx_dbsync_compare_config(&config_sync))
@@ -6150,7 +6591,7 @@ void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced)
 
 	START_SYNC;
 	sec = zbx_time();
-	DCsync_htmpls(&htmpl_sync);
+	DCsync_htmpls(&htmpl_sync, &um_hostids);
 	htsec2 = zbx_time() - sec;
 
 	sec = zbx_time();
@@ -6158,9 +6599,15 @@ void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced)
 	gmsec2 = zbx_time() - sec;
 
 	sec = zbx_time();
-	DCsync_hmacros(&hmacro_sync);
+	DCsync_hmacros(&hmacro_sync, &um_hostids);
 	hmsec2 = zbx_time() - sec;
 
+	/* invalidate user macro values cached by processes */
+	if (0 != gmacro_sync.add_num + gmacro_sync.update_num + gmacro_sync.remove_num)
+		config->um_global_revision = ++config->um_revision;
+
+	dc_um_update_revisions(&um_hostids);
+
 	sec = zbx_time();
 	DCsync_host_tags(&host_tag_sync);
 	host_tag_sec2 = zbx_time() - sec;
@@ -6255,6 +6702,19 @@ void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced)
 		goto out;
 	ifsec = zbx_time() - sec;
 
+	/* changes in linked templates, macros, hosts and interfaces can affect items without being recorded */
+	/* in changelog (cascaded deletes on MySQL do not fire triggers), compare the whole table instead     */
+	if (0 != htmpl_sync.add_num + htmpl_sync.update_num + htmpl_sync.remove_num +
+			gmacro_sync.add_num + gmacro_sync.update_num + gmacro_sync.remove_num +
+			hmacro_sync.add_num + hmacro_sync.update_num + hmacro_sync.remove_num +
+			hosts_sync.add_num + hosts_sync.update_num + hosts_sync.remove_num +
+			if_sync.add_num + if_sync.update_num + if_sync.remove_num)
+	{
+		zbx_dbsync_env_disable_changelog(ZBX_DBSYNC_OBJ_ITEM);
+		zbx_dbsync_env_disable_changelog(ZBX_DBSYNC_OBJ_FUNCTION);
+		zbx_dbsync_env_disable_changelog(ZBX_DBSYNC_OBJ_TRIGGER);
+	}
+
 	sec = zbx_time();
 	if (FAIL == zbx_dbsync_compare_items(&items_sync))
 		goto out;
@@ -6333,6 +6793,13 @@ void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced)
 		goto out;
 	item_tag_sec = zbx_time() - sec;
 
+	/* functions of added or removed items are not recorded as changed */
+	if (0 != items_sync.add_num + items_sync.remove_num)
+	{
+		zbx_dbsync_env_disable_changelog(ZBX_DBSYNC_OBJ_FUNCTION);
+		zbx_dbsync_env_disable_changelog(ZBX_DBSYNC_OBJ_TRIGGER);
+	}
+
 	sec = zbx_time();
 	if (FAIL == zbx_dbsync_compare_functions(&func_sync))
 		goto out;
@@ -6346,6 +6813,9 @@ void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced)
 
 	/* sync rest of the data */
 
+	if (0 != func_sync.add_num + func_sync.update_num + func_sync.remove_num)
+		zbx_dbsync_env_disable_changelog(ZBX_DBSYNC_OBJ_TRIGGER);
+
 	sec = zbx_time();
 	if (FAIL == zbx_dbsync_compare_triggers(&triggers_sync))
 		goto out;
@@ -6410,18 +6880,6 @@ void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced)
 	DCsync_expressions(&expr_sync);
 	expr_sec2 = zbx_time() - sec;
 
-	sec = zbx_time();
-	DCsync_actions(&action_sync);
-	action_sec2 = zbx_time() - sec;
-
-	sec = zbx_time();
-	DCsync_action_ops(&action_op_sync);
-	action_op_sec2 = zbx_time() - sec;
-
-	sec = zbx_time();
-	DCsync_action_conditions(&action_condition_sync);
-	action_condition_sec2 = zbx_time() - sec;
-
 	sec = zbx_time();
 	/* relies on triggers, must be after DCsync_triggers() */
 	DCsync_trigger_tags(&trigger_tag_sync);
@@ -6432,23 +6890,9 @@ void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced)
 	item_tag_sec2 = zbx_time() - sec;
 
 	sec = zbx_time();
-	DCsync_correlations(&correlation_sync);
-	correlation_sec2 = zbx_time() - sec;
 
-	sec = zbx_time();
-	/* relies on correlation rules, must be after DCsync_correlations() */
-	DCsync_corr_conditions(&corr_condition_sync);
-	corr_condition_sec2 = zbx_time() - sec;
-
-	sec = zbx_time();
-	/* relies on correlation rules, must be after DCsync_correlations() */
-	DCsync_corr_operations(&corr_operation_sync);
-	corr_operation_sec2 = zbx_time() - sec;
-
-	sec = zbx_time();
-
-	if (0 != hosts_sync.add_num + hosts_sync.update_num + hosts_sync.remove_num)
-		update_flags |= ZBX_DBSYNC_UPDATE_HOSTS;
+	if (0 != hosts_sync.add_num + hosts_sync.update_num + hosts_sync.remove_num)
+		update_flags |= ZBX_DBSYNC_UPDATE_HOSTS;
 
 	if (0 != items_sync.add_num + items_sync.update_num + items_sync.remove_num)
 		update_flags |= ZBX_DBSYNC_UPDATE_ITEMS;
@@ -6468,14 +6912,53 @@ void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced)
 
 	/* update various trigger related links in cache */
 	if (0 != (update_flags & (ZBX_DBSYNC_UPDATE_HOSTS | ZBX_DBSYNC_UPDATE_ITEMS | ZBX_DBSYNC_UPDATE_FUNCTIONS |
-			ZBX_DBSYNC_UPDATE_TRIGGERS)))
+			ZBX_DBSYNC_UPDATE_TRIGGERS)) || 0 != config->restored)
 	{
 		dc_trigger_update_cache();
 		dc_schedule_trigger_timers((ZBX_DBSYNC_INIT == mode ? &trend_queue : NULL), time(NULL));
+
+		/* timers are not kept in snapshot and must be scheduled for all triggers */
+		config->restored = 0;
 	}
 
 	update_sec = zbx_time() - sec;
 
+	FINISH_SYNC;
+
+	/* actions and correlations do not depend on triggers, let waiting processes in before syncing them */
+	START_SYNC;
+
+	sec = zbx_time();
+	DCsync_actions(&action_sync);
+	action_sec2 = zbx_time() - sec;
+
+	sec = zbx_time();
+	DCsync_action_ops(&action_op_sync);
+	action_op_sec2 = zbx_time() - sec;
+
+	sec = zbx_time();
+	DCsync_action_conditions(&action_condition_sync);
+	action_condition_sec2 = zbx_time() - sec;
+
+	sec = zbx_time();
+	DCsync_correlations(&correlation_sync);
+	correlation_sec2 = zbx_time() - sec;
+
+	sec = zbx_time();
+	/* relies on correlation rules, must be after DCsync_correlations() */
+	DCsync_corr_conditions(&corr_condition_sync);
+	corr_condition_sec2 = zbx_time() - sec;
+
+	sec = zbx_time();
+	/* relies on correlation rules, must be after DCsync_correlations() */
+	DCsync_corr_operations(&corr_operation_sync);
+	corr_operation_sec2 = zbx_time() - sec;
+
+	if (FAIL == changelog)
+		config->full_sync_ts = config->sync_start_ts;
+
+	synced_all = SUCCEED;
+
 	if (SUCCEED == ZBX_CHECK_LOG_LEVEL(LOG_LEVEL_DEBUG))
 	{
 		total = csec + hsec + hisec + htsec + gmsec + hmsec + ifsec + idsec + isec +  tisec + pisec + tsec + dsec + fsec + expr_sec +
@@ -6725,12 +7208,12 @@ void	DCsync_configuration(unsigned char mode, zbx_synced_new_config_t synced)
 
 		for (i = 0; ZBX_POLLER_TYPE_COUNT > i; i++)
 		{
-			zabbix_log(LOG_LEVEL_DEBUG, "%s() queue[%d]   : %d (%d allocated)", __func__,
-					i, config->queues[i].elems_num, config->queues[i].elems_alloc);
+			zabbix_log(LOG_LEVEL_DEBUG, "%s() queue[%d]   : %d (%d due)", __func__,
+					i, zbx_timing_wheel_num(&config->queues[i]), config->queues[i].due.elems_num);
 		}
 
-		zabbix_log(LOG_LEVEL_DEBUG, "%s() pqueue     : %d (%d allocated)", __func__,
-				config->pqueue.elems_num, config->pqueue.elems_alloc);
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() pqueue     : %d (%d due)", __func__,
+				zbx_timing_wheel_num(&config->pqueue), config->pqueue.due.elems_num);
 
 		zabbix_log(LOG_LEVEL_DEBUG, "%s() timer queue: %d (%d allocated)", __func__,
 				config->trigger_queue.elems_num, config->trigger_queue.elems_alloc);
@@ -6756,6 +7239,7 @@ out:
 
 	FINISH_SYNC;
 
+	zbx_vector_uint64_destroy(&um_hostids);
 	zbx_dbsync_clear(&config_sync);
 	zbx_dbsync_clear(&autoreg_config_sync);
 	zbx_dbsync_clear(&hosts_sync);
@@ -6794,6 +7278,10 @@ out:
 	if (ZBX_DBSYNC_INIT == mode)
 		zbx_hashset_destroy(&trend_queue);
 
+	/* keep the changes in changelog until they are applied to configuration cache */
+	if (SUCCEED == synced_all)
+		zbx_dbsync_env_flush_changelog();
+
 	zbx_dbsync_free_env();
 
 	if (SUCCEED == ZBX_CHECK_LOG_LEVEL(LOG_LEVEL_TRACE))
@@ -6802,6 +7290,19 @@ out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: stops configuration sync worker threads and closes their database *
+ *          connections                                                       *
+ *                                                                            *
+ ******************************************************************************/
+void	DCsync_workers_stop(void)
+{
+#ifdef ZBX_DBSYNC_PREFETCH
+	zbx_dbsync_prefetch_destroy();
+#endif
+}
+
 /******************************************************************************
  *                                                                            *
  * Helper functions for configuration cache data structure element comparison *
@@ -7116,22 +7617,17 @@ static int	__config_data_session_compare(const void *d1, const void *d2)
 
 /******************************************************************************
  *                                                                            *
- * Purpose: Allocate shared memory for configuration cache                    *
+ * Purpose: allocates shared memory and creates empty configuration cache     *
  *                                                                            *
  ******************************************************************************/
-int	init_configuration_cache(char **error)
+static int	dc_create_cache(char **error)
 {
 	int	i, ret;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() size:" ZBX_FS_UI64, __func__, CONFIG_CONF_CACHE_SIZE);
-
-	if (SUCCEED != (ret = zbx_rwlock_create(&config_lock, ZBX_RWLOCK_CONFIG, error)))
-		goto out;
-
 	if (SUCCEED != (ret = zbx_shmem_create(&config_mem, CONFIG_CONF_CACHE_SIZE, "configuration cache",
 			"CacheSize", 0, error)))
 	{
-		goto out;
+		return ret;
 	}
 
 	config = (ZBX_DC_CONFIG *)__config_shmem_malloc_func(NULL, sizeof(ZBX_DC_CONFIG) +
@@ -7223,25 +7719,25 @@ int	init_configuration_cache(char **error)
 		switch (i)
 		{
 			case ZBX_POLLER_TYPE_JAVA:
-				zbx_binary_heap_create_ext(&config->queues[i],
+				zbx_timing_wheel_create_ext(&config->queues[i],
 						__config_java_elem_compare,
-						ZBX_BINARY_HEAP_OPTION_DIRECT,
+						(int)time(NULL),
 						__config_shmem_malloc_func,
 						__config_shmem_realloc_func,
 						__config_shmem_free_func);
 				break;
 			case ZBX_POLLER_TYPE_PINGER:
-				zbx_binary_heap_create_ext(&config->queues[i],
+				zbx_timing_wheel_create_ext(&config->queues[i],
 						__config_pinger_elem_compare,
-						ZBX_BINARY_HEAP_OPTION_DIRECT,
+						(int)time(NULL),
 						__config_shmem_malloc_func,
 						__config_shmem_realloc_func,
 						__config_shmem_free_func);
 				break;
 			default:
-				zbx_binary_heap_create_ext(&config->queues[i],
+				zbx_timing_wheel_create_ext(&config->queues[i],
 						__config_heap_elem_compare,
-						ZBX_BINARY_HEAP_OPTION_DIRECT,
+						(int)time(NULL),
 						__config_shmem_malloc_func,
 						__config_shmem_realloc_func,
 						__config_shmem_free_func);
@@ -7249,9 +7745,9 @@ int	init_configuration_cache(char **error)
 		}
 	}
 
-	zbx_binary_heap_create_ext(&config->pqueue,
+	zbx_timing_wheel_create_ext(&config->pqueue,
 					__config_proxy_compare,
-					ZBX_BINARY_HEAP_OPTION_DIRECT,
+					(int)time(NULL),
 					__config_shmem_malloc_func,
 					__config_shmem_realloc_func,
 					__config_shmem_free_func);
@@ -7263,6 +7759,9 @@ int	init_configuration_cache(char **error)
 					__config_shmem_realloc_func,
 					__config_shmem_free_func);
 
+	config->item_load = NULL;
+	dc_item_load_init();
+
 	CREATE_HASHSET_EXT(config->data_sessions, 0, __config_data_session_hash, __config_data_session_compare);
 
 	config->config = NULL;
@@ -7274,6 +7773,10 @@ int	init_configuration_cache(char **error)
 	config->sync_ts = 0;
 	config->item_sync_ts = 0;
 	config->sync_start_ts = 0;
+	config->full_sync_ts = 0;
+	config->restored = 0;
+	config->um_revision = 0;
+	config->um_global_revision = 0;
 
 	config->internal_actions = 0;
 
@@ -7302,7 +7805,24 @@ int	init_configuration_cache(char **error)
 
 #undef CREATE_HASHSET
 #undef CREATE_HASHSET_EXT
-out:
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: Allocate shared memory for configuration cache                    *
+ *                                                                            *
+ ******************************************************************************/
+int	init_configuration_cache(char **error)
+{
+	int	ret;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() size:" ZBX_FS_UI64, __func__, CONFIG_CONF_CACHE_SIZE);
+
+	if (SUCCEED == (ret = zbx_rwlock_create(&config_lock, ZBX_RWLOCK_CONFIG, error)))
+		ret = dc_create_cache(error);
+
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 
 	return ret;
@@ -8347,6 +8867,39 @@ void	DCconfig_get_items_by_itemids_partial(DC_ITEM *items, const zbx_uint64_t *i
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get value types of the specified items                            *
+ *                                                                            *
+ * Parameters: itemids     - [IN] the item identifiers                        *
+ *             value_types - [OUT] the item value types                       *
+ *             errcodes    - [OUT] SUCCEED if item was found in configuration *
+ *                                 cache, FAIL otherwise                      *
+ *             num         - [IN] the number of items                         *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_dc_get_item_value_types(const zbx_uint64_t *itemids, unsigned char *value_types, int *errcodes, int num)
+{
+	int			i;
+	const ZBX_DC_ITEM	*dc_item;
+
+	RDLOCK_CACHE;
+
+	for (i = 0; i < num; i++)
+	{
+		if (NULL == (dc_item = (const ZBX_DC_ITEM *)zbx_hashset_search(&config->items, &itemids[i])))
+		{
+			errcodes[i] = FAIL;
+			continue;
+		}
+
+		value_types[i] = dc_item->value_type;
+		errcodes[i] = SUCCEED;
+	}
+
+	UNLOCK_CACHE;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: initialize new preprocessor item from configuration cache         *
@@ -9421,20 +9974,11 @@ unlock:
  * Return value: nextcheck or FAIL if no items for the specified queue        *
  *                                                                            *
  ******************************************************************************/
-static int	dc_config_get_queue_nextcheck(zbx_binary_heap_t *queue)
+static int	dc_config_get_queue_nextcheck(zbx_timing_wheel_t *queue)
 {
-	int				nextcheck;
-	const zbx_binary_heap_elem_t	*min;
-	const ZBX_DC_ITEM		*dc_item;
-
-	if (FAIL == zbx_binary_heap_empty(queue))
-	{
-		min = zbx_binary_heap_find_min(queue);
-		dc_item = (const ZBX_DC_ITEM *)min->data;
+	int	nextcheck;
 
-		nextcheck = dc_item->nextcheck;
-	}
-	else
+	if (SUCCEED != zbx_timing_wheel_get_nexttime(queue, &nextcheck))
 		nextcheck = FAIL;
 
 	return nextcheck;
@@ -9452,7 +9996,7 @@ static int	dc_config_get_queue_nextcheck(zbx_binary_heap_t *queue)
 int	DCconfig_get_poller_nextcheck(unsigned char poller_type)
 {
 	int			nextcheck;
-	zbx_binary_heap_t	*queue;
+	zbx_timing_wheel_t	*queue;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() poller_type:%d", __func__, (int)poller_type);
 
@@ -9511,60 +10055,41 @@ static void	dc_requeue_item_at(ZBX_DC_ITEM *dc_item, ZBX_DC_HOST *dc_host, int n
 
 /******************************************************************************
  *                                                                            *
- * Purpose: Get array of items for selected poller                            *
+ * Purpose: takes up to max_items due items from the poller queue             *
  *                                                                            *
  * Parameters: poller_type - [IN] poller type (ZBX_POLLER_TYPE_...)           *
- *             items       - [OUT] array of items                             *
- *                                                                            *
- * Return value: number of items in items array                               *
- *                                                                            *
- * Comments: Items leave the queue only through this function. Pollers must   *
- *           always return the items they have taken using DCrequeue_items()  *
- *           or DCpoller_requeue_items().                                     *
- *                                                                            *
- *           Currently batch polling is supported only for JMX, SNMP and      *
- *           icmpping* simple checks. In other cases only single item is      *
- *           retrieved.                                                       *
- *                                                                            *
- *           IPMI poller queue are handled by DCconfig_get_ipmi_poller_items()*
- *           function.                                                        *
+ *             max_items   - [IN] the maximum number of items to get          *
+ *             allocate    - [IN] 1 - allocate items array if more than one   *
+ *                                    item can be returned                    *
+ *                                0 - items points to array of max_items      *
+ *                                    elements                                *
+ *             items       - [IN/OUT] array of items                          *
  *                                                                            *
  ******************************************************************************/
-int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
+static int	dc_config_get_poller_items(unsigned char poller_type, int max_items, int allocate, DC_ITEM **items)
 {
-	int			now, num = 0, max_items;
-	zbx_binary_heap_t	*queue;
+	int				now, num = 0;
+	zbx_timing_wheel_t		*queue;
+	const zbx_binary_heap_elem_t	*min;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() poller_type:%d", __func__, (int)poller_type);
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() poller_type:%d max_items:%d", __func__, (int)poller_type, max_items);
 
 	now = time(NULL);
 
 	queue = &config->queues[poller_type];
 
-	switch (poller_type)
-	{
-		case ZBX_POLLER_TYPE_JAVA:
-			max_items = MAX_JAVA_ITEMS;
-			break;
-		case ZBX_POLLER_TYPE_PINGER:
-			max_items = MAX_PINGER_ITEMS;
-			break;
-		default:
-			max_items = 1;
-	}
-
 	WRLOCK_CACHE;
 
-	while (num < max_items && FAIL == zbx_binary_heap_empty(queue))
+	zbx_timing_wheel_advance(queue, now);
+
+	while (num < max_items && NULL != (min = zbx_timing_wheel_find_due(queue)))
 	{
 		int				disable_until;
-		const zbx_binary_heap_elem_t	*min;
 		ZBX_DC_HOST			*dc_host;
 		ZBX_DC_INTERFACE		*dc_interface;
 		ZBX_DC_ITEM			*dc_item;
 		static const ZBX_DC_ITEM	*dc_item_prev = NULL;
 
-		min = zbx_binary_heap_find_min(queue);
 		dc_item = (ZBX_DC_ITEM *)min->data;
 
 		if (dc_item->nextcheck > now)
@@ -9584,7 +10109,8 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
 			}
 		}
 
-		zbx_binary_heap_remove_min(queue);
+		zbx_timing_wheel_remove_due(queue);
+		dc_item_load_update(dc_item, dc_item->poller_type, dc_item->nextcheck, -1);
 		dc_item->location = ZBX_LOC_NOWHERE;
 
 		if (NULL == (dc_host = (ZBX_DC_HOST *)zbx_hashset_search(&config->hosts, &dc_item->hostid)))
@@ -9619,7 +10145,8 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
 				/* move items on unreachable hosts to unreachable pollers or    */
 				/* postpone checks on hosts that have been checked recently and */
 				/* are still unreachable                                        */
-				if (ZBX_POLLER_TYPE_NORMAL == poller_type || ZBX_POLLER_TYPE_JAVA == poller_type ||
+				if (ZBX_POLLER_TYPE_NORMAL == poller_type || ZBX_POLLER_TYPE_AGENT == poller_type ||
+						ZBX_POLLER_TYPE_SNMP == poller_type || ZBX_POLLER_TYPE_JAVA == poller_type ||
 						disable_until > now)
 				{
 					dc_requeue_item(dc_item, dc_host, dc_interface,
@@ -9633,8 +10160,8 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
 
 		if (0 == num)
 		{
-			if (ZBX_POLLER_TYPE_NORMAL == poller_type && ITEM_TYPE_SNMP == dc_item->type &&
-					0 == (ZBX_FLAG_DISCOVERY_RULE & dc_item->flags))
+			if ((ZBX_POLLER_TYPE_NORMAL == poller_type || ZBX_POLLER_TYPE_SNMP == poller_type) &&
+					ITEM_TYPE_SNMP == dc_item->type && 0 == (ZBX_FLAG_DISCOVERY_RULE & dc_item->flags))
 			{
 				ZBX_DC_SNMPITEM	*snmpitem;
 
@@ -9647,7 +10174,7 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
 				}
 			}
 
-			if (1 < max_items)
+			if (1 < max_items && 0 != allocate)
 				*items = zbx_malloc(NULL, sizeof(DC_ITEM) * max_items);
 		}
 
@@ -9665,6 +10192,101 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
 	return num;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: Get array of items for selected poller                            *
+ *                                                                            *
+ * Parameters: poller_type - [IN] poller type (ZBX_POLLER_TYPE_...)           *
+ *             items       - [OUT] array of items                             *
+ *                                                                            *
+ * Return value: number of items in items array                               *
+ *                                                                            *
+ * Comments: Items leave the queue only through this function. Pollers must   *
+ *           always return the items they have taken using DCrequeue_items()  *
+ *           or DCpoller_requeue_items().                                     *
+ *                                                                            *
+ *           Currently batch polling is supported only for JMX, SNMP and      *
+ *           icmpping* simple checks. In other cases only single item is      *
+ *           retrieved.                                                       *
+ *                                                                            *
+ *           IPMI poller queue are handled by DCconfig_get_ipmi_poller_items()*
+ *           function.                                                        *
+ *                                                                            *
+ ******************************************************************************/
+int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
+{
+	int	max_items;
+
+	switch (poller_type)
+	{
+		case ZBX_POLLER_TYPE_JAVA:
+			max_items = MAX_JAVA_ITEMS;
+			break;
+		case ZBX_POLLER_TYPE_PINGER:
+			max_items = MAX_PINGER_ITEMS;
+			break;
+		default:
+			max_items = 1;
+	}
+
+	return dc_config_get_poller_items(poller_type, max_items, 1, items);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get array of items for agent poller                               *
+ *                                                                            *
+ * Parameters: items     - [OUT] array of items                               *
+ *             max_items - [IN] the items array size                          *
+ *                                                                            *
+ * Return value: number of items in items array                               *
+ *                                                                            *
+ * Comments: Agent pollers take as many items as they have free request slots *
+ *           and must return them with DCpoller_requeue_items().              *
+ *                                                                            *
+ ******************************************************************************/
+int	DCconfig_get_agent_poller_items(DC_ITEM *items, int max_items)
+{
+	return dc_config_get_poller_items(ZBX_POLLER_TYPE_AGENT, max_items, 0, &items);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get array of items for SNMP poller                                *
+ *                                                                            *
+ * Parameters: items     - [OUT] array of items                               *
+ *             max_items - [IN] the items array size                          *
+ *                                                                            *
+ * Return value: number of items in items array                               *
+ *                                                                            *
+ * Comments: Items of one interface are returned per call, up to the number   *
+ *           of variables the interface is expected to handle in a single     *
+ *           request. Items must be returned with DCpoller_requeue_items().   *
+ *                                                                            *
+ ******************************************************************************/
+int	DCconfig_get_snmp_poller_items(DC_ITEM *items, int max_items)
+{
+	return dc_config_get_poller_items(ZBX_POLLER_TYPE_SNMP, max_items, 0, &items);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get array of items for HTTP agent poller                          *
+ *                                                                            *
+ * Parameters: items     - [OUT] array of items                               *
+ *             max_items - [IN] the items array size                          *
+ *                                                                            *
+ * Return value: number of items in items array                               *
+ *                                                                            *
+ * Comments: HTTP agent pollers take as many items as they have free request  *
+ *           slots and must return them with DCpoller_requeue_items().        *
+ *                                                                            *
+ ******************************************************************************/
+int	DCconfig_get_httpagent_poller_items(DC_ITEM *items, int max_items)
+{
+	return dc_config_get_poller_items(ZBX_POLLER_TYPE_HTTPAGENT, max_items, 0, &items);
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: Get array of items for IPMI poller                                *
@@ -9683,8 +10305,9 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM **items)
  ******************************************************************************/
 int	DCconfig_get_ipmi_poller_items(int now, DC_ITEM *items, int items_num, int *nextcheck)
 {
-	int			num = 0;
-	zbx_binary_heap_t	*queue;
+	int				num = 0;
+	zbx_timing_wheel_t		*queue;
+	const zbx_binary_heap_elem_t	*min;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -9692,21 +10315,22 @@ int	DCconfig_get_ipmi_poller_items(int now, DC_ITEM *items, int items_num, int *
 
 	WRLOCK_CACHE;
 
-	while (num < items_num && FAIL == zbx_binary_heap_empty(queue))
+	zbx_timing_wheel_advance(queue, now);
+
+	while (num < items_num && NULL != (min = zbx_timing_wheel_find_due(queue)))
 	{
-		int				disable_until;
-		const zbx_binary_heap_elem_t	*min;
-		ZBX_DC_HOST			*dc_host;
-		ZBX_DC_INTERFACE		*dc_interface;
-		ZBX_DC_ITEM			*dc_item;
+		int			disable_until;
+		ZBX_DC_HOST		*dc_host;
+		ZBX_DC_INTERFACE	*dc_interface;
+		ZBX_DC_ITEM		*dc_item;
 
-		min = zbx_binary_heap_find_min(queue);
 		dc_item = (ZBX_DC_ITEM *)min->data;
 
 		if (dc_item->nextcheck > now)
 			break;
 
-		zbx_binary_heap_remove_min(queue);
+		zbx_timing_wheel_remove_due(queue);
+		dc_item_load_update(dc_item, dc_item->poller_type, dc_item->nextcheck, -1);
 		dc_item->location = ZBX_LOC_NOWHERE;
 
 		if (NULL == (dc_host = (ZBX_DC_HOST *)zbx_hashset_search(&config->hosts, &dc_item->hostid)))
@@ -10679,8 +11303,9 @@ int	DCconfig_get_last_sync_time(void)
  ******************************************************************************/
 int	DCconfig_get_proxypoller_hosts(DC_PROXY *proxies, int max_hosts)
 {
-	int			now, num = 0;
-	zbx_binary_heap_t	*queue;
+	int				now, num = 0;
+	zbx_timing_wheel_t		*queue;
+	const zbx_binary_heap_elem_t	*min;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -10690,18 +11315,18 @@ int	DCconfig_get_proxypoller_hosts(DC_PROXY *proxies, int max_hosts)
 
 	WRLOCK_CACHE;
 
-	while (num < max_hosts && FAIL == zbx_binary_heap_empty(queue))
+	zbx_timing_wheel_advance(queue, now);
+
+	while (num < max_hosts && NULL != (min = zbx_timing_wheel_find_due(queue)))
 	{
-		const zbx_binary_heap_elem_t	*min;
-		ZBX_DC_PROXY			*dc_proxy;
+		ZBX_DC_PROXY	*dc_proxy;
 
-		min = zbx_binary_heap_find_min(queue);
 		dc_proxy = (ZBX_DC_PROXY *)min->data;
 
 		if (dc_proxy->nextcheck > now)
 			break;
 
-		zbx_binary_heap_remove_min(queue);
+		zbx_timing_wheel_remove_due(queue);
 		dc_proxy->location = ZBX_LOC_POLLER;
 
 		DCget_proxy(&proxies[num], dc_proxy);
@@ -10725,7 +11350,7 @@ int	DCconfig_get_proxypoller_hosts(DC_PROXY *proxies, int max_hosts)
 int	DCconfig_get_proxypoller_nextcheck(void)
 {
 	int			nextcheck;
-	zbx_binary_heap_t	*queue;
+	zbx_timing_wheel_t	*queue;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -10733,17 +11358,7 @@ int	DCconfig_get_proxypoller_nextcheck(void)
 
 	RDLOCK_CACHE;
 
-	if (FAIL == zbx_binary_heap_empty(queue))
-	{
-		const zbx_binary_heap_elem_t	*min;
-		const ZBX_DC_PROXY		*dc_proxy;
-
-		min = zbx_binary_heap_find_min(queue);
-		dc_proxy = (const ZBX_DC_PROXY *)min->data;
-
-		nextcheck = dc_proxy->nextcheck;
-	}
-	else
+	if (SUCCEED != zbx_timing_wheel_get_nexttime(queue, &nextcheck))
 		nextcheck = FAIL;
 
 	UNLOCK_CACHE;
@@ -10947,8 +11562,8 @@ static void	dc_get_global_macro(const char *macro, const char *context, char **v
 	}
 }
 
-static void	dc_get_user_macro(const zbx_uint64_t *hostids, int hostids_num, const char *macro, const char *context,
-		char **replace_to)
+static void	dc_resolve_user_macro(const zbx_uint64_t *hostids, int hostids_num, const char *macro,
+		const char *context, char **replace_to)
 {
 	char	*value = NULL, *value_default = NULL;
 
@@ -10982,35 +11597,180 @@ static void	dc_get_user_macro(const zbx_uint64_t *hostids, int hostids_num, cons
 	}
 }
 
-void	DCget_user_macro(const zbx_uint64_t *hostids, int hostids_num, const char *macro, char **replace_to)
+/* resolved user macro value, cached locally by each process */
+typedef struct
 {
-	char	*name = NULL, *context = NULL;
+	zbx_uint64_t	hostid;
+	zbx_uint64_t	revision;
+	char		*macro;
+	char		*context;
+	char		*value;		/* NULL if macro was not resolved */
+	unsigned char	env;
+}
+zbx_dc_um_value_t;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() macro:'%s'", __func__, macro);
+#define ZBX_DC_UM_VALUES_MAX	65536
 
-	if (SUCCEED != zbx_user_macro_parse_dyn(macro, &name, &context, NULL, NULL))
-		goto out;
+static zbx_hashset_t	dc_um_values;
 
-	RDLOCK_CACHE;
+static zbx_hash_t	dc_um_value_hash(const void *data)
+{
+	const zbx_dc_um_value_t	*um_value = (const zbx_dc_um_value_t *)data;
+	zbx_hash_t		hash;
 
-	dc_get_user_macro(hostids, hostids_num, name, context, replace_to);
+	hash = ZBX_DEFAULT_UINT64_HASH_ALGO(&um_value->hostid, sizeof(um_value->hostid), ZBX_DEFAULT_HASH_SEED);
+	hash = ZBX_DEFAULT_STRING_HASH_ALGO(um_value->macro, strlen(um_value->macro), hash);
 
-	UNLOCK_CACHE;
+	if (NULL != um_value->context)
+		hash = ZBX_DEFAULT_STRING_HASH_ALGO(um_value->context, strlen(um_value->context), hash);
 
-	zbx_free(context);
-	zbx_free(name);
-out:
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+	return ZBX_DEFAULT_UINT64_HASH_ALGO(&um_value->env, sizeof(um_value->env), hash);
+}
+
+static int	dc_um_value_compare(const void *d1, const void *d2)
+{
+	const zbx_dc_um_value_t	*um_value1 = (const zbx_dc_um_value_t *)d1;
+	const zbx_dc_um_value_t	*um_value2 = (const zbx_dc_um_value_t *)d2;
+	int			ret;
+
+	ZBX_RETURN_IF_NOT_EQUAL(um_value1->hostid, um_value2->hostid);
+	ZBX_RETURN_IF_NOT_EQUAL(um_value1->env, um_value2->env);
+
+	if (0 != (ret = strcmp(um_value1->macro, um_value2->macro)))
+		return ret;
+
+	return zbx_strcmp_null(um_value1->context, um_value2->context);
+}
+
+static void	dc_um_value_clean(void *data)
+{
+	zbx_dc_um_value_t	*um_value = (zbx_dc_um_value_t *)data;
+
+	zbx_free(um_value->macro);
+	zbx_free(um_value->context);
+	zbx_free(um_value->value);
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: expand user macros in the specified text value                    *
+ * Purpose: gets user macro value for a single host using process local cache *
  *                                                                            *
- * Parameters: text         - [IN] the text value to expand                   *
- *             len          - [IN] the text length                            *
- *             hostids      - [IN] an array of related hostids                *
- *             hostids_num  - [IN] the number of hostids                      *
+ * Parameters: hostids     - [IN] the host identifier array                   *
+ *             hostids_num - [IN] the number of hosts (0 or 1)                *
+ *             macro       - [IN] the macro name                              *
+ *             context     - [IN] the macro context (can be NULL)             *
+ *             replace_to  - [OUT] the macro value, unchanged if macro was    *
+ *                                 not resolved                               *
+ *                                                                            *
+ * Comments: Cached value is valid while neither global macros and secrets    *
+ *           nor macros and templates of the host or any of its templates     *
+ *           have changed, which is tracked by user macro revisions updated   *
+ *           during configuration sync. Values resolved for the hosts that    *
+ *           are not in configuration cache are not cached.                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_get_user_macro_cached(const zbx_uint64_t *hostids, int hostids_num, const char *macro,
+		const char *context, char **replace_to)
+{
+	zbx_dc_um_value_t	um_value_local, *um_value;
+	zbx_uint64_t		revision = config->um_global_revision;
+	char			*value = NULL;
+
+	if (0 != hostids_num)
+	{
+		const ZBX_DC_HOST	*host;
+
+		if (NULL == (host = (const ZBX_DC_HOST *)zbx_hashset_search(&config->hosts, &hostids[0])))
+		{
+			dc_resolve_user_macro(hostids, hostids_num, macro, context, replace_to);
+			return;
+		}
+
+		if (host->um_revision > revision)
+			revision = host->um_revision;
+
+		um_value_local.hostid = hostids[0];
+	}
+	else
+		um_value_local.hostid = 0;
+
+	if (0 == dc_um_values.num_slots)
+	{
+		zbx_hashset_create_ext(&dc_um_values, 1000, dc_um_value_hash, dc_um_value_compare, dc_um_value_clean,
+				ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
+	}
+
+	um_value_local.macro = (char *)macro;
+	um_value_local.context = (char *)context;
+	um_value_local.env = macro_env;
+
+	if (NULL != (um_value = (zbx_dc_um_value_t *)zbx_hashset_search(&dc_um_values, &um_value_local)))
+	{
+		if (um_value->revision >= revision)
+			goto out;
+
+		zbx_free(um_value->value);
+	}
+	else
+	{
+		if (ZBX_DC_UM_VALUES_MAX <= dc_um_values.num_data)
+			zbx_hashset_clear(&dc_um_values);
+
+		um_value_local.macro = zbx_strdup(NULL, macro);
+		um_value_local.context = (NULL != context ? zbx_strdup(NULL, context) : NULL);
+		um_value_local.value = NULL;
+
+		um_value = (zbx_dc_um_value_t *)zbx_hashset_insert(&dc_um_values, &um_value_local,
+				sizeof(um_value_local));
+	}
+
+	dc_resolve_user_macro(hostids, hostids_num, macro, context, &value);
+	um_value->value = value;
+	um_value->revision = config->um_revision;
+out:
+	if (NULL != um_value->value)
+		*replace_to = zbx_strdup(*replace_to, um_value->value);
+}
+
+static void	dc_get_user_macro(const zbx_uint64_t *hostids, int hostids_num, const char *macro, const char *context,
+		char **replace_to)
+{
+	/* values resolved for multiple hosts depend on template chains of all of them and are not cached */
+	if (1 < hostids_num)
+		dc_resolve_user_macro(hostids, hostids_num, macro, context, replace_to);
+	else
+		dc_get_user_macro_cached(hostids, hostids_num, macro, context, replace_to);
+}
+
+void	DCget_user_macro(const zbx_uint64_t *hostids, int hostids_num, const char *macro, char **replace_to)
+{
+	char	*name = NULL, *context = NULL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() macro:'%s'", __func__, macro);
+
+	if (SUCCEED != zbx_user_macro_parse_dyn(macro, &name, &context, NULL, NULL))
+		goto out;
+
+	RDLOCK_CACHE;
+
+	dc_get_user_macro(hostids, hostids_num, name, context, replace_to);
+
+	UNLOCK_CACHE;
+
+	zbx_free(context);
+	zbx_free(name);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: expand user macros in the specified text value                    *
+ *                                                                            *
+ * Parameters: text         - [IN] the text value to expand                   *
+ *             len          - [IN] the text length                            *
+ *             hostids      - [IN] an array of related hostids                *
+ *             hostids_num  - [IN] the number of hostids                      *
  *             value        - [IN] the expanded macro with expanded user      *
  *                                 macros. Unknown or invalid macros will be  *
  *                                 left unresolved.                           *
@@ -11252,6 +12012,11 @@ int	DCget_item_queue(zbx_vector_ptr_t *queue, int from, int to)
 		if (ITEM_STATUS_ACTIVE != dc_item->status)
 			continue;
 
+		/* check the delay first - most items are not delayed and the check */
+		/* needs only item scheduling data, without looking up other objects */
+		if (now - dc_item->nextcheck < from || (ZBX_QUEUE_TO_INFINITY != to && now - dc_item->nextcheck >= to))
+			continue;
+
 		if (SUCCEED != zbx_is_counted_in_item_queue(dc_item->type, dc_item->key))
 			continue;
 
@@ -11261,7 +12026,6 @@ int	DCget_item_queue(zbx_vector_ptr_t *queue, int from, int to)
 		if (HOST_STATUS_MONITORED != dc_host->status)
 			continue;
 
-
 		if (SUCCEED == DCin_maintenance_without_data_collection(dc_host, dc_item))
 			continue;
 
@@ -11283,7 +12047,7 @@ int	DCget_item_queue(zbx_vector_ptr_t *queue, int from, int to)
 			case ITEM_TYPE_ZABBIX_ACTIVE:
 				if (dc_host->data_expected_from > (data_expected_from = dc_item->data_expected_from))
 					data_expected_from = dc_host->data_expected_from;
-				if (SUCCEED != zbx_interval_preproc(dc_item->delay, &delay, NULL, NULL))
+				if (SUCCEED != dc_item_get_simple_interval(dc_item, &delay))
 					continue;
 				if (data_expected_from + delay > now)
 					continue;
@@ -11291,9 +12055,6 @@ int	DCget_item_queue(zbx_vector_ptr_t *queue, int from, int to)
 
 		}
 
-		if (now - dc_item->nextcheck < from || (ZBX_QUEUE_TO_INFINITY != to && now - dc_item->nextcheck >= to))
-			continue;
-
 		if (NULL != queue)
 		{
 			queue_item = (zbx_queue_item_t *)zbx_malloc(NULL, sizeof(zbx_queue_item_t));
@@ -11487,7 +12248,7 @@ static void	dc_status_update(void)
 				{
 					int	delay;
 
-					if (SUCCEED == zbx_interval_preproc(dc_item->delay, &delay, NULL, NULL) &&
+					if (SUCCEED == dc_item_get_simple_interval(dc_item, &delay) &&
 							0 != delay)
 					{
 						config->status->required_performance += 1.0 / delay;
@@ -14121,6 +14882,634 @@ int	zbx_dc_maintenance_has_tags(void)
 	return ret;
 }
 
+/*
+ * Configuration cache snapshot
+ *
+ * The snapshot contains image of the configuration cache shared memory, written on clean shutdown
+ * and restored on the next startup at the same address, so the pointers stored in the cache remain
+ * valid. The file format is:
+ *
+ *   header | shared memory image | end marker
+ *
+ * Function pointers of the cache containers are reset after loading, because they can change between
+ * process runs. Poller queues and trigger timers are rebuilt and the first configuration sync is
+ * performed in update mode, synchronizing only the changes made since the snapshot was written.
+ */
+
+#define ZBX_DC_SNAPSHOT_MAGIC		0x7a626463
+#define ZBX_DC_SNAPSHOT_VERSION		4
+#define ZBX_DC_SNAPSHOT_REVISION_LEN	64
+
+typedef struct
+{
+	zbx_uint32_t	magic;
+	zbx_uint32_t	version;
+	char		revision[ZBX_DC_SNAPSHOT_REVISION_LEN];
+	zbx_uint32_t	config_size;
+	zbx_uint32_t	item_size;
+	zbx_uint32_t	trigger_size;
+	zbx_uint32_t	host_size;
+	int		timer_forks;
+	int		clock;
+	zbx_uint64_t	cache_size;
+	zbx_uint64_t	config_ptr;
+}
+zbx_dc_snapshot_header_t;
+
+static void	dc_snapshot_header_init(zbx_dc_snapshot_header_t *header)
+{
+	memset(header, 0, sizeof(zbx_dc_snapshot_header_t));
+
+	header->magic = ZBX_DC_SNAPSHOT_MAGIC;
+	header->version = ZBX_DC_SNAPSHOT_VERSION;
+	zbx_snprintf(header->revision, sizeof(header->revision), "%s (revision %s)", ZABBIX_VERSION,
+			ZABBIX_REVISION);
+	header->config_size = sizeof(ZBX_DC_CONFIG);
+	header->item_size = sizeof(ZBX_DC_ITEM);
+	header->trigger_size = sizeof(ZBX_DC_TRIGGER);
+	header->host_size = sizeof(ZBX_DC_HOST);
+	header->timer_forks = CONFIG_TIMER_FORKS;
+	header->cache_size = CONFIG_CONF_CACHE_SIZE;
+}
+
+#define DC_RESTORE_MEM_FUNCS(container)							\
+	do										\
+	{										\
+		(container)->mem_malloc_func = __config_shmem_malloc_func;		\
+		(container)->mem_realloc_func = __config_shmem_realloc_func;		\
+		(container)->mem_free_func = __config_shmem_free_func;			\
+	}										\
+	while (0)
+
+static void	dc_restore_hashset(zbx_hashset_t *hashset, zbx_hash_func_t hash_func, zbx_compare_func_t compare_func)
+{
+	hashset->hash_func = hash_func;
+	hashset->compare_func = compare_func;
+	hashset->clean_func = NULL;
+	DC_RESTORE_MEM_FUNCS(hashset);
+}
+
+static void	dc_restore_heap(zbx_binary_heap_t *heap, zbx_compare_func_t compare_func)
+{
+	heap->compare_func = compare_func;
+	DC_RESTORE_MEM_FUNCS(heap);
+
+	if (NULL != heap->key_index)
+	{
+		heap->key_index->hash_func = ZBX_DEFAULT_UINT64_HASH_FUNC;
+		heap->key_index->compare_func = ZBX_DEFAULT_UINT64_COMPARE_FUNC;
+		DC_RESTORE_MEM_FUNCS(heap->key_index);
+	}
+}
+
+static void	dc_restore_timing_wheel(zbx_timing_wheel_t *wheel, zbx_compare_func_t compare_func)
+{
+	dc_restore_hashset(&wheel->nodes, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	dc_restore_heap(&wheel->due, compare_func);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: restores function pointers of configuration cache containers      *
+ *          after cache was loaded from snapshot                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_restore_containers(void)
+{
+#define RESTORE_HASHSET(hashset)	\
+	dc_restore_hashset(&hashset, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC)
+
+	int			i;
+	zbx_hashset_iter_t	iter;
+	ZBX_DC_HOST		*host;
+	ZBX_DC_HTMPL		*htmpl;
+	ZBX_DC_INTERFACE_ADDR	*addr;
+	ZBX_DC_INTERFACE_ITEM	*interface_item;
+	ZBX_DC_ITEM		*item;
+	ZBX_DC_SCRIPTITEM	*scriptitem;
+	ZBX_DC_MASTERITEM	*masteritem;
+	ZBX_DC_PREPROCITEM	*preprocitem;
+	ZBX_DC_TRIGGER		*trigger;
+	ZBX_DC_TRIGGER_DEPLIST	*trigdep;
+	ZBX_DC_GMACRO_M		*gmacro_m;
+	ZBX_DC_HMACRO_HM	*hmacro_hm;
+	ZBX_DC_REGEXP		*regexp;
+	zbx_dc_action_t		*action;
+	zbx_dc_correlation_t	*correlation;
+	zbx_dc_hostgroup_t	*group;
+	zbx_dc_host_tag_index_t	*tag_index;
+	zbx_dc_maintenance_t	*maintenance;
+
+	RESTORE_HASHSET(config->items);
+	RESTORE_HASHSET(config->numitems);
+	RESTORE_HASHSET(config->snmpitems);
+	RESTORE_HASHSET(config->ipmiitems);
+	RESTORE_HASHSET(config->trapitems);
+	RESTORE_HASHSET(config->dependentitems);
+	RESTORE_HASHSET(config->logitems);
+	RESTORE_HASHSET(config->dbitems);
+	RESTORE_HASHSET(config->sshitems);
+	RESTORE_HASHSET(config->telnetitems);
+	RESTORE_HASHSET(config->simpleitems);
+	RESTORE_HASHSET(config->jmxitems);
+	RESTORE_HASHSET(config->calcitems);
+	RESTORE_HASHSET(config->masteritems);
+	RESTORE_HASHSET(config->preprocitems);
+	RESTORE_HASHSET(config->httpitems);
+	RESTORE_HASHSET(config->scriptitems);
+	RESTORE_HASHSET(config->itemscript_params);
+	RESTORE_HASHSET(config->template_items);
+	RESTORE_HASHSET(config->item_discovery);
+	RESTORE_HASHSET(config->prototype_items);
+	RESTORE_HASHSET(config->functions);
+	RESTORE_HASHSET(config->triggers);
+	RESTORE_HASHSET(config->trigdeps);
+	RESTORE_HASHSET(config->hosts);
+	RESTORE_HASHSET(config->proxies);
+	RESTORE_HASHSET(config->host_inventories);
+	RESTORE_HASHSET(config->host_inventories_auto);
+	RESTORE_HASHSET(config->ipmihosts);
+	RESTORE_HASHSET(config->htmpls);
+	RESTORE_HASHSET(config->gmacros);
+	RESTORE_HASHSET(config->hmacros);
+	RESTORE_HASHSET(config->interfaces);
+	RESTORE_HASHSET(config->interfaces_snmp);
+	RESTORE_HASHSET(config->interface_snmpitems);
+	RESTORE_HASHSET(config->expressions);
+	RESTORE_HASHSET(config->actions);
+	RESTORE_HASHSET(config->action_conditions);
+	RESTORE_HASHSET(config->trigger_tags);
+	RESTORE_HASHSET(config->item_tags);
+	RESTORE_HASHSET(config->host_tags);
+	RESTORE_HASHSET(config->host_tags_index);
+	RESTORE_HASHSET(config->correlations);
+	RESTORE_HASHSET(config->corr_conditions);
+	RESTORE_HASHSET(config->corr_operations);
+	RESTORE_HASHSET(config->hostgroups);
+	RESTORE_HASHSET(config->preprocops);
+	RESTORE_HASHSET(config->maintenances);
+	RESTORE_HASHSET(config->maintenance_periods);
+	RESTORE_HASHSET(config->maintenance_tags);
+
+	dc_restore_hashset(&config->items_hk, __config_item_hk_hash, __config_item_hk_compare);
+	dc_restore_hashset(&config->hosts_h, __config_host_h_hash, __config_host_h_compare);
+	dc_restore_hashset(&config->hosts_p, __config_host_h_hash, __config_host_h_compare);
+	dc_restore_hashset(&config->gmacros_m, __config_gmacro_m_hash, __config_gmacro_m_compare);
+	dc_restore_hashset(&config->hmacros_hm, __config_hmacro_hm_hash, __config_hmacro_hm_compare);
+	dc_restore_hashset(&config->interfaces_ht, __config_interface_ht_hash, __config_interface_ht_compare);
+	dc_restore_hashset(&config->interface_snmpaddrs, __config_interface_addr_hash,
+			__config_interface_addr_compare);
+	dc_restore_hashset(&config->regexps, __config_regexp_hash, __config_regexp_compare);
+	dc_restore_hashset(&config->strpool, __config_strpool_hash, __config_strpool_compare);
+#if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
+	dc_restore_hashset(&config->psks, __config_psk_hash, __config_psk_compare);
+#endif
+	dc_restore_hashset(&config->data_sessions, __config_data_session_hash, __config_data_session_compare);
+
+	DC_RESTORE_MEM_FUNCS(&config->hostgroups_name);
+	DC_RESTORE_MEM_FUNCS(&config->kvs_paths);
+
+	for (i = 0; i < config->kvs_paths.values_num; i++)
+	{
+		zbx_dc_kvs_path_t	*kvs_path = (zbx_dc_kvs_path_t *)config->kvs_paths.values[i];
+
+		dc_restore_hashset(&kvs_path->kvs, dc_kv_hash, dc_kv_compare);
+	}
+
+	for (i = 0; i < ZBX_POLLER_TYPE_COUNT; i++)
+	{
+		switch (i)
+		{
+			case ZBX_POLLER_TYPE_JAVA:
+				dc_restore_timing_wheel(&config->queues[i], __config_java_elem_compare);
+				break;
+			case ZBX_POLLER_TYPE_PINGER:
+				dc_restore_timing_wheel(&config->queues[i], __config_pinger_elem_compare);
+				break;
+			default:
+				dc_restore_timing_wheel(&config->queues[i], __config_heap_elem_compare);
+				break;
+		}
+	}
+
+	dc_restore_timing_wheel(&config->pqueue, __config_proxy_compare);
+	dc_restore_heap(&config->trigger_queue, __config_timer_compare);
+
+	zbx_hashset_iter_reset(&config->hosts, &iter);
+	while (NULL != (host = (ZBX_DC_HOST *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&host->interfaces_v);
+
+	zbx_hashset_iter_reset(&config->htmpls, &iter);
+	while (NULL != (htmpl = (ZBX_DC_HTMPL *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&htmpl->templateids);
+
+	zbx_hashset_iter_reset(&config->interface_snmpaddrs, &iter);
+	while (NULL != (addr = (ZBX_DC_INTERFACE_ADDR *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&addr->interfaceids);
+
+	zbx_hashset_iter_reset(&config->interface_snmpitems, &iter);
+	while (NULL != (interface_item = (ZBX_DC_INTERFACE_ITEM *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&interface_item->itemids);
+
+	zbx_hashset_iter_reset(&config->items, &iter);
+	while (NULL != (item = (ZBX_DC_ITEM *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&item->tags);
+
+	zbx_hashset_iter_reset(&config->scriptitems, &iter);
+	while (NULL != (scriptitem = (ZBX_DC_SCRIPTITEM *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&scriptitem->params);
+
+	zbx_hashset_iter_reset(&config->masteritems, &iter);
+	while (NULL != (masteritem = (ZBX_DC_MASTERITEM *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&masteritem->dep_itemids);
+
+	zbx_hashset_iter_reset(&config->preprocitems, &iter);
+	while (NULL != (preprocitem = (ZBX_DC_PREPROCITEM *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&preprocitem->preproc_ops);
+
+	zbx_hashset_iter_reset(&config->triggers, &iter);
+	while (NULL != (trigger = (ZBX_DC_TRIGGER *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&trigger->tags);
+
+	zbx_hashset_iter_reset(&config->trigdeps, &iter);
+	while (NULL != (trigdep = (ZBX_DC_TRIGGER_DEPLIST *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&trigdep->dependencies);
+
+	zbx_hashset_iter_reset(&config->gmacros_m, &iter);
+	while (NULL != (gmacro_m = (ZBX_DC_GMACRO_M *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&gmacro_m->gmacros);
+
+	zbx_hashset_iter_reset(&config->hmacros_hm, &iter);
+	while (NULL != (hmacro_hm = (ZBX_DC_HMACRO_HM *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&hmacro_hm->hmacros);
+
+	zbx_hashset_iter_reset(&config->regexps, &iter);
+	while (NULL != (regexp = (ZBX_DC_REGEXP *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&regexp->expressionids);
+
+	zbx_hashset_iter_reset(&config->actions, &iter);
+	while (NULL != (action = (zbx_dc_action_t *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&action->conditions);
+
+	zbx_hashset_iter_reset(&config->correlations, &iter);
+	while (NULL != (correlation = (zbx_dc_correlation_t *)zbx_hashset_iter_next(&iter)))
+	{
+		DC_RESTORE_MEM_FUNCS(&correlation->conditions);
+		DC_RESTORE_MEM_FUNCS(&correlation->operations);
+	}
+
+	zbx_hashset_iter_reset(&config->hostgroups, &iter);
+	while (NULL != (group = (zbx_dc_hostgroup_t *)zbx_hashset_iter_next(&iter)))
+	{
+		RESTORE_HASHSET(group->hostids);
+
+		if (0 != (group->flags & ZBX_DC_HOSTGROUP_FLAGS_NESTED_GROUPIDS))
+			DC_RESTORE_MEM_FUNCS(&group->nested_groupids);
+	}
+
+	zbx_hashset_iter_reset(&config->host_tags_index, &iter);
+	while (NULL != (tag_index = (zbx_dc_host_tag_index_t *)zbx_hashset_iter_next(&iter)))
+		DC_RESTORE_MEM_FUNCS(&tag_index->tags);
+
+	zbx_hashset_iter_reset(&config->maintenances, &iter);
+	while (NULL != (maintenance = (zbx_dc_maintenance_t *)zbx_hashset_iter_next(&iter)))
+	{
+		DC_RESTORE_MEM_FUNCS(&maintenance->groupids);
+		DC_RESTORE_MEM_FUNCS(&maintenance->hostids);
+		DC_RESTORE_MEM_FUNCS(&maintenance->tags);
+		DC_RESTORE_MEM_FUNCS(&maintenance->periods);
+	}
+
+#undef RESTORE_HASHSET
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: resets runtime state of configuration cache loaded from snapshot  *
+ *                                                                            *
+ * Parameters: now - [IN] the current time                                    *
+ *                                                                            *
+ * Comments: The items and proxies are requeued, because they could have been *
+ *           taken by pollers when the snapshot was written. The items with   *
+ *           missed checks are rescheduled from the current time to avoid     *
+ *           polling all of them at once.                                     *
+ *           Trigger timers are dropped and rescheduled by the first          *
+ *           configuration sync.                                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_restore_runtime_state(int now)
+{
+	int			i;
+	zbx_hashset_iter_t	iter;
+	ZBX_DC_ITEM		*item;
+	ZBX_DC_HOST		*host;
+	ZBX_DC_PROXY		*proxy;
+	ZBX_DC_TRIGGER		*trigger;
+	ZBX_DC_FUNCTION		*function;
+
+	for (i = 0; i < ZBX_POLLER_TYPE_COUNT; i++)
+		zbx_timing_wheel_clear(&config->queues[i], now);
+
+	dc_item_load_init();
+
+	zbx_hashset_iter_reset(&config->hosts, &iter);
+	while (NULL != (host = (ZBX_DC_HOST *)zbx_hashset_iter_next(&iter)))
+		host->data_expected_from = now;
+
+	zbx_hashset_iter_reset(&config->items, &iter);
+	while (NULL != (item = (ZBX_DC_ITEM *)zbx_hashset_iter_next(&iter)))
+	{
+		unsigned char	old_poller_type = item->poller_type;
+
+		item->location = ZBX_LOC_NOWHERE;
+		item->data_expected_from = now;
+
+		if (ITEM_STATUS_ACTIVE != item->status ||
+				NULL == (host = (ZBX_DC_HOST *)zbx_hashset_search(&config->hosts, &item->hostid)) ||
+				HOST_STATUS_MONITORED != host->status)
+		{
+			continue;
+		}
+
+		DCitem_poller_type_update(item, host, 0);
+
+		if (item->nextcheck < now && SUCCEED == zbx_is_counted_in_item_queue(item->type, item->key))
+		{
+			char			*error = NULL;
+			ZBX_DC_INTERFACE	*interface;
+
+			interface = (ZBX_DC_INTERFACE *)zbx_hashset_search(&config->interfaces, &item->interfaceid);
+
+			if (FAIL == DCitem_nextcheck_update(item, interface, ZBX_ITEM_COLLECTED, now, &error))
+				zbx_free(error);
+		}
+
+		DCupdate_item_queue(item, old_poller_type, item->nextcheck);
+	}
+
+	zbx_timing_wheel_clear(&config->pqueue, now);
+
+	zbx_hashset_iter_reset(&config->proxies, &iter);
+	while (NULL != (proxy = (ZBX_DC_PROXY *)zbx_hashset_iter_next(&iter)))
+	{
+		if (ZBX_LOC_NOWHERE == proxy->location)
+			continue;
+
+		proxy->location = ZBX_LOC_NOWHERE;
+		DCupdate_proxy_queue(proxy);
+	}
+
+	while (SUCCEED != zbx_binary_heap_empty(&config->trigger_queue))
+	{
+		zbx_binary_heap_elem_t	*elem;
+
+		elem = zbx_binary_heap_find_min(&config->trigger_queue);
+		dc_trigger_timer_free((zbx_trigger_timer_t *)elem->data);
+		zbx_binary_heap_remove_min(&config->trigger_queue);
+	}
+
+	zbx_hashset_iter_reset(&config->functions, &iter);
+	while (NULL != (function = (ZBX_DC_FUNCTION *)zbx_hashset_iter_next(&iter)))
+		function->timer_revision = 0;
+
+	zbx_hashset_iter_reset(&config->triggers, &iter);
+	while (NULL != (trigger = (ZBX_DC_TRIGGER *)zbx_hashset_iter_next(&iter)))
+	{
+		trigger->timer_revision = 0;
+		trigger->locked = 0;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes configuration cache image into snapshot file               *
+ *                                                                            *
+ * Parameters: path  - [IN] the snapshot file path                            *
+ *             error - [OUT] the error message                                *
+ *                                                                            *
+ * Return value: SUCCEED - the snapshot was written successfully              *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The snapshot is written into temporary file which is renamed to  *
+ *           the target path only after all data are written.                 *
+ *           This function must be called after all processes using           *
+ *           configuration cache have exited.                                 *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_dc_save_snapshot(const char *path, char **error)
+{
+	FILE				*file;
+	char				*tmp_path;
+	int				ret = FAIL;
+	zbx_uint32_t			end = ZBX_DC_SNAPSHOT_MAGIC;
+	zbx_uint64_t			used_size;
+	zbx_dc_snapshot_header_t	header;
+
+	if (NULL == config)
+		return SUCCEED;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() path:%s", __func__, path);
+
+	tmp_path = zbx_dsprintf(NULL, "%s.tmp", path);
+
+	if (NULL == (file = fopen(tmp_path, "wb")))
+	{
+		*error = zbx_dsprintf(*error, "cannot open file \"%s\": %s", tmp_path, zbx_strerror(errno));
+		goto out;
+	}
+
+	dc_snapshot_header_init(&header);
+	header.clock = (int)time(NULL);
+	header.config_ptr = (zbx_uint64_t)(uintptr_t)config;
+
+	RDLOCK_CACHE;
+
+	fwrite(&header, sizeof(header), 1, file);
+	zbx_shmem_write_image(config_mem, file);
+	used_size = config_mem->used_size;
+
+	UNLOCK_CACHE;
+
+	fwrite(&end, sizeof(end), 1, file);
+
+	if (0 != ferror(file))
+	{
+		*error = zbx_dsprintf(*error, "cannot write file \"%s\": %s", tmp_path, zbx_strerror(errno));
+		fclose(file);
+		unlink(tmp_path);
+		goto out;
+	}
+
+	if (0 != fclose(file))
+	{
+		*error = zbx_dsprintf(*error, "cannot close file \"%s\": %s", tmp_path, zbx_strerror(errno));
+		unlink(tmp_path);
+		goto out;
+	}
+
+	if (0 != rename(tmp_path, path))
+	{
+		*error = zbx_dsprintf(*error, "cannot rename file \"%s\" to \"%s\": %s", tmp_path, path,
+				zbx_strerror(errno));
+		unlink(tmp_path);
+		goto out;
+	}
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "saved configuration cache snapshot with " ZBX_FS_UI64 " bytes of data",
+			used_size);
+
+	ret = SUCCEED;
+out:
+	zbx_free(tmp_path);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: replaces configuration cache with image loaded from snapshot file *
+ *                                                                            *
+ * Parameters: path        - [IN] the snapshot file path                      *
+ *             validate_cb - [IN] the callback to check if snapshot written   *
+ *                                at the specified time can be used (optional)*
+ *             error       - [OUT] the error message                          *
+ *                                                                            *
+ * Return value: SUCCEED - the snapshot was loaded or there was no snapshot   *
+ *               FAIL    - the snapshot could not be used                     *
+ *                                                                            *
+ * Comments: The snapshot can be used only by the same server build with the  *
+ *           same cache size and number of timers. When the snapshot cannot   *
+ *           be loaded an empty configuration cache is used, which is fully   *
+ *           synchronized with database as usual.                             *
+ *           The snapshot file is removed after it has been processed.        *
+ *                                                                            *
+ *           This function must be called after configuration cache is        *
+ *           initialized and before it is used by other processes.            *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_dc_load_snapshot(const char *path, zbx_dc_snapshot_validate_func_t validate_cb, char **error)
+{
+	int				fd, ret = FAIL;
+	zbx_stat_t			buf;
+	void				*data = MAP_FAILED;
+	zbx_uint32_t			end;
+	zbx_dc_snapshot_header_t	header, local_header;
+	zbx_shmem_info_t		*mem;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() path:%s", __func__, path);
+
+	if (-1 == (fd = zbx_open(path, O_RDONLY)))
+	{
+		if (ENOENT == errno)
+		{
+			ret = SUCCEED;
+			goto clean;
+		}
+
+		*error = zbx_dsprintf(*error, "cannot open file \"%s\": %s", path, zbx_strerror(errno));
+		goto clean;
+	}
+
+	if (0 != zbx_fstat(fd, &buf))
+	{
+		*error = zbx_dsprintf(*error, "cannot obtain information for file \"%s\": %s", path,
+				zbx_strerror(errno));
+		close(fd);
+		goto out;
+	}
+
+	if ((size_t)buf.st_size < sizeof(header) + sizeof(end))
+	{
+		*error = zbx_dsprintf(*error, "file \"%s\" is too small", path);
+		close(fd);
+		goto out;
+	}
+
+	data = mmap(NULL, (size_t)buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (MAP_FAILED == data)
+	{
+		*error = zbx_dsprintf(*error, "cannot map file \"%s\": %s", path, zbx_strerror(errno));
+		goto out;
+	}
+
+	memcpy(&header, data, sizeof(header));
+	memcpy(&end, (const char *)data + buf.st_size - sizeof(end), sizeof(end));
+
+	dc_snapshot_header_init(&local_header);
+	local_header.clock = header.clock;
+	local_header.config_ptr = header.config_ptr;
+
+	if (ZBX_DC_SNAPSHOT_MAGIC != end || 0 != memcmp(&header, &local_header, sizeof(header)))
+	{
+		*error = zbx_dsprintf(*error, "file \"%s\" is not a compatible configuration cache snapshot", path);
+		goto out;
+	}
+
+	if (NULL != validate_cb && SUCCEED != validate_cb(header.clock))
+	{
+		*error = zbx_dsprintf(*error, "snapshot \"%s\" is outdated", path);
+		goto out;
+	}
+
+	/* The configuration cache is not used yet, so it can be detached to ensure */
+	/* that its address range does not overlap with the snapshot address range.  */
+	zbx_shmem_destroy(config_mem);
+	config_mem = NULL;
+	config = NULL;
+
+	if (SUCCEED != zbx_shmem_create_from_image(&mem, (const char *)data + sizeof(header),
+			(size_t)buf.st_size - sizeof(header) - sizeof(end), "configuration cache", "CacheSize", error))
+	{
+		goto recreate;
+	}
+
+	if (header.config_ptr < (zbx_uint64_t)(uintptr_t)mem->lo_bound ||
+			header.config_ptr >= (zbx_uint64_t)(uintptr_t)mem->hi_bound)
+	{
+		*error = zbx_dsprintf(*error, "file \"%s\" is corrupted", path);
+		zbx_shmem_destroy(mem);
+		goto recreate;
+	}
+
+	config_mem = mem;
+	config = (ZBX_DC_CONFIG *)(uintptr_t)header.config_ptr;
+
+	WRLOCK_CACHE;
+
+	dc_restore_containers();
+	dc_restore_runtime_state((int)time(NULL));
+	config->restored = 1;
+
+	UNLOCK_CACHE;
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "loaded configuration cache snapshot with %d items and %d triggers",
+			config->items.num_data, config->triggers.num_data);
+
+	ret = SUCCEED;
+	goto out;
+recreate:
+	if (SUCCEED != dc_create_cache(error))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot initialize configuration cache: %s", *error);
+		exit(EXIT_FAILURE);
+	}
+out:
+	if (MAP_FAILED != data)
+		munmap(data, (size_t)buf.st_size);
+
+	/* the snapshot is valid only for the first startup after it was written */
+	if (0 != unlink(path))
+		zabbix_log(LOG_LEVEL_WARNING, "cannot remove file \"%s\": %s", path, zbx_strerror(errno));
+clean:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
+
 #ifdef HAVE_TESTS
 #	include "../../../tests/libs/zbxdbcache/dc_item_poller_type_update_test.c"
 #	include "../../../tests/libs/zbxdbcache/dc_function_calculate_nextcheck_test.c"
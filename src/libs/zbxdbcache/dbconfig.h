@@ -88,34 +88,43 @@ ZBX_DC_FUNCTION;
 
 typedef struct
 {
+	/* Fields read for every item by queue scans and poller queue ordering    */
+	/* come first, right after the hashset entry header, followed by the rest */
+	/* of scheduling data. Together they fill the first 64 bytes.             */
 	zbx_uint64_t		itemid;
+	int			nextcheck;
+	unsigned char		status;
+	unsigned char		type;
+	unsigned char		queue_priority;
+	unsigned char		location;
 	zbx_uint64_t		hostid;
 	zbx_uint64_t		interfaceid;
+	int			data_expected_from;
+	unsigned char		state;
+	unsigned char		flags;
+	unsigned char		poller_type;
+	unsigned char		schedulable;
+	const char		*key;
+	const char		*delay;
+	int			simple_interval;	/* parsed simple update interval, see delay_type */
+	unsigned short		nextcheck_shift;	/* scheduler smoothing offset added to nextcheck seed */
+	unsigned char		delay_type;		/* ZBX_DC_DELAY_* parsing state of delay */
+
+	/* configuration data used only when processing individual items */
 	zbx_uint64_t		lastlogsize;
 	zbx_uint64_t		valuemapid;
-	const char		*key;
+	zbx_uint64_t		templateid;
 	const char		*port;
 	const char		*error;
-	const char		*delay;
 	ZBX_DC_TRIGGER		**triggers;
-	int			nextcheck;
 	int			mtime;
-	int			data_expected_from;
 	int			history_sec;
 	unsigned char		history;
-	unsigned char		type;
 	unsigned char		value_type;
-	unsigned char		poller_type;
-	unsigned char		state;
 	unsigned char		db_state;
 	unsigned char		inventory_link;
-	unsigned char		location;
-	unsigned char		flags;
-	unsigned char		status;
-	unsigned char		queue_priority;
-	unsigned char		schedulable;
 	unsigned char		update_triggers;
-	zbx_uint64_t		templateid;
+	unsigned short		load_delay;	/* interval of checks counted in item load histogram */
 
 	zbx_vector_ptr_t	tags;
 }
@@ -327,6 +336,7 @@ typedef struct
 							/* by a particular proxy. */
 							/* NOTE: On disabled hosts all items are counted as disabled. */
 	zbx_uint64_t	maintenanceid;
+	zbx_uint64_t	um_revision;			/* user macro revision of host or its templates change */
 
 	const char	*host;
 	const char	*name;
@@ -798,6 +808,8 @@ typedef struct
 	int			sync_ts;
 	int			item_sync_ts;
 	int			sync_start_ts;
+	int			full_sync_ts;	/* the last time tracked objects were fully compared */
+	unsigned char		restored;	/* restored from snapshot and not synced with database yet */
 
 	unsigned int		internal_actions;		/* number of enabled internal actions */
 
@@ -877,9 +889,12 @@ typedef struct
 							/* by PSK identity */
 #endif
 	zbx_hashset_t		data_sessions;
-	zbx_binary_heap_t	queues[ZBX_POLLER_TYPE_COUNT];
-	zbx_binary_heap_t	pqueue;
+	zbx_timing_wheel_t	queues[ZBX_POLLER_TYPE_COUNT];
+	zbx_timing_wheel_t	pqueue;
 	zbx_binary_heap_t	trigger_queue;
+	unsigned int		*item_load;	/* queued item checks per second of each poller type */
+	zbx_uint64_t		um_revision;		/* user macro configuration revision */
+	zbx_uint64_t		um_global_revision;	/* revision of the last global macro or secret change */
 	ZBX_DC_CONFIG_TABLE	*config;
 	ZBX_DC_STATUS		*status;
 	zbx_hashset_t		strpool;
@@ -19,6 +19,7 @@
 
 #include "dbsync.h"
 
+#include "dbsync_prefetch.h"
 #include "log.h"
 #include "dbcache.h"
 #include "zbxserialize.h"
@@ -27,11 +28,53 @@
 
 typedef struct
 {
-	zbx_hashset_t	strpool;
-	ZBX_DC_CONFIG	*cache;
+	zbx_hashset_t		strpool;
+	ZBX_DC_CONFIG		*cache;
+
+	/* identifiers of the processed changelog records */
+	zbx_vector_uint64_t	changelogids;
+
+	/* identifiers of the changed objects, by object type */
+	zbx_vector_uint64_t	objectids[ZBX_DBSYNC_OBJ_COUNT];
+
+	/* SUCCEED - object changes can be synced from changelog, FAIL - full comparison is required */
+	int			changelog[ZBX_DBSYNC_OBJ_COUNT];
 }
 zbx_dbsync_env_t;
 
+/* use full comparison when the number of changed objects exceeds 1/4 of cached objects */
+#define ZBX_DBSYNC_CHANGELOG_RATIO	4
+/* maximum number of changelog records and changed objects processed without full comparison */
+#define ZBX_DBSYNC_CHANGELOG_MAX	100000
+#define ZBX_DBSYNC_CHANGELOG_BATCH	1000
+
+/* configuration table queries which can be executed in advance by worker threads, */
+/* listed in the order they are used during configuration sync                      */
+typedef enum
+{
+	ZBX_DBSYNC_QUERY_HOST_TEMPLATES = 0,
+	ZBX_DBSYNC_QUERY_GLOBAL_MACROS,
+	ZBX_DBSYNC_QUERY_HOST_MACROS,
+	ZBX_DBSYNC_QUERY_HOST_TAGS,
+	ZBX_DBSYNC_QUERY_HOSTS,
+	ZBX_DBSYNC_QUERY_HOST_INVENTORY,
+	ZBX_DBSYNC_QUERY_HOST_GROUP_HOSTS,
+	ZBX_DBSYNC_QUERY_INTERFACES,
+	ZBX_DBSYNC_QUERY_ITEMS,
+	ZBX_DBSYNC_QUERY_TEMPLATE_ITEMS,
+	ZBX_DBSYNC_QUERY_PROTOTYPE_ITEMS,
+	ZBX_DBSYNC_QUERY_ITEM_DISCOVERY,
+	ZBX_DBSYNC_QUERY_ITEM_PREPROCS,
+	ZBX_DBSYNC_QUERY_ITEM_SCRIPT_PARAMS,
+	ZBX_DBSYNC_QUERY_ITEM_TAGS,
+	ZBX_DBSYNC_QUERY_FUNCTIONS,
+	ZBX_DBSYNC_QUERY_TRIGGERS,
+	ZBX_DBSYNC_QUERY_TRIGGER_DEPENDENCY,
+	ZBX_DBSYNC_QUERY_TRIGGER_TAGS,
+	ZBX_DBSYNC_QUERY_COUNT
+}
+zbx_dbsync_query_t;
+
 static zbx_dbsync_env_t	dbsync_env;
 
 /* string pool support */
@@ -250,17 +293,475 @@ static char	**dbsync_preproc_row(zbx_dbsync_t *sync, char **row)
 	return sync->row;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: appends select statement of the specified configuration query     *
+ *                                                                            *
+ ******************************************************************************/
+static void	dbsync_get_sql(zbx_dbsync_query_t query, char **sql, size_t *sql_alloc, size_t *sql_offset)
+{
+	switch (query)
+	{
+		case ZBX_DBSYNC_QUERY_HOST_TEMPLATES:
+			zbx_strcpy_alloc(sql, sql_alloc, sql_offset,
+					"select hostid,templateid"
+					" from hosts_templates"
+					" order by hostid");
+			break;
+		case ZBX_DBSYNC_QUERY_GLOBAL_MACROS:
+			zbx_strcpy_alloc(sql, sql_alloc, sql_offset,
+					"select globalmacroid,macro,value,type"
+					" from globalmacro");
+			break;
+		case ZBX_DBSYNC_QUERY_HOST_MACROS:
+			zbx_snprintf_alloc(sql, sql_alloc, sql_offset,
+					"select m.hostmacroid,m.hostid,m.macro,m.value,m.type"
+					" from hostmacro m"
+					" inner join hosts h on m.hostid=h.hostid"
+					" where h.flags<>%d",
+					ZBX_FLAG_DISCOVERY_PROTOTYPE);
+			break;
+		case ZBX_DBSYNC_QUERY_HOST_TAGS:
+			zbx_strcpy_alloc(sql, sql_alloc, sql_offset,
+					"select * from host_tag");
+			break;
+		case ZBX_DBSYNC_QUERY_HOSTS:
+#if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
+			zbx_snprintf_alloc(sql, sql_alloc, sql_offset,
+					"select hostid,proxy_hostid,host,ipmi_authtype,ipmi_privilege,ipmi_username,"
+						"ipmi_password,maintenance_status,maintenance_type,maintenance_from,"
+						"status,name,lastaccess,tls_connect,tls_accept,tls_issuer,tls_subject,"
+						"tls_psk_identity,tls_psk,proxy_address,auto_compress,maintenanceid"
+					" from hosts"
+					" where status in (%d,%d,%d,%d)"
+						" and flags<>%d",
+					HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
+					HOST_STATUS_PROXY_ACTIVE, HOST_STATUS_PROXY_PASSIVE,
+					ZBX_FLAG_DISCOVERY_PROTOTYPE);
+#else
+			zbx_snprintf_alloc(sql, sql_alloc, sql_offset,
+					"select hostid,proxy_hostid,host,ipmi_authtype,ipmi_privilege,ipmi_username,"
+						"ipmi_password,maintenance_status,maintenance_type,maintenance_from,"
+						"status,name,lastaccess,tls_connect,tls_accept,"
+						"proxy_address,auto_compress,maintenanceid"
+					" from hosts"
+					" where status in (%d,%d,%d,%d)"
+						" and flags<>%d",
+					HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
+					HOST_STATUS_PROXY_ACTIVE, HOST_STATUS_PROXY_PASSIVE,
+					ZBX_FLAG_DISCOVERY_PROTOTYPE);
+#endif
+			break;
+		case ZBX_DBSYNC_QUERY_HOST_INVENTORY:
+			zbx_strcpy_alloc(sql, sql_alloc, sql_offset,
+					"select hostid,inventory_mode,type,type_full,name,alias,os,os_full,os_short,serialno_a,"
+					"serialno_b,tag,asset_tag,macaddress_a,macaddress_b,hardware,hardware_full,software,"
+					"software_full,software_app_a,software_app_b,software_app_c,software_app_d,"
+					"software_app_e,contact,location,location_lat,location_lon,notes,chassis,model,"
+					"hw_arch,vendor,contract_number,installer_name,deployment_status,url_a,url_b,"
+					"url_c,host_networks,host_netmask,host_router,oob_ip,oob_netmask,oob_router,"
+					"date_hw_purchase,date_hw_install,date_hw_expiry,date_hw_decomm,site_address_a,"
+					"site_address_b,site_address_c,site_city,site_state,site_country,site_zip,site_rack,"
+					"site_notes,poc_1_name,poc_1_email,poc_1_phone_a,poc_1_phone_b,poc_1_cell,"
+					"poc_1_screen,poc_1_notes,poc_2_name,poc_2_email,poc_2_phone_a,poc_2_phone_b,"
+					"poc_2_cell,poc_2_screen,poc_2_notes"
+					" from host_inventory");
+			break;
+		case ZBX_DBSYNC_QUERY_HOST_GROUP_HOSTS:
+			zbx_snprintf_alloc(sql, sql_alloc, sql_offset,
+					"select hg.groupid,hg.hostid"
+					" from hosts_groups hg,hosts h"
+					" where hg.hostid=h.hostid"
+					" and h.status in (%d,%d)"
+					" and h.flags<>%d"
+					" order by hg.groupid",
+					HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED, ZBX_FLAG_DISCOVERY_PROTOTYPE);
+			break;
+		case ZBX_DBSYNC_QUERY_INTERFACES:
+			zbx_strcpy_alloc(sql, sql_alloc, sql_offset,
+					"select i.interfaceid,i.hostid,i.type,i.main,i.useip,i.ip,i.dns,i.port,"
+					"i.available,i.disable_until,i.error,i.errors_from,"
+					"s.version,s.bulk,s.community,s.securityname,s.securitylevel,s.authpassphrase,s.privpassphrase,"
+					"s.authprotocol,s.privprotocol,s.contextname"
+					" from interface i"
+					" left join interface_snmp s on i.interfaceid=s.interfaceid");
+			break;
+		case ZBX_DBSYNC_QUERY_ITEMS:
+			zbx_snprintf_alloc(sql, sql_alloc, sql_offset,
+					"select i.itemid,i.hostid,i.status,i.type,i.value_type,i.key_,i.snmp_oid,i.ipmi_sensor,i.delay,"
+						"i.trapper_hosts,i.logtimefmt,i.params,ir.state,i.authtype,i.username,i.password,"
+						"i.publickey,i.privatekey,i.flags,i.interfaceid,ir.lastlogsize,ir.mtime,"
+						"i.history,i.trends,i.inventory_link,i.valuemapid,i.units,ir.error,i.jmx_endpoint,"
+						"i.master_itemid,i.timeout,i.url,i.query_fields,i.posts,i.status_codes,"
+						"i.follow_redirects,i.post_type,i.http_proxy,i.headers,i.retrieve_mode,"
+						"i.request_method,i.output_format,i.ssl_cert_file,i.ssl_key_file,i.ssl_key_password,"
+						"i.verify_peer,i.verify_host,i.allow_traps,i.templateid,null"
+					" from items i"
+					" inner join hosts h on i.hostid=h.hostid"
+					" join item_rtdata ir on i.itemid=ir.itemid"
+					" where h.status in (%d,%d) and i.flags<>%d",
+					HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED, ZBX_FLAG_DISCOVERY_PROTOTYPE);
+			break;
+		case ZBX_DBSYNC_QUERY_TEMPLATE_ITEMS:
+			zbx_snprintf_alloc(sql, sql_alloc, sql_offset,
+					"select i.itemid,i.hostid,i.templateid from items i inner join hosts h on i.hostid=h.hostid"
+					" where h.status=%d",
+					HOST_STATUS_TEMPLATE);
+			break;
+		case ZBX_DBSYNC_QUERY_PROTOTYPE_ITEMS:
+			zbx_snprintf_alloc(sql, sql_alloc, sql_offset,
+					"select i.itemid,i.hostid,i.templateid from items i where i.flags=%d",
+					ZBX_FLAG_DISCOVERY_PROTOTYPE);
+			break;
+		case ZBX_DBSYNC_QUERY_ITEM_DISCOVERY:
+			zbx_strcpy_alloc(sql, sql_alloc, sql_offset,
+					"select itemid,parent_itemid from item_discovery");
+			break;
+		case ZBX_DBSYNC_QUERY_ITEM_PREPROCS:
+			zbx_snprintf_alloc(sql, sql_alloc, sql_offset,
+					"select pp.item_preprocid,pp.itemid,pp.type,pp.params,pp.step,h.hostid,pp.error_handler,"
+						"pp.error_handler_params"
+					" from item_preproc pp,items i,hosts h"
+					" where pp.itemid=i.itemid"
+						" and i.hostid=h.hostid"
+						" and (h.proxy_hostid is null"
+							" or i.type in (%d,%d,%d))"
+						" and h.status in (%d,%d)"
+						" and i.flags<>%d",
+					ITEM_TYPE_INTERNAL, ITEM_TYPE_CALCULATED, ITEM_TYPE_DEPENDENT,
+					HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
+					ZBX_FLAG_DISCOVERY_PROTOTYPE);
+			break;
+		case ZBX_DBSYNC_QUERY_ITEM_SCRIPT_PARAMS:
+			zbx_snprintf_alloc(sql, sql_alloc, sql_offset,
+					"select p.item_parameterid,p.itemid,p.name,p.value,i.hostid"
+					" from item_parameter p,items i,hosts h"
+					" where p.itemid=i.itemid"
+						" and i.hostid=h.hostid"
+						" and h.status in (%d,%d)"
+						" and i.flags<>%d"
+					" order by p.itemid",
+					HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
+					ZBX_FLAG_DISCOVERY_PROTOTYPE);
+			break;
+		case ZBX_DBSYNC_QUERY_ITEM_TAGS:
+			zbx_strcpy_alloc(sql, sql_alloc, sql_offset,
+					"select itemtagid,itemid,tag,value from item_tag");
+			break;
+		case ZBX_DBSYNC_QUERY_FUNCTIONS:
+			zbx_strcpy_alloc(sql, sql_alloc, sql_offset,
+					"select itemid,functionid,name,parameter,triggerid from functions");
+			break;
+		case ZBX_DBSYNC_QUERY_TRIGGERS:
+			zbx_strcpy_alloc(sql, sql_alloc, sql_offset,
+					"select triggerid,description,expression,error,priority,type,value,state,lastchange,status,"
+					"recovery_mode,recovery_expression,correlation_mode,correlation_tag,opdata,event_name,null,"
+					"null,null,flags"
+					" from triggers");
+			break;
+		case ZBX_DBSYNC_QUERY_TRIGGER_DEPENDENCY:
+			zbx_snprintf_alloc(sql, sql_alloc, sql_offset,
+					"select distinct d.triggerid_down,d.triggerid_up"
+					" from trigger_depends d,triggers t,hosts h,items i,functions f"
+					" where t.triggerid=d.triggerid_down"
+						" and t.flags<>%d"
+						" and h.hostid=i.hostid"
+						" and i.itemid=f.itemid"
+						" and f.triggerid=d.triggerid_down"
+						" and h.status in (%d,%d)",
+					ZBX_FLAG_DISCOVERY_PROTOTYPE, HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED);
+			break;
+		case ZBX_DBSYNC_QUERY_TRIGGER_TAGS:
+			zbx_strcpy_alloc(sql, sql_alloc, sql_offset,
+					"select triggertagid,triggerid,tag,value from trigger_tag");
+			break;
+		default:
+			THIS_SHOULD_NEVER_HAPPEN;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets changed object identifiers if the object table can be        *
+ *          synced from changelog                                             *
+ *                                                                            *
+ * Parameters: object    - [IN] the object type (ZBX_DBSYNC_OBJ_*)            *
+ *             cache_num - [IN] the number of cached objects                  *
+ *                                                                            *
+ * Return value: the changed object identifiers or NULL if full comparison    *
+ *               must be done                                                 *
+ *                                                                            *
+ ******************************************************************************/
+static const zbx_vector_uint64_t	*dbsync_env_get_changes(unsigned char object, int cache_num)
+{
+	const zbx_vector_uint64_t	*objectids = &dbsync_env.objectids[object];
+
+	if (SUCCEED != dbsync_env.changelog[object])
+		return NULL;
+
+	/* selecting the whole table is cheaper than large number of individual rows */
+	if (ZBX_DBSYNC_CHANGELOG_MAX < objectids->values_num ||
+			cache_num / ZBX_DBSYNC_CHANGELOG_RATIO < objectids->values_num)
+	{
+		return NULL;
+	}
+
+	return objectids;
+}
+
+#ifdef ZBX_DBSYNC_PREFETCH
+static void	dbsync_prefetch_sql(int query, char **sql, size_t *sql_alloc, size_t *sql_offset)
+{
+	dbsync_get_sql((zbx_dbsync_query_t)query, sql, sql_alloc, sql_offset);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: queues configuration queries for execution by worker threads      *
+ *                                                                            *
+ * Parameters: mode - [IN] the synchronization mode                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	dbsync_prefetch_start(unsigned char mode)
+{
+	unsigned char	queued[ZBX_DBSYNC_QUERY_COUNT];
+
+	if (0 == CONFIG_CONFSYNCER_WORKERS ||
+			0 == zbx_dbsync_prefetch_init(CONFIG_CONFSYNCER_WORKERS, ZBX_DBSYNC_QUERY_COUNT, dbsync_prefetch_sql))
+	{
+		return;
+	}
+
+	memset(queued, 1, sizeof(queued));
+
+	/* tracked objects synced from changelog use different queries */
+	if (ZBX_DBSYNC_UPDATE == mode)
+	{
+		if (NULL != dbsync_env_get_changes(ZBX_DBSYNC_OBJ_ITEM, dbsync_env.cache->items.num_data))
+			queued[ZBX_DBSYNC_QUERY_ITEMS] = 0;
+
+		if (NULL != dbsync_env_get_changes(ZBX_DBSYNC_OBJ_FUNCTION, dbsync_env.cache->functions.num_data))
+			queued[ZBX_DBSYNC_QUERY_FUNCTIONS] = 0;
+
+		if (NULL != dbsync_env_get_changes(ZBX_DBSYNC_OBJ_TRIGGER, dbsync_env.cache->triggers.num_data))
+			queued[ZBX_DBSYNC_QUERY_TRIGGERS] = 0;
+	}
+
+	zbx_dbsync_prefetch_start(queued);
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets result of the specified configuration query                  *
+ *                                                                            *
+ * Comments: Prefetched result is returned if available, otherwise the query  *
+ *           is executed with configuration syncer database connection.       *
+ *                                                                            *
+ ******************************************************************************/
+static DB_RESULT	dbsync_select(zbx_dbsync_query_t query)
+{
+	DB_RESULT	result = NULL;
+	char		*sql = NULL;
+	size_t		sql_alloc = 0, sql_offset = 0;
+
+#ifdef ZBX_DBSYNC_PREFETCH
+	if (NULL != (result = zbx_dbsync_prefetch_get(query)))
+		return result;
+#endif
+	dbsync_get_sql(query, &sql, &sql_alloc, &sql_offset);
+	result = DBselect("%s", sql);
+	zbx_free(sql);
+
+	return result;
+}
+
 void	zbx_dbsync_init_env(ZBX_DC_CONFIG *cache)
 {
+	int	i;
+
 	dbsync_env.cache = cache;
 	zbx_hashset_create(&dbsync_env.strpool, 100, dbsync_strpool_hash_func, dbsync_strpool_compare_func);
+
+	zbx_vector_uint64_create(&dbsync_env.changelogids);
+
+	for (i = 0; i < ZBX_DBSYNC_OBJ_COUNT; i++)
+	{
+		zbx_vector_uint64_create(&dbsync_env.objectids[i]);
+		dbsync_env.changelog[i] = FAIL;
+	}
 }
 
 void	zbx_dbsync_free_env(void)
 {
+	int	i;
+
+#ifdef ZBX_DBSYNC_PREFETCH
+	zbx_dbsync_prefetch_clear();
+#endif
+
+	for (i = 0; i < ZBX_DBSYNC_OBJ_COUNT; i++)
+		zbx_vector_uint64_destroy(&dbsync_env.objectids[i]);
+
+	zbx_vector_uint64_destroy(&dbsync_env.changelogids);
+
 	zbx_hashset_destroy(&dbsync_env.strpool);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads configuration changes recorded in changelog table           *
+ *                                                                            *
+ * Parameters: mode      - [IN] the synchronization mode                      *
+ *             changelog - [IN] SUCCEED - sync tracked objects from changelog *
+ *                              FAIL    - compare whole tables                *
+ *                                                                            *
+ * Return value: SUCCEED - the changelog was read successfully                *
+ *               FAIL    - database error                                     *
+ *                                                                            *
+ * Comments: The changelog records are written by database triggers. Records  *
+ *           read here are removed by zbx_dbsync_env_flush_changelog() after  *
+ *           successful synchronization. Records committed after reading are  *
+ *           left for the next synchronization, so the changes cannot be lost *
+ *           even if transactions are committed out of changelogid order.     *
+ *           When change tracking is disabled all records are removed without *
+ *           reading them.                                                    *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_dbsync_env_prepare(unsigned char mode, int changelog)
+{
+	DB_RESULT	result;
+	DB_ROW		row;
+	zbx_uint64_t	changelogid, objectid;
+	int		i, object;
+
+	/* Initial sync loads all data and with change tracking disabled the tables are compared during every */
+	/* sync, so the recorded changes are not needed. Database triggers keep recording them regardless,    */
+	/* they are discarded here before reading the tables to keep the changelog table small.              */
+	if (ZBX_DBSYNC_INIT == mode || 0 == CONFIG_CONFSYNCER_FULL_FREQUENCY)
+	{
+		if (ZBX_DB_OK > DBexecute("delete from changelog"))
+			return FAIL;
+#ifdef ZBX_DBSYNC_PREFETCH
+		dbsync_prefetch_start(mode);
+#endif
+		return SUCCEED;
+	}
+
+	/* one record over the limit is read to detect that the limit was exceeded */
+	if (NULL == (result = DBselectN("select changelogid,object,objectid from changelog order by changelogid",
+			ZBX_DBSYNC_CHANGELOG_MAX + 1)))
+	{
+		return FAIL;
+	}
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		ZBX_STR2UINT64(changelogid, row[0]);
+		zbx_vector_uint64_append(&dbsync_env.changelogids, changelogid);
+
+		object = atoi(row[1]);
+
+		if (0 >= object || ZBX_DBSYNC_OBJ_COUNT <= object)
+			continue;
+
+		ZBX_STR2UINT64(objectid, row[2]);
+		zbx_vector_uint64_append(&dbsync_env.objectids[object], objectid);
+	}
+	DBfree_result(result);
+
+	/* Too many changes to select them individually, compare whole tables instead. The records that were not */
+	/* read are left in changelog and are processed by the next synchronizations.                             */
+	if (ZBX_DBSYNC_CHANGELOG_MAX < dbsync_env.changelogids.values_num)
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() changelog has more than %d records, comparing whole tables",
+				__func__, ZBX_DBSYNC_CHANGELOG_MAX);
+		changelog = FAIL;
+	}
+
+	for (i = 0; i < ZBX_DBSYNC_OBJ_COUNT; i++)
+	{
+		if (SUCCEED == changelog)
+		{
+			zbx_vector_uint64_sort(&dbsync_env.objectids[i], ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+			zbx_vector_uint64_uniq(&dbsync_env.objectids[i], ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+		}
+		else
+			zbx_vector_uint64_clear(&dbsync_env.objectids[i]);
+
+		dbsync_env.changelog[i] = changelog;
+	}
+#ifdef ZBX_DBSYNC_PREFETCH
+	dbsync_prefetch_start(mode);
+#endif
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: forces full comparison of the specified object table              *
+ *                                                                            *
+ * Comments: Used when changes of other objects (hosts, macros) can affect    *
+ *           the object rows without being recorded in changelog.             *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_dbsync_env_disable_changelog(unsigned char object)
+{
+	dbsync_env.changelog[object] = FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes processed records from changelog table                    *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_dbsync_env_flush_changelog(void)
+{
+	char	*sql = NULL;
+	size_t	sql_alloc = 0, sql_offset;
+	int	i, num;
+
+	for (i = 0; i < dbsync_env.changelogids.values_num; i += ZBX_DBSYNC_CHANGELOG_BATCH)
+	{
+		num = MIN(ZBX_DBSYNC_CHANGELOG_BATCH, dbsync_env.changelogids.values_num - i);
+
+		sql_offset = 0;
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, "delete from changelog where");
+		DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "changelogid", dbsync_env.changelogids.values + i,
+				num);
+
+		if (ZBX_DB_OK > DBexecute("%s", sql))
+			break;
+	}
+
+	zbx_free(sql);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds removal rows for changed objects that were not selected      *
+ *                                                                            *
+ * Parameters: sync      - [IN/OUT] the changeset                             *
+ *             cache     - [IN] the cached objects, indexed by identifier     *
+ *             ids       - [IN] the identifiers of selected rows              *
+ *             objectids - [IN] the identifiers of changed objects            *
+ *                                                                            *
+ ******************************************************************************/
+static void	dbsync_remove_changed_rows(zbx_dbsync_t *sync, zbx_hashset_t *cache, zbx_hashset_t *ids,
+		const zbx_vector_uint64_t *objectids)
+{
+	int	i;
+
+	for (i = 0; i < objectids->values_num; i++)
+	{
+		if (NULL != zbx_hashset_search(ids, &objectids->values[i]))
+			continue;
+
+		if (NULL != zbx_hashset_search(cache, &objectids->values[i]))
+			dbsync_add_row(sync, objectids->values[i], ZBX_DBSYNC_ROW_REMOVE, NULL);
+	}
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: initializes changeset                                             *
@@ -710,34 +1211,14 @@ int	zbx_dbsync_compare_hosts(zbx_dbsync_t *sync)
 	ZBX_DC_HOST		*host;
 
 #if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
-	if (NULL == (result = DBselect(
-			"select hostid,proxy_hostid,host,ipmi_authtype,ipmi_privilege,ipmi_username,"
-				"ipmi_password,maintenance_status,maintenance_type,maintenance_from,"
-				"status,name,lastaccess,tls_connect,tls_accept,tls_issuer,tls_subject,"
-				"tls_psk_identity,tls_psk,proxy_address,auto_compress,maintenanceid"
-			" from hosts"
-			" where status in (%d,%d,%d,%d)"
-				" and flags<>%d",
-			HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
-			HOST_STATUS_PROXY_ACTIVE, HOST_STATUS_PROXY_PASSIVE,
-			ZBX_FLAG_DISCOVERY_PROTOTYPE)))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_HOSTS)))
 	{
 		return FAIL;
 	}
 
 	dbsync_prepare(sync, 22, NULL);
 #else
-	if (NULL == (result = DBselect(
-			"select hostid,proxy_hostid,host,ipmi_authtype,ipmi_privilege,ipmi_username,"
-				"ipmi_password,maintenance_status,maintenance_type,maintenance_from,"
-				"status,name,lastaccess,tls_connect,tls_accept,"
-				"proxy_address,auto_compress,maintenanceid"
-			" from hosts"
-			" where status in (%d,%d,%d,%d)"
-				" and flags<>%d",
-			HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
-			HOST_STATUS_PROXY_ACTIVE, HOST_STATUS_PROXY_PASSIVE,
-			ZBX_FLAG_DISCOVERY_PROTOTYPE)))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_HOSTS)))
 	{
 		return FAIL;
 	}
@@ -828,22 +1309,8 @@ int	zbx_dbsync_compare_host_inventory(zbx_dbsync_t *sync)
 	zbx_hashset_iter_t	iter;
 	zbx_uint64_t		rowid;
 	ZBX_DC_HOST_INVENTORY	*hi;
-	const char		*sql;
 
-	sql = "select hostid,inventory_mode,type,type_full,name,alias,os,os_full,os_short,serialno_a,"
-			"serialno_b,tag,asset_tag,macaddress_a,macaddress_b,hardware,hardware_full,software,"
-			"software_full,software_app_a,software_app_b,software_app_c,software_app_d,"
-			"software_app_e,contact,location,location_lat,location_lon,notes,chassis,model,"
-			"hw_arch,vendor,contract_number,installer_name,deployment_status,url_a,url_b,"
-			"url_c,host_networks,host_netmask,host_router,oob_ip,oob_netmask,oob_router,"
-			"date_hw_purchase,date_hw_install,date_hw_expiry,date_hw_decomm,site_address_a,"
-			"site_address_b,site_address_c,site_city,site_state,site_country,site_zip,site_rack,"
-			"site_notes,poc_1_name,poc_1_email,poc_1_phone_a,poc_1_phone_b,poc_1_cell,"
-			"poc_1_screen,poc_1_notes,poc_2_name,poc_2_email,poc_2_phone_a,poc_2_phone_b,"
-			"poc_2_cell,poc_2_screen,poc_2_notes"
-			" from host_inventory";
-
-	if (NULL == (result = DBselect("%s", sql)))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_HOST_INVENTORY)))
 		return FAIL;
 
 	dbsync_prepare(sync, 72, NULL);
@@ -912,10 +1379,7 @@ int	zbx_dbsync_compare_host_templates(zbx_dbsync_t *sync)
 	char			hostid_s[MAX_ID_LEN + 1], templateid_s[MAX_ID_LEN + 1];
 	char			*del_row[2] = {hostid_s, templateid_s};
 
-	if (NULL == (result = DBselect(
-			"select hostid,templateid"
-			" from hosts_templates"
-			" order by hostid")))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_HOST_TEMPLATES)))
 	{
 		return FAIL;
 	}
@@ -1038,9 +1502,7 @@ int	zbx_dbsync_compare_global_macros(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	ZBX_DC_GMACRO		*macro;
 
-	if (NULL == (result = DBselect(
-			"select globalmacroid,macro,value,type"
-			" from globalmacro")))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_GLOBAL_MACROS)))
 	{
 		return FAIL;
 	}
@@ -1156,11 +1618,7 @@ int	zbx_dbsync_compare_host_macros(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	ZBX_DC_HMACRO		*macro;
 
-	if (NULL == (result = DBselect(
-			"select m.hostmacroid,m.hostid,m.macro,m.value,m.type"
-			" from hostmacro m"
-			" inner join hosts h on m.hostid=h.hostid"
-			" where h.flags<>%d", ZBX_FLAG_DISCOVERY_PROTOTYPE)))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_HOST_MACROS)))
 	{
 		return FAIL;
 	}
@@ -1326,13 +1784,7 @@ int	zbx_dbsync_compare_interfaces(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	ZBX_DC_INTERFACE	*interface;
 
-	if (NULL == (result = DBselect(
-			"select i.interfaceid,i.hostid,i.type,i.main,i.useip,i.ip,i.dns,i.port,"
-			"i.available,i.disable_until,i.error,i.errors_from,"
-			"s.version,s.bulk,s.community,s.securityname,s.securitylevel,s.authpassphrase,s.privpassphrase,"
-			"s.authprotocol,s.privprotocol,s.contextname"
-			" from interface i"
-			" left join interface_snmp s on i.interfaceid=s.interfaceid")))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_INTERFACES)))
 	{
 		return FAIL;
 	}
@@ -1849,34 +2301,38 @@ static char	**dbsync_item_preproc_row(char **row)
  ******************************************************************************/
 int	zbx_dbsync_compare_items(zbx_dbsync_t *sync)
 {
-	DB_ROW			dbrow;
-	DB_RESULT		result;
-	zbx_hashset_t		ids;
-	zbx_hashset_iter_t	iter;
-	zbx_uint64_t		rowid;
-	ZBX_DC_ITEM		*item;
-	char			**row;
+	DB_ROW				dbrow;
+	DB_RESULT			result;
+	zbx_hashset_t			ids;
+	zbx_hashset_iter_t		iter;
+	zbx_uint64_t			rowid;
+	ZBX_DC_ITEM			*item;
+	char				**row, *sql = NULL;
+	size_t				sql_alloc = 0, sql_offset = 0;
+	const zbx_vector_uint64_t	*itemids = NULL;
 
-	if (NULL == (result = DBselect(
-			"select i.itemid,i.hostid,i.status,i.type,i.value_type,i.key_,i.snmp_oid,i.ipmi_sensor,i.delay,"
-				"i.trapper_hosts,i.logtimefmt,i.params,ir.state,i.authtype,i.username,i.password,"
-				"i.publickey,i.privatekey,i.flags,i.interfaceid,ir.lastlogsize,ir.mtime,"
-				"i.history,i.trends,i.inventory_link,i.valuemapid,i.units,ir.error,i.jmx_endpoint,"
-				"i.master_itemid,i.timeout,i.url,i.query_fields,i.posts,i.status_codes,"
-				"i.follow_redirects,i.post_type,i.http_proxy,i.headers,i.retrieve_mode,"
-				"i.request_method,i.output_format,i.ssl_cert_file,i.ssl_key_file,i.ssl_key_password,"
-				"i.verify_peer,i.verify_host,i.allow_traps,i.templateid,null"
-			" from items i"
-			" inner join hosts h on i.hostid=h.hostid"
-			" join item_rtdata ir on i.itemid=ir.itemid"
-			" where h.status in (%d,%d) and i.flags<>%d",
-			HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED, ZBX_FLAG_DISCOVERY_PROTOTYPE)))
+	dbsync_prepare(sync, 50, dbsync_item_preproc_row);
 
+	if (ZBX_DBSYNC_UPDATE == sync->mode && NULL != (itemids = dbsync_env_get_changes(ZBX_DBSYNC_OBJ_ITEM,
+			dbsync_env.cache->items.num_data)) && 0 == itemids->values_num)
 	{
-		return FAIL;
+		return SUCCEED;
 	}
 
-	dbsync_prepare(sync, 50, dbsync_item_preproc_row);
+	if (NULL != itemids)
+	{
+		dbsync_get_sql(ZBX_DBSYNC_QUERY_ITEMS, &sql, &sql_alloc, &sql_offset);
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " and");
+		DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "i.itemid", itemids->values,
+				itemids->values_num);
+		result = DBselect("%s", sql);
+		zbx_free(sql);
+	}
+	else
+		result = dbsync_select(ZBX_DBSYNC_QUERY_ITEMS);
+
+	if (NULL == result)
+		return FAIL;
 
 	if (ZBX_DBSYNC_INIT == sync->mode)
 	{
@@ -1884,8 +2340,8 @@ int	zbx_dbsync_compare_items(zbx_dbsync_t *sync)
 		return SUCCEED;
 	}
 
-	zbx_hashset_create(&ids, dbsync_env.cache->items.num_data, ZBX_DEFAULT_UINT64_HASH_FUNC,
-			ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_hashset_create(&ids, NULL == itemids ? dbsync_env.cache->items.num_data : itemids->values_num,
+			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
 	while (NULL != (dbrow = DBfetch(result)))
 	{
@@ -1905,11 +2361,18 @@ int	zbx_dbsync_compare_items(zbx_dbsync_t *sync)
 			dbsync_add_row(sync, rowid, tag, row);
 	}
 
-	zbx_hashset_iter_reset(&dbsync_env.cache->items, &iter);
-	while (NULL != (item = (ZBX_DC_ITEM *)zbx_hashset_iter_next(&iter)))
+	if (NULL != itemids)
 	{
-		if (NULL == zbx_hashset_search(&ids, &item->itemid))
-			dbsync_add_row(sync, item->itemid, ZBX_DBSYNC_ROW_REMOVE, NULL);
+		dbsync_remove_changed_rows(sync, &dbsync_env.cache->items, &ids, itemids);
+	}
+	else
+	{
+		zbx_hashset_iter_reset(&dbsync_env.cache->items, &iter);
+		while (NULL != (item = (ZBX_DC_ITEM *)zbx_hashset_iter_next(&iter)))
+		{
+			if (NULL == zbx_hashset_search(&ids, &item->itemid))
+				dbsync_add_row(sync, item->itemid, ZBX_DBSYNC_ROW_REMOVE, NULL);
+		}
 	}
 
 	zbx_hashset_destroy(&ids);
@@ -1942,7 +2405,7 @@ int	zbx_dbsync_compare_item_discovery(zbx_dbsync_t *sync)
 	ZBX_DC_ITEM_DISCOVERY	*item_discovery;
 	char			**row;
 
-	if (NULL == (result = DBselect("select itemid,parent_itemid from item_discovery")))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_ITEM_DISCOVERY)))
 		return FAIL;
 
 	dbsync_prepare(sync, 2, NULL);
@@ -2019,9 +2482,7 @@ int	zbx_dbsync_compare_template_items(zbx_dbsync_t *sync)
 	ZBX_DC_TEMPLATE_ITEM	*item;
 	char			**row;
 
-	if (NULL == (result = DBselect(
-			"select i.itemid,i.hostid,i.templateid from items i inner join hosts h on i.hostid=h.hostid"
-			" where h.status=%d", HOST_STATUS_TEMPLATE)))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_TEMPLATE_ITEMS)))
 	{
 		return FAIL;
 	}
@@ -2100,9 +2561,7 @@ int	zbx_dbsync_compare_prototype_items(zbx_dbsync_t *sync)
 	ZBX_DC_PROTOTYPE_ITEM	*item;
 	char			**row;
 
-	if (NULL == (result = DBselect(
-			"select i.itemid,i.hostid,i.templateid from items i where i.flags=%d",
-				ZBX_FLAG_DISCOVERY_PROTOTYPE)))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_PROTOTYPE_ITEMS)))
 	{
 		return FAIL;
 	}
@@ -2336,24 +2795,38 @@ static char	**dbsync_trigger_preproc_row(char **row)
  ******************************************************************************/
 int	zbx_dbsync_compare_triggers(zbx_dbsync_t *sync)
 {
-	DB_ROW			dbrow;
-	DB_RESULT		result;
-	zbx_hashset_t		ids;
-	zbx_hashset_iter_t	iter;
-	zbx_uint64_t		rowid;
-	ZBX_DC_TRIGGER		*trigger;
-	char			**row;
+	DB_ROW				dbrow;
+	DB_RESULT			result;
+	zbx_hashset_t			ids;
+	zbx_hashset_iter_t		iter;
+	zbx_uint64_t			rowid;
+	ZBX_DC_TRIGGER			*trigger;
+	char				**row, *sql = NULL;
+	size_t				sql_alloc = 0, sql_offset = 0;
+	const zbx_vector_uint64_t	*triggerids = NULL;
 
-	if (NULL == (result = DBselect(
-			"select triggerid,description,expression,error,priority,type,value,state,lastchange,status,"
-			"recovery_mode,recovery_expression,correlation_mode,correlation_tag,opdata,event_name,null,"
-			"null,null,flags"
-			" from triggers")))
+	dbsync_prepare(sync, 20, dbsync_trigger_preproc_row);
+
+	if (ZBX_DBSYNC_UPDATE == sync->mode && NULL != (triggerids = dbsync_env_get_changes(ZBX_DBSYNC_OBJ_TRIGGER,
+			dbsync_env.cache->triggers.num_data)) && 0 == triggerids->values_num)
 	{
-		return FAIL;
+		return SUCCEED;
 	}
 
-	dbsync_prepare(sync, 20, dbsync_trigger_preproc_row);
+	if (NULL != triggerids)
+	{
+		dbsync_get_sql(ZBX_DBSYNC_QUERY_TRIGGERS, &sql, &sql_alloc, &sql_offset);
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " where");
+		DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "triggerid", triggerids->values,
+				triggerids->values_num);
+		result = DBselect("%s", sql);
+		zbx_free(sql);
+	}
+	else
+		result = dbsync_select(ZBX_DBSYNC_QUERY_TRIGGERS);
+
+	if (NULL == result)
+		return FAIL;
 
 	if (ZBX_DBSYNC_INIT == sync->mode)
 	{
@@ -2361,8 +2834,8 @@ int	zbx_dbsync_compare_triggers(zbx_dbsync_t *sync)
 		return SUCCEED;
 	}
 
-	zbx_hashset_create(&ids, dbsync_env.cache->triggers.num_data, ZBX_DEFAULT_UINT64_HASH_FUNC,
-			ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_hashset_create(&ids, NULL == triggerids ? dbsync_env.cache->triggers.num_data : triggerids->values_num,
+			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
 	while (NULL != (dbrow = DBfetch(result)))
 	{
@@ -2382,11 +2855,18 @@ int	zbx_dbsync_compare_triggers(zbx_dbsync_t *sync)
 		}
 	}
 
-	zbx_hashset_iter_reset(&dbsync_env.cache->triggers, &iter);
-	while (NULL != (trigger = (ZBX_DC_TRIGGER *)zbx_hashset_iter_next(&iter)))
+	if (NULL != triggerids)
 	{
-		if (NULL == zbx_hashset_search(&ids, &trigger->triggerid))
-			dbsync_add_row(sync, trigger->triggerid, ZBX_DBSYNC_ROW_REMOVE, NULL);
+		dbsync_remove_changed_rows(sync, &dbsync_env.cache->triggers, &ids, triggerids);
+	}
+	else
+	{
+		zbx_hashset_iter_reset(&dbsync_env.cache->triggers, &iter);
+		while (NULL != (trigger = (ZBX_DC_TRIGGER *)zbx_hashset_iter_next(&iter)))
+		{
+			if (NULL == zbx_hashset_search(&ids, &trigger->triggerid))
+				dbsync_add_row(sync, trigger->triggerid, ZBX_DBSYNC_ROW_REMOVE, NULL);
+		}
 	}
 
 	zbx_hashset_destroy(&ids);
@@ -2417,16 +2897,7 @@ int	zbx_dbsync_compare_trigger_dependency(zbx_dbsync_t *sync)
 	char			*del_row[2] = {down_s, up_s};
 	int			i;
 
-	if (NULL == (result = DBselect(
-			"select distinct d.triggerid_down,d.triggerid_up"
-			" from trigger_depends d,triggers t,hosts h,items i,functions f"
-			" where t.triggerid=d.triggerid_down"
-				" and t.flags<>%d"
-				" and h.hostid=i.hostid"
-				" and i.itemid=f.itemid"
-				" and f.triggerid=d.triggerid_down"
-				" and h.status in (%d,%d)",
-				ZBX_FLAG_DISCOVERY_PROTOTYPE, HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED)))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_TRIGGER_DEPENDENCY)))
 	{
 		return FAIL;
 	}
@@ -2559,27 +3030,47 @@ static char	**dbsync_function_preproc_row(char **row)
  ******************************************************************************/
 int	zbx_dbsync_compare_functions(zbx_dbsync_t *sync)
 {
-	DB_ROW			dbrow;
-	DB_RESULT		result;
-	zbx_hashset_t		ids;
-	zbx_hashset_iter_t	iter;
-	zbx_uint64_t		rowid, itemid;
-	ZBX_DC_FUNCTION		*function;
-	char			**row;
-
-	if (NULL == (result = DBselect("select itemid,functionid,name,parameter,triggerid from functions")))
-		return FAIL;
+	DB_ROW				dbrow;
+	DB_RESULT			result;
+	zbx_hashset_t			ids;
+	zbx_hashset_iter_t		iter;
+	zbx_uint64_t			rowid, itemid;
+	ZBX_DC_FUNCTION			*function;
+	char				**row, *sql = NULL;
+	size_t				sql_alloc = 0, sql_offset = 0;
+	const zbx_vector_uint64_t	*functionids = NULL;
 
 	dbsync_prepare(sync, 5, dbsync_function_preproc_row);
 
+	if (ZBX_DBSYNC_UPDATE == sync->mode && NULL != (functionids = dbsync_env_get_changes(ZBX_DBSYNC_OBJ_FUNCTION,
+			dbsync_env.cache->functions.num_data)) && 0 == functionids->values_num)
+	{
+		return SUCCEED;
+	}
+
+	if (NULL != functionids)
+	{
+		dbsync_get_sql(ZBX_DBSYNC_QUERY_FUNCTIONS, &sql, &sql_alloc, &sql_offset);
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " where");
+		DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "functionid", functionids->values,
+				functionids->values_num);
+		result = DBselect("%s", sql);
+		zbx_free(sql);
+	}
+	else
+		result = dbsync_select(ZBX_DBSYNC_QUERY_FUNCTIONS);
+
+	if (NULL == result)
+		return FAIL;
+
 	if (ZBX_DBSYNC_INIT == sync->mode)
 	{
 		sync->dbresult = result;
 		return SUCCEED;
 	}
 
-	zbx_hashset_create(&ids, dbsync_env.cache->functions.num_data, ZBX_DEFAULT_UINT64_HASH_FUNC,
-			ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_hashset_create(&ids, NULL == functionids ? dbsync_env.cache->functions.num_data :
+			functionids->values_num, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
 	while (NULL != (dbrow = DBfetch(result)))
 	{
@@ -2603,11 +3094,18 @@ int	zbx_dbsync_compare_functions(zbx_dbsync_t *sync)
 			dbsync_add_row(sync, rowid, tag, row);
 	}
 
-	zbx_hashset_iter_reset(&dbsync_env.cache->functions, &iter);
-	while (NULL != (function = (ZBX_DC_FUNCTION *)zbx_hashset_iter_next(&iter)))
+	if (NULL != functionids)
 	{
-		if (NULL == zbx_hashset_search(&ids, &function->functionid))
-			dbsync_add_row(sync, function->functionid, ZBX_DBSYNC_ROW_REMOVE, NULL);
+		dbsync_remove_changed_rows(sync, &dbsync_env.cache->functions, &ids, functionids);
+	}
+	else
+	{
+		zbx_hashset_iter_reset(&dbsync_env.cache->functions, &iter);
+		while (NULL != (function = (ZBX_DC_FUNCTION *)zbx_hashset_iter_next(&iter)))
+		{
+			if (NULL == zbx_hashset_search(&ids, &function->functionid))
+				dbsync_add_row(sync, function->functionid, ZBX_DBSYNC_ROW_REMOVE, NULL);
+		}
 	}
 
 	zbx_hashset_destroy(&ids);
@@ -3054,7 +3552,7 @@ int	zbx_dbsync_compare_trigger_tags(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	zbx_dc_trigger_tag_t	*trigger_tag;
 
-	if (NULL == (result = DBselect("select triggertagid,triggerid,tag,value from trigger_tag")))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_TRIGGER_TAGS)))
 		return FAIL;
 
 	dbsync_prepare(sync, 4, NULL);
@@ -3144,7 +3642,7 @@ int	zbx_dbsync_compare_item_tags(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid, itemid;
 	zbx_dc_item_tag_t	*item_tag;
 
-	if (NULL == (result = DBselect("select itemtagid,itemid,tag,value from item_tag")))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_ITEM_TAGS)))
 		return FAIL;
 
 	dbsync_prepare(sync, 4, NULL);
@@ -3238,8 +3736,7 @@ int	zbx_dbsync_compare_host_tags(zbx_dbsync_t *sync)
 	zbx_uint64_t		rowid;
 	zbx_dc_host_tag_t	*host_tag;
 
-	if (NULL == (result = DBselect(
-			"select * from host_tag")))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_HOST_TAGS)))
 	{
 		printf("db query failed!\n");
 		return FAIL;
@@ -3794,19 +4291,7 @@ int	zbx_dbsync_compare_item_preprocs(zbx_dbsync_t *sync)
 	zbx_dc_preproc_op_t	*preproc;
 	char			**row;
 
-	if (NULL == (result = DBselect(
-			"select pp.item_preprocid,pp.itemid,pp.type,pp.params,pp.step,h.hostid,pp.error_handler,"
-				"pp.error_handler_params"
-			" from item_preproc pp,items i,hosts h"
-			" where pp.itemid=i.itemid"
-				" and i.hostid=h.hostid"
-				" and (h.proxy_hostid is null"
-					" or i.type in (%d,%d,%d))"
-				" and h.status in (%d,%d)"
-				" and i.flags<>%d",
-			ITEM_TYPE_INTERNAL, ITEM_TYPE_CALCULATED, ITEM_TYPE_DEPENDENT,
-			HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
-			ZBX_FLAG_DISCOVERY_PROTOTYPE)))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_ITEM_PREPROCS)))
 	{
 		return FAIL;
 	}
@@ -3931,16 +4416,7 @@ int	zbx_dbsync_compare_item_script_param(zbx_dbsync_t *sync)
 	zbx_dc_scriptitem_param_t	*itemscript_params;
 	char				**row;
 
-	if (NULL == (result = DBselect(
-			"select p.item_parameterid,p.itemid,p.name,p.value,i.hostid"
-			" from item_parameter p,items i,hosts h"
-			" where p.itemid=i.itemid"
-				" and i.hostid=h.hostid"
-				" and h.status in (%d,%d)"
-				" and i.flags<>%d"
-			" order by p.itemid",
-			HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
-			ZBX_FLAG_DISCOVERY_PROTOTYPE)))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_ITEM_SCRIPT_PARAMS)))
 	{
 		return FAIL;
 	}
@@ -4436,14 +4912,7 @@ int	zbx_dbsync_compare_host_group_hosts(zbx_dbsync_t *sync)
 	char			groupid_s[MAX_ID_LEN + 1], hostid_s[MAX_ID_LEN + 1];
 	char			*del_row[2] = {groupid_s, hostid_s};
 
-	if (NULL == (result = DBselect(
-			"select hg.groupid,hg.hostid"
-			" from hosts_groups hg,hosts h"
-			" where hg.hostid=h.hostid"
-			" and h.status in (%d,%d)"
-			" and h.flags<>%d"
-			" order by hg.groupid",
-			HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED, ZBX_FLAG_DISCOVERY_PROTOTYPE)))
+	if (NULL == (result = dbsync_select(ZBX_DBSYNC_QUERY_HOST_GROUP_HOSTS)))
 	{
 		return FAIL;
 	}
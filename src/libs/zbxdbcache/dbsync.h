@@ -32,6 +32,12 @@
 /* a cached object must be removed from configuration cache */
 #define ZBX_DBSYNC_ROW_REMOVE	3
 
+/* configuration objects tracked in changelog table */
+#define ZBX_DBSYNC_OBJ_ITEM		3
+#define ZBX_DBSYNC_OBJ_TRIGGER		5
+#define ZBX_DBSYNC_OBJ_FUNCTION		7
+#define ZBX_DBSYNC_OBJ_COUNT		8
+
 #define ZBX_DBSYNC_UPDATE_HOSTS			__UINT64_C(0x0001)
 #define ZBX_DBSYNC_UPDATE_ITEMS			__UINT64_C(0x0002)
 #define ZBX_DBSYNC_UPDATE_FUNCTIONS		__UINT64_C(0x0004)
@@ -109,6 +115,9 @@ struct zbx_dbsync
 
 void	zbx_dbsync_init_env(ZBX_DC_CONFIG *cache);
 void	zbx_dbsync_free_env(void);
+int	zbx_dbsync_env_prepare(unsigned char mode, int changelog);
+void	zbx_dbsync_env_disable_changelog(unsigned char object);
+void	zbx_dbsync_env_flush_changelog(void);
 
 void	zbx_dbsync_init(zbx_dbsync_t *sync, unsigned char mode);
 void	zbx_dbsync_clear(zbx_dbsync_t *sync);
@@ -0,0 +1,388 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "dbsync_prefetch.h"
+
+#ifdef ZBX_DBSYNC_PREFETCH
+
+#include "log.h"
+#include "db.h"
+
+/*
+ * Configuration query prefetch
+ * ============================
+ *
+ * Worker threads execute configuration queries with their own database connections while configuration syncer
+ * compares the results of the previous queries with configuration cache. Queries are executed in the order they are
+ * queued, which is the order configuration syncer uses them. Each worker keeps at most one result ahead of
+ * configuration syncer, so the memory used by prefetched results is limited by the number of workers.
+ *
+ * A query not yet started by a worker when configuration syncer needs it is executed by configuration syncer
+ * itself. Failed queries are not retried by workers - configuration syncer executes the query again when the
+ * prefetched result is missing.
+ */
+
+#define ZBX_DBSYNC_QUERY_NONE		0	/* query is not requested */
+#define ZBX_DBSYNC_QUERY_PENDING	1	/* query is waiting for a worker */
+#define ZBX_DBSYNC_QUERY_RUNNING	2	/* query is being executed by a worker */
+#define ZBX_DBSYNC_QUERY_DONE		3	/* query result is ready */
+
+typedef struct
+{
+	int		state;
+	DB_RESULT	result;
+}
+zbx_dbsync_prefetch_query_t;
+
+static zbx_dbsync_prefetch_query_t	*prefetch_queries;
+static int				prefetch_queries_num;
+static zbx_dbsync_prefetch_sql_func_t	prefetch_sql_func;
+
+static pthread_t	*prefetch_workers;
+static int		prefetch_workers_num;
+
+/* the number of running queries and results not taken by configuration syncer */
+static int		prefetch_inflight_num;
+static int		prefetch_stop;
+
+static pthread_mutex_t	prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	prefetch_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	prefetch_done = PTHREAD_COND_INITIALIZER;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: finds the first queued query if a worker may start it             *
+ *                                                                            *
+ * Return value: the query index or FAIL if there is nothing to execute       *
+ *                                                                            *
+ * Comments: Must be called with prefetch_lock locked.                        *
+ *                                                                            *
+ ******************************************************************************/
+static int	dbsync_prefetch_next(void)
+{
+	int	i;
+
+	if (prefetch_inflight_num >= prefetch_workers_num)
+		return FAIL;
+
+	for (i = 0; i < prefetch_queries_num; i++)
+	{
+		if (ZBX_DBSYNC_QUERY_PENDING == prefetch_queries[i].state)
+			return i;
+	}
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: executes queued configuration queries with own database           *
+ *          connection                                                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	*dbsync_prefetch_worker(void *args)
+{
+	sigset_t	mask;
+	int		i, connected = 0;
+	char		*sql = NULL;
+	size_t		sql_alloc = 0, sql_offset;
+	DB_RESULT	result;
+
+	ZBX_UNUSED(args);
+
+	/* signals are handled by the configuration syncer thread */
+	sigfillset(&mask);
+	pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+	/* database settings were detected by configuration syncer connection */
+	zbx_db_init_worker_options();
+
+	pthread_mutex_lock(&prefetch_lock);
+
+	while (0 == prefetch_stop)
+	{
+		if (FAIL == (i = dbsync_prefetch_next()))
+		{
+			pthread_cond_wait(&prefetch_queued, &prefetch_lock);
+			continue;
+		}
+
+		prefetch_queries[i].state = ZBX_DBSYNC_QUERY_RUNNING;
+		prefetch_inflight_num++;
+		pthread_mutex_unlock(&prefetch_lock);
+
+		result = NULL;
+
+		if (0 == connected && ZBX_DB_OK == DBconnect(ZBX_DB_CONNECT_ONCE))
+			connected = 1;
+
+		if (0 != connected)
+		{
+			sql_offset = 0;
+			prefetch_sql_func(i, &sql, &sql_alloc, &sql_offset);
+
+			if ((DB_RESULT)ZBX_DB_DOWN == (result = DBselect_once("%s", sql)))
+			{
+				result = NULL;
+				DBclose();
+				connected = 0;
+			}
+		}
+
+		pthread_mutex_lock(&prefetch_lock);
+
+		prefetch_queries[i].result = result;
+		prefetch_queries[i].state = ZBX_DBSYNC_QUERY_DONE;
+		pthread_cond_broadcast(&prefetch_done);
+	}
+
+	pthread_mutex_unlock(&prefetch_lock);
+
+	if (0 != connected)
+		DBclose();
+
+	zbx_free(sql);
+
+	return NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: starts worker threads                                             *
+ *                                                                            *
+ * Parameters: workers_num - [IN] the number of worker threads to start       *
+ *             queries_num - [IN] the number of queries                       *
+ *             sql_func    - [IN] the callback writing SQL of a query         *
+ *                                                                            *
+ * Return value: the number of running worker threads                         *
+ *                                                                            *
+ * Comments: Workers that are already running are reused.                     *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_dbsync_prefetch_init(int workers_num, int queries_num, zbx_dbsync_prefetch_sql_func_t sql_func)
+{
+	if (0 != prefetch_workers_num)
+		return prefetch_workers_num;
+
+	prefetch_queries = (zbx_dbsync_prefetch_query_t *)zbx_calloc(NULL, (size_t)queries_num,
+			sizeof(zbx_dbsync_prefetch_query_t));
+	prefetch_queries_num = queries_num;
+	prefetch_sql_func = sql_func;
+	prefetch_inflight_num = 0;
+	prefetch_stop = 0;
+
+	prefetch_workers = (pthread_t *)zbx_malloc(NULL, sizeof(pthread_t) * (size_t)workers_num);
+
+	/* the started workers wait until the number of workers is known */
+	pthread_mutex_lock(&prefetch_lock);
+
+	for (; prefetch_workers_num < workers_num; prefetch_workers_num++)
+	{
+		int	err;
+
+		if (0 != (err = pthread_create(&prefetch_workers[prefetch_workers_num], NULL, dbsync_prefetch_worker,
+				NULL)))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot start configuration sync worker: %s", zbx_strerror(err));
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&prefetch_lock);
+
+	if (0 == prefetch_workers_num)
+	{
+		zbx_free(prefetch_workers);
+		zbx_free(prefetch_queries);
+	}
+
+	return prefetch_workers_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: queues queries for execution by worker threads                    *
+ *                                                                            *
+ * Parameters: queued - [IN] the flags of queries to execute, in the order of *
+ *                           use                                              *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_dbsync_prefetch_start(const unsigned char *queued)
+{
+	int	i;
+
+	if (0 == prefetch_workers_num)
+		return;
+
+	pthread_mutex_lock(&prefetch_lock);
+
+	for (i = 0; i < prefetch_queries_num; i++)
+	{
+		if (0 != queued[i])
+			prefetch_queries[i].state = ZBX_DBSYNC_QUERY_PENDING;
+	}
+
+	pthread_cond_broadcast(&prefetch_queued);
+	pthread_mutex_unlock(&prefetch_lock);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: takes prefetched query result                                     *
+ *                                                                            *
+ * Parameters: query - [IN] the query index                                   *
+ *                                                                            *
+ * Return value: the query result or NULL if the query was not started by a   *
+ *               worker or failed                                             *
+ *                                                                            *
+ * Comments: The returned result must be freed by the caller. Queries not     *
+ *           started yet are removed from queue, so the caller does not wait  *
+ *           for a free worker.                                               *
+ *                                                                            *
+ ******************************************************************************/
+DB_RESULT	zbx_dbsync_prefetch_get(int query)
+{
+	zbx_dbsync_prefetch_query_t	*prefetch;
+	DB_RESULT			result = NULL;
+
+	if (0 == prefetch_workers_num)
+		return NULL;
+
+	prefetch = &prefetch_queries[query];
+
+	pthread_mutex_lock(&prefetch_lock);
+
+	if (ZBX_DBSYNC_QUERY_PENDING == prefetch->state)
+		prefetch->state = ZBX_DBSYNC_QUERY_NONE;
+
+	while (ZBX_DBSYNC_QUERY_RUNNING == prefetch->state)
+		pthread_cond_wait(&prefetch_done, &prefetch_lock);
+
+	if (ZBX_DBSYNC_QUERY_DONE == prefetch->state)
+	{
+		result = prefetch->result;
+		prefetch->state = ZBX_DBSYNC_QUERY_NONE;
+
+		/* the result was taken, let worker start the next query */
+		prefetch_inflight_num--;
+		pthread_cond_broadcast(&prefetch_queued);
+	}
+
+	pthread_mutex_unlock(&prefetch_lock);
+
+	return result;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: frees query results that were not taken                           *
+ *                                                                            *
+ * Comments: Must be called with prefetch_lock locked after queued queries    *
+ *           were cancelled.                                                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	dbsync_prefetch_free_results(void)
+{
+	int	i;
+
+	for (i = 0; i < prefetch_queries_num; i++)
+	{
+		while (ZBX_DBSYNC_QUERY_RUNNING == prefetch_queries[i].state)
+			pthread_cond_wait(&prefetch_done, &prefetch_lock);
+
+		if (ZBX_DBSYNC_QUERY_DONE == prefetch_queries[i].state)
+		{
+			DBfree_result(prefetch_queries[i].result);
+			prefetch_queries[i].state = ZBX_DBSYNC_QUERY_NONE;
+			prefetch_inflight_num--;
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes queries not started by workers from queue                 *
+ *                                                                            *
+ * Comments: Must be called with prefetch_lock locked.                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	dbsync_prefetch_cancel(void)
+{
+	int	i;
+
+	for (i = 0; i < prefetch_queries_num; i++)
+	{
+		if (ZBX_DBSYNC_QUERY_PENDING == prefetch_queries[i].state)
+			prefetch_queries[i].state = ZBX_DBSYNC_QUERY_NONE;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: cancels queued queries and frees results that were not taken      *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_dbsync_prefetch_clear(void)
+{
+	if (0 == prefetch_workers_num)
+		return;
+
+	pthread_mutex_lock(&prefetch_lock);
+
+	dbsync_prefetch_cancel();
+	dbsync_prefetch_free_results();
+
+	pthread_mutex_unlock(&prefetch_lock);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: stops worker threads and closes their database connections       *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_dbsync_prefetch_destroy(void)
+{
+	int	i;
+
+	if (0 == prefetch_workers_num)
+		return;
+
+	pthread_mutex_lock(&prefetch_lock);
+
+	dbsync_prefetch_cancel();
+	prefetch_stop = 1;
+	pthread_cond_broadcast(&prefetch_queued);
+
+	pthread_mutex_unlock(&prefetch_lock);
+
+	/* workers finish the running queries before exiting */
+	for (i = 0; i < prefetch_workers_num; i++)
+		pthread_join(prefetch_workers[i], NULL);
+
+	pthread_mutex_lock(&prefetch_lock);
+	dbsync_prefetch_free_results();
+	pthread_mutex_unlock(&prefetch_lock);
+
+	zbx_free(prefetch_workers);
+	zbx_free(prefetch_queries);
+	prefetch_workers_num = 0;
+	prefetch_queries_num = 0;
+}
+
+#endif
@@ -0,0 +1,46 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_DBSYNC_PREFETCH_H
+#define ZABBIX_DBSYNC_PREFETCH_H
+
+#include "common.h"
+#include "zbxdb.h"
+
+/* Worker threads require separate database connections, which are supported only with thread local */
+/* storage. Oracle results are bound to the connection statement handle and cannot be passed between */
+/* threads, while SQLite uses single connection.                                                     */
+#if defined(HAVE_THREAD_LOCAL) && (defined(HAVE_MYSQL) || defined(HAVE_POSTGRESQL))
+#	define ZBX_DBSYNC_PREFETCH
+#endif
+
+#ifdef ZBX_DBSYNC_PREFETCH
+
+/* writes SQL statement of the specified query */
+typedef void	(*zbx_dbsync_prefetch_sql_func_t)(int query, char **sql, size_t *sql_alloc, size_t *sql_offset);
+
+int		zbx_dbsync_prefetch_init(int workers_num, int queries_num, zbx_dbsync_prefetch_sql_func_t sql_func);
+void		zbx_dbsync_prefetch_start(const unsigned char *queued);
+DB_RESULT	zbx_dbsync_prefetch_get(int query);
+void		zbx_dbsync_prefetch_clear(void);
+void		zbx_dbsync_prefetch_destroy(void);
+
+#endif
+
+#endif
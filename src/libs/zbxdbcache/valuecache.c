@@ -23,6 +23,8 @@
 #include "dbcache.h"
 #include "zbxmutexs.h"
 
+#include <sys/mman.h>
+
 /*
  * The cache (zbx_vc_cache_t) is organized as a hashset of item records (zbx_vc_item_t).
  *
@@ -42,8 +44,16 @@
  * When cache runs out of memory to store new items it enters in low memory mode.
  * In low memory mode cache continues to function as before with few restrictions:
  *   1) items that weren't accessed during the last day are removed from cache.
- *   2) items with worst hits/values ratio might be removed from cache to free the space.
- *   3) no new items are added to the cache.
+ *   2) items are removed from cache to free the space using 2Q replacement policy (see below).
+ *   3) no new items are added to the cache, except recently removed items (ghosts).
+ *
+ * The items are admitted into the probation queue and are promoted to the protected queue
+ * after the first cache hit. When space must be freed the least recently accessed probation
+ * items are removed first. Protected items are removed only if the space is requested by
+ * protected item or the probation queue holds less than ZBX_VC_PROBATION_SHARE percent of
+ * cached values - so requests of large ranges of rarely used items cannot flush the frequently
+ * used items from cache. The identifiers of removed items are kept in the ghost queue and
+ * such items are readmitted directly to the protected queue when requested again.
  *
  * The low memory mode can't be turned off - it will persist until server is rebooted.
  * In low memory mode a warning message is written into log every 5 minutes.
@@ -71,6 +81,9 @@ static int	vc_state = ZBX_VC_DISABLED;
 /* the value cache size */
 extern zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE;
 
+/* compress numeric item values */
+extern int	CONFIG_VALUE_CACHE_COMPRESSION;
+
 ZBX_SHMEM_FUNC_IMPL(__vc, vc_mem)
 
 #define VC_STRPOOL_INIT_SIZE	(1000)
@@ -85,6 +98,14 @@ ZBX_SHMEM_FUNC_IMPL(__vc, vc_mem)
 
 #define ZBX_VC_ITEM_EXPIRE_PERIOD	SEC_PER_DAY
 
+/* the minimum share (in percents) of values cached by probation items before protected items can be */
+/* removed to free space for probation items                                                          */
+#define ZBX_VC_PROBATION_SHARE		25
+
+/* the ghost queue holds one removed item identifier per this number of cache bytes */
+#define ZBX_VC_GHOST_ENTRY_BYTES	(16 * ZBX_KIBIBYTE)
+#define ZBX_VC_GHOST_MIN		1000
+
 /* the data chunk used to store data fragment */
 typedef struct zbx_vc_chunk
 {
@@ -103,11 +124,72 @@ typedef struct zbx_vc_chunk
 	/* the number of item value slots in chunk */
 	int			slots_num;
 
+	/* the size of compressed value data in bytes, 0 for uncompressed chunks */
+	int			packed_size;
+
 	/* the item value data */
 	zbx_history_record_t	slots[1];
 }
 zbx_vc_chunk_t;
 
+/*
+ * Compressed (packed) chunks are used for numeric items when value cache compression is enabled.
+ * Once a chunk is no longer the head chunk (it does not receive new values) its values are
+ * encoded into a bit stream using Gorilla style compression - delta-of-delta encoded timestamp
+ * seconds, repeated nanoseconds flag and XOR encoded values. For packed chunks:
+ *   slots[0]     - the first (oldest) cached value
+ *   slots[1]     - the last (newest) cached value
+ *   &slots[2]    - the bit stream of packed_size bytes, holding slots_num values
+ *   first_value  - the index of first cached value in the bit stream, values before it
+ *                  were removed from cache
+ *   last_value   - always slots_num - 1
+ * Packed chunks are immutable, they are decoded into a temporary buffer when accessed.
+ */
+
+#define VC_CHUNK_IS_PACKED(chunk)	(0 != (chunk)->packed_size)
+
+/* a packed chunk can be merged with the next chunk unless it exceeds */
+/* this number of times the current slot count of uncompressed chunks */
+#define ZBX_VC_PACKED_CHUNK_FACTOR	4
+
+/* the maximum number of time windows aggregated per item */
+#define ZBX_VC_ITEM_AGGREGATES_MAX	8
+
+/* the minimum number of incremental aggregate updates before it's recalculated */
+#define ZBX_VC_AGGREGATE_UPDATES_MIN	64
+
+/* the running aggregate of item values within a sliding time window ending with */
+/* the newest cached item value                                                 */
+typedef struct
+{
+	/* the window length in seconds */
+	int		seconds;
+
+	/* the last time the aggregate was requested */
+	int		lastaccess;
+
+	/* the number of values within window, -1 if the aggregate must be recalculated */
+	int		count;
+
+	/* The number of incremental updates since the last recalculation.  */
+	/* Used to limit the accumulation of floating point rounding errors. */
+	int		updates;
+
+	/* the window end - timestamp of the newest item value */
+	zbx_timespec_t	end;
+
+	/* the timestamp of the oldest value within window */
+	zbx_timespec_t	first;
+
+	history_value_t	sum;
+	history_value_t	min;
+	history_value_t	max;
+
+	/* the sum of unsigned values as floating point number, used to calculate average */
+	double		sum_dbl;
+}
+zbx_vc_item_aggregate_t;
+
 /* min/max number of item history values to store in chunk */
 
 #define ZBX_VC_MIN_CHUNK_RECORDS	2
@@ -131,6 +213,9 @@ typedef struct
 	/* the hour when the current/global range sync was done       */
 	unsigned char	range_sync_hour;
 
+	/* the replacement policy queue (ZBX_VC_QUEUE_*)              */
+	unsigned char	queue;
+
 	/* The total number of item values in cache.                  */
 	/* Used to evaluate if the item must be dropped from cache    */
 	/* in low memory situation.                                   */
@@ -178,6 +263,11 @@ typedef struct
 
 	/* the first (oldest) chunk of item history data              */
 	zbx_vc_chunk_t	*tail;
+
+	/* the running aggregates of numeric item values within time windows requested */
+	/* by trigger functions                                                        */
+	zbx_vc_item_aggregate_t	*aggregates;
+	int			aggregates_num;
 }
 zbx_vc_item_t;
 
@@ -207,9 +297,39 @@ typedef struct
 
 	/* the string pool for str, text and log item values */
 	zbx_hashset_t	strpool;
+
+	/* the number of values and allocated bytes of compressed chunks */
+	zbx_uint64_t	packed_values;
+	zbx_uint64_t	packed_size;
+
+	/* the replacement policy statistics per queue */
+	zbx_uint64_t	queue_hits[ZBX_VC_QUEUE_COUNT];
+	zbx_uint64_t	queue_misses[ZBX_VC_QUEUE_COUNT];
+	zbx_uint64_t	queue_evictions[ZBX_VC_QUEUE_COUNT];
+
+	/* the number of removed items readmitted from ghost queue */
+	zbx_uint64_t	ghost_hits;
+
+	/* the ghost queue - ring buffer of removed item identifiers */
+	zbx_uint64_t	*ghosts;
+	int		ghosts_size;
+	int		ghosts_head;
+
+	/* the ghost queue index (zbx_vc_ghost_t) by itemid */
+	zbx_hashset_t	ghosts_index;
 }
 zbx_vc_cache_t;
 
+/* the ghost queue index entry */
+typedef struct
+{
+	zbx_uint64_t	itemid;
+
+	/* the item position in ghost queue ring buffer */
+	int		index;
+}
+zbx_vc_ghost_t;
+
 /* the item weight data, used to determine if item can be removed from cache */
 typedef struct
 {
@@ -224,10 +344,13 @@ zbx_vc_item_weight_t;
 ZBX_VECTOR_DECL(vc_itemweight, zbx_vc_item_weight_t)
 ZBX_VECTOR_IMPL(vc_itemweight, zbx_vc_item_weight_t)
 
+ZBX_VECTOR_IMPL(vc_request, zbx_vc_request_t)
+
 typedef enum
 {
 	ZBX_VC_UPDATE_STATS,
-	ZBX_VC_UPDATE_RANGE
+	ZBX_VC_UPDATE_RANGE,
+	ZBX_VC_UPDATE_AGGREGATE
 }
 zbx_vc_item_update_type_t;
 
@@ -243,6 +366,12 @@ enum
 	ZBX_VC_UPDATE_RANGE_NOW
 };
 
+enum
+{
+	ZBX_VC_UPDATE_AGGREGATE_SECONDS,
+	ZBX_VC_UPDATE_AGGREGATE_NOW
+};
+
 typedef struct
 {
 	zbx_uint64_t			itemid;
@@ -273,8 +402,15 @@ static void	vc_cache_item_update(zbx_uint64_t itemid, zbx_vc_item_update_type_t
 /* the value cache */
 static zbx_vc_cache_t	*vc_cache = NULL;
 
-#define	RDLOCK_CACHE	zbx_rwlock_rdlock(vc_lock);
-#define	WRLOCK_CACHE	zbx_rwlock_wrlock(vc_lock);
+/* the buffer for decoded packed chunk values */
+static zbx_history_record_t	*vc_unpacked = NULL;
+static int			vc_unpacked_alloc = 0;
+
+/* the packed chunk currently decoded in buffer, valid only while cache is locked */
+static const zbx_vc_chunk_t	*vc_unpacked_chunk = NULL;
+
+#define	RDLOCK_CACHE	zbx_rwlock_rdlock(vc_lock); vc_unpacked_chunk = NULL;
+#define	WRLOCK_CACHE	zbx_rwlock_wrlock(vc_lock); vc_unpacked_chunk = NULL;
 #define	UNLOCK_CACHE	zbx_rwlock_unlock(vc_lock);
 
 /* function prototypes */
@@ -285,6 +421,7 @@ static size_t	vch_item_free_cache(zbx_vc_item_t *item);
 static size_t	vch_item_free_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk);
 static int	vch_item_add_values_at_tail(zbx_vc_item_t *item, const zbx_history_record_t *values, int values_num);
 static void	vch_item_clean_cache(zbx_vc_item_t *item);
+static void	vch_item_invalidate_aggregates(zbx_vc_item_t *item, int timestamp);
 
 /*********************************************************************************
  *                                                                               *
@@ -550,7 +687,8 @@ static int	vc_strpool_compare_func(const void *d1, const void *d2)
 
 /******************************************************************************
  *                                                                            *
- * Purpose: compares two item weight data structures by their 'weight'        *
+ * Purpose: compares two item weight data structures by their replacement     *
+ *          policy queue, last access time and 'weight'                       *
  *                                                                            *
  * Parameters: d1   - [IN] the first item weight data structure               *
  *             d2   - [IN] the second item weight data structure              *
@@ -558,6 +696,8 @@ static int	vc_strpool_compare_func(const void *d1, const void *d2)
  ******************************************************************************/
 static int	vc_item_weight_compare_func(const zbx_vc_item_weight_t *d1, const zbx_vc_item_weight_t *d2)
 {
+	ZBX_RETURN_IF_NOT_EQUAL(d1->item->queue, d2->item->queue);
+	ZBX_RETURN_IF_NOT_EQUAL(d1->item->last_accessed, d2->item->last_accessed);
 	ZBX_RETURN_IF_NOT_EQUAL(d1->weight, d2->weight);
 
 	return 0;
@@ -640,6 +780,7 @@ static void	vc_history_record_vector_clean(zbx_vector_history_record_t *vector,
  *                                                                            *
  * Comments: The misses are added only to cache statistics, while hits are    *
  *           added to both - item and cache statistics.                       *
+ *           Items are promoted from probation to protected queue on hit.     *
  *                                                                            *
  ******************************************************************************/
 static void	vc_update_statistics(zbx_vc_item_t *item, int hits, int misses, int now)
@@ -648,6 +789,15 @@ static void	vc_update_statistics(zbx_vc_item_t *item, int hits, int misses, int
 	{
 		int	hour;
 
+		if (ZBX_VC_ENABLED == vc_state)
+		{
+			vc_cache->queue_hits[item->queue] += hits;
+			vc_cache->queue_misses[item->queue] += misses;
+		}
+
+		if (0 != hits)
+			item->queue = ZBX_VC_QUEUE_PROTECTED;
+
 		item->hits += hits;
 		item->last_accessed = now;
 
@@ -757,6 +907,125 @@ static void	vc_warn_low_memory(void)
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds removed item to the ghost queue                              *
+ *                                                                            *
+ * Parameters: itemid - [IN] the removed item identifier                      *
+ *                                                                            *
+ * Comments: The oldest ghost is dropped when the ghost queue is full.        *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_ghost_add(zbx_uint64_t itemid)
+{
+	zbx_vc_ghost_t	*ghost;
+	int		index = vc_cache->ghosts_head;
+
+	if (0 != vc_cache->ghosts[index])
+	{
+		/* the index entry might already point to a newer ghost queue position of the same item */
+		if (NULL != (ghost = (zbx_vc_ghost_t *)zbx_hashset_search(&vc_cache->ghosts_index,
+				&vc_cache->ghosts[index])) && ghost->index == index)
+		{
+			zbx_hashset_remove_direct(&vc_cache->ghosts_index, ghost);
+		}
+	}
+
+	vc_cache->ghosts[index] = itemid;
+	vc_cache->ghosts_head = (index + 1) % vc_cache->ghosts_size;
+
+	if (NULL == (ghost = (zbx_vc_ghost_t *)zbx_hashset_search(&vc_cache->ghosts_index, &itemid)))
+	{
+		zbx_vc_ghost_t	ghost_local = {.itemid = itemid};
+
+		/* the item will not be recognized as ghost if there is not enough memory for index entry */
+		if (NULL == (ghost = (zbx_vc_ghost_t *)zbx_hashset_insert(&vc_cache->ghosts_index, &ghost_local,
+				sizeof(ghost_local))))
+		{
+			return;
+		}
+	}
+
+	ghost->index = index;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes item from the ghost queue                                 *
+ *                                                                            *
+ * Parameters: itemid - [IN] the item identifier                              *
+ *                                                                            *
+ * Return value: SUCCEED - the item was in ghost queue                        *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: Only the index entry is removed, the ring buffer slot is reused  *
+ *           when the ghost queue wraps around.                               *
+ *                                                                            *
+ ******************************************************************************/
+static int	vc_ghost_remove(zbx_uint64_t itemid)
+{
+	zbx_vc_ghost_t	*ghost;
+
+	if (NULL == (ghost = (zbx_vc_ghost_t *)zbx_hashset_search(&vc_cache->ghosts_index, &itemid)))
+		return FAIL;
+
+	zbx_hashset_remove_direct(&vc_cache->ghosts_index, ghost);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: checks if new item can be added to cache                          *
+ *                                                                            *
+ * Parameters: itemid - [IN] the item identifier                              *
+ *                                                                            *
+ * Return value: SUCCEED - the item can be added to cache                     *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: In low memory mode only the recently removed items are added.    *
+ *                                                                            *
+ ******************************************************************************/
+static int	vc_item_is_admissible(zbx_uint64_t itemid)
+{
+	if (ZBX_VC_MODE_NORMAL == vc_cache->mode)
+		return SUCCEED;
+
+	if (NULL != zbx_hashset_search(&vc_cache->ghosts_index, &itemid))
+		return SUCCEED;
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets item from cache, adding it if necessary                      *
+ *                                                                            *
+ * Parameters: itemid     - [IN] the item identifier                          *
+ *             value_type - [IN] the item value type                          *
+ *                                                                            *
+ * Return value: the cached item or NULL if there was not enough memory       *
+ *                                                                            *
+ * Comments: New items are added to probation queue, while items readmitted   *
+ *           from ghost queue are added directly to protected queue.          *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_vc_item_t	*vc_insert_item(zbx_uint64_t itemid, unsigned char value_type)
+{
+	zbx_vc_item_t	*item, new_item = {.itemid = itemid, .value_type = value_type};
+
+	if (NULL != (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
+		return item;
+
+	if (SUCCEED == vc_ghost_remove(itemid))
+	{
+		new_item.queue = ZBX_VC_QUEUE_PROTECTED;
+		vc_cache->ghost_hits++;
+	}
+
+	return (zbx_vc_item_t *)zbx_hashset_insert(&vc_cache->items, &new_item, sizeof(new_item));
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: frees space in cache by dropping items not accessed for more than *
@@ -816,7 +1085,7 @@ void	zbx_vc_housekeeping_value_cache(void)
 /******************************************************************************
  *                                                                            *
  * Purpose: frees space in cache to store the specified number of bytes by    *
- *          dropping the least accessed items                                 *
+ *          dropping the least recently accessed items                        *
  *                                                                            *
  * Parameters: item  - [IN] the item requesting more space to store its data  *
  *             space - [IN] the number of bytes to free                       *
@@ -826,6 +1095,10 @@ void	zbx_vc_housekeeping_value_cache(void)
  *           time after calling vc_free_space() function).                    *
  *           vc_free_space() attempts to free at least min_free_request       *
  *           bytes of space to reduce number of space release requests.       *
+ *           The probation items are removed before protected items. The      *
+ *           protected items are not removed to free space for probation item *
+ *           unless probation items hold less than ZBX_VC_PROBATION_SHARE     *
+ *           percent of cached values.                                        *
  *                                                                            *
  ******************************************************************************/
 static void	vc_release_space(zbx_vc_item_t *source_item, size_t space)
@@ -835,6 +1108,8 @@ static void	vc_release_space(zbx_vc_item_t *source_item, size_t space)
 	int				i;
 	size_t				freed;
 	zbx_vector_vc_itemweight_t	items;
+	zbx_uint64_t			values_total = 0, probation_values = 0;
+	unsigned char			queue_max = ZBX_VC_QUEUE_PROTECTED;
 
 	/* reserve at least min_free_request bytes to avoid spamming with free space requests */
 	if (space < vc_cache->min_free_request)
@@ -850,13 +1125,18 @@ static void	vc_release_space(zbx_vc_item_t *source_item, size_t space)
 
 	vc_warn_low_memory();
 
-	/* remove items with least hits/size ratio */
+	/* remove the least recently accessed items, probation items first */
 	zbx_vector_vc_itemweight_create(&items);
 
 	zbx_hashset_iter_reset(&vc_cache->items, &iter);
 
 	while (NULL != (item = (zbx_vc_item_t *)zbx_hashset_iter_next(&iter)))
 	{
+		values_total += (zbx_uint64_t)item->values_total;
+
+		if (ZBX_VC_QUEUE_PROBATION == item->queue)
+			probation_values += (zbx_uint64_t)item->values_total;
+
 		/* don't remove the item that requested the space and also keep */
 		/* items currently being accessed                               */
 		if (item != source_item)
@@ -870,12 +1150,24 @@ static void	vc_release_space(zbx_vc_item_t *source_item, size_t space)
 		}
 	}
 
+	if (ZBX_VC_QUEUE_PROBATION == source_item->queue &&
+			probation_values * 100 >= values_total * ZBX_VC_PROBATION_SHARE)
+	{
+		queue_max = ZBX_VC_QUEUE_PROBATION;
+	}
+
 	zbx_vector_vc_itemweight_sort(&items, (zbx_compare_func_t)vc_item_weight_compare_func);
 
 	for (i = 0; i < items.values_num && freed < space; i++)
 	{
 		item = items.values[i].item;
 
+		if (item->queue > queue_max)
+			break;
+
+		vc_cache->queue_evictions[item->queue]++;
+		vc_ghost_add(item->itemid);
+
 		freed += vch_item_free_cache(item) + sizeof(zbx_vc_item_t);
 		zbx_hashset_remove_direct(&vc_cache->items, item);
 	}
@@ -925,7 +1217,7 @@ static void	vc_history_record_copy(zbx_history_record_t *dst, const zbx_history_
  *                                                                            *
  ******************************************************************************/
 static void	vc_history_record_vector_append(zbx_vector_history_record_t *vector, int value_type,
-		zbx_history_record_t *value)
+		const zbx_history_record_t *value)
 {
 	zbx_history_record_t	record;
 
@@ -1368,132 +1660,610 @@ static int	vch_item_add_chunk(zbx_vc_item_t *item, int nslots, zbx_vc_chunk_t *i
 
 /******************************************************************************
  *                                                                            *
- * Purpose: find the index of the last value in chunk with timestamp less or  *
- *          equal to the specified timestamp.                                 *
+ * Purpose: returns the first (oldest) value of chunk                         *
  *                                                                            *
- * Parameters:  chunk - [IN] the chunk                                        *
- *              ts    - [IN] the target timestamp                             *
+ ******************************************************************************/
+static const zbx_history_record_t	*vch_chunk_first(const zbx_vc_chunk_t *chunk)
+{
+	return VC_CHUNK_IS_PACKED(chunk) ? &chunk->slots[0] : &chunk->slots[chunk->first_value];
+}
+
+/******************************************************************************
  *                                                                            *
- * Return value: The index of the last value in chunk with timestamp less or  *
- *               equal to the specified timestamp.                            *
- *               -1 is returned in the case of failure (meaning that all      *
- *               values have timestamps greater than the target timestamp).   *
+ * Purpose: returns the last (newest) value of chunk                          *
  *                                                                            *
  ******************************************************************************/
-static int	vch_chunk_find_last_value_before(const zbx_vc_chunk_t *chunk, const zbx_timespec_t *ts)
+static const zbx_history_record_t	*vch_chunk_last(const zbx_vc_chunk_t *chunk)
 {
-	int	start = chunk->first_value, end = chunk->last_value, middle;
+	return VC_CHUNK_IS_PACKED(chunk) ? &chunk->slots[1] : &chunk->slots[chunk->last_value];
+}
 
-	/* check if the last value timestamp is already greater or equal to the specified timestamp */
-	if (0 >= zbx_timespec_compare(&chunk->slots[end].timestamp, ts))
-		return end;
+/* the bit stream used to encode/decode packed chunk values */
+typedef struct
+{
+	unsigned char	*data;
+	size_t		alloc;
+	size_t		offset;
+}
+zbx_vc_bitstream_t;
 
-	/* chunk contains only one value, which did not pass the above check, return failure */
-	if (start == end)
-		return -1;
+/* the buffer for packed chunk encoding */
+static zbx_vc_bitstream_t	vc_packbuf = {NULL, 0, 0};
 
-	/* perform value lookup using binary search */
-	while (start != end)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes the lowest bits of value into bit stream                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_bits_write(zbx_vc_bitstream_t *bs, zbx_uint64_t value, int bits)
+{
+	while (0 < bits)
 	{
-		middle = start + (end - start) / 2;
+		size_t	byte = bs->offset >> 3;
+		int	free_bits = 8 - (int)(bs->offset & 7), n;
 
-		if (0 < zbx_timespec_compare(&chunk->slots[middle].timestamp, ts))
+		if (byte >= bs->alloc)
 		{
-			end = middle;
-			continue;
+			bs->alloc = (0 == bs->alloc ? 1024 : bs->alloc * 2);
+			bs->data = (unsigned char *)zbx_realloc(bs->data, bs->alloc);
 		}
 
-		if (0 >= zbx_timespec_compare(&chunk->slots[middle + 1].timestamp, ts))
-		{
-			start = middle;
-			continue;
-		}
+		if (8 == free_bits)
+			bs->data[byte] = 0;
 
-		return middle;
+		n = MIN(free_bits, bits);
+		bits -= n;
+		bs->data[byte] |= (unsigned char)(((value >> bits) & ((1 << n) - 1)) << (free_bits - n));
+		bs->offset += (size_t)n;
 	}
-
-	return -1;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: gets the chunk and index of the last value with a timestamp less  *
- *          or equal to the specified timestamp                               *
+ * Purpose: reads the specified number of bits from bit stream                *
  *                                                                            *
- * Parameters:  item          - [IN] the item                                 *
- *              ts            - [IN] the target timestamp                     *
- *                                   (NULL - current time)                    *
- *              pchunk        - [OUT] the chunk containing the target value   *
- *              pindex        - [OUT] the index of the target value           *
+ ******************************************************************************/
+static zbx_uint64_t	vc_bits_read(zbx_vc_bitstream_t *bs, int bits)
+{
+	zbx_uint64_t	value = 0;
+
+	while (0 < bits)
+	{
+		int	avail_bits = 8 - (int)(bs->offset & 7), n;
+
+		n = MIN(avail_bits, bits);
+		value = (value << n) | ((bs->data[bs->offset >> 3] >> (avail_bits - n)) & ((1 << n) - 1));
+		bits -= n;
+		bs->offset += (size_t)n;
+	}
+
+	return value;
+}
+
+/* the previous value state of packed chunk encoder/decoder */
+typedef struct
+{
+	zbx_timespec_t	ts;
+	zbx_int64_t	delta;
+	zbx_uint64_t	value;
+	int		leading;
+	int		trailing;
+}
+zbx_vc_pack_state_t;
+
+/******************************************************************************
  *                                                                            *
- * Return value: SUCCEED - the last value was found successfully              *
- *               FAIL - all values in cache have timestamps greater than the  *
- *                      target (timeshift) timestamp.                         *
+ * Purpose: encodes value into packed chunk bit stream                        *
  *                                                                            *
- * Comments: If end_timestamp value is 0, then simply the last item value in  *
- *           cache is returned.                                               *
+ * Parameters: bs     - [IN/OUT] the bit stream                               *
+ *             state  - [IN/OUT] the previous value state                     *
+ *             record - [IN] the value to encode                              *
+ *                                                                            *
+ * Comments: Numeric values (both float and unsigned) are encoded as 64 bit   *
+ *           patterns.                                                        *
  *                                                                            *
  ******************************************************************************/
-static int	vch_item_get_last_value(const zbx_vc_item_t *item, const zbx_timespec_t *ts, zbx_vc_chunk_t **pchunk,
-		int *pindex)
+static void	vc_pack_value(zbx_vc_bitstream_t *bs, zbx_vc_pack_state_t *state, const zbx_history_record_t *record)
 {
-	zbx_vc_chunk_t	*chunk = item->head;
-	int		index;
-
-	if (NULL == chunk)
-		return FAIL;
+	zbx_int64_t	delta, dod;
+	zbx_uint64_t	xor;
+	int		leading, trailing;
+
+	/* timestamp seconds - delta of deltas */
+	delta = (zbx_int64_t)record->timestamp.sec - state->ts.sec;
+	dod = delta - state->delta;
+
+	if (0 == dod)
+		vc_bits_write(bs, 0, 1);
+	else if (-63 <= dod && dod <= 64)
+		vc_bits_write(bs, (__UINT64_C(0x2) << 7) | (zbx_uint64_t)(dod + 63), 2 + 7);
+	else if (-255 <= dod && dod <= 256)
+		vc_bits_write(bs, (__UINT64_C(0x6) << 9) | (zbx_uint64_t)(dod + 255), 3 + 9);
+	else if (-2047 <= dod && dod <= 2048)
+		vc_bits_write(bs, (__UINT64_C(0xe) << 12) | (zbx_uint64_t)(dod + 2047), 4 + 12);
+	else
+	{
+		vc_bits_write(bs, 0xf, 4);
+		vc_bits_write(bs, (zbx_uint64_t)dod, 64);
+	}
 
-	index = chunk->last_value;
+	/* timestamp nanoseconds - either same as previous or stored as is */
+	if (record->timestamp.ns == state->ts.ns)
+	{
+		vc_bits_write(bs, 0, 1);
+	}
+	else
+	{
+		vc_bits_write(bs, 1, 1);
+		vc_bits_write(bs, (zbx_uint64_t)record->timestamp.ns, 30);
+	}
 
-	if (0 < zbx_timespec_compare(&chunk->slots[index].timestamp, ts))
+	/* value - meaningful bits of XOR with the previous value */
+	if (0 == (xor = record->value.ui64 ^ state->value))
 	{
-		while (0 < zbx_timespec_compare(&chunk->slots[chunk->first_value].timestamp, ts))
+		vc_bits_write(bs, 0, 1);
+	}
+	else
+	{
+		for (leading = 0; 0 == (xor & (__UINT64_C(1) << (63 - leading))); leading++)
+			;
+
+		for (trailing = 0; 0 == (xor & (__UINT64_C(1) << trailing)); trailing++)
+			;
+
+		if (-1 != state->leading && leading >= state->leading && trailing >= state->trailing)
 		{
-			chunk = chunk->prev;
-			/* there are no values for requested range, return failure */
-			if (NULL == chunk)
-				return FAIL;
+			vc_bits_write(bs, 0x2, 2);
+			vc_bits_write(bs, xor >> state->trailing, 64 - state->leading - state->trailing);
 		}
-		index = vch_chunk_find_last_value_before(chunk, ts);
-	}
+		else
+		{
+			vc_bits_write(bs, 0x3, 2);
+			vc_bits_write(bs, (zbx_uint64_t)leading, 6);
+			vc_bits_write(bs, (zbx_uint64_t)(63 - leading - trailing), 6);
+			vc_bits_write(bs, xor >> trailing, 64 - leading - trailing);
 
-	*pchunk = chunk;
-	*pindex = index;
+			state->leading = leading;
+			state->trailing = trailing;
+		}
+	}
 
-	return SUCCEED;
+	state->ts = record->timestamp;
+	state->delta = delta;
+	state->value = record->value.ui64;
 }
 
 /******************************************************************************
  *                                                                            *
- * Purpose: copies value in the specified item's chunk slot                   *
- *                                                                            *
- * Parameters: chunk        - [IN/OUT] the target chunk                       *
- *             index        - [IN] the target slot                            *
- *             source_value - [IN] the value to copy                          *
- *                                                                            *
- * Return value: SUCCEED - the value was copied successfully                  *
- *               FAIL    - the value copying failed (not enough space for     *
- *                         string, text or log type data)                     *
+ * Purpose: decodes value from packed chunk bit stream                        *
  *                                                                            *
- * Comments: This function is used to copy data to cache. The contents of     *
- *           str, text and log type values are stored in cache string pool.   *
+ * Parameters: bs     - [IN/OUT] the bit stream                               *
+ *             state  - [IN/OUT] the previous value state                     *
+ *             record - [OUT] the decoded value                               *
  *                                                                            *
  ******************************************************************************/
-static int	vch_item_copy_value(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk, int index,
-		const zbx_history_record_t *source_value)
+static void	vc_unpack_value(zbx_vc_bitstream_t *bs, zbx_vc_pack_state_t *state, zbx_history_record_t *record)
 {
-	zbx_history_record_t	*value;
-	int			ret = FAIL;
+	zbx_int64_t	dod;
+	int		bits;
+
+	if (0 == vc_bits_read(bs, 1))
+		dod = 0;
+	else if (0 == vc_bits_read(bs, 1))
+		dod = (zbx_int64_t)vc_bits_read(bs, 7) - 63;
+	else if (0 == vc_bits_read(bs, 1))
+		dod = (zbx_int64_t)vc_bits_read(bs, 9) - 255;
+	else if (0 == vc_bits_read(bs, 1))
+		dod = (zbx_int64_t)vc_bits_read(bs, 12) - 2047;
+	else
+		dod = (zbx_int64_t)vc_bits_read(bs, 64);
 
-	value = &chunk->slots[index];
+	state->delta += dod;
+	state->ts.sec = (int)(state->ts.sec + state->delta);
 
-	switch (item->value_type)
+	if (0 != vc_bits_read(bs, 1))
+		state->ts.ns = (int)vc_bits_read(bs, 30);
+
+	if (0 != vc_bits_read(bs, 1))
 	{
-		case ITEM_VALUE_TYPE_STR:
-		case ITEM_VALUE_TYPE_TEXT:
-			if (NULL == (value->value.str = vc_item_strdup(item, source_value->value.str)))
-				goto out;
-			break;
+		if (0 != vc_bits_read(bs, 1))
+		{
+			state->leading = (int)vc_bits_read(bs, 6);
+			state->trailing = 63 - state->leading - (int)vc_bits_read(bs, 6);
+		}
+
+		bits = 64 - state->leading - state->trailing;
+		state->value ^= vc_bits_read(bs, bits) << state->trailing;
+	}
+
+	record->timestamp = state->ts;
+	record->value.ui64 = state->value;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: encodes values into packed chunk bit stream                       *
+ *                                                                            *
+ * Parameters: bs         - [OUT] the bit stream                              *
+ *             values     - [IN] the values to encode in ascending order      *
+ *             values_num - [IN] the number of values                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_pack_values(zbx_vc_bitstream_t *bs, const zbx_history_record_t *values, int values_num)
+{
+	zbx_vc_pack_state_t	state = {{0, 0}, 0, 0, -1, 0};
+	int			i;
+
+	bs->offset = 0;
+
+	/* the first value is stored as is */
+	vc_bits_write(bs, (zbx_uint64_t)(zbx_uint32_t)values[0].timestamp.sec, 32);
+	vc_bits_write(bs, (zbx_uint64_t)values[0].timestamp.ns, 30);
+	vc_bits_write(bs, values[0].value.ui64, 64);
+
+	state.ts = values[0].timestamp;
+	state.value = values[0].value.ui64;
+
+	for (i = 1; i < values_num; i++)
+		vc_pack_value(bs, &state, &values[i]);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: decodes all values of packed chunk                                *
+ *                                                                            *
+ * Parameters: chunk  - [IN] the packed chunk                                 *
+ *             values - [OUT] the decoded values, indexed the same way as     *
+ *                            uncompressed chunk slots                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_chunk_unpack(const zbx_vc_chunk_t *chunk, zbx_history_record_t *values)
+{
+	zbx_vc_pack_state_t	state = {{0, 0}, 0, 0, -1, 0};
+	zbx_vc_bitstream_t	bs;
+	int			i;
+
+	bs.data = (unsigned char *)&chunk->slots[2];
+	bs.alloc = (size_t)chunk->packed_size;
+	bs.offset = 0;
+
+	state.ts.sec = (int)vc_bits_read(&bs, 32);
+	state.ts.ns = (int)vc_bits_read(&bs, 30);
+	state.value = vc_bits_read(&bs, 64);
+
+	values[0].timestamp = state.ts;
+	values[0].value.ui64 = state.value;
+
+	for (i = 1; i < chunk->slots_num; i++)
+		vc_unpack_value(&bs, &state, &values[i]);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns chunk values                                              *
+ *                                                                            *
+ * Parameters: chunk - [IN] the chunk                                         *
+ *                                                                            *
+ * Return value: The chunk slots. Packed chunks are decoded into a process    *
+ *               local buffer, which is valid until the next packed chunk is  *
+ *               accessed. The last decoded chunk is not decoded again until  *
+ *               the cache is unlocked.                                       *
+ *                                                                            *
+ ******************************************************************************/
+static const zbx_history_record_t	*vch_chunk_get_slots(const zbx_vc_chunk_t *chunk)
+{
+	if (!VC_CHUNK_IS_PACKED(chunk))
+		return chunk->slots;
+
+	if (chunk == vc_unpacked_chunk)
+		return vc_unpacked;
+
+	if (vc_unpacked_alloc < chunk->slots_num)
+	{
+		vc_unpacked_alloc = chunk->slots_num;
+		vc_unpacked = (zbx_history_record_t *)zbx_realloc(vc_unpacked,
+				sizeof(zbx_history_record_t) * (size_t)vc_unpacked_alloc);
+	}
+
+	vch_chunk_unpack(chunk, vc_unpacked);
+	vc_unpacked_chunk = chunk;
+
+	return vc_unpacked;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: compresses item history data chunk                                *
+ *                                                                            *
+ * Parameters: item  - [IN/OUT] the chunk owner item                          *
+ *             chunk - [IN] the uncompressed chunk                            *
+ *                                                                            *
+ * Comments: The chunk is merged with the previous packed chunk if the        *
+ *           resulting chunk does not exceed the packed chunk size limit.     *
+ *           If the chunk cannot be compressed (not enough memory or no gain) *
+ *           it is left as is.                                                *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_pack_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk)
+{
+	zbx_vc_chunk_t			*packed, *first = chunk;
+	const zbx_history_record_t	*values;
+	int				values_num, packed_size, merged_num = 0;
+	size_t				size;
+
+	values_num = chunk->last_value - chunk->first_value + 1;
+
+	if (NULL != chunk->prev && VC_CHUNK_IS_PACKED(chunk->prev) && chunk->prev->slots_num + values_num <=
+			ZBX_VC_PACKED_CHUNK_FACTOR * vch_item_chunk_slot_count(item, 0))
+	{
+		first = chunk->prev;
+		merged_num = first->last_value - first->first_value + 1;
+
+		if (vc_unpacked_alloc < first->slots_num + values_num)
+		{
+			vc_unpacked_alloc = first->slots_num + values_num;
+			vc_unpacked = (zbx_history_record_t *)zbx_realloc(vc_unpacked,
+					sizeof(zbx_history_record_t) * (size_t)vc_unpacked_alloc);
+		}
+
+		vc_unpacked_chunk = NULL;
+		vch_chunk_unpack(first, vc_unpacked);
+		memcpy(&vc_unpacked[first->slots_num], &chunk->slots[chunk->first_value],
+				sizeof(zbx_history_record_t) * (size_t)values_num);
+
+		values = &vc_unpacked[first->first_value];
+	}
+	else
+		values = &chunk->slots[chunk->first_value];
+
+	vc_pack_values(&vc_packbuf, values, merged_num + values_num);
+	packed_size = (int)((vc_packbuf.offset + 7) >> 3);
+	size = sizeof(zbx_vc_chunk_t) + sizeof(zbx_history_record_t) + (size_t)packed_size;
+
+	if (chunk == first && size >= sizeof(zbx_vc_chunk_t) + (chunk->slots_num - 1) * sizeof(zbx_history_record_t))
+		return;
+
+	/* allocate without freeing cache space, so the item being processed is not removed */
+	if (NULL == (packed = (zbx_vc_chunk_t *)__vc_shmem_malloc_func(NULL, size)))
+		return;
+
+	packed->prev = first->prev;
+	packed->next = chunk->next;
+	packed->first_value = 0;
+	packed->slots_num = merged_num + values_num;
+	packed->last_value = packed->slots_num - 1;
+	packed->packed_size = packed_size;
+	packed->slots[0] = values[0];
+	packed->slots[1] = values[packed->last_value];
+	memcpy(&packed->slots[2], vc_packbuf.data, (size_t)packed_size);
+
+	if (NULL != packed->prev)
+		packed->prev->next = packed;
+	else
+		item->tail = packed;
+
+	if (NULL != packed->next)
+		packed->next->prev = packed;
+	else
+		item->head = packed;
+
+	vc_cache->packed_values += packed->slots_num;
+	vc_cache->packed_size += size;
+
+	if (first != chunk)
+	{
+		vc_cache->packed_values -= first->slots_num;
+		vc_cache->packed_size -= sizeof(zbx_vc_chunk_t) + sizeof(zbx_history_record_t) + first->packed_size;
+		__vc_shmem_free_func(first);
+		vc_unpacked_chunk = NULL;
+	}
+
+	__vc_shmem_free_func(chunk);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: compresses item history data chunks that do not receive new       *
+ *          values anymore                                                    *
+ *                                                                            *
+ * Parameters: item - [IN/OUT] the item                                       *
+ *                                                                            *
+ * Comments: Only numeric item values are compressed and only when value      *
+ *           cache compression is enabled. The head chunk is never            *
+ *           compressed.                                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_pack_chunks(zbx_vc_item_t *item)
+{
+	zbx_vc_chunk_t	*chunk, *next;
+
+	if (0 == CONFIG_VALUE_CACHE_COMPRESSION)
+		return;
+
+	if (ITEM_VALUE_TYPE_FLOAT != item->value_type && ITEM_VALUE_TYPE_UINT64 != item->value_type)
+		return;
+
+	for (chunk = item->tail; NULL != chunk && chunk != item->head; chunk = next)
+	{
+		next = chunk->next;
+
+		if (!VC_CHUNK_IS_PACKED(chunk))
+			vch_item_pack_chunk(item, chunk);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes values older than the specified timestamp from the        *
+ *          beginning of chunk                                                *
+ *                                                                            *
+ * Parameters: item      - [IN/OUT] the chunk owner item                      *
+ *             chunk     - [IN/OUT] the chunk                                 *
+ *             timestamp - [IN] the timestamp (seconds)                       *
+ *                                                                            *
+ * Comments: The chunk must contain at least one value with timestamp greater *
+ *           or equal to the specified timestamp.                             *
+ *           The values removed from packed chunks are skipped by adjusting   *
+ *           first value index, the memory is released when the whole chunk  *
+ *           is removed.                                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_chunk_remove_values(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk, int timestamp)
+{
+	if (VC_CHUNK_IS_PACKED(chunk))
+	{
+		const zbx_history_record_t	*slots;
+		int				first_value = chunk->first_value;
+
+		slots = vch_chunk_get_slots(chunk);
+
+		while (slots[chunk->first_value].timestamp.sec < timestamp)
+			chunk->first_value++;
+
+		chunk->slots[0] = slots[chunk->first_value];
+		item->values_total -= chunk->first_value - first_value;
+
+		return;
+	}
+
+	while (chunk->slots[chunk->first_value].timestamp.sec < timestamp)
+	{
+		vc_item_free_values(item, chunk->slots, chunk->first_value, chunk->first_value);
+		chunk->first_value++;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: find the index of the last value in chunk with timestamp less or  *
+ *          equal to the specified timestamp.                                 *
+ *                                                                            *
+ * Parameters:  chunk - [IN] the chunk                                        *
+ *              ts    - [IN] the target timestamp                             *
+ *                                                                            *
+ * Return value: The index of the last value in chunk with timestamp less or  *
+ *               equal to the specified timestamp.                            *
+ *               -1 is returned in the case of failure (meaning that all      *
+ *               values have timestamps greater than the target timestamp).   *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_chunk_find_last_value_before(const zbx_vc_chunk_t *chunk, const zbx_timespec_t *ts)
+{
+	int				start = chunk->first_value, end = chunk->last_value, middle;
+	const zbx_history_record_t	*slots;
+
+	/* check if the last value timestamp is already greater or equal to the specified timestamp */
+	if (0 >= zbx_timespec_compare(&vch_chunk_last(chunk)->timestamp, ts))
+		return end;
+
+	/* chunk contains only one value, which did not pass the above check, return failure */
+	if (start == end)
+		return -1;
+
+	slots = vch_chunk_get_slots(chunk);
+
+	/* perform value lookup using binary search */
+	while (start != end)
+	{
+		middle = start + (end - start) / 2;
+
+		if (0 < zbx_timespec_compare(&slots[middle].timestamp, ts))
+		{
+			end = middle;
+			continue;
+		}
+
+		if (0 >= zbx_timespec_compare(&slots[middle + 1].timestamp, ts))
+		{
+			start = middle;
+			continue;
+		}
+
+		return middle;
+	}
+
+	return -1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets the chunk and index of the last value with a timestamp less  *
+ *          or equal to the specified timestamp                               *
+ *                                                                            *
+ * Parameters:  item          - [IN] the item                                 *
+ *              ts            - [IN] the target timestamp                     *
+ *                                   (NULL - current time)                    *
+ *              pchunk        - [OUT] the chunk containing the target value   *
+ *              pindex        - [OUT] the index of the target value           *
+ *                                                                            *
+ * Return value: SUCCEED - the last value was found successfully              *
+ *               FAIL - all values in cache have timestamps greater than the  *
+ *                      target (timeshift) timestamp.                         *
+ *                                                                            *
+ * Comments: If end_timestamp value is 0, then simply the last item value in  *
+ *           cache is returned.                                               *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_get_last_value(const zbx_vc_item_t *item, const zbx_timespec_t *ts, zbx_vc_chunk_t **pchunk,
+		int *pindex)
+{
+	zbx_vc_chunk_t	*chunk = item->head;
+	int		index;
+
+	if (NULL == chunk)
+		return FAIL;
+
+	index = chunk->last_value;
+
+	if (0 < zbx_timespec_compare(&vch_chunk_last(chunk)->timestamp, ts))
+	{
+		while (0 < zbx_timespec_compare(&vch_chunk_first(chunk)->timestamp, ts))
+		{
+			chunk = chunk->prev;
+			/* there are no values for requested range, return failure */
+			if (NULL == chunk)
+				return FAIL;
+		}
+		index = vch_chunk_find_last_value_before(chunk, ts);
+	}
+
+	*pchunk = chunk;
+	*pindex = index;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: copies value in the specified item's chunk slot                   *
+ *                                                                            *
+ * Parameters: chunk        - [IN/OUT] the target chunk                       *
+ *             index        - [IN] the target slot                            *
+ *             source_value - [IN] the value to copy                          *
+ *                                                                            *
+ * Return value: SUCCEED - the value was copied successfully                  *
+ *               FAIL    - the value copying failed (not enough space for     *
+ *                         string, text or log type data)                     *
+ *                                                                            *
+ * Comments: This function is used to copy data to cache. The contents of     *
+ *           str, text and log type values are stored in cache string pool.   *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_copy_value(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk, int index,
+		const zbx_history_record_t *source_value)
+{
+	zbx_history_record_t	*value;
+	int			ret = FAIL;
+
+	value = &chunk->slots[index];
+
+	switch (item->value_type)
+	{
+		case ITEM_VALUE_TYPE_STR:
+		case ITEM_VALUE_TYPE_TEXT:
+			if (NULL == (value->value.str = vc_item_strdup(item, source_value->value.str)))
+				goto out;
+			break;
 		case ITEM_VALUE_TYPE_LOG:
 			if (NULL == (value->value.log = vc_item_logdup(item, source_value->value.log)))
 				goto out;
@@ -1585,8 +2355,22 @@ static size_t	vch_item_free_chunk(zbx_vc_item_t *item, zbx_vc_chunk_t *chunk)
 {
 	size_t	freed;
 
-	freed = sizeof(zbx_vc_chunk_t) + (chunk->slots_num - 1) * sizeof(zbx_history_record_t);
-	freed += vc_item_free_values(item, chunk->slots, chunk->first_value, chunk->last_value);
+	if (VC_CHUNK_IS_PACKED(chunk))
+	{
+		freed = sizeof(zbx_vc_chunk_t) + sizeof(zbx_history_record_t) + chunk->packed_size;
+		item->values_total -= chunk->last_value - chunk->first_value + 1;
+
+		vc_cache->packed_values -= chunk->slots_num;
+		vc_cache->packed_size -= freed;
+
+		if (chunk == vc_unpacked_chunk)
+			vc_unpacked_chunk = NULL;
+	}
+	else
+	{
+		freed = sizeof(zbx_vc_chunk_t) + (chunk->slots_num - 1) * sizeof(zbx_history_record_t);
+		freed += vc_item_free_values(item, chunk->slots, chunk->first_value, chunk->last_value);
+	}
 
 	__vc_shmem_free_func(chunk);
 
@@ -1639,9 +2423,8 @@ static void	vch_item_clean_cache(zbx_vc_item_t *item)
 		timestamp = time(NULL) - item->active_range;
 
 		/* try to remove chunks with all history values older than maximum request range */
-		while (NULL != chunk && chunk->slots[chunk->last_value].timestamp.sec < timestamp &&
-				chunk->slots[chunk->last_value].timestamp.sec !=
-						item->head->slots[item->head->last_value].timestamp.sec)
+		while (NULL != chunk && vch_chunk_last(chunk)->timestamp.sec < timestamp &&
+				vch_chunk_last(chunk)->timestamp.sec != vch_chunk_last(item->head)->timestamp.sec)
 		{
 			/* don't remove the head chunk */
 			if (NULL == (next = chunk->next))
@@ -1655,18 +2438,14 @@ static void	vch_item_clean_cache(zbx_vc_item_t *item)
 			/* In this case increase the first value index of the next chunk until the first  */
 			/* value timestamp is greater.                                                    */
 
-			if (next->slots[next->first_value].timestamp.sec != next->slots[next->last_value].timestamp.sec)
+			if (vch_chunk_first(next)->timestamp.sec != vch_chunk_last(next)->timestamp.sec &&
+					vch_chunk_first(next)->timestamp.sec == vch_chunk_last(chunk)->timestamp.sec)
 			{
-				while (next->slots[next->first_value].timestamp.sec ==
-						chunk->slots[chunk->last_value].timestamp.sec)
-				{
-					vc_item_free_values(item, next->slots, next->first_value, next->first_value);
-					next->first_value++;
-				}
+				vch_item_chunk_remove_values(item, next, vch_chunk_last(chunk)->timestamp.sec + 1);
 			}
 
 			/* set the database cached from timestamp to the last (oldest) removed value timestamp + 1 */
-			item->db_cached_from = chunk->slots[chunk->last_value].timestamp.sec + 1;
+			item->db_cached_from = vch_chunk_last(chunk)->timestamp.sec + 1;
 
 			vch_item_remove_chunk(item, chunk);
 
@@ -1675,7 +2454,10 @@ static void	vch_item_clean_cache(zbx_vc_item_t *item)
 
 		/* reset the status flags if data was removed from cache */
 		if (tail != item->tail)
+		{
 			item->status = 0;
+			vch_item_invalidate_aggregates(item, item->db_cached_from);
+		}
 	}
 }
 
@@ -1696,22 +2478,19 @@ static void	vch_item_remove_values(zbx_vc_item_t *item, int timestamp)
 	if (ZBX_ITEM_STATUS_CACHED_ALL == item->status)
 		item->status = 0;
 
+	vch_item_invalidate_aggregates(item, timestamp);
+
 	/* try to remove chunks with all history values older than the timestamp */
-	while (NULL != chunk && chunk->slots[chunk->first_value].timestamp.sec < timestamp)
+	while (NULL != chunk && vch_chunk_first(chunk)->timestamp.sec < timestamp)
 	{
 		zbx_vc_chunk_t	*next;
 
 		/* If chunk contains values with timestamp greater or equal - remove */
 		/* only the values with less timestamp. Otherwise remove the while   */
 		/* chunk and check next one.                                         */
-		if (chunk->slots[chunk->last_value].timestamp.sec >= timestamp)
+		if (vch_chunk_last(chunk)->timestamp.sec >= timestamp)
 		{
-			while (chunk->slots[chunk->first_value].timestamp.sec < timestamp)
-			{
-				vc_item_free_values(item, chunk->slots, chunk->first_value, chunk->first_value);
-				chunk->first_value++;
-			}
-
+			vch_item_chunk_remove_values(item, chunk, timestamp);
 			break;
 		}
 
@@ -1741,10 +2520,9 @@ static int	vch_item_add_value_at_head(zbx_vc_item_t *item, const zbx_history_rec
 	int		ret = FAIL, index, sindex, nslots = 0;
 	zbx_vc_chunk_t	*chunk, *schunk;
 
-	if (NULL != item->head &&
-			0 < zbx_history_record_compare_asc_func(&item->head->slots[item->head->last_value], value))
+	if (NULL != item->head && 0 < zbx_history_record_compare_asc_func(vch_chunk_last(item->head), value))
 	{
-		if (0 < zbx_history_record_compare_asc_func(&item->tail->slots[item->tail->first_value], value))
+		if (0 < zbx_history_record_compare_asc_func(vch_chunk_first(item->tail), value))
 		{
 			/* If the added value has the same or older timestamp as the first value in cache */
 			/* we can't add it to keep cache consistency. Additionally we must make sure no   */
@@ -1765,6 +2543,16 @@ static int	vch_item_add_value_at_head(zbx_vc_item_t *item, const zbx_history_rec
 			goto out;
 		}
 
+		/* values cannot be inserted into packed chunks - fail and let */
+		/* the item to be cached again from database when requested    */
+		for (chunk = item->head; NULL != chunk &&
+				0 < zbx_history_record_compare_asc_func(vch_chunk_last(chunk), value);
+				chunk = chunk->prev)
+		{
+			if (VC_CHUNK_IS_PACKED(chunk))
+				goto out;
+		}
+
 		sindex = item->head->last_value;
 		schunk = item->head;
 
@@ -1799,6 +2587,10 @@ static int	vch_item_add_value_at_head(zbx_vc_item_t *item, const zbx_history_rec
 				}
 
 				sindex = schunk->last_value;
+
+				/* packed chunks contain only older values, as checked above */
+				if (VC_CHUNK_IS_PACKED(schunk))
+					break;
 			}
 		}
 		while (0 < zbx_timespec_compare(&schunk->slots[sindex].timestamp, &value->timestamp));
@@ -1854,7 +2646,7 @@ static int	vch_item_add_values_at_tail(zbx_vc_item_t *item, const zbx_history_re
 	/* skip values already added to the item cache by another process */
 	if (NULL != item->tail)
 	{
-		int	sec = item->tail->slots[item->tail->first_value].timestamp.sec;
+		int	sec = vch_chunk_first(item->tail)->timestamp.sec;
 
 		while (--count >= 0 && values[count].timestamp.sec >= sec)
 			;
@@ -1888,11 +2680,50 @@ static int	vch_item_add_values_at_tail(zbx_vc_item_t *item, const zbx_history_re
 			goto out;
 	}
 
+	vch_item_pack_chunks(item);
+
 	ret = SUCCEED;
 out:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds item history data read from database by time based request   *
+ *          to cache                                                          *
+ *                                                                            *
+ * Parameters: item        - [OUT] the item                                   *
+ *             itemid      - [IN] the item identifier                         *
+ *             value_type  - [IN] the item value type                         *
+ *             records     - [IN] the history data sorted by timestamps in    *
+ *                                ascending order                             *
+ *             range_start - [IN] the interval start time                     *
+ *                                                                            *
+ * Return value:  >=0    - the number of values added to cache                *
+ *                FAIL   - an error occurred while trying to cache values     *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_cache_db_values(zbx_vc_item_t **item, zbx_uint64_t itemid, unsigned char value_type,
+		const zbx_vector_history_record_t *records, int range_start)
+{
+	if (NULL == (*item = vc_insert_item(itemid, value_type)))
+		return FAIL;
+
+	/* when updating cache with time based request we can always reset status flags */
+	/* flag even if the requested period contains no data                           */
+	(*item)->status = 0;
+
+	if (0 < records->values_num)
+	{
+		if (SUCCEED != vch_item_add_values_at_tail(*item, records->values, records->values_num))
+			return FAIL;
+	}
+
+	vc_item_update_db_cached_from(*item, range_start);
+
+	return records->values_num;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: cache item history data for the specified time period             *
@@ -1925,7 +2756,7 @@ static int	vch_item_cache_values_by_time(zbx_vc_item_t **item, int range_start)
 	if (NULL != (*item)->tail)
 	{
 		/* we need to get item values before the first cached value, but not including it */
-		range_end = (*item)->tail->slots[(*item)->tail->first_value].timestamp.sec - 1;
+		range_end = vch_chunk_first((*item)->tail)->timestamp.sec - 1;
 	}
 	else
 		range_end = ZBX_JAN_2038;
@@ -1951,26 +2782,7 @@ static int	vch_item_cache_values_by_time(zbx_vc_item_t **item, int range_start)
 	if (SUCCEED != ret)
 		goto out;
 
-	if (NULL == (*item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
-	{
-		zbx_vc_item_t	new_item = {.itemid = itemid, .value_type = value_type};
-
-		if (NULL == (*item = (zbx_vc_item_t *)zbx_hashset_insert(&vc_cache->items, &new_item, sizeof(new_item))))
-			goto out;
-	}
-
-	/* when updating cache with time based request we can always reset status flags */
-	/* flag even if the requested period contains no data                           */
-	(*item)->status = 0;
-
-	if (0 < records.values_num)
-	{
-		if (SUCCEED != (ret = vch_item_add_values_at_tail(*item, records.values, records.values_num)))
-			goto out;
-	}
-
-	ret = records.values_num;
-	vc_item_update_db_cached_from(*item, range_start);
+	ret = vch_item_cache_db_values(item, itemid, value_type, &records, range_start);
 out:
 	zbx_history_record_vector_destroy(&records, value_type);
 
@@ -2030,7 +2842,7 @@ static int	vch_item_cache_values_by_time_and_count(zbx_vc_item_t **item, int ran
 
 	/* get the end timestamp to which (including) the values should be cached */
 	if (NULL != (*item)->head)
-		range_end = (*item)->tail->slots[(*item)->tail->first_value].timestamp.sec - 1;
+		range_end = vch_chunk_first((*item)->tail)->timestamp.sec - 1;
 	else
 		range_end = ZBX_JAN_2038;
 
@@ -2060,13 +2872,8 @@ static int	vch_item_cache_values_by_time_and_count(zbx_vc_item_t **item, int ran
 	if (SUCCEED != ret)
 		goto out;
 
-	if (NULL == (*item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
-	{
-		zbx_vc_item_t	new_item = {.itemid = itemid, .value_type = value_type};
-
-		if (NULL == (*item = (zbx_vc_item_t *)zbx_hashset_insert(&vc_cache->items, &new_item, sizeof(new_item))))
-			goto out;
-	}
+	if (NULL == (*item = vc_insert_item(itemid, value_type)))
+		goto out;
 
 	if (0 < records.values_num)
 		ret = vch_item_add_values_at_tail(*item, records.values, records.values_num);
@@ -2085,8 +2892,7 @@ static int	vch_item_cache_values_by_time_and_count(zbx_vc_item_t **item, int ran
 
 	if ((count <= records.values_num || 0 == range_start) && 0 != records.values_num)
 	{
-		vc_item_update_db_cached_from(*item,
-				(*item)->tail->slots[(*item)->tail->first_value].timestamp.sec);
+		vc_item_update_db_cached_from(*item, vch_chunk_first((*item)->tail)->timestamp.sec);
 	}
 	else if (0 != range_start)
 		vc_item_update_db_cached_from(*item, range_start);
@@ -2133,10 +2939,12 @@ static void	vch_item_get_values_by_time(const zbx_vc_item_t *item, zbx_vector_hi
 	}
 
 	/* fill the values vector with item history values until the start timestamp is reached */
-	while (0 < zbx_timespec_compare(&chunk->slots[chunk->last_value].timestamp, &start))
+	while (0 < zbx_timespec_compare(&vch_chunk_last(chunk)->timestamp, &start))
 	{
-		while (index >= chunk->first_value && 0 < zbx_timespec_compare(&chunk->slots[index].timestamp, &start))
-			vc_history_record_vector_append(values, item->value_type, &chunk->slots[index--]);
+		const zbx_history_record_t	*slots = vch_chunk_get_slots(chunk);
+
+		while (index >= chunk->first_value && 0 < zbx_timespec_compare(&slots[index].timestamp, &start))
+			vc_history_record_vector_append(values, item->value_type, &slots[index--]);
 
 		if (NULL == (chunk = chunk->prev))
 			break;
@@ -2188,11 +2996,13 @@ static void	vch_item_get_values_by_time_and_count(zbx_vc_item_t *item, zbx_vecto
 	/* fill the values vector with item history values until the <count> values are read    */
 	/* or no more values within specified time period                                       */
 	/* fill the values vector with item history values until the start timestamp is reached */
-	while (0 < zbx_timespec_compare(&chunk->slots[chunk->last_value].timestamp, &start))
+	while (0 < zbx_timespec_compare(&vch_chunk_last(chunk)->timestamp, &start))
 	{
-		while (index >= chunk->first_value && 0 < zbx_timespec_compare(&chunk->slots[index].timestamp, &start))
+		const zbx_history_record_t	*slots = vch_chunk_get_slots(chunk);
+
+		while (index >= chunk->first_value && 0 < zbx_timespec_compare(&slots[index].timestamp, &start))
 		{
-			vc_history_record_vector_append(values, item->value_type, &chunk->slots[index--]);
+			vc_history_record_vector_append(values, item->value_type, &slots[index--]);
 
 			if (values->values_num == count)
 				goto out;
@@ -2322,9 +3132,352 @@ static size_t	vch_item_free_cache(zbx_vc_item_t *item)
 	item->head = NULL;
 	item->tail = NULL;
 
+	if (NULL != item->aggregates)
+	{
+		freed += sizeof(zbx_vc_item_aggregate_t) * (size_t)item->aggregates_num;
+		__vc_shmem_free_func(item->aggregates);
+		item->aggregates = NULL;
+		item->aggregates_num = 0;
+	}
+
 	return freed;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: adds value to the window aggregate                                *
+ *                                                                            *
+ * Parameters: aggregate  - [IN/OUT] the aggregate                            *
+ *             value_type - [IN] the item value type                          *
+ *             record     - [IN] the value to add                             *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_aggregate_add(zbx_vc_item_aggregate_t *aggregate, unsigned char value_type,
+		const zbx_history_record_t *record)
+{
+	if (ITEM_VALUE_TYPE_FLOAT == value_type)
+	{
+		aggregate->sum.dbl += record->value.dbl;
+
+		if (0 == aggregate->count || record->value.dbl < aggregate->min.dbl)
+			aggregate->min.dbl = record->value.dbl;
+
+		if (0 == aggregate->count || record->value.dbl > aggregate->max.dbl)
+			aggregate->max.dbl = record->value.dbl;
+	}
+	else
+	{
+		aggregate->sum.ui64 += record->value.ui64;
+		aggregate->sum_dbl += (double)record->value.ui64;
+
+		if (0 == aggregate->count || record->value.ui64 < aggregate->min.ui64)
+			aggregate->min.ui64 = record->value.ui64;
+
+		if (0 == aggregate->count || record->value.ui64 > aggregate->max.ui64)
+			aggregate->max.ui64 = record->value.ui64;
+	}
+
+	aggregate->count++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes value from the window aggregate                           *
+ *                                                                            *
+ * Parameters: aggregate  - [IN/OUT] the aggregate                            *
+ *             value_type - [IN] the item value type                          *
+ *             record     - [IN] the value to remove                          *
+ *                                                                            *
+ * Return value: SUCCEED - the value was removed                              *
+ *               FAIL    - the removed value was the window minimum or        *
+ *                         maximum, the aggregate must be recalculated        *
+ *                                                                            *
+ ******************************************************************************/
+static int	vc_aggregate_remove(zbx_vc_item_aggregate_t *aggregate, unsigned char value_type,
+		const zbx_history_record_t *record)
+{
+	aggregate->count--;
+
+	if (ITEM_VALUE_TYPE_FLOAT == value_type)
+	{
+		aggregate->sum.dbl -= record->value.dbl;
+
+		if (record->value.dbl == aggregate->min.dbl || record->value.dbl == aggregate->max.dbl)
+			return FAIL;
+	}
+	else
+	{
+		aggregate->sum.ui64 -= record->value.ui64;
+		aggregate->sum_dbl -= (double)record->value.ui64;
+
+		if (record->value.ui64 == aggregate->min.ui64 || record->value.ui64 == aggregate->max.ui64)
+			return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: calculates window aggregate from the cached item values           *
+ *                                                                            *
+ * Parameters: item      - [IN] the item                                      *
+ *             aggregate - [IN/OUT] the aggregate                             *
+ *                                                                            *
+ * Comments: The aggregate is marked as invalid if not all values within      *
+ *           window are cached.                                               *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_calculate_aggregate(zbx_vc_item_t *item, zbx_vc_item_aggregate_t *aggregate)
+{
+	int		index;
+	zbx_timespec_t	start;
+	zbx_vc_chunk_t	*chunk;
+
+	aggregate->count = -1;
+	aggregate->updates = 0;
+
+	if (NULL == (chunk = item->head))
+		return;
+
+	aggregate->end = vch_chunk_last(chunk)->timestamp;
+	start.sec = aggregate->end.sec - aggregate->seconds;
+	start.ns = aggregate->end.ns;
+
+	if (ZBX_ITEM_STATUS_CACHED_ALL != item->status &&
+			(0 == item->db_cached_from || item->db_cached_from > start.sec))
+	{
+		return;
+	}
+
+	aggregate->count = 0;
+	aggregate->sum.ui64 = 0;
+	aggregate->sum_dbl = 0;
+
+	if (ITEM_VALUE_TYPE_FLOAT == item->value_type)
+		aggregate->sum.dbl = 0;
+
+	index = chunk->last_value;
+
+	while (0 < zbx_timespec_compare(&vch_chunk_last(chunk)->timestamp, &start))
+	{
+		const zbx_history_record_t	*slots = vch_chunk_get_slots(chunk);
+
+		while (index >= chunk->first_value && 0 < zbx_timespec_compare(&slots[index].timestamp, &start))
+		{
+			vc_aggregate_add(aggregate, item->value_type, &slots[index]);
+			aggregate->first = slots[index--].timestamp;
+		}
+
+		if (NULL == (chunk = chunk->prev))
+			break;
+
+		index = chunk->last_value;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes values left window from the aggregate                     *
+ *                                                                            *
+ * Parameters: item      - [IN] the item                                      *
+ *             aggregate - [IN/OUT] the aggregate                             *
+ *             start     - [IN] the new window start (exclusive)              *
+ *                                                                            *
+ * Return value: SUCCEED - the values were removed                            *
+ *               FAIL    - the aggregate must be recalculated                 *
+ *                                                                            *
+ ******************************************************************************/
+static int	vch_item_aggregate_remove_values(zbx_vc_item_t *item, zbx_vc_item_aggregate_t *aggregate,
+		const zbx_timespec_t *start)
+{
+	int				index, ret = SUCCEED;
+	zbx_vc_chunk_t			*chunk;
+	zbx_timespec_t			first = aggregate->first;
+	const zbx_history_record_t	*slots;
+
+	if (FAIL == vch_item_get_last_value(item, start, &chunk, &index))
+		return SUCCEED;
+
+	slots = vch_chunk_get_slots(chunk);
+
+	/* the oldest value within window follows the last value before window start */
+	if (index < chunk->last_value)
+		aggregate->first = slots[index + 1].timestamp;
+	else if (NULL != chunk->next)
+		aggregate->first = vch_chunk_first(chunk->next)->timestamp;
+
+	while (1)
+	{
+		while (index >= chunk->first_value && 0 <= zbx_timespec_compare(&slots[index].timestamp, &first))
+		{
+			if (SUCCEED != vc_aggregate_remove(aggregate, item->value_type, &slots[index--]))
+				ret = FAIL;
+		}
+
+		if (index >= chunk->first_value || NULL == (chunk = chunk->prev))
+			break;
+
+		slots = vch_chunk_get_slots(chunk);
+		index = chunk->last_value;
+	}
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: updates item window aggregates with a value added to cache        *
+ *                                                                            *
+ * Parameters: item             - [IN] the item                               *
+ *             record           - [IN] the added value                        *
+ *             expire_timestamp - [IN] the aggregates not requested since     *
+ *                                     this time are removed                  *
+ *                                                                            *
+ * Comments: When a newer value is added the window slides forward - the new  *
+ *           value is added to the aggregate and the values left window are   *
+ *           removed from it. So the aggregate update cost depends only on    *
+ *           the number of values entering and leaving window, unless the     *
+ *           window minimum or maximum value leaves it.                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_update_aggregates(zbx_vc_item_t *item, const zbx_history_record_t *record,
+		int expire_timestamp)
+{
+	int	i;
+
+	for (i = 0; i < item->aggregates_num; i++)
+	{
+		zbx_vc_item_aggregate_t	*aggregate = &item->aggregates[i];
+		zbx_timespec_t		start;
+
+		if (aggregate->lastaccess < expire_timestamp)
+		{
+			item->aggregates[i--] = item->aggregates[--item->aggregates_num];
+			continue;
+		}
+
+		if (-1 == aggregate->count)
+		{
+			vch_item_calculate_aggregate(item, aggregate);
+			continue;
+		}
+
+		if (0 < zbx_timespec_compare(&record->timestamp, &aggregate->end))
+		{
+			if (0 == aggregate->count)
+				aggregate->first = record->timestamp;
+
+			vc_aggregate_add(aggregate, item->value_type, record);
+			aggregate->end = record->timestamp;
+			aggregate->updates++;
+
+			start.sec = aggregate->end.sec - aggregate->seconds;
+			start.ns = aggregate->end.ns;
+
+			if (0 >= zbx_timespec_compare(&aggregate->first, &start) &&
+					SUCCEED != vch_item_aggregate_remove_values(item, aggregate, &start))
+			{
+				vch_item_calculate_aggregate(item, aggregate);
+				continue;
+			}
+		}
+		else
+		{
+			start.sec = aggregate->end.sec - aggregate->seconds;
+			start.ns = aggregate->end.ns;
+
+			/* older values are added only if they are within window */
+			if (0 <= zbx_timespec_compare(&start, &record->timestamp))
+				continue;
+
+			if (0 == aggregate->count || 0 > zbx_timespec_compare(&record->timestamp, &aggregate->first))
+				aggregate->first = record->timestamp;
+
+			vc_aggregate_add(aggregate, item->value_type, record);
+			aggregate->updates++;
+		}
+
+		if (ZBX_VC_AGGREGATE_UPDATES_MIN < aggregate->updates && aggregate->count < aggregate->updates)
+			vch_item_calculate_aggregate(item, aggregate);
+	}
+
+	if (0 == item->aggregates_num && NULL != item->aggregates)
+	{
+		__vc_shmem_free_func(item->aggregates);
+		item->aggregates = NULL;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: marks item window aggregates containing values older than the     *
+ *          specified timestamp for recalculation                             *
+ *                                                                            *
+ * Parameters: item      - [IN] the item                                      *
+ *             timestamp - [IN] the values before this timestamp (seconds)    *
+ *                              were removed from cache                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_invalidate_aggregates(zbx_vc_item_t *item, int timestamp)
+{
+	int	i;
+
+	for (i = 0; i < item->aggregates_num; i++)
+	{
+		zbx_vc_item_aggregate_t	*aggregate = &item->aggregates[i];
+
+		if (aggregate->end.sec - aggregate->seconds < timestamp)
+			aggregate->count = -1;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: registers item window aggregate or updates its access time        *
+ *                                                                            *
+ * Parameters: item    - [IN] the item                                        *
+ *             seconds - [IN] the window length in seconds                    *
+ *             now     - [IN] the current timestamp                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	vch_item_register_aggregate(zbx_vc_item_t *item, int seconds, int now)
+{
+	int			i;
+	zbx_vc_item_aggregate_t	*aggregates;
+
+	for (i = 0; i < item->aggregates_num; i++)
+	{
+		if (item->aggregates[i].seconds == seconds)
+		{
+			item->aggregates[i].lastaccess = now;
+			return;
+		}
+	}
+
+	if (ZBX_VC_ITEM_AGGREGATES_MAX == item->aggregates_num)
+		return;
+
+	if (NULL == (aggregates = (zbx_vc_item_aggregate_t *)vc_item_malloc(item,
+			sizeof(zbx_vc_item_aggregate_t) * (size_t)(item->aggregates_num + 1))))
+	{
+		return;
+	}
+
+	if (0 != item->aggregates_num)
+	{
+		memcpy(aggregates, item->aggregates, sizeof(zbx_vc_item_aggregate_t) * (size_t)item->aggregates_num);
+		__vc_shmem_free_func(item->aggregates);
+	}
+
+	item->aggregates = aggregates;
+
+	memset(&aggregates[item->aggregates_num], 0, sizeof(zbx_vc_item_aggregate_t));
+	aggregates[item->aggregates_num].seconds = seconds;
+	aggregates[item->aggregates_num].lastaccess = now;
+	vch_item_calculate_aggregate(item, &aggregates[item->aggregates_num++]);
+}
+
 /******************************************************************************************************************
  *                                                                                                                *
  * Public API                                                                                                     *
@@ -2388,6 +3541,27 @@ int	zbx_vc_init(char **error)
 		goto out;
 	}
 
+	if (ZBX_VC_GHOST_MIN > (vc_cache->ghosts_size = (int)(CONFIG_VALUE_CACHE_SIZE / ZBX_VC_GHOST_ENTRY_BYTES)))
+		vc_cache->ghosts_size = ZBX_VC_GHOST_MIN;
+
+	if (NULL == (vc_cache->ghosts = (zbx_uint64_t *)__vc_shmem_malloc_func(NULL,
+			sizeof(zbx_uint64_t) * (size_t)vc_cache->ghosts_size)))
+	{
+		*error = zbx_strdup(*error, "cannot allocate value cache ghost queue");
+		goto out;
+	}
+	memset(vc_cache->ghosts, 0, sizeof(zbx_uint64_t) * (size_t)vc_cache->ghosts_size);
+
+	zbx_hashset_create_ext(&vc_cache->ghosts_index, (size_t)vc_cache->ghosts_size,
+			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL,
+			__vc_shmem_malloc_func, __vc_shmem_realloc_func, __vc_shmem_free_func);
+
+	if (NULL == vc_cache->ghosts_index.slots)
+	{
+		*error = zbx_strdup(*error, "cannot allocate value cache ghost queue index");
+		goto out;
+	}
+
 	/* the free space request should be 5% of cache size, but no more than 128KB */
 	vc_cache->min_free_request = (CONFIG_VALUE_CACHE_SIZE / 100) * 5;
 	if (vc_cache->min_free_request > 128 * ZBX_KIBIBYTE)
@@ -2420,10 +3594,17 @@ void	zbx_vc_destroy(void)
 
 		zbx_hashset_destroy(&vc_cache->items);
 		zbx_hashset_destroy(&vc_cache->strpool);
+		zbx_hashset_destroy(&vc_cache->ghosts_index);
+		__vc_shmem_free_func(vc_cache->ghosts);
 
 		__vc_shmem_free_func(vc_cache);
 		vc_cache = NULL;
 
+		zbx_free(vc_unpacked);
+		vc_unpacked_alloc = 0;
+		zbx_free(vc_packbuf.data);
+		vc_packbuf.alloc = 0;
+
 		zbx_shmem_destroy(vc_mem);
 		vc_mem = NULL;
 		zbx_rwlock_destroy(&vc_lock);
@@ -2461,6 +3642,15 @@ void	zbx_vc_reset(void)
 		vc_cache->hits = 0;
 		vc_cache->misses = 0;
 		vc_cache->min_free_request = 0;
+
+		memset(vc_cache->queue_hits, 0, sizeof(vc_cache->queue_hits));
+		memset(vc_cache->queue_misses, 0, sizeof(vc_cache->queue_misses));
+		memset(vc_cache->queue_evictions, 0, sizeof(vc_cache->queue_evictions));
+		vc_cache->ghost_hits = 0;
+
+		zbx_hashset_clear(&vc_cache->ghosts_index);
+		memset(vc_cache->ghosts, 0, sizeof(zbx_uint64_t) * (size_t)vc_cache->ghosts_size);
+		vc_cache->ghosts_head = 0;
 		vc_cache->mode = ZBX_VC_MODE_NORMAL;
 		vc_cache->mode_time = 0;
 		vc_cache->last_warning_time = 0;
@@ -2520,9 +3710,16 @@ int	zbx_vc_add_values(zbx_vector_ptr_t *history, int *ret_flush)
 				continue;
 			}
 
-			/* try to remove old (unused) chunks if a new chunk was added */
+			if (0 != item->aggregates_num)
+				vch_item_update_aggregates(item, &record, (int)expire_timestamp);
+
+			/* try to remove old (unused) chunks and compress the previous head chunk */
+			/* if a new chunk was added                                              */
 			if (head != item->head)
+			{
 				vch_item_clean_cache(item);
+				vch_item_pack_chunks(item);
+			}
 
 		}
 	}
@@ -2574,7 +3771,7 @@ int	zbx_vc_get_values(zbx_uint64_t itemid, int value_type, zbx_vector_history_re
 
 	if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)))
 	{
-		if (ZBX_VC_MODE_NORMAL != vc_cache->mode)
+		if (SUCCEED != vc_item_is_admissible(itemid))
 			goto out;
 
 		memset(&new_item, 0, sizeof(new_item));
@@ -2610,6 +3807,258 @@ out:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: caches history data of multiple items for the specified time      *
+ *          periods                                                           *
+ *                                                                            *
+ * Parameters: requests - [IN] the item value requests                        *
+ *                                                                            *
+ * Comments: The values missing in cache are read from database with a few    *
+ *           multiple item queries (one per value type) instead of separate   *
+ *           query for each item, which would be done by zbx_vc_get_values()  *
+ *           calls afterwards.                                                *
+ *           Only the items with numeric values are prefetched and new items  *
+ *           are not added to cache in low memory mode.                       *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_vc_prefetch_values(const zbx_vector_vc_request_t *requests)
+{
+	int			i, value_type, now;
+	zbx_vc_item_t		*item;
+	zbx_hashset_t		index;
+	zbx_hashset_iter_t	iter;
+	zbx_history_request_t	*history_request;
+	zbx_vector_ptr_t	history_requests[ITEM_VALUE_TYPE_MAX];
+
+	if (ZBX_VC_DISABLED == vc_state || 0 == requests->values_num)
+		return;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() requests:%d", __func__, requests->values_num);
+
+	zbx_hashset_create(&index, (size_t)requests->values_num, ZBX_DEFAULT_UINT64_HASH_FUNC,
+			ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	for (i = 0; i < ITEM_VALUE_TYPE_MAX; i++)
+		zbx_vector_ptr_create(&history_requests[i]);
+
+	RDLOCK_CACHE;
+
+	if (ZBX_VC_DISABLED == vc_state)
+	{
+		UNLOCK_CACHE;
+		goto out;
+	}
+
+	for (i = 0; i < requests->values_num; i++)
+	{
+		const zbx_vc_request_t	*request = &requests->values[i];
+		zbx_history_request_t	history_request_local;
+		int			range_start, range_end = ZBX_JAN_2038;
+
+		if (ITEM_VALUE_TYPE_FLOAT != request->value_type && ITEM_VALUE_TYPE_UINT64 != request->value_type)
+			continue;
+
+		if (0 > (range_start = request->ts.sec - request->seconds))
+			range_start = 0;
+
+		if (NULL != (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &request->itemid)))
+		{
+			if (item->value_type != request->value_type || ZBX_ITEM_STATUS_CACHED_ALL == item->status)
+				continue;
+
+			if (0 != item->db_cached_from && range_start >= item->db_cached_from)
+				continue;
+
+			/* read item values before the first cached value, but not including it */
+			if (NULL != item->tail)
+				range_end = vch_chunk_first(item->tail)->timestamp.sec - 1;
+		}
+		else if (SUCCEED != vc_item_is_admissible(request->itemid))
+			continue;
+
+		if (range_start >= range_end)
+			continue;
+
+		/* decrement interval start point because interval starting point is excluded by history backend */
+		if (0 != range_start)
+			range_start--;
+
+		if (NULL != (history_request = (zbx_history_request_t *)zbx_hashset_search(&index, &request->itemid)))
+		{
+			/* the same item can be requested with different periods - read the longest period */
+			if (history_request->start > range_start)
+				history_request->start = range_start;
+			continue;
+		}
+
+		history_request_local.itemid = request->itemid;
+		history_request_local.start = range_start;
+		history_request_local.end = range_end;
+
+		history_request = (zbx_history_request_t *)zbx_hashset_insert(&index, &history_request_local,
+				sizeof(history_request_local));
+		zbx_history_record_vector_create(&history_request->values);
+
+		zbx_vector_ptr_append(&history_requests[request->value_type], history_request);
+	}
+
+	UNLOCK_CACHE;
+
+	if (0 == index.num_data)
+		goto out;
+
+	for (value_type = 0; value_type < ITEM_VALUE_TYPE_MAX; value_type++)
+	{
+		if (0 == history_requests[value_type].values_num)
+			continue;
+
+		if (SUCCEED != zbx_history_get_values_multi(value_type, &history_requests[value_type]))
+			zbx_vector_ptr_clear(&history_requests[value_type]);
+	}
+
+	now = time(NULL);
+
+	WRLOCK_CACHE;
+
+	for (value_type = 0; value_type < ITEM_VALUE_TYPE_MAX && ZBX_VC_DISABLED != vc_state; value_type++)
+	{
+		for (i = 0; i < history_requests[value_type].values_num; i++)
+		{
+			int	records_num;
+
+			history_request = (zbx_history_request_t *)history_requests[value_type].values[i];
+
+			/* the item might have been cached with different value type by another process */
+			if (NULL != (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items,
+					&history_request->itemid)) && item->value_type != value_type)
+			{
+				continue;
+			}
+
+			zbx_vector_history_record_sort(&history_request->values,
+					(zbx_compare_func_t)zbx_history_record_compare_asc_func);
+
+			if (FAIL == (records_num = vch_item_cache_db_values(&item, history_request->itemid,
+					(unsigned char)value_type, &history_request->values,
+					0 == history_request->start ? 0 : history_request->start + 1)))
+			{
+				vc_remove_item_by_id(history_request->itemid);
+				continue;
+			}
+
+			vc_update_statistics(item, 0, records_num, now);
+		}
+	}
+
+	UNLOCK_CACHE;
+out:
+	for (i = 0; i < ITEM_VALUE_TYPE_MAX; i++)
+		zbx_vector_ptr_destroy(&history_requests[i]);
+
+	zbx_hashset_iter_reset(&index, &iter);
+	while (NULL != (history_request = (zbx_history_request_t *)zbx_hashset_iter_next(&iter)))
+	{
+		/* only numeric values are prefetched, no need to free value data */
+		zbx_vector_history_record_destroy(&history_request->values);
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() items:%d", __func__, index.num_data);
+
+	zbx_hashset_destroy(&index);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get aggregated item values for the specified time period          *
+ *                                                                            *
+ * Parameters: itemid     - [IN] the item id                                  *
+ *             value_type - [IN] the item value type                          *
+ *             seconds    - [IN] the time period                              *
+ *             ts         - [IN] the period end timestamp                     *
+ *             aggregate  - [OUT] the aggregated values                       *
+ *                                                                            *
+ * Return value:  SUCCEED - the aggregated values were retrieved successfully *
+ *                FAIL    - the aggregated values are not available, the      *
+ *                          values must be retrieved with zbx_vc_get_values() *
+ *                                                                            *
+ * Comments: The running aggregates are maintained for numeric items when new *
+ *           values are added to cache. The aggregate for the requested time  *
+ *           period is registered with the first request and can be used by   *
+ *           the following requests as long as the requested period contains  *
+ *           the same values as the aggregate window.                         *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vc_get_aggregate(zbx_uint64_t itemid, int value_type, int seconds, const zbx_timespec_t *ts,
+		zbx_vc_aggregate_t *aggregate)
+{
+	zbx_vc_item_t			*item;
+	const zbx_vc_item_aggregate_t	*window = NULL;
+	zbx_timespec_t			start = {ts->sec - seconds, ts->ns};
+	int				i, now, ret = FAIL;
+
+	if (ITEM_VALUE_TYPE_FLOAT != value_type && ITEM_VALUE_TYPE_UINT64 != value_type)
+		return FAIL;
+
+	RDLOCK_CACHE;
+
+	if (ZBX_VC_DISABLED == vc_state)
+		goto out;
+
+	if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_search(&vc_cache->items, &itemid)) ||
+			item->value_type != value_type)
+	{
+		goto out;
+	}
+
+	now = time(NULL);
+	vc_cache_item_update(itemid, ZBX_VC_UPDATE_AGGREGATE, seconds, now);
+
+	for (i = 0; i < item->aggregates_num; i++)
+	{
+		if (item->aggregates[i].seconds == seconds)
+		{
+			window = &item->aggregates[i];
+			break;
+		}
+	}
+
+	/* the requested period must not contain values newer or older than the aggregate window */
+	if (NULL == window || -1 == window->count || 0 > zbx_timespec_compare(ts, &window->end) ||
+			(0 != window->count && 0 >= zbx_timespec_compare(&window->first, &start)))
+	{
+		goto out;
+	}
+
+	aggregate->count = window->count;
+	aggregate->sum = window->sum;
+	aggregate->min = window->min;
+	aggregate->max = window->max;
+
+	if (0 != window->count)
+	{
+		if (ITEM_VALUE_TYPE_FLOAT == value_type)
+			aggregate->avg = window->sum.dbl / window->count;
+		else
+			aggregate->avg = window->sum_dbl / window->count;
+	}
+	else
+		aggregate->avg = 0;
+
+	/* add another second to include nanosecond shifts */
+	vc_cache_item_update(itemid, ZBX_VC_UPDATE_RANGE, seconds + now - ts->sec + 1, now);
+	vc_cache_item_update(itemid, ZBX_VC_UPDATE_STATS, window->count, 0);
+
+	ret = SUCCEED;
+out:
+	UNLOCK_CACHE;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() itemid:" ZBX_FS_UI64 " period:%d end_timestamp '%s':%s", __func__, itemid,
+			seconds, zbx_timespec_str(ts), zbx_result_string(ret));
+
+	return ret;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: get the last history value with a timestamp less or equal to the  *
@@ -2675,6 +4124,14 @@ int	zbx_vc_get_statistics(zbx_vc_stats_t *stats)
 	stats->total_size = vc_mem->total_size;
 	stats->free_size = vc_mem->free_size;
 
+	if (0 != vc_cache->packed_size)
+	{
+		stats->compression_ratio = (double)(vc_cache->packed_values * sizeof(zbx_history_record_t)) /
+				vc_cache->packed_size;
+	}
+	else
+		stats->compression_ratio = 1;
+
 	UNLOCK_CACHE;
 
 	return SUCCEED;
@@ -2705,13 +4162,21 @@ void	zbx_vc_disable(void)
  *                                                                            *
  * Purpose: get value cache diagnostic statistics                             *
  *                                                                            *
+ * Parameters: items_num  - [OUT] the number of cached items                  *
+ *             values_num - [OUT] the number of cached values                 *
+ *             mode       - [OUT] the cache operating mode, -1 if disabled    *
+ *             policy     - [OUT] the replacement policy statistics           *
+ *                                                                            *
  ******************************************************************************/
-void	zbx_vc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num, int *mode)
+void	zbx_vc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num, int *mode,
+		zbx_vc_policy_stats_t *policy)
 {
 	zbx_hashset_iter_t	iter;
 	zbx_vc_item_t		*item;
+	int			i;
 
 	*values_num = 0;
+	memset(policy, 0, sizeof(zbx_vc_policy_stats_t));
 
 	if (ZBX_VC_DISABLED == vc_state)
 	{
@@ -2725,9 +4190,23 @@ void	zbx_vc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num, in
 	*items_num = vc_cache->items.num_data;
 	*mode = vc_cache->mode;
 
+	for (i = 0; i < ZBX_VC_QUEUE_COUNT; i++)
+	{
+		policy->queues[i].hits = vc_cache->queue_hits[i];
+		policy->queues[i].misses = vc_cache->queue_misses[i];
+		policy->queues[i].evictions = vc_cache->queue_evictions[i];
+	}
+
+	policy->ghosts_num = (zbx_uint64_t)vc_cache->ghosts_index.num_data;
+	policy->ghost_hits = vc_cache->ghost_hits;
+
 	zbx_hashset_iter_reset(&vc_cache->items, &iter);
 	while (NULL != (item = (zbx_vc_item_t *)zbx_hashset_iter_next(&iter)))
+	{
 		*values_num += item->values_total;
+		policy->queues[item->queue].items_num++;
+		policy->queues[item->queue].values_num += (zbx_uint64_t)item->values_total;
+	}
 
 	UNLOCK_CACHE;
 }
@@ -2824,6 +4303,10 @@ void	zbx_vc_flush_stats(void)
 				vc_update_statistics(item, update->data[ZBX_VC_UPDATE_STATS_HITS],
 						update->data[ZBX_VC_UPDATE_STATS_MISSES], now);
 				break;
+			case ZBX_VC_UPDATE_AGGREGATE:
+				vch_item_register_aggregate(item, update->data[ZBX_VC_UPDATE_AGGREGATE_SECONDS],
+						update->data[ZBX_VC_UPDATE_AGGREGATE_NOW]);
+				break;
 		}
 	}
 
@@ -2832,6 +4315,611 @@ void	zbx_vc_flush_stats(void)
 	zbx_vector_vc_itemupdate_clear(&vc_itemupdates);
 }
 
+/******************************************************************************************************************
+ *                                                                                                                *
+ * Value cache snapshot                                                                                           *
+ *                                                                                                                *
+ ******************************************************************************************************************/
+/*
+ * On clean shutdown the cached item data can be written into a local snapshot file which is
+ * loaded back into value cache during next startup, sparing the database from reading the same
+ * history values for every cached item after restart. The snapshot is removed once loaded, so it
+ * is never reused after an unclean stop.
+ *
+ * The snapshot is stored in native byte order and structure layout (verified by header):
+ *
+ *   header | item 1 | values of item 1 | ... | item N | values of item N | end marker
+ *
+ * Each value is stored as timestamp followed by the value data. Strings are stored as 32-bit
+ * length (including terminating zero, 0 for NULL strings) followed by the string contents.
+ */
+
+#define ZBX_VC_SNAPSHOT_MAGIC		0x7a627663
+#define ZBX_VC_SNAPSHOT_VERSION		1
+
+/* stop loading snapshot when less than the specified percentage of cache memory is free */
+#define ZBX_VC_SNAPSHOT_FREE_PERCENT	20
+
+typedef struct
+{
+	zbx_uint32_t	magic;
+	zbx_uint32_t	version;
+	zbx_uint32_t	item_size;
+	zbx_uint32_t	record_size;
+	int		clock;
+	int		items_num;
+}
+zbx_vc_snapshot_header_t;
+
+typedef struct
+{
+	zbx_uint64_t	itemid;
+	zbx_uint64_t	hits;
+	int		values_num;
+	int		last_accessed;
+	int		active_range;
+	int		daily_range;
+	int		db_cached_from;
+	int		last_hourly_num;
+	int		hourly_num;
+	int		hour;
+	unsigned char	value_type;
+	unsigned char	status;
+	unsigned char	range_sync_hour;
+}
+zbx_vc_snapshot_item_t;
+
+typedef struct
+{
+	const unsigned char	*data;
+	size_t			size;
+	size_t			offset;
+}
+zbx_vc_snapshot_reader_t;
+
+static void	vc_snapshot_write(FILE *file, const void *data, size_t size)
+{
+	if (0 != size)
+		fwrite(data, size, 1, file);
+}
+
+static void	vc_snapshot_write_str(FILE *file, const char *str)
+{
+	zbx_uint32_t	len = (NULL == str ? 0 : (zbx_uint32_t)strlen(str) + 1);
+
+	vc_snapshot_write(file, &len, sizeof(len));
+	vc_snapshot_write(file, str, len);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes item value into snapshot file                              *
+ *                                                                            *
+ * Parameters: file       - [IN] the snapshot file                            *
+ *             value_type - [IN] the item value type                          *
+ *             record     - [IN] the value to write                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	vc_snapshot_write_value(FILE *file, unsigned char value_type, const zbx_history_record_t *record)
+{
+	const zbx_log_value_t	*log;
+
+	vc_snapshot_write(file, &record->timestamp, sizeof(record->timestamp));
+
+	switch (value_type)
+	{
+		case ITEM_VALUE_TYPE_STR:
+		case ITEM_VALUE_TYPE_TEXT:
+			vc_snapshot_write_str(file, record->value.str);
+			break;
+		case ITEM_VALUE_TYPE_LOG:
+			log = record->value.log;
+			vc_snapshot_write(file, &log->timestamp, sizeof(log->timestamp));
+			vc_snapshot_write(file, &log->logeventid, sizeof(log->logeventid));
+			vc_snapshot_write(file, &log->severity, sizeof(log->severity));
+			vc_snapshot_write_str(file, log->source);
+			vc_snapshot_write_str(file, log->value);
+			break;
+		default:
+			vc_snapshot_write(file, &record->value, sizeof(record->value));
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes cached item and its values into snapshot file              *
+ *                                                                            *
+ * Parameters: file - [IN] the snapshot file                                  *
+ *             item - [IN] the item                                           *
+ *                                                                            *
+ * Return value: the number of written values                                 *
+ *                                                                            *
+ ******************************************************************************/
+static int	vc_snapshot_write_item(FILE *file, const zbx_vc_item_t *item)
+{
+	zbx_vc_snapshot_item_t	snapshot_item;
+	const zbx_vc_chunk_t	*chunk;
+	int			i;
+
+	memset(&snapshot_item, 0, sizeof(snapshot_item));
+
+	snapshot_item.itemid = item->itemid;
+	snapshot_item.hits = item->hits;
+	snapshot_item.last_accessed = item->last_accessed;
+	snapshot_item.active_range = item->active_range;
+	snapshot_item.daily_range = item->daily_range;
+	snapshot_item.db_cached_from = item->db_cached_from;
+	snapshot_item.last_hourly_num = item->last_hourly_num;
+	snapshot_item.hourly_num = item->hourly_num;
+	snapshot_item.hour = item->hour;
+	snapshot_item.value_type = item->value_type;
+	snapshot_item.status = item->status;
+	snapshot_item.range_sync_hour = item->range_sync_hour;
+
+	for (chunk = item->tail; NULL != chunk; chunk = chunk->next)
+		snapshot_item.values_num += chunk->last_value - chunk->first_value + 1;
+
+	vc_snapshot_write(file, &snapshot_item, sizeof(snapshot_item));
+
+	for (chunk = item->tail; NULL != chunk; chunk = chunk->next)
+	{
+		const zbx_history_record_t	*slots = vch_chunk_get_slots(chunk);
+
+		for (i = chunk->first_value; i <= chunk->last_value; i++)
+			vc_snapshot_write_value(file, item->value_type, &slots[i]);
+	}
+
+	return snapshot_item.values_num;
+}
+
+static int	vc_snapshot_read(zbx_vc_snapshot_reader_t *reader, void *data, size_t size)
+{
+	if (reader->size - reader->offset < size)
+		return FAIL;
+
+	memcpy(data, reader->data + reader->offset, size);
+	reader->offset += size;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads string from snapshot                                        *
+ *                                                                            *
+ * Parameters: reader - [IN] the snapshot reader                              *
+ *             str    - [OUT] the string, pointing inside snapshot data       *
+ *                                                                            *
+ * Return value: SUCCEED - the string was read successfully                   *
+ *               FAIL    - the snapshot data is corrupted                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	vc_snapshot_read_str(zbx_vc_snapshot_reader_t *reader, char **str)
+{
+	zbx_uint32_t	len;
+
+	if (SUCCEED != vc_snapshot_read(reader, &len, sizeof(len)))
+		return FAIL;
+
+	if (0 == len)
+	{
+		*str = NULL;
+		return SUCCEED;
+	}
+
+	if (reader->size - reader->offset < len || '\0' != reader->data[reader->offset + len - 1])
+		return FAIL;
+
+	/* snapshot data is mapped read-only, the strings are only copied from it */
+	*str = (char *)(reader->data + reader->offset);
+	reader->offset += len;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads item value from snapshot                                    *
+ *                                                                            *
+ * Parameters: reader     - [IN] the snapshot reader                          *
+ *             value_type - [IN] the item value type                          *
+ *             record     - [OUT] the value                                   *
+ *             log        - [OUT] the log value storage                       *
+ *                                                                            *
+ * Return value: SUCCEED - the value was read successfully                    *
+ *               FAIL    - the snapshot data is corrupted                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	vc_snapshot_read_value(zbx_vc_snapshot_reader_t *reader, unsigned char value_type,
+		zbx_history_record_t *record, zbx_log_value_t *log)
+{
+	if (SUCCEED != vc_snapshot_read(reader, &record->timestamp, sizeof(record->timestamp)))
+		return FAIL;
+
+	switch (value_type)
+	{
+		case ITEM_VALUE_TYPE_STR:
+		case ITEM_VALUE_TYPE_TEXT:
+			if (SUCCEED != vc_snapshot_read_str(reader, &record->value.str) || NULL == record->value.str)
+				return FAIL;
+			break;
+		case ITEM_VALUE_TYPE_LOG:
+			if (SUCCEED != vc_snapshot_read(reader, &log->timestamp, sizeof(log->timestamp)) ||
+					SUCCEED != vc_snapshot_read(reader, &log->logeventid, sizeof(log->logeventid)) ||
+					SUCCEED != vc_snapshot_read(reader, &log->severity, sizeof(log->severity)) ||
+					SUCCEED != vc_snapshot_read_str(reader, &log->source) ||
+					SUCCEED != vc_snapshot_read_str(reader, &log->value) || NULL == log->value)
+			{
+				return FAIL;
+			}
+			record->value.log = log;
+			break;
+		default:
+			if (SUCCEED != vc_snapshot_read(reader, &record->value, sizeof(record->value)))
+				return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads item and its values from snapshot                           *
+ *                                                                            *
+ * Parameters: reader     - [IN] the snapshot reader                          *
+ *             item       - [OUT] the item                                    *
+ *             records    - [OUT] the item values in ascending order          *
+ *             logs       - [IN/OUT] the log value storage                    *
+ *             logs_alloc - [IN/OUT] the number of allocated log values       *
+ *                                                                            *
+ * Return value: SUCCEED - the item was read successfully                     *
+ *               FAIL    - the snapshot data is corrupted                     *
+ *                                                                            *
+ * Comments: The string values reference snapshot data, so the records must   *
+ *           not be freed.                                                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	vc_snapshot_read_item(zbx_vc_snapshot_reader_t *reader, zbx_vc_snapshot_item_t *item,
+		zbx_vector_history_record_t *records, zbx_log_value_t **logs, int *logs_alloc)
+{
+	int			i;
+	zbx_history_record_t	record;
+
+	zbx_vector_history_record_clear(records);
+
+	if (SUCCEED != vc_snapshot_read(reader, item, sizeof(zbx_vc_snapshot_item_t)))
+		return FAIL;
+
+	if (ITEM_VALUE_TYPE_TEXT < item->value_type || 0 > item->values_num ||
+			(reader->size - reader->offset) / sizeof(zbx_timespec_t) < (size_t)item->values_num)
+	{
+		return FAIL;
+	}
+
+	if (ITEM_VALUE_TYPE_LOG == item->value_type && *logs_alloc < item->values_num)
+	{
+		*logs_alloc = item->values_num;
+		*logs = (zbx_log_value_t *)zbx_realloc(*logs, sizeof(zbx_log_value_t) * (size_t)*logs_alloc);
+	}
+
+	zbx_vector_history_record_reserve(records, (size_t)item->values_num);
+
+	for (i = 0; i < item->values_num; i++)
+	{
+		if (SUCCEED != vc_snapshot_read_value(reader, item->value_type, &record, *logs + i))
+			return FAIL;
+
+		/* values must be stored in ascending order */
+		if (0 != i && 0 <= zbx_timespec_compare(&records->values[i - 1].timestamp, &record.timestamp))
+			return FAIL;
+
+		zbx_vector_history_record_append_ptr(records, &record);
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes value cache contents into snapshot file                    *
+ *                                                                            *
+ * Parameters: path  - [IN] the snapshot file path                            *
+ *             error - [OUT] the error message                                *
+ *                                                                            *
+ * Return value: SUCCEED - the snapshot was written successfully              *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The snapshot is written into temporary file which is renamed to  *
+ *           the target path only after all data are written.                 *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vc_save_snapshot(const char *path, char **error)
+{
+	FILE				*file;
+	char				*tmp_path;
+	int				ret = FAIL;
+	zbx_uint64_t			values_num = 0;
+	zbx_uint32_t			end = ZBX_VC_SNAPSHOT_MAGIC;
+	zbx_vc_snapshot_header_t	header;
+	zbx_hashset_iter_t		iter;
+	zbx_vc_item_t			*item;
+
+	if (NULL == vc_cache)
+		return SUCCEED;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() path:%s", __func__, path);
+
+	tmp_path = zbx_dsprintf(NULL, "%s.tmp", path);
+
+	if (NULL == (file = fopen(tmp_path, "wb")))
+	{
+		*error = zbx_dsprintf(*error, "cannot open file \"%s\": %s", tmp_path, zbx_strerror(errno));
+		goto out;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = ZBX_VC_SNAPSHOT_MAGIC;
+	header.version = ZBX_VC_SNAPSHOT_VERSION;
+	header.item_size = sizeof(zbx_vc_snapshot_item_t);
+	header.record_size = sizeof(zbx_history_record_t);
+	header.clock = (int)time(NULL);
+
+	RDLOCK_CACHE;
+
+	header.items_num = vc_cache->items.num_data;
+	vc_snapshot_write(file, &header, sizeof(header));
+
+	zbx_hashset_iter_reset(&vc_cache->items, &iter);
+	while (NULL != (item = (zbx_vc_item_t *)zbx_hashset_iter_next(&iter)))
+		values_num += (zbx_uint64_t)vc_snapshot_write_item(file, item);
+
+	UNLOCK_CACHE;
+
+	vc_snapshot_write(file, &end, sizeof(end));
+
+	if (0 != ferror(file))
+	{
+		*error = zbx_dsprintf(*error, "cannot write file \"%s\": %s", tmp_path, zbx_strerror(errno));
+		fclose(file);
+		unlink(tmp_path);
+		goto out;
+	}
+
+	if (0 != fclose(file))
+	{
+		*error = zbx_dsprintf(*error, "cannot close file \"%s\": %s", tmp_path, zbx_strerror(errno));
+		unlink(tmp_path);
+		goto out;
+	}
+
+	if (0 != rename(tmp_path, path))
+	{
+		*error = zbx_dsprintf(*error, "cannot rename file \"%s\" to \"%s\": %s", tmp_path, path,
+				zbx_strerror(errno));
+		unlink(tmp_path);
+		goto out;
+	}
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "saved value cache snapshot with %d items and " ZBX_FS_UI64 " values",
+			header.items_num, values_num);
+
+	ret = SUCCEED;
+out:
+	zbx_free(tmp_path);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: loads value cache contents from snapshot file                     *
+ *                                                                            *
+ * Parameters: path        - [IN] the snapshot file path                      *
+ *             validate_cb - [IN] the callback to check if snapshot written   *
+ *                                at the specified time can be used (optional)*
+ *             error       - [OUT] the error message                          *
+ *                                                                            *
+ * Return value: SUCCEED - the snapshot was loaded or there was no snapshot   *
+ *               FAIL    - the snapshot could not be used                     *
+ *                                                                            *
+ * Comments: Only items existing in configuration cache with the same value   *
+ *           type are loaded, other items will be cached from database on     *
+ *           first request as usual. Loading stops when cache memory gets     *
+ *           low, leaving space for items not present in the snapshot.        *
+ *           The snapshot file is removed after it has been processed.        *
+ *                                                                            *
+ *           This function must be called before value cache is enabled and   *
+ *           used by other processes.                                         *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vc_load_snapshot(const char *path, zbx_vc_snapshot_validate_func_t validate_cb, char **error)
+{
+	int				fd, i, ret = FAIL, logs_alloc = 0, items_num = 0, *errcodes = NULL;
+	zbx_stat_t			buf;
+	void				*data = MAP_FAILED;
+	zbx_uint32_t			end;
+	zbx_uint64_t			values_num = 0, free_min;
+	unsigned char			*value_types = NULL;
+	zbx_vc_snapshot_header_t	header;
+	zbx_vc_snapshot_item_t		snapshot_item;
+	zbx_vc_snapshot_reader_t	reader;
+	zbx_vector_uint64_t		itemids, offsets;
+	zbx_vector_history_record_t	records;
+	zbx_log_value_t			*logs = NULL;
+
+	if (NULL == vc_cache)
+		return SUCCEED;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() path:%s", __func__, path);
+
+	zbx_vector_uint64_create(&itemids);
+	zbx_vector_uint64_create(&offsets);
+	zbx_vector_history_record_create(&records);
+
+	if (-1 == (fd = zbx_open(path, O_RDONLY)))
+	{
+		if (ENOENT == errno)
+		{
+			ret = SUCCEED;
+			goto clean;
+		}
+
+		*error = zbx_dsprintf(*error, "cannot open file \"%s\": %s", path, zbx_strerror(errno));
+		goto clean;
+	}
+
+	if (0 != zbx_fstat(fd, &buf))
+	{
+		*error = zbx_dsprintf(*error, "cannot obtain information for file \"%s\": %s", path,
+				zbx_strerror(errno));
+		close(fd);
+		goto out;
+	}
+
+	if ((size_t)buf.st_size < sizeof(header) + sizeof(end))
+	{
+		*error = zbx_dsprintf(*error, "file \"%s\" is too small", path);
+		close(fd);
+		goto out;
+	}
+
+	data = mmap(NULL, (size_t)buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (MAP_FAILED == data)
+	{
+		*error = zbx_dsprintf(*error, "cannot map file \"%s\": %s", path, zbx_strerror(errno));
+		goto out;
+	}
+
+	reader.data = (const unsigned char *)data;
+	reader.size = (size_t)buf.st_size - sizeof(end);
+	reader.offset = 0;
+
+	memcpy(&end, reader.data + reader.size, sizeof(end));
+	vc_snapshot_read(&reader, &header, sizeof(header));
+
+	if (ZBX_VC_SNAPSHOT_MAGIC != header.magic || ZBX_VC_SNAPSHOT_MAGIC != end ||
+			ZBX_VC_SNAPSHOT_VERSION != header.version ||
+			sizeof(zbx_vc_snapshot_item_t) != header.item_size ||
+			sizeof(zbx_history_record_t) != header.record_size || 0 > header.items_num)
+	{
+		*error = zbx_dsprintf(*error, "file \"%s\" is not a compatible value cache snapshot", path);
+		goto out;
+	}
+
+	if (NULL != validate_cb && SUCCEED != validate_cb(header.clock))
+	{
+		*error = zbx_dsprintf(*error, "snapshot \"%s\" is outdated", path);
+		goto out;
+	}
+
+	/* validate snapshot structure and index items before modifying cache */
+	zbx_vector_uint64_reserve(&itemids, (size_t)header.items_num);
+	zbx_vector_uint64_reserve(&offsets, (size_t)header.items_num);
+
+	for (i = 0; i < header.items_num; i++)
+	{
+		zbx_vector_uint64_append(&offsets, (zbx_uint64_t)reader.offset);
+
+		if (SUCCEED != vc_snapshot_read_item(&reader, &snapshot_item, &records, &logs, &logs_alloc))
+			break;
+
+		zbx_vector_uint64_append(&itemids, snapshot_item.itemid);
+	}
+
+	if (i != header.items_num || reader.offset != reader.size)
+	{
+		*error = zbx_dsprintf(*error, "file \"%s\" is corrupted", path);
+		goto out;
+	}
+
+	value_types = (unsigned char *)zbx_malloc(NULL, sizeof(unsigned char) * (size_t)itemids.values_num);
+	errcodes = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)itemids.values_num);
+	zbx_dc_get_item_value_types(itemids.values, value_types, errcodes, itemids.values_num);
+
+	free_min = vc_mem->total_size / 100 * ZBX_VC_SNAPSHOT_FREE_PERCENT;
+
+	WRLOCK_CACHE;
+
+	for (i = 0; i < itemids.values_num; i++)
+	{
+		zbx_vc_item_t	*item, new_item;
+
+		if (vc_mem->free_size < free_min)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "value cache is getting low on memory, skipping remaining"
+					" %d items of snapshot", itemids.values_num - i);
+			break;
+		}
+
+		reader.offset = (size_t)offsets.values[i];
+		vc_snapshot_read_item(&reader, &snapshot_item, &records, &logs, &logs_alloc);
+
+		/* item was removed or its value type changed while server was stopped */
+		if (SUCCEED != errcodes[i] || value_types[i] != snapshot_item.value_type)
+			continue;
+
+		if (NULL != zbx_hashset_search(&vc_cache->items, &snapshot_item.itemid))
+			continue;
+
+		memset(&new_item, 0, sizeof(new_item));
+		new_item.itemid = snapshot_item.itemid;
+		new_item.value_type = snapshot_item.value_type;
+		new_item.status = snapshot_item.status;
+		new_item.range_sync_hour = snapshot_item.range_sync_hour;
+		new_item.last_accessed = snapshot_item.last_accessed;
+		new_item.active_range = snapshot_item.active_range;
+		new_item.daily_range = snapshot_item.daily_range;
+		new_item.db_cached_from = snapshot_item.db_cached_from;
+		new_item.last_hourly_num = snapshot_item.last_hourly_num;
+		new_item.hourly_num = snapshot_item.hourly_num;
+		new_item.hour = snapshot_item.hour;
+		new_item.hits = snapshot_item.hits;
+		new_item.queue = (0 != new_item.hits ? ZBX_VC_QUEUE_PROTECTED : ZBX_VC_QUEUE_PROBATION);
+
+		if (NULL == (item = (zbx_vc_item_t *)zbx_hashset_insert(&vc_cache->items, &new_item, sizeof(new_item))))
+			break;
+
+		if (0 != records.values_num && SUCCEED != vch_item_add_values_at_tail(item, records.values,
+				records.values_num))
+		{
+			vc_remove_item(item);
+			break;
+		}
+
+		items_num++;
+		values_num += (zbx_uint64_t)records.values_num;
+	}
+
+	UNLOCK_CACHE;
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "loaded %d of %d items with " ZBX_FS_UI64 " values from value cache"
+			" snapshot", items_num, header.items_num, values_num);
+
+	ret = SUCCEED;
+out:
+	if (MAP_FAILED != data)
+		munmap(data, (size_t)buf.st_size);
+
+	/* the snapshot is valid only for the first startup after it was written */
+	if (0 != unlink(path))
+		zabbix_log(LOG_LEVEL_WARNING, "cannot remove file \"%s\": %s", path, zbx_strerror(errno));
+clean:
+	zbx_free(errcodes);
+	zbx_free(value_types);
+	zbx_free(logs);
+	zbx_vector_history_record_destroy(&records);
+	zbx_vector_uint64_destroy(&offsets);
+	zbx_vector_uint64_destroy(&itemids);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
+
 #ifdef HAVE_TESTS
 #	include "../../../tests/libs/zbxdbcache/valuecache_test.c"
 #endif
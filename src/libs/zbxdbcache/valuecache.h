@@ -80,6 +80,9 @@ typedef struct
 
 	/* value cache operating mode - see ZBX_VC_MODE_* defines */
 	int		mode;
+
+	/* the ratio of uncompressed to compressed size of compressed values */
+	double		compression_ratio;
 }
 zbx_vc_stats_t;
 
@@ -92,6 +95,58 @@ typedef struct
 }
 zbx_vc_item_stats_t;
 
+/* value cache replacement policy (2Q) queues */
+#define ZBX_VC_QUEUE_PROBATION	0
+#define ZBX_VC_QUEUE_PROTECTED	1
+#define ZBX_VC_QUEUE_COUNT	2
+
+/* replacement policy queue diagnostic statistics */
+typedef struct
+{
+	zbx_uint64_t	items_num;
+	zbx_uint64_t	values_num;
+	zbx_uint64_t	hits;
+	zbx_uint64_t	misses;
+	zbx_uint64_t	evictions;
+}
+zbx_vc_queue_stats_t;
+
+/* replacement policy diagnostic statistics */
+typedef struct
+{
+	zbx_vc_queue_stats_t	queues[ZBX_VC_QUEUE_COUNT];
+
+	/* the number of recently removed items in ghost queue */
+	zbx_uint64_t		ghosts_num;
+
+	/* the number of removed items readmitted from ghost queue */
+	zbx_uint64_t		ghost_hits;
+}
+zbx_vc_policy_stats_t;
+
+/* the aggregated item values within time period */
+typedef struct
+{
+	int		count;
+	history_value_t	sum;
+	history_value_t	min;
+	history_value_t	max;
+	double		avg;
+}
+zbx_vc_aggregate_t;
+
+/* the request of item values within time period, used to cache values of multiple items at once */
+typedef struct
+{
+	zbx_uint64_t	itemid;
+	int		value_type;
+	int		seconds;
+	zbx_timespec_t	ts;
+}
+zbx_vc_request_t;
+
+ZBX_VECTOR_DECL(vc_request, zbx_vc_request_t)
+
 int	zbx_vc_init(char **error);
 
 void	zbx_vc_destroy(void);
@@ -107,15 +162,27 @@ int	zbx_vc_get_values(zbx_uint64_t itemid, int value_type, zbx_vector_history_re
 
 int	zbx_vc_get_value(zbx_uint64_t itemid, int value_type, const zbx_timespec_t *ts, zbx_history_record_t *value);
 
+void	zbx_vc_prefetch_values(const zbx_vector_vc_request_t *requests);
+
+int	zbx_vc_get_aggregate(zbx_uint64_t itemid, int value_type, int seconds, const zbx_timespec_t *ts,
+		zbx_vc_aggregate_t *aggregate);
+
 int	zbx_vc_add_values(zbx_vector_ptr_t *history, int *ret_flush);
 
 int	zbx_vc_get_statistics(zbx_vc_stats_t *stats);
 
 void	zbx_vc_housekeeping_value_cache(void);
 
-void	zbx_vc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num, int *mode);
+void	zbx_vc_get_diag_stats(zbx_uint64_t *items_num, zbx_uint64_t *values_num, int *mode,
+		zbx_vc_policy_stats_t *policy);
 void	zbx_vc_get_mem_stats(zbx_shmem_stats_t *mem);
 void	zbx_vc_get_item_stats(zbx_vector_ptr_t *stats);
 void	zbx_vc_flush_stats(void);
 
+/* value cache snapshot validation callback, returns SUCCEED if snapshot written at the specified time can be used */
+typedef int	(*zbx_vc_snapshot_validate_func_t)(int saved);
+
+int	zbx_vc_save_snapshot(const char *path, char **error);
+int	zbx_vc_load_snapshot(const char *path, zbx_vc_snapshot_validate_func_t validate_cb, char **error);
+
 #endif	/* ZABBIX_VALUECACHE_H */
@@ -58,7 +58,7 @@ zbx_autoreg_host_t;
 extern char	ZBX_PG_ESCAPE_BACKSLASH;
 #endif
 
-static int	connection_failure;
+static ZBX_THREAD_LOCAL int	connection_failure;
 extern unsigned char	program_type;
 
 void	DBclose(void)
@@ -333,6 +333,190 @@ static int	DBpatch_6010023(void)
 	return ret;
 }
 
+static int	DBpatch_6010024(void)
+{
+	/* changelog identifiers are generated by database, which is not supported by DBcreate_table() */
+#if defined(HAVE_MYSQL)
+	if (ZBX_DB_OK > DBexecute("create table changelog ("
+				"changelogid bigint unsigned not null auto_increment,"
+				"object integer default '0' not null,"
+				"objectid bigint unsigned not null,"
+				"operation integer default '0' not null,"
+				"clock integer default '0' not null,"
+				"primary key (changelogid))"
+				" engine=InnoDB"))
+	{
+		return FAIL;
+	}
+#elif defined(HAVE_ORACLE)
+	if (ZBX_DB_OK > DBexecute("create table changelog ("
+				"changelogid number(20) not null,"
+				"object number(10) default '0' not null,"
+				"objectid number(20) not null,"
+				"operation number(10) default '0' not null,"
+				"clock number(10) default '0' not null,"
+				"primary key (changelogid))"))
+	{
+		return FAIL;
+	}
+
+	if (ZBX_DB_OK > DBexecute("create sequence changelog_seq start with 1 increment by 1 nomaxvalue"))
+		return FAIL;
+
+	if (ZBX_DB_OK > DBexecute("create trigger changelog_tr before insert on changelog for each row"
+				" begin select changelog_seq.nextval into :new.changelogid from dual; end;"))
+	{
+		return FAIL;
+	}
+#elif defined(HAVE_POSTGRESQL)
+	if (ZBX_DB_OK > DBexecute("create table changelog ("
+				"changelogid bigserial not null,"
+				"object integer default '0' not null,"
+				"objectid bigint not null,"
+				"operation integer default '0' not null,"
+				"clock integer default '0' not null,"
+				"primary key (changelogid))"))
+	{
+		return FAIL;
+	}
+#endif
+	return DBcreate_index("changelog", "changelog_1", "clock", 0);
+}
+
+static int	DBpatch_6010025(void)
+{
+#define ZBX_CHANGELOG_INSERT	1
+#define ZBX_CHANGELOG_UPDATE	2
+#define ZBX_CHANGELOG_DELETE	3
+
+	/* trigger value, state, error and lastchange are updated by server and are not configuration changes */
+	const char	*trigger_fields[] = {"expression", "description", "url", "status", "priority", "comments",
+				"templateid", "type", "flags", "recovery_mode", "recovery_expression",
+				"correlation_mode", "correlation_tag", "manual_close", "opdata", "discover",
+				"event_name", "uuid", NULL};
+
+	const struct
+	{
+		const char	*table;
+		const char	*field;
+		int		object;
+		const char	**update_fields;	/* updates of other fields are not recorded */
+	}
+	objects[] = {{"items", "itemid", 3, NULL}, {"triggers", "triggerid", 5, trigger_fields},
+			{"functions", "functionid", 7, NULL}};
+
+	const struct
+	{
+		const char	*name;
+		const char	*ref;
+		int		operation;
+	}
+	ops[] = {{"insert", "new", ZBX_CHANGELOG_INSERT}, {"update", "new", ZBX_CHANGELOG_UPDATE},
+			{"delete", "old", ZBX_CHANGELOG_DELETE}};
+
+	size_t		i, j, event_alloc = 0, event_offset;
+	const char	**field;
+	char		*event = NULL;
+	int		ret = FAIL;
+#if defined(HAVE_MYSQL)
+	char		*cond = NULL;
+	size_t		cond_alloc = 0, cond_offset;
+#endif
+
+	for (i = 0; i < ARRSIZE(objects); i++)
+	{
+		for (j = 0; j < ARRSIZE(ops); j++)
+		{
+			event_offset = 0;
+			zbx_strcpy_alloc(&event, &event_alloc, &event_offset, ops[j].name);
+#if defined(HAVE_MYSQL)
+			cond_offset = 0;
+			zbx_strcpy_alloc(&cond, &cond_alloc, &cond_offset, "");
+#endif
+			if (ZBX_CHANGELOG_UPDATE == ops[j].operation && NULL != objects[i].update_fields)
+			{
+#if defined(HAVE_MYSQL)
+				/* MySQL triggers cannot be limited to updates of specific columns, compare them */
+				zbx_strcpy_alloc(&cond, &cond_alloc, &cond_offset, " from dual where not (");
+
+				for (field = objects[i].update_fields; NULL != *field; field++)
+				{
+					zbx_snprintf_alloc(&cond, &cond_alloc, &cond_offset, "%sold.%s<=>new.%s",
+							field == objects[i].update_fields ? "" : " and ", *field, *field);
+				}
+
+				zbx_chrcpy_alloc(&cond, &cond_alloc, &cond_offset, ')');
+#else
+				zbx_strcpy_alloc(&event, &event_alloc, &event_offset, " of ");
+
+				for (field = objects[i].update_fields; NULL != *field; field++)
+				{
+					zbx_snprintf_alloc(&event, &event_alloc, &event_offset, "%s%s",
+							field == objects[i].update_fields ? "" : ",", *field);
+				}
+#endif
+			}
+#if defined(HAVE_POSTGRESQL)
+			if (ZBX_DB_OK > DBexecute("create or replace function changelog_%s_%s() returns trigger as $$"
+					" begin"
+						" insert into changelog (object,objectid,operation,clock)"
+						" values (%d,%s.%s,%d,cast(extract(epoch from now()) as int));"
+						" return %s;"
+					" end;"
+					" $$ language plpgsql",
+					objects[i].table, ops[j].name, objects[i].object, ops[j].ref, objects[i].field,
+					ops[j].operation, ops[j].ref))
+			{
+				goto out;
+			}
+
+			if (ZBX_DB_OK > DBexecute("create trigger %s_%s after %s on %s"
+					" for each row execute procedure changelog_%s_%s()",
+					objects[i].table, ops[j].name, event, objects[i].table, objects[i].table,
+					ops[j].name))
+			{
+				goto out;
+			}
+#elif defined(HAVE_MYSQL)
+			if (ZBX_DB_OK > DBexecute("create trigger %s_%s after %s on %s"
+					" for each row"
+					" insert into changelog (object,objectid,operation,clock)"
+					" select %d,%s.%s,%d,unix_timestamp()%s",
+					objects[i].table, ops[j].name, event, objects[i].table, objects[i].object,
+					ops[j].ref, objects[i].field, ops[j].operation, cond))
+			{
+				goto out;
+			}
+#elif defined(HAVE_ORACLE)
+			if (ZBX_DB_OK > DBexecute("create trigger %s_%s after %s on %s"
+					" for each row"
+					" begin"
+						" insert into changelog (object,objectid,operation,clock)"
+						" values (%d,:%s.%s,%d,"
+							"(cast(sys_extract_utc(systimestamp) as date)-date'1970-01-01')*86400);"
+					" end;",
+					objects[i].table, ops[j].name, event, objects[i].table, objects[i].object,
+					ops[j].ref, objects[i].field, ops[j].operation))
+			{
+				goto out;
+			}
+#endif
+		}
+	}
+
+	ret = SUCCEED;
+out:
+	zbx_free(event);
+#if defined(HAVE_MYSQL)
+	zbx_free(cond);
+#endif
+	return ret;
+
+#undef ZBX_CHANGELOG_INSERT
+#undef ZBX_CHANGELOG_UPDATE
+#undef ZBX_CHANGELOG_DELETE
+}
+
 #endif
 
 DBPATCH_START(6010)
@@ -363,5 +547,7 @@ DBPATCH_ADD(6010020, 0,	1)
 DBPATCH_ADD(6010021, 0,	1)
 DBPATCH_ADD(6010022, 0,	1)
 DBPATCH_ADD(6010023, 0,	1)
+DBPATCH_ADD(6010024, 0,	1)
+DBPATCH_ADD(6010025, 0,	1)
 
 DBPATCH_END()
@@ -200,6 +200,29 @@ void	zbx_diag_add_mem_stats(struct zbx_json *json, const char *name, const zbx_s
 
 	zbx_json_close(json);
 	zbx_json_close(json);
+
+	zbx_json_addobject(json, "pages");
+	zbx_json_adduint64(json, "size", stats->page_size);
+	zbx_json_addstring(json, "numa", zbx_shmem_numa_policy_string(stats->numa_policy), ZBX_JSON_TYPE_STRING);
+
+	zbx_json_addarray(json, "nodes");
+
+	for (i = 0; i < ZBX_SHMEM_NUMA_MAX_NODES; i++)
+	{
+		if (0 != (stats->numa_nodes & (__UINT64_C(1) << i)) || 0 != stats->numa_pages[i])
+		{
+			char	buf[MAX_ID_LEN + 2];
+
+			zbx_snprintf(buf, sizeof(buf), "%d", i);
+			zbx_json_addobject(json, NULL);
+			zbx_json_adduint64(json, buf, stats->numa_pages[i]);
+			zbx_json_close(json);
+		}
+	}
+
+	zbx_json_close(json);
+	zbx_json_close(json);
+
 	zbx_json_close(json);
 }
 
@@ -536,13 +559,24 @@ void	zbx_diag_add_locks_info(struct zbx_json *json)
 #endif
 	zbx_json_addarray(json, ZBX_DIAG_LOCKS);
 
-	for (i = 0; i < ZBX_MUTEX_COUNT; i++)
+	for (i = 0; i < ZBX_MUTEX_CACHE_SHARD; i++)
 	{
 		zbx_json_addobject(json, NULL);
 		zbx_json_addhex(json, names[i], (zbx_uint64_t)zbx_mutex_addr_get(i));
 		zbx_json_close(json);
 	}
 
+	for (i = ZBX_MUTEX_CACHE_SHARD; i <= ZBX_MUTEX_CACHE_SHARD_LAST; i++)
+	{
+		char	name[64];
+
+		zbx_snprintf(name, sizeof(name), "ZBX_MUTEX_CACHE_SHARD_%d", i - ZBX_MUTEX_CACHE_SHARD + 1);
+
+		zbx_json_addobject(json, NULL);
+		zbx_json_addhex(json, name, (zbx_uint64_t)zbx_mutex_addr_get(i));
+		zbx_json_close(json);
+	}
+
 	zbx_json_addobject(json, NULL);
 	zbx_json_addhex(json, "ZBX_RWLOCK_CONFIG", (zbx_uint64_t)zbx_rwlock_addr_get(ZBX_RWLOCK_CONFIG));
 	zbx_json_close(json);
@@ -802,6 +836,34 @@ static void	diag_log_history_cache(struct zbx_json_parse *jp, char **out, size_t
 	zbx_strlog_alloc(LOG_LEVEL_INFORMATION, out, out_alloc, out_offset, "==");
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: log value cache replacement policy information                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	diag_log_value_cache_policy(struct zbx_json_parse *jp, char **out, size_t *out_alloc,
+		size_t *out_offset)
+{
+	struct zbx_json_parse	jp_policy, jp_queue;
+	const char		*pnext = NULL;
+	char			queue[MAX_STRING_LEN], *msg = NULL;
+
+	if (FAIL == zbx_json_open_path(jp, "$.policy", &jp_policy))
+		return;
+
+	zbx_strlog_alloc(LOG_LEVEL_INFORMATION, out, out_alloc, out_offset, "policy:");
+
+	while (NULL != (pnext = zbx_json_pair_next(&jp_policy, pnext, queue, sizeof(queue))))
+	{
+		if (SUCCEED == zbx_json_brackets_open(pnext, &jp_queue))
+		{
+			diag_get_simple_values(&jp_queue, &msg);
+			zbx_strlog_alloc(LOG_LEVEL_INFORMATION, out, out_alloc, out_offset, "  %s: %s", queue, msg);
+			zbx_free(msg);
+		}
+	}
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: log value cache diagnostic information                            *
@@ -817,6 +879,8 @@ static void	diag_log_value_cache(struct zbx_json_parse *jp, char **out, size_t *
 	zbx_strlog_alloc(LOG_LEVEL_INFORMATION, out, out_alloc, out_offset, "%s", msg);
 	zbx_free(msg);
 
+	diag_log_value_cache_policy(jp, out, out_alloc, out_offset);
+
 	diag_log_memory_info(jp, "memory", "$.memory", out, out_alloc, out_offset);
 
 	diag_log_top_view(jp, "top.values", "$.top.values", out, out_alloc, out_offset);
@@ -171,6 +171,49 @@ int	zbx_history_get_values(zbx_uint64_t itemid, int value_type, int start, int c
 	return ret;
 }
 
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: gets history data of multiple items from history storage                *
+ *                                                                                  *
+ * Parameters: value_type - [IN] the items value type                               *
+ *             requests   - [IN/OUT] the item history requests                      *
+ *                                      (zbx_history_request_t)                     *
+ *                                                                                  *
+ * Return value: SUCCEED - the history data were read successfully                  *
+ *               FAIL - otherwise                                                   *
+ *                                                                                  *
+ * Comments: This function reads all values from ]<start>,<end>] interval of each   *
+ *           request into request values vector.                                    *
+ *                                                                                  *
+ ************************************************************************************/
+int	zbx_history_get_values_multi(int value_type, zbx_vector_ptr_t *requests)
+{
+	int			i, ret = SUCCEED;
+	zbx_history_iface_t	*writer = &history_ifaces[value_type];
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() value_type:%d requests:%d", __func__, value_type,
+			requests->values_num);
+
+	if (NULL != writer->get_values_multi)
+	{
+		ret = writer->get_values_multi(writer, requests);
+	}
+	else
+	{
+		for (i = 0; i < requests->values_num && SUCCEED == ret; i++)
+		{
+			zbx_history_request_t	*request = (zbx_history_request_t *)requests->values[i];
+
+			ret = writer->get_values(writer, request->itemid, request->start, 0, request->end,
+					&request->values);
+		}
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
+
 /************************************************************************************
  *                                                                                  *
  * Purpose: checks if the value type requires trends data calculations              *
@@ -986,6 +986,7 @@ int	zbx_history_elastic_init(zbx_history_iface_t *hist, unsigned char value_type
 	hist->add_values = elastic_add_values;
 	hist->flush = elastic_flush;
 	hist->get_values = elastic_get_values;
+	hist->get_values_multi = NULL;
 	hist->requires_trends = 0;
 
 	return SUCCEED;
@@ -570,6 +570,119 @@ out:
 	return ret;
 }
 
+/* the maximum number of items read by one multiple item history query */
+#define ZBX_HISTORY_MULTI_BATCH_SIZE	1000
+
+static int	history_request_compare_by_period(const void *d1, const void *d2)
+{
+	const zbx_history_request_t	*r1 = *(const zbx_history_request_t * const *)d1;
+	const zbx_history_request_t	*r2 = *(const zbx_history_request_t * const *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(r1->start, r2->start);
+	ZBX_RETURN_IF_NOT_EQUAL(r1->end, r2->end);
+	ZBX_RETURN_IF_NOT_EQUAL(r1->itemid, r2->itemid);
+
+	return 0;
+}
+
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: reads history data of multiple items from database                      *
+ *                                                                                  *
+ * Parameters:  value_type   - [IN] the value type (see ITEM_VALUE_TYPE_* defs)     *
+ *              requests     - [IN/OUT] the item history requests, sorted by        *
+ *                                      period                                      *
+ *              requests_num - [IN] the number of requests                          *
+ *                                                                                  *
+ * Return value: SUCCEED - the history data were read successfully                  *
+ *               FAIL - otherwise                                                   *
+ *                                                                                  *
+ * Comments: The requests with the same period are combined into one itemid         *
+ *           condition, so all values are read with a single query.                 *
+ *                                                                                  *
+ ************************************************************************************/
+static int	db_read_values_multi(int value_type, zbx_history_request_t **requests, int requests_num)
+{
+	char			*sql = NULL;
+	size_t			sql_alloc = 0, sql_offset = 0;
+	int			i, j;
+	DB_RESULT		result;
+	DB_ROW			row;
+	zbx_vc_history_table_t	*table = &vc_history_tables[value_type];
+	zbx_vector_uint64_t	itemids;
+	zbx_vector_ptr_t	index;
+
+	zbx_vector_uint64_create(&itemids);
+	zbx_vector_ptr_create(&index);
+	zbx_vector_ptr_append_array(&index, (void **)requests, requests_num);
+	zbx_vector_ptr_sort(&index, ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC);
+
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
+			"select itemid,clock,ns,%s"
+			" from %s"
+			" where",
+			table->fields, table->name);
+
+	for (i = 0; i < requests_num; i = j)
+	{
+		zbx_vector_uint64_clear(&itemids);
+
+		for (j = i; j < requests_num && requests[j]->start == requests[i]->start &&
+				requests[j]->end == requests[i]->end; j++)
+		{
+			zbx_vector_uint64_append(&itemids, requests[j]->itemid);
+		}
+
+		if (0 != i)
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " or");
+
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " (");
+		DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "itemid", itemids.values, itemids.values_num);
+		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, " and clock>%d", requests[i]->start);
+
+		if (ZBX_JAN_2038 != requests[i]->end)
+			zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, " and clock<=%d", requests[i]->end);
+
+		zbx_chrcpy_alloc(&sql, &sql_alloc, &sql_offset, ')');
+	}
+
+	result = DBselect("%s", sql);
+
+	zbx_free(sql);
+
+	if (NULL == result)
+		goto out;
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		zbx_history_record_t	value;
+		zbx_history_request_t	*request;
+		zbx_uint64_t		itemid;
+
+		ZBX_STR2UINT64(itemid, row[0]);
+
+		if (FAIL == (i = zbx_vector_ptr_bsearch(&index, &itemid, ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC)))
+		{
+			THIS_SHOULD_NEVER_HAPPEN;
+			continue;
+		}
+
+		request = (zbx_history_request_t *)index.values[i];
+
+		value.timestamp.sec = atoi(row[1]);
+		value.timestamp.ns = atoi(row[2]);
+		table->rtov(&value.value, row + 3);
+
+		zbx_vector_history_record_append_ptr(&request->values, &value);
+	}
+	DBfree_result(result);
+out:
+	zbx_vector_ptr_destroy(&index);
+	zbx_vector_uint64_destroy(&itemids);
+
+	return SUCCEED;
+}
+
 /******************************************************************************************************************
  *                                                                                                                *
  * history interface support                                                                                      *
@@ -618,6 +731,32 @@ static int	sql_get_values(zbx_history_iface_t *hist, zbx_uint64_t itemid, int st
 	return db_read_values_by_time_and_count(itemid, hist->value_type, values, end - start, count, end);
 }
 
+/************************************************************************************
+ *                                                                                  *
+ * Purpose: gets history data of multiple items from history storage                *
+ *                                                                                  *
+ * Parameters:  hist     - [IN] the history storage interface                       *
+ *              requests - [IN/OUT] the item history requests                       *
+ *                                                                                  *
+ * Return value: SUCCEED - the history data were read successfully                  *
+ *               FAIL - otherwise                                                   *
+ *                                                                                  *
+ ************************************************************************************/
+static int	sql_get_values_multi(zbx_history_iface_t *hist, zbx_vector_ptr_t *requests)
+{
+	int	i, ret = SUCCEED;
+
+	zbx_vector_ptr_sort(requests, history_request_compare_by_period);
+
+	for (i = 0; i < requests->values_num && SUCCEED == ret; i += ZBX_HISTORY_MULTI_BATCH_SIZE)
+	{
+		ret = db_read_values_multi(hist->value_type, (zbx_history_request_t **)requests->values + i,
+				MIN(ZBX_HISTORY_MULTI_BATCH_SIZE, requests->values_num - i));
+	}
+
+	return ret;
+}
+
 /************************************************************************************
  *                                                                                  *
  * Purpose: sends history data to the storage                                       *
@@ -683,6 +822,7 @@ int	zbx_history_sql_init(zbx_history_iface_t *hist, unsigned char value_type, ch
 	hist->add_values = sql_add_values;
 	hist->flush = sql_flush;
 	hist->get_values = sql_get_values;
+	hist->get_values_multi = sql_get_values_multi;
 
 	switch (value_type)
 	{
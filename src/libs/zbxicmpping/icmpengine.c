@@ -0,0 +1,778 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "icmpengine.h"
+
+#include "log.h"
+
+/*
+ * Native ICMP echo engine
+ *
+ * Pings a batch of hosts from the calling process without executing fping.
+ * The engine core keeps the send schedule and reply statistics and does not
+ * touch sockets or clocks, so it can be driven by unit tests. Packets are
+ * sent in rounds like fping does: the first packet to every host, then the
+ * second one and so on. Any two packets are at least 1/NativeICMPPingRate
+ * seconds apart and packets to the same host are at least the item period
+ * apart. The engine fills ZBX_FPING_HOST statistics the same way the fping
+ * output parser does.
+ *
+ * Raw ICMP sockets are used when the process is allowed to open them,
+ * otherwise unprivileged ICMP datagram sockets are tried. Replies are matched
+ * to requests by a cookie in the packet data, because the kernel replaces
+ * echo identifier of datagram sockets.
+ */
+
+extern char	*CONFIG_SOURCE_IP;
+extern int	CONFIG_NATIVE_ICMP_PING_RATE;
+
+#define ZBX_ICMP_ECHO_REQUEST	8
+#define ZBX_ICMP_ECHO_REPLY	0
+#define ZBX_ICMP6_ECHO_REQUEST	128
+#define ZBX_ICMP6_ECHO_REPLY	129
+
+#define ZBX_ICMP_PACKET_MAX	65536
+#define ZBX_ICMP_RCVBUF_SIZE	ZBX_MEBIBYTE
+#define ZBX_ICMP_PACING_SLACK	0.01	/* seconds the sender may catch up with the schedule by sending in bursts */
+
+static void	icmp_put_uint16(unsigned char *buf, unsigned short value)
+{
+	buf[0] = (unsigned char)(value >> 8);
+	buf[1] = (unsigned char)value;
+}
+
+static void	icmp_put_uint32(unsigned char *buf, zbx_uint32_t value)
+{
+	buf[0] = (unsigned char)(value >> 24);
+	buf[1] = (unsigned char)(value >> 16);
+	buf[2] = (unsigned char)(value >> 8);
+	buf[3] = (unsigned char)value;
+}
+
+static zbx_uint32_t	icmp_get_uint32(const unsigned char *buf)
+{
+	return ((zbx_uint32_t)buf[0] << 24) | ((zbx_uint32_t)buf[1] << 16) | ((zbx_uint32_t)buf[2] << 8) |
+			(zbx_uint32_t)buf[3];
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: calculates internet checksum (RFC 1071)                           *
+ *                                                                            *
+ * Parameters: data - [IN] the data                                           *
+ *             len  - [IN] the data length                                    *
+ *                                                                            *
+ * Return value: the checksum in host byte order                              *
+ *                                                                            *
+ ******************************************************************************/
+unsigned short	zbx_icmp_checksum(const unsigned char *data, size_t len)
+{
+	zbx_uint32_t	sum = 0;
+	size_t		i;
+
+	for (i = 0; i + 1 < len; i += 2)
+		sum += ((zbx_uint32_t)data[i] << 8) | data[i + 1];
+
+	if (0 != (len & 1))
+		sum += (zbx_uint32_t)data[len - 1] << 8;
+
+	while (0 != (sum >> 16))
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return (unsigned short)~sum;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: builds ICMP or ICMPv6 echo request                                *
+ *                                                                            *
+ * Parameters: buf    - [OUT] the packet buffer, must fit ZBX_ICMP_HEADER_LEN *
+ *                            and the packet data                             *
+ *             family - [IN] the address family                               *
+ *             id     - [IN] the echo identifier                              *
+ *             seq    - [IN] the echo sequence number                         *
+ *             tag    - [IN] the batch tag                                    *
+ *             target - [IN] the target index                                 *
+ *             packet - [IN] the packet index                                 *
+ *             size   - [IN] the packet data size                             *
+ *                                                                            *
+ * Return value: the packet length                                            *
+ *                                                                            *
+ * Comments: The checksum of ICMPv6 packets covers IPv6 pseudo header and is  *
+ *           calculated by kernel.                                            *
+ *                                                                            *
+ ******************************************************************************/
+size_t	zbx_icmp_build_echo(unsigned char *buf, int family, unsigned short id, unsigned short seq, zbx_uint32_t tag,
+		int target, int packet, int size)
+{
+	size_t	len;
+
+	len = ZBX_ICMP_HEADER_LEN + (size_t)MAX(size, ZBX_ICMP_COOKIE_LEN);
+	memset(buf, 0, len);
+
+	buf[0] = (AF_INET6 == family ? ZBX_ICMP6_ECHO_REQUEST : ZBX_ICMP_ECHO_REQUEST);
+	icmp_put_uint16(buf + 4, id);
+	icmp_put_uint16(buf + 6, seq);
+
+	icmp_put_uint32(buf + ZBX_ICMP_HEADER_LEN, tag);
+	icmp_put_uint32(buf + ZBX_ICMP_HEADER_LEN + 4, (zbx_uint32_t)target);
+	icmp_put_uint32(buf + ZBX_ICMP_HEADER_LEN + 8, (zbx_uint32_t)packet);
+
+	if (ZBX_ICMP_ECHO_REQUEST == buf[0])
+		icmp_put_uint16(buf + 2, zbx_icmp_checksum(buf, len));
+
+	return len;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: parses echo reply to a request of the batch                       *
+ *                                                                            *
+ * Parameters: buf    - [IN] the received data                                *
+ *             len    - [IN] the received data length                         *
+ *             family - [IN] the address family of the socket                 *
+ *             tag    - [IN] the batch tag                                    *
+ *             target - [OUT] the target index                                *
+ *             packet - [OUT] the packet index                                *
+ *                                                                            *
+ * Return value: SUCCEED - the data is an echo reply to the batch request     *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: IPv4 header is present in data read from raw sockets and on      *
+ *           some systems from datagram sockets. It is detected by version    *
+ *           field, the type of echo reply is 0 so ICMP data cannot start     *
+ *           with a version nibble.                                           *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_icmp_parse_echo_reply(const unsigned char *buf, size_t len, int family, zbx_uint32_t tag, int *target,
+		int *packet)
+{
+	unsigned char	type = (AF_INET6 == family ? ZBX_ICMP6_ECHO_REPLY : ZBX_ICMP_ECHO_REPLY);
+
+	if (ZBX_ICMP_ECHO_REPLY == type && 0 != len && 4 == (buf[0] >> 4))
+	{
+		size_t	hl = (size_t)(buf[0] & 0x0f) * 4;
+
+		if (20 > hl || len < hl)
+			return FAIL;
+
+		buf += hl;
+		len -= hl;
+	}
+
+	if (ZBX_ICMP_HEADER_LEN + ZBX_ICMP_COOKIE_LEN > len)
+		return FAIL;
+
+	if (type != buf[0] || 0 != buf[1])
+		return FAIL;
+
+	if (ZBX_ICMP_ECHO_REPLY == type && 0 != zbx_icmp_checksum(buf, len))
+		return FAIL;
+
+	if (tag != icmp_get_uint32(buf + ZBX_ICMP_HEADER_LEN))
+		return FAIL;
+
+	*target = (int)icmp_get_uint32(buf + ZBX_ICMP_HEADER_LEN + 4);
+	*packet = (int)icmp_get_uint32(buf + ZBX_ICMP_HEADER_LEN + 8);
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: initializes engine for a batch of hosts                           *
+ *                                                                            *
+ * Parameters: engine    - [OUT] the engine                                   *
+ *             hosts     - [IN] the hosts to ping                             *
+ *             hosts_num - [IN] the number of hosts                           *
+ *             count     - [IN] the number of packets to send to each host    *
+ *             period    - [IN] the milliseconds between packets to one host, *
+ *                              0 - default                                   *
+ *             size      - [IN] the packet data size, 0 - default             *
+ *             timeout   - [IN] the milliseconds to wait for reply,           *
+ *                              0 - default                                   *
+ *             rate      - [IN] the maximum packets per second, 0 - no limit  *
+ *             tag       - [IN] the batch tag                                 *
+ *                                                                            *
+ * Comments: Defaults are the same as used by fping in count mode. Targets    *
+ *           are not resolved, the caller sets addresses and resolved flag    *
+ *           before zbx_icmp_engine_start().                                  *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_icmp_engine_init(zbx_icmp_engine_t *engine, ZBX_FPING_HOST *hosts, int hosts_num, int count, int period,
+		int size, int timeout, int rate, zbx_uint32_t tag)
+{
+	int	i;
+	size_t	packets_num;
+
+	memset(engine, 0, sizeof(zbx_icmp_engine_t));
+
+	if (0 == period)
+		period = ZBX_ICMP_DEFAULT_PERIOD;
+
+	if (0 == timeout)
+		timeout = MIN(period, ZBX_ICMP_DEFAULT_TIMEOUT_MAX);
+
+	engine->count = count;
+	engine->size = (0 != size ? size : ZBX_ICMP_DEFAULT_DATA_SIZE);
+	engine->period = period / 1000.0;
+	engine->timeout = timeout / 1000.0;
+	engine->interval = (0 != rate ? 1.0 / rate : 0.0);
+	engine->tag = tag;
+
+	engine->targets_num = hosts_num;
+	engine->targets = (zbx_icmp_target_t *)zbx_malloc(NULL, sizeof(zbx_icmp_target_t) * (size_t)MAX(hosts_num, 1));
+	memset(engine->targets, 0, sizeof(zbx_icmp_target_t) * (size_t)hosts_num);
+
+	for (i = 0; i < hosts_num; i++)
+		engine->targets[i].host = &hosts[i];
+
+	packets_num = (size_t)MAX(hosts_num, 1) * (size_t)count;
+	engine->sent = (double *)zbx_malloc(NULL, sizeof(double) * packets_num);
+	engine->received = (unsigned char *)zbx_malloc(NULL, packets_num);
+	memset(engine->received, 0, packets_num);
+
+	for (i = 0; i < (int)packets_num; i++)
+		engine->sent[i] = -1.0;
+}
+
+void	zbx_icmp_engine_clear(zbx_icmp_engine_t *engine)
+{
+	zbx_free(engine->received);
+	zbx_free(engine->sent);
+	zbx_free(engine->targets);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: finds the next resolved target starting with the specified index  *
+ *                                                                            *
+ ******************************************************************************/
+static int	icmp_engine_next_target(const zbx_icmp_engine_t *engine, int index)
+{
+	for (; index < engine->targets_num; index++)
+	{
+		if (0 != engine->targets[index].resolved)
+			return index;
+	}
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: positions the send schedule on the first packet                   *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_icmp_engine_start(zbx_icmp_engine_t *engine)
+{
+	engine->round = 0;
+
+	if (FAIL == (engine->next = icmp_engine_next_target(engine, 0)))
+		engine->round = engine->count;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets the next packet to send                                      *
+ *                                                                            *
+ * Parameters: engine - [IN] the engine                                       *
+ *             at     - [OUT] the time when the packet can be sent            *
+ *                                                                            *
+ * Return value: the target index or FAIL if all packets have been sent       *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_icmp_engine_next(const zbx_icmp_engine_t *engine, double *at)
+{
+	if (engine->round >= engine->count)
+		return FAIL;
+
+	*at = (0 == engine->sent_num ? 0.0 : engine->scheduled + engine->interval);
+
+	if (0 != engine->round)
+	{
+		double	prev = engine->sent[engine->next * engine->count + engine->round - 1];
+
+		if (*at < prev + engine->period)
+			*at = prev + engine->period;
+	}
+
+	return engine->next;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: registers that the packet returned by zbx_icmp_engine_next() has  *
+ *          been sent and moves to the next one                               *
+ *                                                                            *
+ * Parameters: engine    - [IN/OUT] the engine                                *
+ *             scheduled - [IN] the time returned by zbx_icmp_engine_next()   *
+ *             now       - [IN] the current time                              *
+ *                                                                            *
+ * Comments: A sender late by less than ZBX_ICMP_PACING_SLACK keeps the       *
+ *           schedule, otherwise the schedule restarts from the current time  *
+ *           instead of sending a burst of delayed packets.                   *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_icmp_engine_sent(zbx_icmp_engine_t *engine, double scheduled, double now)
+{
+	engine->sent[engine->next * engine->count + engine->round] = now;
+	engine->scheduled = (scheduled < now - ZBX_ICMP_PACING_SLACK ? now : scheduled);
+	engine->last_sent = now;
+	engine->sent_num++;
+
+	if (FAIL == (engine->next = icmp_engine_next_target(engine, engine->next + 1)) &&
+			++engine->round < engine->count)
+	{
+		engine->next = icmp_engine_next_target(engine, 0);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: registers echo reply                                              *
+ *                                                                            *
+ * Parameters: engine - [IN/OUT] the engine                                   *
+ *             target - [IN] the target index                                 *
+ *             packet - [IN] the packet index                                 *
+ *             now    - [IN] the receive time                                 *
+ *                                                                            *
+ * Return value: SUCCEED - the reply was counted                              *
+ *               FAIL    - the reply is invalid, duplicate or late            *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_icmp_engine_reply(zbx_icmp_engine_t *engine, int target, int packet, double now)
+{
+	ZBX_FPING_HOST	*host;
+	int		index;
+	double		sec;
+
+	if (0 > target || target >= engine->targets_num || 0 > packet || packet >= engine->count)
+		return FAIL;
+
+	index = target * engine->count + packet;
+
+	if (0 > engine->sent[index] || 0 != engine->received[index])
+		return FAIL;
+
+	if (engine->timeout < (sec = now - engine->sent[index]))
+		return FAIL;
+
+	if (0 > sec)
+		sec = 0;
+
+	engine->received[index] = 1;
+	engine->received_num++;
+
+	host = engine->targets[target].host;
+
+	if (0 == host->rcv || host->min > sec)
+		host->min = sec;
+	if (0 == host->rcv || host->max < sec)
+		host->max = sec;
+	host->sum += sec;
+	host->rcv++;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: checks if all packets are sent and answered or timed out          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_icmp_engine_done(const zbx_icmp_engine_t *engine, double now)
+{
+	if (engine->round < engine->count)
+		return FAIL;
+
+	if (engine->received_num == engine->sent_num || now >= zbx_icmp_engine_deadline(engine))
+		return SUCCEED;
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets the time when the last sent packet times out                 *
+ *                                                                            *
+ ******************************************************************************/
+double	zbx_icmp_engine_deadline(const zbx_icmp_engine_t *engine)
+{
+	return engine->last_sent + engine->timeout;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: updates number of sent packets of the pinged hosts                *
+ *                                                                            *
+ * Comments: Hosts that could not be resolved are left with zero count, the   *
+ *           same as hosts missing in fping output.                           *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_icmp_engine_finish(zbx_icmp_engine_t *engine)
+{
+	int	i;
+
+	for (i = 0; i < engine->targets_num; i++)
+	{
+		if (0 != engine->targets[i].resolved)
+			engine->targets[i].host->cnt += engine->count;
+	}
+}
+
+static double	icmp_clock(void)
+{
+	struct timespec	ts;
+
+	if (0 != clock_gettime(CLOCK_MONOTONIC, &ts))
+		return zbx_time();
+
+	return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int	icmp_resolve(zbx_icmp_target_t *target, int family)
+{
+	struct addrinfo	hints, *ai = NULL;
+	int		ret = FAIL;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = family;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	if (0 != getaddrinfo(target->host->addr, NULL, &hints, &ai))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "cannot resolve \"%s\"", target->host->addr);
+		return FAIL;
+	}
+
+	if (sizeof(target->addr) >= ai->ai_addrlen)
+	{
+		memcpy(&target->addr, ai->ai_addr, ai->ai_addrlen);
+		target->addr_len = (socklen_t)ai->ai_addrlen;
+		target->family = ai->ai_family;
+		ret = SUCCEED;
+	}
+
+	freeaddrinfo(ai);
+
+	return ret;
+}
+
+static int	icmp_addr_equal(const zbx_icmp_target_t *target, const ZBX_SOCKADDR *addr)
+{
+	if (target->family != ((const struct sockaddr *)addr)->sa_family)
+		return FAIL;
+
+#ifdef HAVE_IPV6
+	if (AF_INET6 == target->family)
+	{
+		if (0 != memcmp(&((const struct sockaddr_in6 *)&target->addr)->sin6_addr,
+				&((const struct sockaddr_in6 *)addr)->sin6_addr, sizeof(struct in6_addr)))
+		{
+			return FAIL;
+		}
+
+		return SUCCEED;
+	}
+#endif
+	if (((const struct sockaddr_in *)&target->addr)->sin_addr.s_addr !=
+			((const struct sockaddr_in *)addr)->sin_addr.s_addr)
+	{
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: opens non-blocking ICMP socket                                    *
+ *                                                                            *
+ * Parameters: family        - [IN] the address family                        *
+ *             s             - [OUT] the socket                               *
+ *             error         - [OUT] error string if function fails           *
+ *             max_error_len - [IN] length of error buffer                    *
+ *                                                                            *
+ * Return value: SUCCEED - the socket was opened                              *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: Raw sockets require root or CAP_NET_RAW capability. Datagram     *
+ *           ICMP sockets are available to unprivileged users on Linux within *
+ *           net.ipv4.ping_group_range and on macOS.                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	icmp_socket_open(int family, ZBX_SOCKET *s, char *error, size_t max_error_len)
+{
+	int		protocol = IPPROTO_ICMP, rcvbuf = ZBX_ICMP_RCVBUF_SIZE, flags;
+	const char	*version = "";
+
+#ifdef HAVE_IPV6
+	if (AF_INET6 == family)
+	{
+		protocol = IPPROTO_ICMPV6;
+		version = "v6";
+	}
+#endif
+	if (-1 == (*s = socket(family, SOCK_RAW, protocol)) &&
+			((EPERM != errno && EACCES != errno) || -1 == (*s = socket(family, SOCK_DGRAM, protocol))))
+	{
+		zbx_snprintf(error, max_error_len, "Cannot create ICMP%s socket: %s", version, zbx_strerror(errno));
+		return FAIL;
+	}
+
+	if (-1 == (flags = fcntl(*s, F_GETFL, 0)) || -1 == fcntl(*s, F_SETFL, flags | O_NONBLOCK))
+	{
+		zbx_snprintf(error, max_error_len, "Cannot set ICMP%s socket non-blocking mode: %s", version,
+				zbx_strerror(errno));
+		goto fail;
+	}
+
+	/* large batches receive replies faster than they are processed */
+	if (-1 == setsockopt(*s, SOL_SOCKET, SO_RCVBUF, (void *)&rcvbuf, sizeof(rcvbuf)))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "cannot set ICMP%s socket receive buffer size: %s", version,
+				zbx_strerror(errno));
+	}
+
+	if (NULL != CONFIG_SOURCE_IP)
+	{
+		struct addrinfo	hints, *ai = NULL;
+		int		rc;
+
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = family;
+		hints.ai_socktype = SOCK_DGRAM;
+		hints.ai_flags = AI_NUMERICHOST;
+
+		if (0 != (rc = getaddrinfo(CONFIG_SOURCE_IP, NULL, &hints, &ai)))
+		{
+			zbx_snprintf(error, max_error_len, "Invalid source IP address \"%s\": %s", CONFIG_SOURCE_IP,
+					gai_strerror(rc));
+			goto fail;
+		}
+
+		rc = bind(*s, ai->ai_addr, ai->ai_addrlen);
+		freeaddrinfo(ai);
+
+		if (-1 == rc)
+		{
+			zbx_snprintf(error, max_error_len, "Cannot bind ICMP%s socket to \"%s\": %s", version,
+					CONFIG_SOURCE_IP, zbx_strerror(errno));
+			goto fail;
+		}
+	}
+
+	return SUCCEED;
+fail:
+	close(*s);
+	*s = -1;
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads all pending replies from the socket                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	icmp_receive(zbx_icmp_engine_t *engine, ZBX_SOCKET s, int family, unsigned char *buf, size_t buf_size)
+{
+	while (1)
+	{
+		ZBX_SOCKADDR	from;
+		socklen_t	from_len = sizeof(from);
+		ssize_t		n;
+		int		target, packet;
+
+		if (-1 == (n = recvfrom(s, (void *)buf, buf_size, 0, (struct sockaddr *)&from, &from_len)))
+		{
+			if (EINTR == errno)
+				continue;
+
+			if (EAGAIN != errno && EWOULDBLOCK != errno)
+				zabbix_log(LOG_LEVEL_DEBUG, "cannot receive ICMP reply: %s", zbx_strerror(errno));
+
+			break;
+		}
+
+		if (SUCCEED != zbx_icmp_parse_echo_reply(buf, (size_t)n, family, engine->tag, &target, &packet))
+			continue;
+
+		if (0 > target || target >= engine->targets_num)
+			continue;
+
+		/* ignore responses from other addresses, for example to broadcast requests */
+		if (SUCCEED != icmp_addr_equal(&engine->targets[target], &from))
+			continue;
+
+		zbx_icmp_engine_reply(engine, target, packet, icmp_clock());
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: pings hosts with native ICMP echo requests                        *
+ *                                                                            *
+ * Parameters: see zbx_ping()                                                 *
+ *                                                                            *
+ * Return value: SUCCEED - successfully processed hosts                       *
+ *               NOTSUPPORTED - otherwise                                     *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_icmp_ping(ZBX_FPING_HOST *hosts, int hosts_count, int count, int period, int size, int timeout,
+		char *error, size_t max_error_len)
+{
+	static zbx_uint32_t	batch;
+	zbx_icmp_engine_t	engine;
+	struct pollfd		pfds[2];
+	int			families[2], pfds_num = 0, family = AF_UNSPEC, i, ret = NOTSUPPORTED;
+	ZBX_SOCKET		s4 = -1;
+#ifdef HAVE_IPV6
+	ZBX_SOCKET		s6 = -1;
+#endif
+	unsigned char		*packet = NULL, *buf = NULL;
+	unsigned short		id;
+	zbx_uint32_t		tag;
+
+	id = (unsigned short)getpid();
+	tag = ((zbx_uint32_t)getpid() << 16) ^ ((zbx_uint32_t)time(NULL) << 8) ^ ++batch;
+
+	zbx_icmp_engine_init(&engine, hosts, hosts_count, count, period, size, timeout, CONFIG_NATIVE_ICMP_PING_RATE,
+			tag);
+
+#ifdef HAVE_IPV6
+	/* like fping, hosts of the other address family are not pinged when source IP is set */
+	if (NULL != CONFIG_SOURCE_IP && SUCCEED != get_address_family(CONFIG_SOURCE_IP, &family, error,
+			(int)max_error_len))
+	{
+		goto out;
+	}
+#else
+	family = AF_INET;
+#endif
+	for (i = 0; i < hosts_count; i++)
+	{
+		zbx_icmp_target_t	*target = &engine.targets[i];
+
+		if (SUCCEED != icmp_resolve(target, family))
+			continue;
+
+		target->resolved = 1;
+
+		if (AF_INET == target->family && -1 == s4)
+		{
+			if (SUCCEED != icmp_socket_open(AF_INET, &s4, error, max_error_len))
+				goto out;
+
+			pfds[pfds_num].fd = s4;
+			families[pfds_num++] = AF_INET;
+		}
+#ifdef HAVE_IPV6
+		else if (AF_INET6 == target->family && -1 == s6)
+		{
+			if (SUCCEED != icmp_socket_open(AF_INET6, &s6, error, max_error_len))
+				goto out;
+
+			pfds[pfds_num].fd = s6;
+			families[pfds_num++] = AF_INET6;
+		}
+#endif
+	}
+
+	packet = (unsigned char *)zbx_malloc(NULL, ZBX_ICMP_HEADER_LEN + (size_t)MAX(engine.size,
+			ZBX_ICMP_COOKIE_LEN));
+	buf = (unsigned char *)zbx_malloc(NULL, ZBX_ICMP_PACKET_MAX);
+
+	zbx_icmp_engine_start(&engine);
+
+	while (1)
+	{
+		double	now, at = 0, wakeup;
+		int	index, wait_ms;
+
+		now = icmp_clock();
+
+		while (FAIL != (index = zbx_icmp_engine_next(&engine, &at)) && at <= now)
+		{
+			zbx_icmp_target_t	*target = &engine.targets[index];
+			ZBX_SOCKET		s = s4;
+			size_t			len;
+
+#ifdef HAVE_IPV6
+			if (AF_INET6 == target->family)
+				s = s6;
+#endif
+			len = zbx_icmp_build_echo(packet, target->family, id, (unsigned short)engine.sent_num, tag, index,
+					engine.round, engine.size);
+
+			if (-1 == sendto(s, (void *)packet, len, 0, (struct sockaddr *)&target->addr, target->addr_len))
+			{
+				zabbix_log(LOG_LEVEL_DEBUG, "cannot send ICMP echo request to \"%s\": %s",
+						target->host->addr, zbx_strerror(errno));
+			}
+
+			zbx_icmp_engine_sent(&engine, at, now);
+		}
+
+		if (SUCCEED == zbx_icmp_engine_done(&engine, now))
+			break;
+
+		/* wait for the next packet to send or for the last sent packet to time out */
+		wakeup = (FAIL != index ? at : zbx_icmp_engine_deadline(&engine));
+
+		wait_ms = (int)ceil((wakeup - now) * 1000);
+
+		for (i = 0; i < pfds_num; i++)
+		{
+			pfds[i].events = POLLIN;
+			pfds[i].revents = 0;
+		}
+
+		if (-1 == poll(pfds, (nfds_t)pfds_num, MAX(wait_ms, 0)))
+		{
+			if (EINTR == errno)
+				continue;
+
+			zbx_snprintf(error, max_error_len, "Cannot wait for ICMP replies: %s", zbx_strerror(errno));
+			goto out;
+		}
+
+		for (i = 0; i < pfds_num; i++)
+		{
+			if (0 != (pfds[i].revents & POLLIN))
+				icmp_receive(&engine, pfds[i].fd, families[i], buf, ZBX_ICMP_PACKET_MAX);
+		}
+	}
+
+	zbx_icmp_engine_finish(&engine);
+	ret = SUCCEED;
+out:
+	if (-1 != s4)
+		close(s4);
+#ifdef HAVE_IPV6
+	if (-1 != s6)
+		close(s6);
+#endif
+	zbx_free(buf);
+	zbx_free(packet);
+	zbx_icmp_engine_clear(&engine);
+
+	return ret;
+}
@@ -0,0 +1,86 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_ICMPENGINE_H
+#define ZABBIX_ICMPENGINE_H
+
+#include "zbxicmpping.h"
+#include "zbxcomms.h"
+
+#define ZBX_ICMP_HEADER_LEN		8
+#define ZBX_ICMP_COOKIE_LEN		12	/* batch tag, target index and packet index */
+#define ZBX_ICMP_DEFAULT_DATA_SIZE	56	/* same as fping default (-b) */
+#define ZBX_ICMP_DEFAULT_PERIOD		1000	/* same as fping default (-p), in milliseconds */
+#define ZBX_ICMP_DEFAULT_TIMEOUT_MAX	2000	/* fping uses the period as timeout up to this value */
+
+/* ICMP echo target, the engine keeps one per host */
+typedef struct
+{
+	ZBX_FPING_HOST	*host;
+	unsigned char	resolved;	/* 0 - the address could not be resolved, packets are not sent */
+	int		family;
+	ZBX_SOCKADDR	addr;
+	socklen_t	addr_len;
+}
+zbx_icmp_target_t;
+
+/* ICMP echo engine state, independent of sockets and clock to allow unit testing */
+typedef struct
+{
+	zbx_icmp_target_t	*targets;
+	int			targets_num;
+	int			count;		/* packets per target */
+	int			size;		/* packet data size */
+	double			period;		/* seconds between packets to the same target */
+	double			interval;	/* seconds between any two packets */
+	double			timeout;	/* seconds to wait for a reply */
+	zbx_uint32_t		tag;		/* identifies replies to this batch */
+	double			*sent;		/* send time of each packet, negative if not sent */
+	unsigned char		*received;	/* 1 - a valid reply has been received for the packet */
+
+	int			round;		/* index of the next packet to send */
+	int			next;		/* target of the next packet to send */
+	double			scheduled;	/* scheduled time of the last sent packet */
+	double			last_sent;
+	int			sent_num;
+	int			received_num;
+}
+zbx_icmp_engine_t;
+
+void	zbx_icmp_engine_init(zbx_icmp_engine_t *engine, ZBX_FPING_HOST *hosts, int hosts_num, int count, int period,
+		int size, int timeout, int rate, zbx_uint32_t tag);
+void	zbx_icmp_engine_clear(zbx_icmp_engine_t *engine);
+void	zbx_icmp_engine_start(zbx_icmp_engine_t *engine);
+int	zbx_icmp_engine_next(const zbx_icmp_engine_t *engine, double *at);
+void	zbx_icmp_engine_sent(zbx_icmp_engine_t *engine, double scheduled, double now);
+int	zbx_icmp_engine_reply(zbx_icmp_engine_t *engine, int target, int packet, double now);
+int	zbx_icmp_engine_done(const zbx_icmp_engine_t *engine, double now);
+double	zbx_icmp_engine_deadline(const zbx_icmp_engine_t *engine);
+void	zbx_icmp_engine_finish(zbx_icmp_engine_t *engine);
+
+unsigned short	zbx_icmp_checksum(const unsigned char *data, size_t len);
+size_t	zbx_icmp_build_echo(unsigned char *buf, int family, unsigned short id, unsigned short seq, zbx_uint32_t tag,
+		int target, int packet, int size);
+int	zbx_icmp_parse_echo_reply(const unsigned char *buf, size_t len, int family, zbx_uint32_t tag, int *target,
+		int *packet);
+
+int	zbx_icmp_ping(ZBX_FPING_HOST *hosts, int hosts_count, int count, int period, int size, int timeout,
+		char *error, size_t max_error_len);
+
+#endif
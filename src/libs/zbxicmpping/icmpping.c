@@ -19,6 +19,7 @@
 
 #include "zbxicmpping.h"
 
+#include "icmpengine.h"
 #include "zbxthreads.h"
 #include "zbxcomms.h"
 #include "zbxexec.h"
@@ -31,6 +32,7 @@ extern char	*CONFIG_FPING_LOCATION;
 extern char	*CONFIG_FPING6_LOCATION;
 #endif
 extern char	*CONFIG_TMPDIR;
+extern int	CONFIG_NATIVE_ICMP_PING;
 
 /* old official fping (2.4b2_to_ipv6) did not support source IP address */
 /* old patched versions (2.4b2_to_ipv6) provided either -I or -S options */
@@ -723,6 +725,7 @@ out:
  *               NOTSUPPORTED - otherwise                                     *
  *                                                                            *
  * Comments: use external binary 'fping' to avoid superuser privileges        *
+ *           unless built-in ICMP engine is enabled with NativeICMPPing       *
  *                                                                            *
  ******************************************************************************/
 int	zbx_ping(ZBX_FPING_HOST *hosts, int hosts_count, int count, int period, int size, int timeout,
@@ -732,7 +735,12 @@ int	zbx_ping(ZBX_FPING_HOST *hosts, int hosts_count, int count, int period, int
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() hosts_count:%d", __func__, hosts_count);
 
-	if (NOTSUPPORTED == (ret = process_ping(hosts, hosts_count, count, period, size, timeout, error, max_error_len)))
+	if (0 != CONFIG_NATIVE_ICMP_PING)
+		ret = zbx_icmp_ping(hosts, hosts_count, count, period, size, timeout, error, max_error_len);
+	else
+		ret = process_ping(hosts, hosts_count, count, period, size, timeout, error, max_error_len);
+
+	if (NOTSUPPORTED == ret)
 		zabbix_log(LOG_LEVEL_ERR, "%s", error);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
@@ -1210,6 +1210,7 @@ static int	evaluate_COUNT(zbx_variant_t *value, DC_ITEM *item, const char *param
 	zbx_vector_ptr_t		regexps;
 	zbx_vector_history_record_t	values;
 	zbx_timespec_t			ts_end = *ts;
+	zbx_vc_aggregate_t		aggregate;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -1389,6 +1390,15 @@ static int	evaluate_COUNT(zbx_variant_t *value, DC_ITEM *item, const char *param
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
+	/* plain value count can be taken from value cache aggregates */
+	if (1 == nparams && COUNT_ALL == unique && ZBX_VALUE_SECONDS == arg1_type &&
+			SUCCEED == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, &ts_end, &aggregate))
+	{
+		zbx_variant_set_dbl(value, MIN(aggregate.count, limit));
+		ret = SUCCEED;
+		goto out;
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -1539,6 +1549,7 @@ static int	evaluate_SUM(zbx_variant_t *value, DC_ITEM *item, const char *paramet
 	zbx_vector_history_record_t	values;
 	history_value_t			result;
 	zbx_timespec_t			ts_end = *ts;
+	zbx_vc_aggregate_t		aggregate;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -1577,6 +1588,14 @@ static int	evaluate_SUM(zbx_variant_t *value, DC_ITEM *item, const char *paramet
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
+	if (ZBX_VALUE_SECONDS == arg1_type &&
+			SUCCEED == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, &ts_end, &aggregate))
+	{
+		zbx_history_value2variant(&aggregate.sum, item->value_type, value);
+		ret = SUCCEED;
+		goto out;
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -1630,6 +1649,7 @@ static int	evaluate_AVG(zbx_variant_t *value, DC_ITEM *item, const char *paramet
 	zbx_value_type_t		arg1_type;
 	zbx_vector_history_record_t	values;
 	zbx_timespec_t			ts_end = *ts;
+	zbx_vc_aggregate_t		aggregate;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -1668,6 +1688,20 @@ static int	evaluate_AVG(zbx_variant_t *value, DC_ITEM *item, const char *paramet
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
+	if (ZBX_VALUE_SECONDS == arg1_type &&
+			SUCCEED == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, &ts_end, &aggregate))
+	{
+		if (0 < aggregate.count)
+		{
+			zbx_variant_set_dbl(value, aggregate.avg);
+			ret = SUCCEED;
+		}
+		else
+			*error = zbx_strdup(*error, "not enough data");
+
+		goto out;
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -1774,6 +1808,7 @@ static int	evaluate_MIN_or_MAX(zbx_variant_t *value, const DC_ITEM *item, const
 	zbx_value_type_t		arg1_type;
 	zbx_vector_history_record_t	values;
 	zbx_timespec_t			ts_end = *ts;
+	zbx_vc_aggregate_t		aggregate;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
 
@@ -1812,6 +1847,21 @@ static int	evaluate_MIN_or_MAX(zbx_variant_t *value, const DC_ITEM *item, const
 			THIS_SHOULD_NEVER_HAPPEN;
 	}
 
+	if (ZBX_VALUE_SECONDS == arg1_type &&
+			SUCCEED == zbx_vc_get_aggregate(item->itemid, item->value_type, seconds, &ts_end, &aggregate))
+	{
+		if (0 < aggregate.count)
+		{
+			zbx_history_value2variant(EVALUATE_MIN == min_or_max ? &aggregate.min : &aggregate.max,
+					item->value_type, value);
+			ret = SUCCEED;
+		}
+		else
+			*error = zbx_strdup(*error, "not enough data");
+
+		goto out;
+	}
+
 	if (FAIL == zbx_vc_get_values(item->itemid, item->value_type, &values, seconds, nvalues, &ts_end))
 	{
 		*error = zbx_strdup(*error, "cannot get values from value cache");
@@ -3871,6 +3921,56 @@ int	evaluate_function2(zbx_variant_t *value, DC_ITEM *item, const char *function
 #undef EVALUATE_MIN
 #undef EVALUATE_MAX
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get the time period of item values used by function               *
+ *                                                                            *
+ * Parameters: function  - [IN] the function name                             *
+ *             parameter - [IN] the function parameters                       *
+ *             ts        - [IN] the function evaluation time                  *
+ *             seconds   - [OUT] the period length in seconds                 *
+ *             ts_end    - [OUT] the period end timestamp                     *
+ *                                                                            *
+ * Return value: SUCCEED - the function uses item values from time period     *
+ *               FAIL - otherwise                                             *
+ *                                                                            *
+ * Comments: Used to retrieve values of multiple functions from value cache   *
+ *           before evaluating them.                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_get_function_history_period(const char *function, const char *parameter, const zbx_timespec_t *ts,
+		int *seconds, zbx_timespec_t *ts_end)
+{
+	const char		*functions[] = {"min", "max", "avg", "sum", "percentile", "count", "countunique",
+				"find", "forecast", "timeleft", "first", "kurtosis", "mad", "skewness", "stddevpop",
+				"stddevsamp", "sumofsquares", "varpop", "varsamp", "monoinc", "monodec", "rate",
+				"changecount", NULL};
+	const char		**ptr;
+	int			arg1, time_shift;
+	zbx_value_type_t	arg1_type;
+
+	for (ptr = functions; NULL != *ptr; ptr++)
+	{
+		if (0 == strcmp(*ptr, function))
+			break;
+	}
+
+	if (NULL == *ptr)
+		return FAIL;
+
+	if (SUCCEED != get_function_parameter_hist_range(ts->sec, parameter, 1, &arg1, &arg1_type, &time_shift) ||
+			ZBX_VALUE_SECONDS != arg1_type)
+	{
+		return FAIL;
+	}
+
+	*seconds = arg1;
+	*ts_end = *ts;
+	ts_end->sec -= time_shift;
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: check if the specified function is a trigger function             *
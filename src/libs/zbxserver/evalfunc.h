@@ -28,6 +28,8 @@ int	zbx_evaluate_RATE(zbx_variant_t *value, DC_ITEM *item, const char *parameter
 		char **error);
 int	evaluate_function2(zbx_variant_t *value, DC_ITEM *item, const char *function, const char *parameter,
 		const zbx_timespec_t *ts, char **error);
+int	zbx_get_function_history_period(const char *function, const char *parameter, const zbx_timespec_t *ts,
+		int *seconds, zbx_timespec_t *ts_end);
 
 int	zbx_is_trigger_function(const char *name, size_t len);
 
@@ -5029,6 +5029,79 @@ static void	zbx_populate_function_items(const zbx_vector_uint64_t *functionids,
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() ifuncs_num:%d", __func__, ifuncs->num_data);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: retrieve item values required by history functions into value    *
+ *          cache with batched history queries                                *
+ *                                                                            *
+ * Parameters: funcs            - [IN] the functions to evaluate              *
+ *             history_itemids  - [IN] the items retrieved by history syncer  *
+ *             history_items    - [IN] the history syncer items               *
+ *             history_errcodes - [IN] the history syncer item errcodes       *
+ *             itemids          - [IN] the additionally retrieved items       *
+ *             items            - [IN] the additionally retrieved items       *
+ *             errcodes         - [IN] the additionally retrieved item        *
+ *                                     errcodes                               *
+ *                                                                            *
+ ******************************************************************************/
+static void	prefetch_function_values(zbx_hashset_t *funcs, const zbx_vector_uint64_t *history_itemids,
+		const DC_ITEM *history_items, const int *history_errcodes, const zbx_vector_uint64_t *itemids,
+		const DC_ITEM *items, const int *errcodes)
+{
+	zbx_func_t		*func;
+	zbx_hashset_iter_t	iter;
+	zbx_vector_vc_request_t	requests;
+	zbx_vc_request_t	request;
+	int			i, errcode;
+	const DC_ITEM		*item;
+
+	zbx_vector_vc_request_create(&requests);
+
+	zbx_hashset_iter_reset(funcs, &iter);
+	while (NULL != (func = (zbx_func_t *)zbx_hashset_iter_next(&iter)))
+	{
+		if (ZBX_FUNCTION_TYPE_HISTORY != func->type)
+			continue;
+
+		if (FAIL != (i = zbx_vector_uint64_bsearch(history_itemids, func->itemid,
+				ZBX_DEFAULT_UINT64_COMPARE_FUNC)))
+		{
+			item = history_items + i;
+			errcode = history_errcodes[i];
+		}
+		else
+		{
+			i = zbx_vector_uint64_bsearch(itemids, func->itemid, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+			item = items + i;
+			errcode = errcodes[i];
+		}
+
+		if (SUCCEED != errcode || ITEM_STATUS_ACTIVE != item->status || 0 == item->history ||
+				HOST_STATUS_MONITORED != item->host.status)
+		{
+			continue;
+		}
+
+		if (ITEM_VALUE_TYPE_FLOAT != item->value_type && ITEM_VALUE_TYPE_UINT64 != item->value_type)
+			continue;
+
+		if (SUCCEED != zbx_get_function_history_period(func->function, func->parameter, &func->timespec,
+				&request.seconds, &request.ts))
+		{
+			continue;
+		}
+
+		request.itemid = item->itemid;
+		request.value_type = item->value_type;
+		zbx_vector_vc_request_append(&requests, request);
+	}
+
+	if (1 < requests.values_num)
+		zbx_vc_prefetch_values(&requests);
+
+	zbx_vector_vc_request_destroy(&requests);
+}
+
 static void	zbx_evaluate_item_functions(zbx_hashset_t *funcs, const zbx_vector_uint64_t *history_itemids,
 		const DC_ITEM *history_items, const int *history_errcodes)
 {
@@ -5063,6 +5136,8 @@ static void	zbx_evaluate_item_functions(zbx_hashset_t *funcs, const zbx_vector_u
 				ZBX_ITEM_GET_SYNC);
 	}
 
+	prefetch_function_values(funcs, history_itemids, history_items, history_errcodes, &itemids, items, errcodes);
+
 	zbx_hashset_iter_reset(funcs, &iter);
 	while (NULL != (func = (zbx_func_t *)zbx_hashset_iter_next(&iter)))
 	{
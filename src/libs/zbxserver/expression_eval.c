@@ -1525,6 +1525,52 @@ err:
  *               FAIL    - otherwise                                          *
  *                                                                            *
  ******************************************************************************/
+/******************************************************************************
+ *                                                                            *
+ * Purpose: retrieve values of many item query into value cache with batched  *
+ *          history queries                                                   *
+ *                                                                            *
+ * Parameters: eval    - [IN] the evaluation data                             *
+ *             data    - [IN] the many item query data                        *
+ *             seconds - [IN] the time period                                 *
+ *             ts      - [IN] the function execution time                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	expression_prefetch_many(zbx_expression_eval_t *eval, const zbx_expression_query_many_t *data,
+		int seconds, const zbx_timespec_t *ts)
+{
+	zbx_vector_vc_request_t	requests;
+	zbx_vc_request_t	request;
+	int			i;
+
+	zbx_vector_vc_request_create(&requests);
+
+	for (i = 0; i < data->itemids.values_num; i++)
+	{
+		DC_ITEM	*dcitem;
+
+		if (NULL == (dcitem = get_dcitem(&eval->dcitem_refs, data->itemids.values[i])))
+			continue;
+
+		if (ITEM_STATUS_ACTIVE != dcitem->status || HOST_STATUS_MONITORED != dcitem->host.status)
+			continue;
+
+		if (ITEM_VALUE_TYPE_FLOAT != dcitem->value_type && ITEM_VALUE_TYPE_UINT64 != dcitem->value_type)
+			continue;
+
+		request.itemid = dcitem->itemid;
+		request.value_type = dcitem->value_type;
+		request.seconds = seconds;
+		request.ts = *ts;
+		zbx_vector_vc_request_append(&requests, request);
+	}
+
+	if (1 < requests.values_num)
+		zbx_vc_prefetch_values(&requests);
+
+	zbx_vector_vc_request_destroy(&requests);
+}
+
 static int	expression_eval_many(zbx_expression_eval_t *eval, zbx_expression_query_t *query, const char *name,
 		size_t len, int args_num, const zbx_variant_t *args, const zbx_timespec_t *ts, zbx_variant_t *value,
 		char **error)
@@ -1607,6 +1653,9 @@ static int	expression_eval_many(zbx_expression_eval_t *eval, zbx_expression_quer
 			goto out;
 	}
 
+	if (0 != seconds)
+		expression_prefetch_many(eval, data, seconds, ts);
+
 	results_vector = (zbx_vector_dbl_t *)zbx_malloc(NULL, sizeof(zbx_vector_dbl_t));
 	zbx_vector_dbl_create(results_vector);
 
@@ -22,6 +22,19 @@
 #include "common.h"
 #include "log.h"
 
+extern int	CONFIG_SHMEM_HUGE_PAGES;
+extern char	*CONFIG_SHMEM_NUMA_POLICY;
+
+#if defined(__linux__) && defined(SYS_mbind)
+#	define SHMEM_NUMA_SUPPORTED
+/* memory policy modes as defined in linux/mempolicy.h */
+#	define SHMEM_MPOL_BIND		2
+#	define SHMEM_MPOL_INTERLEAVE	3
+#endif
+
+/* number of pages sampled to estimate memory placement across NUMA nodes */
+#define SHMEM_NUMA_SAMPLES		256
+
 /******************************************************************************
  *                                                                            *
  *                     Some information on memory layout                      *
@@ -524,13 +537,477 @@ static void	__mem_free(zbx_shmem_info_t *info, void *ptr)
 	}
 }
 
+/* shared memory segment helpers */
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets default huge page size                                       *
+ *                                                                            *
+ * Return value: the huge page size in bytes or 0 if it cannot be determined  *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_uint64_t	shmem_get_huge_page_size(void)
+{
+	static zbx_uint64_t	huge_page_size;
+	static int		initialized;
+	FILE			*f;
+	char			line[MAX_STRING_LEN];
+	zbx_uint64_t		size;
+
+	if (0 != initialized)
+		return huge_page_size;
+
+	initialized = 1;
+
+	if (NULL == (f = fopen("/proc/meminfo", "r")))
+		return 0;
+
+	while (NULL != fgets(line, sizeof(line), f))
+	{
+		if (1 == sscanf(line, "Hugepagesize: " ZBX_FS_UI64 " kB", &size))
+		{
+			huge_page_size = size * ZBX_KIBIBYTE;
+			break;
+		}
+	}
+
+	zbx_fclose(f);
+
+	return huge_page_size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets normal page size                                             *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_uint64_t	shmem_get_page_size(void)
+{
+	long	page_size;
+
+	if (0 >= (page_size = sysconf(_SC_PAGESIZE)))
+		return 4 * ZBX_KIBIBYTE;
+
+	return (zbx_uint64_t)page_size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: creates private shared memory segment and attaches it             *
+ *                                                                            *
+ * Parameters: size      - [IN] the segment size                              *
+ *             addr      - [IN] the address to attach segment at, NULL to let *
+ *                              system choose it                              *
+ *             descr     - [IN] the shared memory description                 *
+ *             shm_id    - [OUT] the shared memory identifier                 *
+ *             base      - [OUT] the attached segment address                 *
+ *             page_size - [OUT] the size of pages backing the segment        *
+ *             error     - [OUT] the error message                            *
+ *                                                                            *
+ * Return value: SUCCEED - the segment was created and attached               *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: When huge pages are enabled, but the segment cannot be backed    *
+ *           by them (no huge pages reserved, missing permissions or the      *
+ *           address is not aligned to huge page size) a warning is logged    *
+ *           and normal pages are used instead.                               *
+ *                                                                            *
+ *           The segment is marked for destruction after the last detach.     *
+ *                                                                            *
+ ******************************************************************************/
+static int	shmem_attach(zbx_uint64_t size, void *addr, const char *descr, int *shm_id, void **base,
+		zbx_uint64_t *page_size, char **error)
+{
+	if (0 != CONFIG_SHMEM_HUGE_PAGES)
+	{
+#ifdef SHM_HUGETLB
+		zbx_uint64_t	huge_page_size;
+
+		if (0 == (huge_page_size = shmem_get_huge_page_size()))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot allocate huge pages for %s: unknown huge page size,"
+					" falling back to normal pages", descr);
+		}
+		else if (-1 == (*shm_id = shmget(IPC_PRIVATE, (size + huge_page_size - 1) / huge_page_size *
+				huge_page_size, SHM_HUGETLB | 0600)))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot allocate huge pages for %s: %s, falling back to normal"
+					" pages", descr, zbx_strerror(errno));
+		}
+		else if ((void *)(-1) == (*base = shmat(*shm_id, addr, 0)))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot attach huge pages for %s: %s, falling back to normal"
+					" pages", descr, zbx_strerror(errno));
+			(void)shmctl(*shm_id, IPC_RMID, NULL);
+		}
+		else
+		{
+			*page_size = huge_page_size;
+			goto out;
+		}
+#else
+		zabbix_log(LOG_LEVEL_WARNING, "cannot allocate huge pages for %s: not supported on this platform,"
+				" falling back to normal pages", descr);
+#endif
+	}
+
+	if (-1 == (*shm_id = shmget(IPC_PRIVATE, (size_t)size, 0600)))
+	{
+		*error = zbx_dsprintf(*error, "cannot get private shared memory of size " ZBX_FS_UI64 " for %s: %s",
+				size, descr, zbx_strerror(errno));
+		return FAIL;
+	}
+
+	if ((void *)(-1) == (*base = shmat(*shm_id, addr, 0)))
+	{
+		if (NULL == addr)
+		{
+			*error = zbx_dsprintf(*error, "cannot attach shared memory for %s: %s", descr,
+					zbx_strerror(errno));
+		}
+		else
+		{
+			*error = zbx_dsprintf(*error, "cannot attach shared memory for %s at address %p: %s", descr,
+					addr, zbx_strerror(errno));
+		}
+
+		(void)shmctl(*shm_id, IPC_RMID, NULL);
+		return FAIL;
+	}
+
+	*page_size = shmem_get_page_size();
+out:
+	if (-1 == shmctl(*shm_id, IPC_RMID, NULL))
+		zbx_error("cannot mark shared memory %d for destruction: %s", *shm_id, zbx_strerror(errno));
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: parses NUMA node number                                           *
+ *                                                                            *
+ * Return value: pointer to the next character after node number or NULL if   *
+ *               the node number is not valid                                 *
+ *                                                                            *
+ ******************************************************************************/
+static const char	*shmem_parse_numa_node(const char *ptr, unsigned int *node)
+{
+	if (0 == isdigit((unsigned char)*ptr))
+		return NULL;
+
+	for (*node = 0; 0 != isdigit((unsigned char)*ptr); ptr++)
+	{
+		if (ZBX_SHMEM_NUMA_MAX_NODES <= (*node = *node * 10 + (unsigned int)(*ptr - '0')))
+			return NULL;
+	}
+
+	return ptr;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: parses NUMA node list in format <node>[-<node>][,...]             *
+ *                                                                            *
+ * Parameters: str   - [IN] the node list                                     *
+ *             nodes - [OUT] the node bitmask                                 *
+ *                                                                            *
+ * Return value: SUCCEED - the node list was parsed                           *
+ *               FAIL    - invalid node list or node number exceeds           *
+ *                         ZBX_SHMEM_NUMA_MAX_NODES                           *
+ *                                                                            *
+ ******************************************************************************/
+static int	shmem_parse_numa_nodes(const char *str, zbx_uint64_t *nodes)
+{
+	const char	*ptr = str;
+	unsigned int	first, last;
+
+	*nodes = 0;
+
+	for (;;)
+	{
+		if (NULL == (ptr = shmem_parse_numa_node(ptr, &first)))
+			return FAIL;
+
+		last = first;
+
+		if ('-' == *ptr && (NULL == (ptr = shmem_parse_numa_node(ptr + 1, &last)) || first > last))
+			return FAIL;
+
+		for (; first <= last; first++)
+			*nodes |= __UINT64_C(1) << first;
+
+		if ('\0' == *ptr)
+			return SUCCEED;
+
+		if (',' != *ptr++)
+			return FAIL;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets bitmask of online NUMA nodes                                 *
+ *                                                                            *
+ ******************************************************************************/
+static int	shmem_get_online_numa_nodes(zbx_uint64_t *nodes)
+{
+	FILE	*f;
+	char	line[MAX_STRING_LEN];
+	int	ret = FAIL;
+
+	if (NULL == (f = fopen("/sys/devices/system/node/online", "r")))
+		return FAIL;
+
+	if (NULL != fgets(line, sizeof(line), f))
+	{
+		zbx_rtrim(line, ZBX_WHITESPACE);
+		ret = shmem_parse_numa_nodes(line, nodes);
+	}
+
+	zbx_fclose(f);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: parses single NUMA policy in format <mode>[:<nodes>]              *
+ *                                                                            *
+ ******************************************************************************/
+static int	shmem_parse_numa_policy(const char *str, unsigned char *policy, zbx_uint64_t *nodes)
+{
+	const char	*delim;
+	size_t		len;
+
+	*nodes = 0;
+
+	len = (NULL == (delim = strchr(str, ':')) ? strlen(str) : (size_t)(delim - str));
+
+	if (ZBX_CONST_STRLEN("default") == len && 0 == strncmp(str, "default", len))
+	{
+		*policy = ZBX_SHMEM_NUMA_DEFAULT;
+		return NULL == delim ? SUCCEED : FAIL;
+	}
+
+	if (ZBX_CONST_STRLEN("interleave") == len && 0 == strncmp(str, "interleave", len))
+		*policy = ZBX_SHMEM_NUMA_INTERLEAVE;
+	else if (ZBX_CONST_STRLEN("bind") == len && 0 == strncmp(str, "bind", len))
+		*policy = ZBX_SHMEM_NUMA_BIND;
+	else
+		return FAIL;
+
+	/* interleave defaults to all online nodes while bind requires explicit node list */
+	if (NULL == delim)
+		return ZBX_SHMEM_NUMA_INTERLEAVE == *policy ? SUCCEED : FAIL;
+
+	return shmem_parse_numa_nodes(delim + 1, nodes);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets NUMA policy configured for the shared memory segment         *
+ *                                                                            *
+ * Parameters: param  - [IN] the configuration parameter defining segment     *
+ *                           size                                             *
+ *             policy - [OUT] the NUMA policy                                 *
+ *             nodes  - [OUT] the node bitmask, 0 for all online nodes        *
+ *             error  - [OUT] the error message                               *
+ *                                                                            *
+ * Return value: SUCCEED - the policy was found or not configured             *
+ *               FAIL    - invalid SharedMemoryNUMAPolicy parameter           *
+ *                                                                            *
+ * Comments: The SharedMemoryNUMAPolicy parameter is a ';' separated list of  *
+ *           <parameter>:<mode>[:<nodes>] entries, where parameter '*'        *
+ *           matches segments without their own entry.                        *
+ *                                                                            *
+ ******************************************************************************/
+static int	shmem_get_numa_policy(const char *param, unsigned char *policy, zbx_uint64_t *nodes, char **error)
+{
+	char		*buf, *entry, *next, *delim;
+	unsigned char	entry_policy;
+	zbx_uint64_t	entry_nodes;
+	int		ret = FAIL, found = 0;
+
+	*policy = ZBX_SHMEM_NUMA_DEFAULT;
+	*nodes = 0;
+
+	if (NULL == CONFIG_SHMEM_NUMA_POLICY)
+		return SUCCEED;
+
+	buf = zbx_strdup(NULL, CONFIG_SHMEM_NUMA_POLICY);
+
+	for (entry = buf; NULL != entry; entry = next)
+	{
+		if (NULL != (next = strchr(entry, ';')))
+			*next++ = '\0';
+
+		zbx_lrtrim(entry, ZBX_WHITESPACE);
+
+		if ('\0' == *entry)
+			continue;
+
+		if (NULL == (delim = strchr(entry, ':')) ||
+				SUCCEED != shmem_parse_numa_policy(delim + 1, &entry_policy, &entry_nodes))
+		{
+			*error = zbx_dsprintf(*error, "invalid SharedMemoryNUMAPolicy entry \"%s\"", entry);
+			goto out;
+		}
+
+		*delim = '\0';
+
+		if (0 == strcmp(entry, param))
+		{
+			found = 1;
+		}
+		else if (0 != found || 0 != strcmp(entry, "*"))
+			continue;
+
+		*policy = entry_policy;
+		*nodes = entry_nodes;
+	}
+
+	ret = SUCCEED;
+out:
+	zbx_free(buf);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: applies NUMA policy to the shared memory segment                  *
+ *                                                                            *
+ * Parameters: base   - [IN] the segment address                              *
+ *             size   - [IN] the segment size                                 *
+ *             descr  - [IN] the shared memory description                    *
+ *             policy - [IN/OUT] the NUMA policy, reset to default if the     *
+ *                               policy could not be applied                  *
+ *             nodes  - [IN/OUT] the node bitmask, 0 for all online nodes     *
+ *                               on input and the used nodes on output        *
+ *                                                                            *
+ * Comments: The policy must be applied before the segment pages are touched, *
+ *           failures are logged and the default policy is used then.         *
+ *                                                                            *
+ ******************************************************************************/
+static void	shmem_set_numa_policy(void *base, zbx_uint64_t size, const char *descr, unsigned char *policy,
+		zbx_uint64_t *nodes)
+{
+#ifdef SHMEM_NUMA_SUPPORTED
+	unsigned long	mask[ZBX_SHMEM_NUMA_MAX_NODES / (8 * sizeof(unsigned long))];
+	int		i, mode;
+
+	if (ZBX_SHMEM_NUMA_DEFAULT == *policy)
+		return;
+
+	if (0 == *nodes && SUCCEED != shmem_get_online_numa_nodes(nodes))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot set NUMA memory policy for %s: cannot get online nodes", descr);
+		goto fail;
+	}
+
+	memset(mask, 0, sizeof(mask));
+
+	for (i = 0; i < ZBX_SHMEM_NUMA_MAX_NODES; i++)
+	{
+		if (0 != (*nodes & (__UINT64_C(1) << i)))
+			mask[i / (8 * sizeof(unsigned long))] |= 1UL << (i % (8 * sizeof(unsigned long)));
+	}
+
+	mode = (ZBX_SHMEM_NUMA_INTERLEAVE == *policy ? SHMEM_MPOL_INTERLEAVE : SHMEM_MPOL_BIND);
+
+	/* the node count is passed increased by one to match kernel expectations */
+	if (0 != syscall(SYS_mbind, base, (unsigned long)size, mode, mask, (unsigned long)ZBX_SHMEM_NUMA_MAX_NODES + 1,
+			0U))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot set NUMA memory policy for %s: %s", descr, zbx_strerror(errno));
+		goto fail;
+	}
+
+	return;
+fail:
+#else
+	ZBX_UNUSED(base);
+	ZBX_UNUSED(size);
+
+	if (ZBX_SHMEM_NUMA_DEFAULT == *policy)
+		return;
+
+	zabbix_log(LOG_LEVEL_WARNING, "cannot set NUMA memory policy for %s: not supported on this platform", descr);
+#endif
+	*policy = ZBX_SHMEM_NUMA_DEFAULT;
+	*nodes = 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: samples placement of resident shared memory pages across NUMA     *
+ *          nodes                                                             *
+ *                                                                            *
+ * Parameters: info       - [IN] the shared memory                            *
+ *             numa_pages - [OUT] the number of sampled pages per node        *
+ *                                                                            *
+ ******************************************************************************/
+static void	shmem_get_numa_pages(const zbx_shmem_info_t *info, unsigned int *numa_pages)
+{
+#if defined(SHMEM_NUMA_SUPPORTED) && defined(SYS_move_pages)
+	void		*pages[SHMEM_NUMA_SAMPLES];
+	int		status[SHMEM_NUMA_SAMPLES], i;
+	zbx_uint64_t	pages_num, samples_num;
+#endif
+	memset(numa_pages, 0, sizeof(unsigned int) * ZBX_SHMEM_NUMA_MAX_NODES);
+
+#if defined(SHMEM_NUMA_SUPPORTED) && defined(SYS_move_pages)
+	if (0 == info->page_size)
+		return;
+
+	pages_num = (info->orig_size + info->page_size - 1) / info->page_size;
+	samples_num = MIN(pages_num, SHMEM_NUMA_SAMPLES);
+
+	for (i = 0; i < (int)samples_num; i++)
+		pages[i] = (char *)info->base + (zbx_uint64_t)i * pages_num / samples_num * info->page_size;
+
+	/* without target nodes move_pages() only reports the node of each page, not resident pages are skipped */
+	if (0 != syscall(SYS_move_pages, 0, (unsigned long)samples_num, pages, NULL, status, 0))
+		return;
+
+	for (i = 0; i < (int)samples_num; i++)
+	{
+		if (0 <= status[i] && ZBX_SHMEM_NUMA_MAX_NODES > status[i])
+			numa_pages[status[i]]++;
+	}
+#else
+	ZBX_UNUSED(info);
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns NUMA policy name                                          *
+ *                                                                            *
+ ******************************************************************************/
+const char	*zbx_shmem_numa_policy_string(unsigned char policy)
+{
+	switch (policy)
+	{
+		case ZBX_SHMEM_NUMA_INTERLEAVE:
+			return "interleave";
+		case ZBX_SHMEM_NUMA_BIND:
+			return "bind";
+		default:
+			return "default";
+	}
+}
+
 /* public memory interface */
 
 int	zbx_shmem_create(zbx_shmem_info_t **info, zbx_uint64_t size, const char *descr, const char *param,
 		int allow_oom, char **error)
 {
-	int	shm_id, index, ret = FAIL;
-	void	*base;
+	int		shm_id, index, ret = FAIL;
+	void		*base;
+	zbx_uint64_t	page_size, numa_nodes;
+	unsigned char	numa_policy;
 
 	descr = ZBX_NULL2STR(descr);
 	param = ZBX_NULL2STR(param);
@@ -553,21 +1030,14 @@ int	zbx_shmem_create(zbx_shmem_info_t **info, zbx_uint64_t size, const char *des
 		goto out;
 	}
 
-	if (-1 == (shm_id = shmget(IPC_PRIVATE, size, 0600)))
-	{
-		*error = zbx_dsprintf(*error, "cannot get private shared memory of size " ZBX_FS_SIZE_T " for %s: %s",
-				(zbx_fs_size_t)size, descr, zbx_strerror(errno));
+	if (SUCCEED != shmem_get_numa_policy(param, &numa_policy, &numa_nodes, error))
 		goto out;
-	}
 
-	if ((void *)(-1) == (base = shmat(shm_id, NULL, 0)))
-	{
-		*error = zbx_dsprintf(*error, "cannot attach shared memory for %s: %s", descr, zbx_strerror(errno));
+	if (SUCCEED != shmem_attach(size, NULL, descr, &shm_id, &base, &page_size, error))
 		goto out;
-	}
 
-	if (-1 == shmctl(shm_id, IPC_RMID, NULL))
-		zbx_error("cannot mark shared memory %d for destruction: %s", shm_id, zbx_strerror(errno));
+	/* memory policy must be set before the pages are touched to take effect */
+	shmem_set_numa_policy(base, size, descr, &numa_policy, &numa_nodes);
 
 	ret = SUCCEED;
 
@@ -577,6 +1047,9 @@ int	zbx_shmem_create(zbx_shmem_info_t **info, zbx_uint64_t size, const char *des
 	(*info)->base = base;
 	(*info)->shm_id = shm_id;
 	(*info)->orig_size = size;
+	(*info)->page_size = page_size;
+	(*info)->numa_policy = numa_policy;
+	(*info)->numa_nodes = numa_nodes;
 	size -= (char *)(*info + 1) - (char *)base;
 
 	base = (void *)(*info + 1);
@@ -614,10 +1087,10 @@ int	zbx_shmem_create(zbx_shmem_info_t **info, zbx_uint64_t size, const char *des
 	(*info)->used_size = 0;
 	(*info)->free_size = (*info)->total_size;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "valid user addresses: [%p, %p] total size: " ZBX_FS_SIZE_T,
-			(void *)((char *)(*info)->lo_bound + SHMEM_SIZE_FIELD),
-			(void *)((char *)(*info)->hi_bound - SHMEM_SIZE_FIELD),
-			(zbx_fs_size_t)(*info)->total_size);
+	zabbix_log(LOG_LEVEL_DEBUG, "valid user addresses: [%p, %p] total size: " ZBX_FS_SIZE_T " page size: "
+			ZBX_FS_UI64 " NUMA policy: %s", (void *)((char *)(*info)->lo_bound + SHMEM_SIZE_FIELD),
+			(void *)((char *)(*info)->hi_bound - SHMEM_SIZE_FIELD), (zbx_fs_size_t)(*info)->total_size,
+			page_size, zbx_shmem_numa_policy_string(numa_policy));
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 
@@ -759,6 +1232,11 @@ void	zbx_shmem_get_stats(const zbx_shmem_info_t *info, zbx_shmem_stats_t *stats)
 	stats->used_chunks = stats->overhead / (2 * SHMEM_SIZE_FIELD) + 1 - stats->free_chunks;
 	stats->free_size = info->free_size;
 	stats->used_size = info->used_size;
+	stats->page_size = info->page_size;
+	stats->numa_policy = info->numa_policy;
+	stats->numa_nodes = info->numa_nodes;
+
+	shmem_get_numa_pages(info, stats->numa_pages);
 }
 
 void	zbx_shmem_dump_stats(int level, zbx_shmem_info_t *info)
@@ -830,3 +1308,155 @@ zbx_uint64_t	zbx_shmem_required_chunk_size(zbx_uint64_t size)
 
 	return mem_proper_alloc_size(size) + SHMEM_SIZE_FIELD * 2;
 }
+
+static void	mem_write_image_range(const zbx_shmem_info_t *info, FILE *file, const char *start, const char *end)
+{
+	zbx_uint64_t	range[2];
+
+	if (start == end)
+		return;
+
+	range[0] = (zbx_uint64_t)(start - (const char *)info->base);
+	range[1] = (zbx_uint64_t)(end - start);
+
+	fwrite(range, sizeof(range), 1, file);
+	fwrite(start, (size_t)range[1], 1, file);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes shared memory image into file                              *
+ *                                                                            *
+ * Parameters: info - [IN] the shared memory                                  *
+ *             file - [IN] the output file                                    *
+ *                                                                            *
+ * Comments: The image starts with shared memory address and size followed    *
+ *           by offset, size and contents of the written memory ranges and    *
+ *           terminated by empty range. Only size fields and free list links  *
+ *           are written for free chunks, so the image size depends on the    *
+ *           used memory size rather than the shared memory size.             *
+ *                                                                            *
+ *           The write errors must be checked by the caller with ferror().    *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_shmem_write_image(const zbx_shmem_info_t *info, FILE *file)
+{
+	zbx_uint64_t	header[2], end[2] = {0, 0};
+	const char	*chunk, *start;
+
+	header[0] = (zbx_uint64_t)(uintptr_t)info->base;
+	header[1] = info->orig_size;
+	fwrite(header, sizeof(header), 1, file);
+
+	start = (const char *)info->base;
+
+	for (chunk = (const char *)info->lo_bound; chunk < (const char *)info->hi_bound;
+			chunk += CHUNK_SIZE(chunk) + 2 * SHMEM_SIZE_FIELD)
+	{
+		if (!FREE_CHUNK(chunk))
+			continue;
+
+		mem_write_image_range(info, file, start, chunk + SHMEM_SIZE_FIELD + 2 * ZBX_PTR_SIZE);
+		start = chunk + SHMEM_SIZE_FIELD + CHUNK_SIZE(chunk);
+	}
+
+	mem_write_image_range(info, file, start, (const char *)info->hi_bound);
+	fwrite(end, sizeof(end), 1, file);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: creates shared memory from image written by                       *
+ *          zbx_shmem_write_image()                                           *
+ *                                                                            *
+ * Parameters: info  - [OUT] the shared memory                                *
+ *             data  - [IN] the image data                                    *
+ *             size  - [IN] the image data size                               *
+ *             descr - [IN] the shared memory description                     *
+ *             param - [IN] the configuration parameter defining shared       *
+ *                          memory size                                       *
+ *             error - [OUT] the error message                                *
+ *                                                                            *
+ * Return value: SUCCEED - the shared memory was created                      *
+ *               FAIL    - the image is not valid or shared memory could not  *
+ *                         be attached at the address it was written from     *
+ *                                                                            *
+ * Comments: The shared memory is attached at the same address as the memory  *
+ *           the image was written from, so the pointers stored in it remain  *
+ *           valid. Other pointers (like function pointers) must be restored  *
+ *           by the caller.                                                   *
+ *                                                                            *
+ *           Huge pages and NUMA policy are applied according to the current  *
+ *           configuration rather than the one the image was written with.    *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_shmem_create_from_image(zbx_shmem_info_t **info, const void *data, size_t size, const char *descr,
+		const char *param, char **error)
+{
+	zbx_uint64_t	header[2], range[2], page_size, numa_nodes;
+	size_t		offset;
+	int		shm_id;
+	void		*base;
+	unsigned char	numa_policy;
+
+	if (size < sizeof(header))
+	{
+		*error = zbx_dsprintf(*error, "invalid %s image size", descr);
+		return FAIL;
+	}
+
+	memcpy(header, data, sizeof(header));
+	offset = sizeof(header);
+
+	if (!(SHMEM_MIN_SIZE <= header[1] && header[1] <= SHMEM_MAX_SIZE))
+	{
+		*error = zbx_dsprintf(*error, "invalid %s image memory size " ZBX_FS_UI64, descr, header[1]);
+		return FAIL;
+	}
+
+	if (SUCCEED != shmem_get_numa_policy(param, &numa_policy, &numa_nodes, error))
+		return FAIL;
+
+	if (SUCCEED != shmem_attach(header[1], (void *)(uintptr_t)header[0], descr, &shm_id, &base, &page_size,
+			error))
+	{
+		return FAIL;
+	}
+
+	shmem_set_numa_policy(base, header[1], descr, &numa_policy, &numa_nodes);
+
+	for (;;)
+	{
+		if (size - offset < sizeof(range))
+			goto fail;
+
+		memcpy(range, (const char *)data + offset, sizeof(range));
+		offset += sizeof(range);
+
+		if (0 == range[1])
+			break;
+
+		if (range[0] > header[1] || range[1] > header[1] - range[0] || range[1] > size - offset)
+			goto fail;
+
+		memcpy((char *)base + range[0], (const char *)data + offset, (size_t)range[1]);
+		offset += (size_t)range[1];
+	}
+
+	*info = (zbx_shmem_info_t *)ALIGN8(base);
+
+	if ((*info)->base != base || (*info)->orig_size != header[1])
+		goto fail;
+
+	(*info)->shm_id = shm_id;
+	(*info)->page_size = page_size;
+	(*info)->numa_policy = numa_policy;
+	(*info)->numa_nodes = numa_nodes;
+
+	return SUCCEED;
+fail:
+	(void)shmdt(base);
+	*error = zbx_dsprintf(*error, "invalid %s image", descr);
+
+	return FAIL;
+}
@@ -22,6 +22,55 @@
 #include "common.h"
 #include "log.h"
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get average values of baseline data periods                       *
+ *                                                                            *
+ * Parameters: itemid     - [IN] the item identifier                          *
+ *             table      - [IN] the trends table name                        *
+ *             periods    - [IN] the data periods in each season              *
+ *             season_num - [IN] the number of seasons                        *
+ *             skip       - [IN] how many data periods to skip                *
+ *             values     - [OUT] the average data period value in each       *
+ *                                season                                      *
+ *             index      - [OUT] the index of returned values                *
+ *             error      - [OUT] the error message                           *
+ *                                                                            *
+ * Return value: SUCCEED - data were retrieved successfully                   *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	baseline_get_period_values(zbx_uint64_t itemid, const char *table, zbx_trend_period_t *periods,
+		int season_num, int skip, zbx_vector_dbl_t *values, zbx_vector_uint64_t *index, char **error)
+{
+	int	i;
+
+	if (skip >= season_num)
+		return SUCCEED;
+
+	/* all seasons are evaluated at once to avoid database query per season */
+	zbx_trends_get_avg_multi(table, itemid, periods + skip, season_num - skip);
+
+	for (i = skip; i < season_num; i++)
+	{
+		if (ZBX_TREND_STATE_NORMAL != periods[i].state)
+		{
+			if (0 == i || ZBX_TREND_STATE_NODATA != periods[i].state)
+			{
+				*error = zbx_strdup(NULL, zbx_trends_error(periods[i].state));
+				return FAIL;
+			}
+		}
+		else
+		{
+			zbx_vector_dbl_append(values, periods[i].value);
+			zbx_vector_uint64_append(index, (zbx_uint64_t)(i - skip));
+		}
+	}
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: get baseline data for common period/season combinations           *
@@ -49,37 +98,18 @@ static int	baseline_get_common_data(zbx_uint64_t itemid, const char *table, time
 		int season_num, zbx_time_unit_t season_unit, int skip, zbx_vector_dbl_t *values,
 		zbx_vector_uint64_t *index, char **error)
 {
-	int			i, start, end;
-	double			value_dbl;
+	int			i, ret = FAIL;
 	struct tm		tm, tm_now;
+	zbx_trend_period_t	*periods;
+
+	periods = (zbx_trend_period_t *)zbx_malloc(NULL, sizeof(zbx_trend_period_t) * (size_t)season_num);
 
 	tm_now = *localtime(&now);
 
 	for (i = 0; i < season_num; i++)
 	{
-		if (FAIL == zbx_trends_parse_range(now, period, &start, &end, error))
-			return FAIL;
-
-		if (skip <= i)
-		{
-			zbx_trend_state_t	state;
-
-			state = zbx_trends_get_avg(table, itemid, start, end, &value_dbl);
-
-			if (ZBX_TREND_STATE_NORMAL != state)
-			{
-				if (0 == i || ZBX_TREND_STATE_NODATA != state)
-				{
-					*error = zbx_strdup(NULL, zbx_trends_error(state));
-					return FAIL;
-				}
-			}
-			else
-			{
-				zbx_vector_dbl_append(values, value_dbl);
-				zbx_vector_uint64_append(index, (zbx_uint64_t)(i - skip));
-			}
-		}
+		if (FAIL == zbx_trends_parse_range(now, period, &periods[i].start, &periods[i].end, error))
+			goto out;
 
 		tm = tm_now;
 		zbx_tm_sub(&tm, i + 1, season_unit);
@@ -87,11 +117,15 @@ static int	baseline_get_common_data(zbx_uint64_t itemid, const char *table, time
 		if (-1 == (now = mktime(&tm)))
 		{
 			*error = zbx_dsprintf(*error, "cannot convert season start time: %s", zbx_strerror(errno));
-			return FAIL;
+			goto out;
 		}
 	}
 
-	return SUCCEED;
+	ret = baseline_get_period_values(itemid, table, periods, season_num, skip, values, index, error);
+out:
+	zbx_free(periods);
+
+	return ret;
 }
 
 /******************************************************************************
@@ -119,12 +153,12 @@ static int	baseline_get_common_data(zbx_uint64_t itemid, const char *table, time
 static int	baseline_get_isoyear_data(zbx_uint64_t itemid, const char *table, time_t now, const char *period,
 		int season_num, int skip, zbx_vector_dbl_t *values, zbx_vector_uint64_t *index, char **error)
 {
-	int		i, start, end, period_num;
-	time_t		time_tmp;
-	double		value_dbl;
-	struct tm	tm_end, tm_start;
-	size_t		len;
-	zbx_time_unit_t	period_unit;
+	int			i, start, end, period_num, ret = FAIL;
+	time_t			time_tmp;
+	struct tm		tm_end, tm_start;
+	size_t			len;
+	zbx_time_unit_t		period_unit;
+	zbx_trend_period_t	*periods;
 
 	if (FAIL == zbx_tm_parse_period(period, &len, &period_num, &period_unit, error))
 		return FAIL;
@@ -132,38 +166,22 @@ static int	baseline_get_isoyear_data(zbx_uint64_t itemid, const char *table, tim
 	if (FAIL == zbx_trends_parse_range(now, period, &start, &end, error))
 		return FAIL;
 
+	periods = (zbx_trend_period_t *)zbx_malloc(NULL, sizeof(zbx_trend_period_t) * (size_t)season_num);
+
 	time_tmp = end;
 	tm_end = *localtime(&time_tmp);
 
 	for (i = 0; i < season_num; i++)
 	{
-		if (skip <= i)
-		{
-			zbx_trend_state_t	state;
-
-			state = zbx_trends_get_avg(table, itemid, start, end, &value_dbl);
-
-			if (ZBX_TREND_STATE_NORMAL != state)
-			{
-				if (0 == i || ZBX_TREND_STATE_NODATA != state)
-				{
-					*error = zbx_strdup(NULL, zbx_trends_error(state));
-					return FAIL;
-				}
-			}
-			else
-			{
-				zbx_vector_dbl_append(values, value_dbl);
-				zbx_vector_uint64_append(index, (zbx_uint64_t)(i - skip));
-			}
-		}
+		periods[i].start = start;
+		periods[i].end = end;
 
 		zbx_tm_sub(&tm_end, 1, ZBX_TIME_UNIT_ISOYEAR);
 
 		if (-1 == (end = (int)mktime(&tm_end)))
 		{
 			*error = zbx_dsprintf(*error, "cannot convert data period end time: %s", zbx_strerror(errno));
-			return FAIL;
+			goto out;
 		}
 
 		tm_start = tm_end;
@@ -174,11 +192,15 @@ static int	baseline_get_isoyear_data(zbx_uint64_t itemid, const char *table, tim
 		if (-1 == (start = (int)mktime(&tm_start)))
 		{
 			*error = zbx_dsprintf(*error, "cannot convert data period start time: %s", zbx_strerror(errno));
-			return FAIL;
+			goto out;
 		}
 	}
 
-	return SUCCEED;
+	ret = baseline_get_period_values(itemid, table, periods, season_num, skip, values, index, error);
+out:
+	zbx_free(periods);
+
+	return ret;
 }
 
 /******************************************************************************
@@ -314,6 +314,51 @@ static zbx_tfc_data_t	*tfc_index_add(zbx_tfc_data_t *data_local)
 	return data;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: store value and state in trend function cache                     *
+ *                                                                            *
+ * Comments: The cache must be locked.                                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	tfc_put_data(zbx_uint64_t itemid, int start, int end, zbx_trend_function_t function, double value,
+		zbx_trend_state_t state)
+{
+	zbx_tfc_data_t	*data, data_local, *root;
+
+	data_local.itemid = itemid;
+	data_local.start = 0;
+	data_local.end = 0;
+	data_local.function = ZBX_TREND_FUNCTION_UNKNOWN;
+
+	tfc_reserve_slot();
+
+	if (NULL == (root = (zbx_tfc_data_t *)zbx_hashset_search(&cache->index, &data_local)))
+	{
+		root = tfc_index_add(&data_local);
+		root->prev_value = tfc_data_slot_index(root);
+		root->next_value = root->prev_value;
+		cache->items_num++;
+		tfc_reserve_slot();
+	}
+
+	data_local.start = start;
+	data_local.end = end;
+	data_local.function = function;
+	data_local.state = ZBX_TREND_STATE_UNKNOWN;
+	data = tfc_index_add(&data_local);
+
+	if (ZBX_TREND_STATE_UNKNOWN == data->state)
+	{
+		/* new slot was allocated, link it */
+		tfc_lru_append(data);
+		tfc_value_append(root, data);
+	}
+
+	data->value = value;
+	data->state = state;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: return trend function name in readable format                     *
@@ -537,8 +582,6 @@ int	zbx_tfc_get_value(zbx_uint64_t itemid, int start, int end, zbx_trend_functio
 void	zbx_tfc_put_value(zbx_uint64_t itemid, int start, int end, zbx_trend_function_t function, double value,
 		zbx_trend_state_t state)
 {
-	zbx_tfc_data_t	*data, data_local, *root;
-
 	if (NULL == cache)
 		return;
 
@@ -565,39 +608,9 @@ void	zbx_tfc_put_value(zbx_uint64_t itemid, int start, int end, zbx_trend_functi
 				tfc_state_str(state));
 	}
 
-	data_local.itemid = itemid;
-	data_local.start = 0;
-	data_local.end = 0;
-	data_local.function = ZBX_TREND_FUNCTION_UNKNOWN;
-
 	LOCK_CACHE;
 
-	tfc_reserve_slot();
-
-	if (NULL == (root = (zbx_tfc_data_t *)zbx_hashset_search(&cache->index, &data_local)))
-	{
-		root = tfc_index_add(&data_local);
-		root->prev_value = tfc_data_slot_index(root);
-		root->next_value = root->prev_value;
-		cache->items_num++;
-		tfc_reserve_slot();
-	}
-
-	data_local.start = start;
-	data_local.end = end;
-	data_local.function = function;
-	data_local.state = ZBX_TREND_STATE_UNKNOWN;
-	data = tfc_index_add(&data_local);
-
-	if (ZBX_TREND_STATE_UNKNOWN == data->state)
-	{
-		/* new slot was allocated, link it */
-		tfc_lru_append(data);
-		tfc_value_append(root, data);
-	}
-
-	data->value = value;
-	data->state = state;
+	tfc_put_data(itemid, start, end, function, value, state);
 
 	UNLOCK_CACHE;
 
@@ -664,3 +677,273 @@ int	zbx_tfc_get_stats(zbx_tfc_stats_t *stats, char **error)
 
 	return SUCCEED;
 }
+
+/*
+ * Trend function cache snapshot
+ *
+ * On clean shutdown the cached function values can be written into a local snapshot file which
+ * is loaded back during next startup, so the trend functions over long periods do not have to be
+ * recalculated from database after restart. The snapshot is removed once loaded.
+ *
+ * The snapshot is stored in native byte order and structure layout (verified by header):
+ *
+ *   header | entry 1 | ... | entry N | end marker
+ *
+ * The entries are written in least recently used order, so when loaded into a smaller cache the
+ * least recently used entries are evicted first.
+ */
+
+#define ZBX_TFC_SNAPSHOT_MAGIC		0x7a627466
+#define ZBX_TFC_SNAPSHOT_VERSION	1
+
+typedef struct
+{
+	zbx_uint32_t	magic;
+	zbx_uint32_t	version;
+	zbx_uint32_t	entry_size;
+	int		clock;
+	zbx_uint32_t	entries_num;
+}
+zbx_tfc_snapshot_header_t;
+
+typedef struct
+{
+	zbx_uint64_t		itemid;
+	int			start;
+	int			end;
+	zbx_trend_function_t	function;
+	zbx_trend_state_t	state;
+	double			value;
+}
+zbx_tfc_snapshot_entry_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: writes trend function cache contents into snapshot file           *
+ *                                                                            *
+ * Parameters: path  - [IN] the snapshot file path                            *
+ *             error - [OUT] the error message                                *
+ *                                                                            *
+ * Return value: SUCCEED - the snapshot was written successfully              *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The snapshot is written into temporary file which is renamed to  *
+ *           the target path only after all data are written.                 *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_tfc_save_snapshot(const char *path, char **error)
+{
+	FILE				*file;
+	char				*tmp_path;
+	int				ret = FAIL;
+	zbx_uint32_t			index, end = ZBX_TFC_SNAPSHOT_MAGIC;
+	zbx_tfc_snapshot_header_t	header;
+	zbx_tfc_snapshot_entry_t	entry;
+
+	if (NULL == cache)
+		return SUCCEED;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() path:%s", __func__, path);
+
+	tmp_path = zbx_dsprintf(NULL, "%s.tmp", path);
+
+	if (NULL == (file = fopen(tmp_path, "wb")))
+	{
+		*error = zbx_dsprintf(*error, "cannot open file \"%s\": %s", tmp_path, zbx_strerror(errno));
+		goto out;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = ZBX_TFC_SNAPSHOT_MAGIC;
+	header.version = ZBX_TFC_SNAPSHOT_VERSION;
+	header.entry_size = sizeof(zbx_tfc_snapshot_entry_t);
+	header.clock = (int)time(NULL);
+
+	memset(&entry, 0, sizeof(entry));
+
+	LOCK_CACHE;
+
+	/* item roots are not linked in LRU list */
+	header.entries_num = (zbx_uint32_t)(cache->index.num_data - cache->items_num);
+	fwrite(&header, sizeof(header), 1, file);
+
+	for (index = cache->lru_head; UINT32_MAX != index; index = cache->slots[index].data.next)
+	{
+		const zbx_tfc_data_t	*data = &cache->slots[index].data;
+
+		entry.itemid = data->itemid;
+		entry.start = data->start;
+		entry.end = data->end;
+		entry.function = data->function;
+		entry.state = data->state;
+		entry.value = data->value;
+
+		fwrite(&entry, sizeof(entry), 1, file);
+	}
+
+	UNLOCK_CACHE;
+
+	fwrite(&end, sizeof(end), 1, file);
+
+	if (0 != ferror(file))
+	{
+		*error = zbx_dsprintf(*error, "cannot write file \"%s\": %s", tmp_path, zbx_strerror(errno));
+		fclose(file);
+		unlink(tmp_path);
+		goto out;
+	}
+
+	if (0 != fclose(file))
+	{
+		*error = zbx_dsprintf(*error, "cannot close file \"%s\": %s", tmp_path, zbx_strerror(errno));
+		unlink(tmp_path);
+		goto out;
+	}
+
+	if (0 != rename(tmp_path, path))
+	{
+		*error = zbx_dsprintf(*error, "cannot rename file \"%s\" to \"%s\": %s", tmp_path, path,
+				zbx_strerror(errno));
+		unlink(tmp_path);
+		goto out;
+	}
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "saved trend function cache snapshot with %u values", header.entries_num);
+
+	ret = SUCCEED;
+out:
+	zbx_free(tmp_path);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: loads trend function cache contents from snapshot file            *
+ *                                                                            *
+ * Parameters: path        - [IN] the snapshot file path                      *
+ *             validate_cb - [IN] the callback to check if snapshot written   *
+ *                                at the specified time can be used (optional)*
+ *             error       - [OUT] the error message                          *
+ *                                                                            *
+ * Return value: SUCCEED - the snapshot was loaded or there was no snapshot   *
+ *               FAIL    - the snapshot could not be used                     *
+ *                                                                            *
+ * Comments: While running, cached values are invalidated by                  *
+ *           zbx_tfc_invalidate_trends() when trends with clock within the    *
+ *           cached period are written. Trends written after the snapshot     *
+ *           can only start from the hour the snapshot was saved in, so       *
+ *           the values of periods ending at or after that hour are dropped.  *
+ *           The snapshot file is removed after it has been processed.        *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_tfc_load_snapshot(const char *path, zbx_tfc_snapshot_validate_func_t validate_cb, char **error)
+{
+	FILE				*file;
+	int				ret = FAIL, clock_min;
+	zbx_uint32_t			i, end, entries_num = 0;
+	zbx_stat_t			buf;
+	zbx_tfc_snapshot_header_t	header;
+	zbx_tfc_snapshot_entry_t	*entries = NULL;
+
+	if (NULL == cache)
+		return SUCCEED;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() path:%s", __func__, path);
+
+	if (NULL == (file = fopen(path, "rb")))
+	{
+		if (ENOENT == errno)
+		{
+			ret = SUCCEED;
+			goto clean;
+		}
+
+		*error = zbx_dsprintf(*error, "cannot open file \"%s\": %s", path, zbx_strerror(errno));
+		goto clean;
+	}
+
+	if (1 != fread(&header, sizeof(header), 1, file) || ZBX_TFC_SNAPSHOT_MAGIC != header.magic ||
+			ZBX_TFC_SNAPSHOT_VERSION != header.version ||
+			sizeof(zbx_tfc_snapshot_entry_t) != header.entry_size)
+	{
+		*error = zbx_dsprintf(*error, "file \"%s\" is not a compatible trend function cache snapshot", path);
+		goto out;
+	}
+
+	if (NULL != validate_cb && SUCCEED != validate_cb(header.clock))
+	{
+		*error = zbx_dsprintf(*error, "snapshot \"%s\" is outdated", path);
+		goto out;
+	}
+
+	if (0 != zbx_fstat(fileno(file), &buf))
+	{
+		*error = zbx_dsprintf(*error, "cannot obtain information for file \"%s\": %s", path,
+				zbx_strerror(errno));
+		goto out;
+	}
+
+	/* read and validate all entries before modifying cache */
+	if ((zbx_uint64_t)buf.st_size != sizeof(header) + sizeof(zbx_tfc_snapshot_entry_t) *
+			(zbx_uint64_t)header.entries_num + sizeof(end))
+	{
+		*error = zbx_dsprintf(*error, "file \"%s\" is corrupted", path);
+		goto out;
+	}
+
+	if (0 != header.entries_num)
+	{
+		entries = (zbx_tfc_snapshot_entry_t *)zbx_malloc(NULL, sizeof(zbx_tfc_snapshot_entry_t) *
+				header.entries_num);
+	}
+
+	if (header.entries_num != fread(entries, sizeof(zbx_tfc_snapshot_entry_t), header.entries_num, file) ||
+			1 != fread(&end, sizeof(end), 1, file) || ZBX_TFC_SNAPSHOT_MAGIC != end)
+	{
+		*error = zbx_dsprintf(*error, "file \"%s\" is corrupted", path);
+		goto out;
+	}
+
+	clock_min = header.clock - header.clock % SEC_PER_HOUR;
+
+	LOCK_CACHE;
+
+	for (i = 0; i < header.entries_num; i++)
+	{
+		zbx_tfc_snapshot_entry_t	*entry = &entries[i];
+
+		if (entry->end >= clock_min || entry->start > entry->end)
+			continue;
+
+		if (ZBX_TREND_FUNCTION_UNKNOWN == entry->function || ZBX_TREND_FUNCTION_SUM < entry->function ||
+				ZBX_TREND_STATE_UNKNOWN == entry->state || ZBX_TREND_STATE_COUNT <= entry->state)
+		{
+			continue;
+		}
+
+		tfc_put_data(entry->itemid, entry->start, entry->end, entry->function, entry->value, entry->state);
+		entries_num++;
+	}
+
+	UNLOCK_CACHE;
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "loaded %u of %u values from trend function cache snapshot", entries_num,
+			header.entries_num);
+
+	ret = SUCCEED;
+out:
+	fclose(file);
+
+	/* the snapshot is valid only for the first startup after it was written */
+	if (0 != unlink(path))
+		zabbix_log(LOG_LEVEL_WARNING, "cannot remove file \"%s\": %s", path, zbx_strerror(errno));
+clean:
+	zbx_free(entries);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
@@ -670,17 +670,125 @@ int	zbx_trends_eval_sum(const char *table, zbx_uint64_t itemid, int start, int e
 	return FAIL;
 }
 
-zbx_trend_state_t	zbx_trends_get_avg(const char *table, zbx_uint64_t itemid, int start, int end, double *value)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: evaluate avg function with trends data for multiple periods       *
+ *                                                                            *
+ * Parameters: table       - [IN] the trends table name                       *
+ *             itemid      - [IN] the itemid                                  *
+ *             periods     - [IN/OUT] the periods to evaluate                 *
+ *             periods_num - [IN] the number of periods                       *
+ *                                                                            *
+ * Comments: Trends of all periods are selected with a single query and       *
+ *           aggregated for each period in the same way as trends_eval_avg(). *
+ *                                                                            *
+ ******************************************************************************/
+static void	trends_eval_avg_multi(const char *table, zbx_uint64_t itemid, zbx_trend_period_t **periods,
+		int periods_num)
 {
-	zbx_trend_state_t	state;
+	DB_RESULT	result;
+	DB_ROW		row;
+	char		*sql = NULL;
+	size_t		sql_alloc = 0, sql_offset = 0;
+	const char	*separator = "";
+	double		*nums, avg, num;
+	int		i, clock;
 
-	if (FAIL == zbx_tfc_get_value(itemid, start, end, ZBX_TREND_FUNCTION_AVG, value, &state))
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "select clock,value_avg,num from %s where itemid="
+			ZBX_FS_UI64 " and (", table, itemid);
+
+	for (i = 0; i < periods_num; i++)
 	{
-		state = trends_eval_avg(table, itemid, start, end, value);
-		zbx_tfc_put_value(itemid, start, end, ZBX_TREND_FUNCTION_AVG, *value, state);
+		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "%s(clock>=%d and clock<=%d)", separator,
+				periods[i]->start, periods[i]->end);
+		separator = " or ";
+
+		periods[i]->state = ZBX_TREND_STATE_NODATA;
+		periods[i]->value = 0;
 	}
 
-	return state;
+	zbx_chrcpy_alloc(&sql, &sql_alloc, &sql_offset, ')');
+
+	nums = (double *)zbx_malloc(NULL, sizeof(double) * (size_t)periods_num);
+
+	result = DBselect("%s", sql);
+	zbx_free(sql);
+
+	while (NULL != (row = DBfetch(result)))
+	{
+		clock = atoi(row[0]);
+		avg = atof(row[1]);
+		num = atof(row[2]);
+
+		/* data periods can overlap when period is longer than season */
+		for (i = 0; i < periods_num; i++)
+		{
+			zbx_trend_period_t	*period = periods[i];
+
+			if (clock < period->start || clock > period->end)
+				continue;
+
+			if (ZBX_TREND_STATE_NORMAL != period->state)
+			{
+				period->value = avg;
+				period->state = ZBX_TREND_STATE_NORMAL;
+				nums[i] = num;
+			}
+			else
+			{
+				period->value = period->value / (nums[i] + num) * nums[i] + avg / (nums[i] + num) * num;
+				nums[i] += num;
+			}
+		}
+	}
+
+	DBfree_result(result);
+	zbx_free(nums);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: get average values of multiple periods                            *
+ *                                                                            *
+ * Parameters: table       - [IN] the trends table name                       *
+ *             itemid      - [IN] the itemid                                  *
+ *             periods     - [IN/OUT] the periods to evaluate                 *
+ *             periods_num - [IN] the number of periods                       *
+ *                                                                            *
+ * Comments: The values are taken from trend function cache, the periods not  *
+ *           found in cache are evaluated with a single database query and    *
+ *           cached separately.                                               *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_trends_get_avg_multi(const char *table, zbx_uint64_t itemid, zbx_trend_period_t *periods,
+		int periods_num)
+{
+	zbx_trend_period_t	**misses;
+	int			i, misses_num = 0;
+
+	misses = (zbx_trend_period_t **)zbx_malloc(NULL, sizeof(zbx_trend_period_t *) * (size_t)periods_num);
+
+	for (i = 0; i < periods_num; i++)
+	{
+		if (FAIL == zbx_tfc_get_value(itemid, periods[i].start, periods[i].end, ZBX_TREND_FUNCTION_AVG,
+				&periods[i].value, &periods[i].state))
+		{
+			misses[misses_num++] = &periods[i];
+		}
+	}
+
+	if (0 != misses_num)
+	{
+		trends_eval_avg_multi(table, itemid, misses, misses_num);
+
+		for (i = 0; i < misses_num; i++)
+		{
+			zbx_tfc_put_value(itemid, misses[i]->start, misses[i]->end, ZBX_TREND_FUNCTION_AVG,
+					misses[i]->value, misses[i]->state);
+		}
+	}
+
+	zbx_free(misses);
 }
 
 const char	*zbx_trends_error(zbx_trend_state_t state)
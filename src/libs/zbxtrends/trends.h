@@ -50,6 +50,17 @@ int	zbx_tfc_get_value(zbx_uint64_t itemid, int start, int end, zbx_trend_functio
 void	zbx_tfc_put_value(zbx_uint64_t itemid, int start, int end, zbx_trend_function_t function, double value,
 		zbx_trend_state_t state);
 const char	*zbx_trends_error(zbx_trend_state_t state);
-zbx_trend_state_t	zbx_trends_get_avg(const char *table, zbx_uint64_t itemid, int start, int end, double *value);
+
+typedef struct
+{
+	int			start;		/* the period start time (including) */
+	int			end;		/* the period end time (including) */
+	zbx_trend_state_t	state;		/* the evaluated value state */
+	double			value;		/* the evaluated value */
+}
+zbx_trend_period_t;
+
+void	zbx_trends_get_avg_multi(const char *table, zbx_uint64_t itemid, zbx_trend_period_t *periods,
+		int periods_num);
 
 #endif
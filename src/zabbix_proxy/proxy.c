@@ -38,6 +38,9 @@
 #include "housekeeper/housekeeper.h"
 #include "../zabbix_server/pinger/pinger.h"
 #include "../zabbix_server/poller/poller.h"
+#include "../zabbix_server/poller/agent_poller.h"
+#include "../zabbix_server/poller/snmp_poller.h"
+#include "../zabbix_server/poller/httpagent_poller.h"
 #include "../zabbix_server/trapper/trapper.h"
 #include "../zabbix_server/trapper/proxydata.h"
 #include "../zabbix_server/snmptrapper/snmptrapper.h"
@@ -186,6 +189,11 @@ int	CONFIG_AVAILMAN_FORKS		= 1;
 int	CONFIG_SERVICEMAN_FORKS		= 0;
 int	CONFIG_TRIGGERHOUSEKEEPER_FORKS	= 0;
 int	CONFIG_ODBCPOLLER_FORKS		= 1;
+int	CONFIG_AGENTPOLLER_FORKS	= 1;
+int	CONFIG_SNMPPOLLER_FORKS		= 0;
+int	CONFIG_HTTPAGENTPOLLER_FORKS	= 0;
+int	CONFIG_MAX_CONCURRENT_CHECKS	= 1000;
+int	CONFIG_MAX_CONCURRENT_HTTP_HOST_CHECKS	= 0;
 
 int	CONFIG_LISTEN_PORT		= ZBX_DEFAULT_SERVER_PORT;
 char	*CONFIG_LISTEN_IP		= NULL;
@@ -204,7 +212,11 @@ int	CONFIG_PROXYDATA_FREQUENCY	= 1;
 
 int	CONFIG_HISTSYNCER_FORKS		= 4;
 int	CONFIG_HISTSYNCER_FREQUENCY	= 1;
+int	CONFIG_HISTORY_WRITERS		= 0;
 int	CONFIG_CONFSYNCER_FORKS		= 1;
+int	CONFIG_CONFSYNCER_FULL_FREQUENCY = 0;
+int	CONFIG_CONFSYNCER_WORKERS	= 0;
+int	CONFIG_SCHEDULER_SMOOTHING_WINDOW = 0;
 
 int	CONFIG_VMWARE_FORKS		= 0;
 int	CONFIG_VMWARE_FREQUENCY		= 60;
@@ -214,8 +226,13 @@ int	CONFIG_VMWARE_TIMEOUT		= 10;
 zbx_uint64_t	CONFIG_CONF_CACHE_SIZE		= 8 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_HISTORY_CACHE_SIZE	= 16 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_HISTORY_INDEX_CACHE_SIZE	= 4 * ZBX_MEBIBYTE;
+int		CONFIG_HISTORY_CACHE_SHARDS	= 1;
 zbx_uint64_t	CONFIG_TRENDS_CACHE_SIZE	= 0;
+int		CONFIG_TRENDS_FLUSH_PERIOD	= 0;
 zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE		= 0;
+int		CONFIG_SHMEM_HUGE_PAGES		= 0;
+char		*CONFIG_SHMEM_NUMA_POLICY	= NULL;
+int		CONFIG_VALUE_CACHE_COMPRESSION	= 0;
 zbx_uint64_t	CONFIG_VMWARE_CACHE_SIZE	= 8 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_EXPORT_FILE_SIZE;
 
@@ -228,6 +245,8 @@ char	*CONFIG_EXTERNALSCRIPTS		= NULL;
 char	*CONFIG_TMPDIR			= NULL;
 char	*CONFIG_FPING_LOCATION		= NULL;
 char	*CONFIG_FPING6_LOCATION		= NULL;
+int	CONFIG_NATIVE_ICMP_PING		= 0;
+int	CONFIG_NATIVE_ICMP_PING_RATE	= 10000;
 char	*CONFIG_DBHOST			= NULL;
 char	*CONFIG_DBNAME			= NULL;
 char	*CONFIG_DBSCHEMA		= NULL;
@@ -441,6 +460,21 @@ int	get_process_info_by_thread(int local_server_num, unsigned char *local_proces
 		*local_process_type = ZBX_PROCESS_TYPE_ODBCPOLLER;
 		*local_process_num = local_server_num - server_count + CONFIG_ODBCPOLLER_FORKS;
 	}
+	else if (local_server_num <= (server_count += CONFIG_AGENTPOLLER_FORKS))
+	{
+		*local_process_type = ZBX_PROCESS_TYPE_AGENT_POLLER;
+		*local_process_num = local_server_num - server_count + CONFIG_AGENTPOLLER_FORKS;
+	}
+	else if (local_server_num <= (server_count += CONFIG_SNMPPOLLER_FORKS))
+	{
+		*local_process_type = ZBX_PROCESS_TYPE_SNMP_POLLER;
+		*local_process_num = local_server_num - server_count + CONFIG_SNMPPOLLER_FORKS;
+	}
+	else if (local_server_num <= (server_count += CONFIG_HTTPAGENTPOLLER_FORKS))
+	{
+		*local_process_type = ZBX_PROCESS_TYPE_HTTPAGENT_POLLER;
+		*local_process_num = local_server_num - server_count + CONFIG_HTTPAGENTPOLLER_FORKS;
+	}
 	else
 		return FAIL;
 
@@ -574,10 +608,11 @@ static void	zbx_validate_config(ZBX_TASK_EX *task)
 		err = 1;
 	}
 
-	if (0 == CONFIG_UNREACHABLE_POLLER_FORKS && 0 != CONFIG_POLLER_FORKS + CONFIG_JAVAPOLLER_FORKS)
+	if (0 == CONFIG_UNREACHABLE_POLLER_FORKS && 0 != CONFIG_POLLER_FORKS + CONFIG_JAVAPOLLER_FORKS +
+			CONFIG_AGENTPOLLER_FORKS + CONFIG_SNMPPOLLER_FORKS)
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "\"StartPollersUnreachable\" configuration parameter must not be 0"
-				" if regular or Java pollers are started");
+				" if regular, Java, agent or SNMP pollers are started");
 		err = 1;
 	}
 
@@ -661,6 +696,13 @@ static void	zbx_validate_config(ZBX_TASK_EX *task)
 #if !defined(HAVE_OPENIPMI)
 	err |= (FAIL == check_cfg_feature_int("StartIPMIPollers", CONFIG_IPMIPOLLER_FORKS, "IPMI support"));
 #endif
+#if !defined(HAVE_NETSNMP)
+	err |= (FAIL == check_cfg_feature_int("StartSNMPPollers", CONFIG_SNMPPOLLER_FORKS, "SNMP support"));
+#endif
+#if !defined(ZBX_HAVE_HTTPAGENT_POLLER)
+	err |= (FAIL == check_cfg_feature_int("StartHTTPAgentPollers", CONFIG_HTTPAGENTPOLLER_FORKS,
+			"cURL library 7.28.0 or newer"));
+#endif
 
 	err |= (FAIL == zbx_db_validate_config_features());
 
@@ -729,10 +771,18 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			1},
 		{"CacheSize",			&CONFIG_CONF_CACHE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(64) * ZBX_GIBIBYTE},
+		{"SharedMemoryHugePages",	&CONFIG_SHMEM_HUGE_PAGES,		TYPE_INT,
+			PARM_OPT,	0,			1},
+		{"SharedMemoryNUMAPolicy",	&CONFIG_SHMEM_NUMA_POLICY,		TYPE_STRING,
+			PARM_OPT,	0,			0},
+		{"SchedulerSmoothingWindow",	&CONFIG_SCHEDULER_SMOOTHING_WINDOW,	TYPE_INT,
+			PARM_OPT,	0,			SEC_PER_HOUR},
 		{"HistoryCacheSize",		&CONFIG_HISTORY_CACHE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
 		{"HistoryIndexCacheSize",	&CONFIG_HISTORY_INDEX_CACHE_SIZE,	TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
+		{"HistoryCacheShards",		&CONFIG_HISTORY_CACHE_SHARDS,		TYPE_INT,
+			PARM_OPT,	1,			ZBX_HC_SHARDS_MAX},
 		{"HousekeepingFrequency",	&CONFIG_HOUSEKEEPING_FREQUENCY,		TYPE_INT,
 			PARM_OPT,	0,			24},
 		{"ProxyLocalBuffer",		&CONFIG_PROXY_LOCAL_BUFFER,		TYPE_INT,
@@ -751,6 +801,10 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"Fping6Location",		&CONFIG_FPING6_LOCATION,		TYPE_STRING,
 			PARM_OPT,	0,			0},
+		{"NativeICMPPing",		&CONFIG_NATIVE_ICMP_PING,		TYPE_INT,
+			PARM_OPT,	0,			1},
+		{"NativeICMPPingRate",		&CONFIG_NATIVE_ICMP_PING_RATE,		TYPE_INT,
+			PARM_OPT,	0,			1000000},
 		{"Timeout",			&CONFIG_TIMEOUT,			TYPE_INT,
 			PARM_OPT,	1,			30},
 		{"TrapperTimeout",		&CONFIG_TRAPPER_TIMEOUT,		TYPE_INT,
@@ -893,6 +947,16 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			INT_MAX},
 		{"StartODBCPollers",		&CONFIG_ODBCPOLLER_FORKS,		TYPE_INT,
 			PARM_OPT,	0,			1000},
+		{"StartAgentPollers",		&CONFIG_AGENTPOLLER_FORKS,		TYPE_INT,
+			PARM_OPT,	0,			1000},
+		{"StartSNMPPollers",		&CONFIG_SNMPPOLLER_FORKS,		TYPE_INT,
+			PARM_OPT,	0,			1000},
+		{"StartHTTPAgentPollers",	&CONFIG_HTTPAGENTPOLLER_FORKS,		TYPE_INT,
+			PARM_OPT,	0,			1000},
+		{"MaxConcurrentChecksPerPoller",	&CONFIG_MAX_CONCURRENT_CHECKS,	TYPE_INT,
+			PARM_OPT,	1,			100000},
+		{"MaxConcurrentHTTPChecksPerHost",	&CONFIG_MAX_CONCURRENT_HTTP_HOST_CHECKS,	TYPE_INT,
+			PARM_OPT,	0,			1000},
 		{NULL}
 	};
 
@@ -1349,7 +1413,8 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 			+ CONFIG_JAVAPOLLER_FORKS + CONFIG_SNMPTRAPPER_FORKS + CONFIG_SELFMON_FORKS
 			+ CONFIG_VMWARE_FORKS + CONFIG_IPMIMANAGER_FORKS + CONFIG_TASKMANAGER_FORKS
 			+ CONFIG_PREPROCMAN_FORKS + CONFIG_PREPROCESSOR_FORKS + CONFIG_AVAILMAN_FORKS
-			+ CONFIG_ODBCPOLLER_FORKS;
+			+ CONFIG_ODBCPOLLER_FORKS + CONFIG_AGENTPOLLER_FORKS + CONFIG_SNMPPOLLER_FORKS
+			+ CONFIG_HTTPAGENTPOLLER_FORKS;
 
 	threads = (pid_t *)zbx_calloc(threads, (size_t)threads_num, sizeof(pid_t));
 	threads_flags = (int *)zbx_calloc(threads_flags, (size_t)threads_num, sizeof(int));
@@ -1468,6 +1533,19 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 				thread_args.args = &poller_type;
 				zbx_thread_start(poller_thread, &thread_args, &threads[i]);
 				break;
+			case ZBX_PROCESS_TYPE_AGENT_POLLER:
+				zbx_thread_start(agent_poller_thread, &thread_args, &threads[i]);
+				break;
+#ifdef HAVE_NETSNMP
+			case ZBX_PROCESS_TYPE_SNMP_POLLER:
+				zbx_thread_start(snmp_poller_thread, &thread_args, &threads[i]);
+				break;
+#endif
+#ifdef ZBX_HAVE_HTTPAGENT_POLLER
+			case ZBX_PROCESS_TYPE_HTTPAGENT_POLLER:
+				zbx_thread_start(httpagent_poller_thread, &thread_args, &threads[i]);
+				break;
+#endif
 		}
 	}
 
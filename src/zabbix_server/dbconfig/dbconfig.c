@@ -129,6 +129,7 @@ ZBX_THREAD_ENTRY(dbconfig_thread, args)
 				get_process_type_string(process_type), sec, CONFIG_CONFSYNCER_FREQUENCY);
 	}
 stop:
+	DCsync_workers_stop();
 	zbx_setproctitle("%s #%d [terminated]", get_process_type_string(process_type), process_num);
 
 	while (1)
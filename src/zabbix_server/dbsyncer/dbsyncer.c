@@ -26,6 +26,7 @@
 #include "dbcache.h"
 #include "export.h"
 
+extern int				CONFIG_HISTSYNCER_FORKS;
 extern int				CONFIG_HISTSYNCER_FREQUENCY;
 extern ZBX_THREAD_LOCAL unsigned char	process_type;
 extern unsigned char			program_type;
@@ -89,6 +90,7 @@ ZBX_THREAD_ENTRY(dbsyncer_thread, args)
 	char		*stats = NULL;
 	const char	*process_name;
 	size_t		stats_alloc = 0, stats_offset = 0;
+	unsigned char	sync_stages = ZBX_SYNC_STAGE_ALL;
 
 	process_type = ((zbx_thread_args_t *)args)->process_type;
 	server_num = ((zbx_thread_args_t *)args)->server_num;
@@ -102,6 +104,13 @@ ZBX_THREAD_ENTRY(dbsyncer_thread, args)
 #define STAT_INTERVAL	5	/* if a process is busy and does not sleep then update status not faster than */
 				/* once in STAT_INTERVAL seconds */
 
+	/* in pipelined mode the last HistoryWriters syncers write history and the rest recalculate triggers */
+	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER) && 0 != CONFIG_HISTORY_WRITERS)
+	{
+		sync_stages = (process_num > CONFIG_HISTSYNCER_FORKS - CONFIG_HISTORY_WRITERS ?
+				ZBX_SYNC_STAGE_HISTORY : ZBX_SYNC_STAGE_TRIGGERS);
+	}
+
 	zbx_setproctitle("%s #%d [connecting to the database]", process_name, process_num);
 	last_stat_time = time(NULL);
 
@@ -139,7 +148,7 @@ ZBX_THREAD_ENTRY(dbsyncer_thread, args)
 
 		/* database APIs might not handle signals correctly and hang, block signals to avoid hanging */
 		zbx_block_signals(&orig_mask);
-		zbx_sync_history_cache(&values_num, &triggers_num, &more);
+		zbx_sync_history_cache(sync_stages, &values_num, &triggers_num, &more);
 
 		if (!ZBX_IS_RUNNING() && SUCCEED != zbx_db_trigger_queue_locked())
 			zbx_db_flush_timer_queue();
@@ -157,7 +166,7 @@ ZBX_THREAD_ENTRY(dbsyncer_thread, args)
 			stats_offset = 0;
 			zbx_snprintf_alloc(&stats, &stats_alloc, &stats_offset, "processed %d values", total_values_num);
 
-			if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+			if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER) && 0 != (sync_stages & ZBX_SYNC_STAGE_TRIGGERS))
 			{
 				zbx_snprintf_alloc(&stats, &stats_alloc, &stats_offset, ", %d triggers",
 						total_triggers_num);
@@ -88,10 +88,32 @@ static void	diag_valuecache_add_items(struct zbx_json *json, const char *field,
 #define ZBX_DIAG_VALUECACHE_VALUES		0x00000002
 #define ZBX_DIAG_VALUECACHE_MODE		0x00000004
 #define ZBX_DIAG_VALUECACHE_MEMORY		0x00000008
+#define ZBX_DIAG_VALUECACHE_POLICY		0x00000010
 
 #define ZBX_DIAG_VALUECACHE_SIMPLE	(ZBX_DIAG_VALUECACHE_ITEMS | \
 					ZBX_DIAG_VALUECACHE_VALUES | \
-					ZBX_DIAG_VALUECACHE_MODE)
+					ZBX_DIAG_VALUECACHE_MODE | \
+					ZBX_DIAG_VALUECACHE_POLICY)
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: add value cache replacement policy queue statistics to json data  *
+ *                                                                            *
+ * Parameters: json  - [IN/OUT] the json to update                            *
+ *             name  - [IN] the queue name                                    *
+ *             queue - [IN] the queue statistics                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	diag_valuecache_add_queue(struct zbx_json *json, const char *name, const zbx_vc_queue_stats_t *queue)
+{
+	zbx_json_addobject(json, name);
+	zbx_json_adduint64(json, "items", queue->items_num);
+	zbx_json_adduint64(json, "values", queue->values_num);
+	zbx_json_adduint64(json, "hits", queue->hits);
+	zbx_json_adduint64(json, "misses", queue->misses);
+	zbx_json_adduint64(json, "evictions", queue->evictions);
+	zbx_json_close(json);
+}
 
 /******************************************************************************
  *                                                                            *
@@ -117,6 +139,7 @@ static int	diag_add_valuecache_info(const struct zbx_json_parse *jp, struct zbx_
 					{"values", ZBX_DIAG_VALUECACHE_VALUES},
 					{"mode", ZBX_DIAG_VALUECACHE_MODE},
 					{"memory", ZBX_DIAG_VALUECACHE_MEMORY},
+					{"policy", ZBX_DIAG_VALUECACHE_POLICY},
 					{NULL, 0}
 					};
 
@@ -128,11 +151,12 @@ static int	diag_add_valuecache_info(const struct zbx_json_parse *jp, struct zbx_
 
 		if (0 != (fields & ZBX_DIAG_VALUECACHE_SIMPLE))
 		{
-			zbx_uint64_t	values_num, items_num;
-			int		mode;
+			zbx_uint64_t		values_num, items_num;
+			int			mode;
+			zbx_vc_policy_stats_t	policy;
 
 			time1 = zbx_time();
-			zbx_vc_get_diag_stats(&items_num, &values_num, &mode);
+			zbx_vc_get_diag_stats(&items_num, &values_num, &mode, &policy);
 			time2 = zbx_time();
 			time_total += time2 - time1;
 
@@ -142,6 +166,18 @@ static int	diag_add_valuecache_info(const struct zbx_json_parse *jp, struct zbx_
 				zbx_json_addint64(json, "values", values_num);
 			if (0 != (fields & ZBX_DIAG_VALUECACHE_MODE))
 				zbx_json_addint64(json, "mode", mode);
+
+			if (0 != (fields & ZBX_DIAG_VALUECACHE_POLICY))
+			{
+				zbx_json_addobject(json, "policy");
+				diag_valuecache_add_queue(json, "probation", &policy.queues[ZBX_VC_QUEUE_PROBATION]);
+				diag_valuecache_add_queue(json, "protected", &policy.queues[ZBX_VC_QUEUE_PROTECTED]);
+				zbx_json_addobject(json, "ghost");
+				zbx_json_adduint64(json, "items", policy.ghosts_num);
+				zbx_json_adduint64(json, "hits", policy.ghost_hits);
+				zbx_json_close(json);
+				zbx_json_close(json);
+			}
 		}
 
 		if (0 != (fields & ZBX_DIAG_VALUECACHE_MEMORY))
@@ -0,0 +1,928 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "agent_poller.h"
+
+#include "poller.h"
+#include "checks_agent.h"
+#include "zbxserver.h"
+#include "zbxnix.h"
+#include "zbxself.h"
+#include "preproc.h"
+#include "zbxrtc.h"
+#include "zbxcomms.h"
+#include "zbxcompress.h"
+#include "zbxcrypto.h"
+#include "log.h"
+#include "zbxavailability.h"
+
+extern ZBX_THREAD_LOCAL unsigned char	process_type;
+extern unsigned char			program_type;
+extern ZBX_THREAD_LOCAL int		server_num, process_num;
+
+#define AGENT_POLLER_STATE_CONNECT	0
+#define AGENT_POLLER_STATE_SEND		1
+#define AGENT_POLLER_STATE_RECV		2
+
+#define AGENT_POLLER_HEADER		"ZBXD"
+#define AGENT_POLLER_HEADER_LEN		ZBX_CONST_STRLEN(AGENT_POLLER_HEADER)
+/* header, protocol flags, data length and reserved fields */
+#define AGENT_POLLER_PACKET_HEADER_LEN	(AGENT_POLLER_HEADER_LEN + 1 + 2 * sizeof(zbx_uint32_t))
+
+#define AGENT_POLLER_FETCH_MAX		128	/* maximum number of items taken from queue at once */
+#define AGENT_POLLER_RESERVED_FDS	64	/* file descriptors left for logs, IPC and database */
+
+typedef struct
+{
+	DC_ITEM		item;
+	AGENT_RESULT	result;
+	int		errcode;
+	int		fd;
+	int		index;		/* index in the requests in progress array */
+	unsigned char	state;
+	unsigned char	protocol;
+	double		deadline;
+	char		*buffer;
+	size_t		buffer_alloc;
+	size_t		buffer_offset;
+	size_t		buffer_size;	/* number of bytes to send or expected to receive */
+	zbx_uint32_t	reserved;
+}
+zbx_agent_request_t;
+
+typedef struct
+{
+	zbx_agent_request_t	**requests;	/* requests in progress */
+	int			requests_num;
+	int			requests_max;
+	zbx_vector_ptr_t	completed;
+#ifdef HAVE_SYS_EPOLL_H
+	int			epoll_fd;
+	struct epoll_event	*events;
+#else
+	struct pollfd		*pollfds;
+	zbx_agent_request_t	**polled;
+#endif
+}
+zbx_agent_poller_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: limits the number of concurrent checks by the open files limit    *
+ *                                                                            *
+ * Parameters: requests_max - [IN] the configured number of concurrent checks *
+ *                                                                            *
+ * Return value: the number of concurrent checks the process can handle       *
+ *                                                                            *
+ ******************************************************************************/
+static int	agent_poller_get_requests_max(int requests_max)
+{
+	struct rlimit	rlim;
+	rlim_t		required = (rlim_t)requests_max + AGENT_POLLER_RESERVED_FDS;
+
+	if (0 != getrlimit(RLIMIT_NOFILE, &rlim))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot get open files limit: %s", zbx_strerror(errno));
+		return requests_max;
+	}
+
+	if (rlim.rlim_cur >= required)
+		return requests_max;
+
+	if (RLIM_INFINITY == rlim.rlim_max || rlim.rlim_max >= required)
+		rlim.rlim_cur = required;
+	else
+		rlim.rlim_cur = rlim.rlim_max;
+
+	if (0 != setrlimit(RLIMIT_NOFILE, &rlim) && 0 != getrlimit(RLIMIT_NOFILE, &rlim))
+		return requests_max;
+
+	if (rlim.rlim_cur < required)
+	{
+		int	limit;
+
+		limit = (AGENT_POLLER_RESERVED_FDS + 1 < rlim.rlim_cur ?
+				(int)(rlim.rlim_cur - AGENT_POLLER_RESERVED_FDS) : 1);
+
+		zabbix_log(LOG_LEVEL_WARNING, "open files limit " ZBX_FS_UI64 " is too low for %d concurrent checks,"
+				" agent poller will perform up to %d concurrent checks", (zbx_uint64_t)rlim.rlim_cur,
+				requests_max, limit);
+
+		return limit;
+	}
+
+	return requests_max;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: allocates agent poller request slots and event backend            *
+ *                                                                            *
+ ******************************************************************************/
+static void	agent_poller_init(zbx_agent_poller_t *poller, int requests_max)
+{
+	poller->requests_max = requests_max;
+	poller->requests_num = 0;
+	poller->requests = (zbx_agent_request_t **)zbx_malloc(NULL, sizeof(zbx_agent_request_t *) *
+			(size_t)requests_max);
+	zbx_vector_ptr_create(&poller->completed);
+#ifdef HAVE_SYS_EPOLL_H
+	if (-1 == (poller->epoll_fd = epoll_create(requests_max)))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot create epoll instance: %s", zbx_strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	if (-1 == fcntl(poller->epoll_fd, F_SETFD, FD_CLOEXEC))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot set close-on-exec flag on epoll instance: %s",
+				zbx_strerror(errno));
+	}
+
+	poller->events = (struct epoll_event *)zbx_malloc(NULL, sizeof(struct epoll_event) * (size_t)requests_max);
+#else
+	poller->pollfds = (struct pollfd *)zbx_malloc(NULL, sizeof(struct pollfd) * (size_t)requests_max);
+	poller->polled = (zbx_agent_request_t **)zbx_malloc(NULL, sizeof(zbx_agent_request_t *) *
+			(size_t)requests_max);
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: registers request socket for the events of its current state      *
+ *                                                                            *
+ ******************************************************************************/
+static int	agent_poller_watch(zbx_agent_poller_t *poller, zbx_agent_request_t *request, int op)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event	event;
+
+	event.events = (AGENT_POLLER_STATE_RECV == request->state ? EPOLLIN : EPOLLOUT);
+	event.data.ptr = request;
+
+	if (0 != epoll_ctl(poller->epoll_fd, op, request->fd, &event))
+	{
+		SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: cannot register"
+				" socket for [[%s]:%hu]: %s", request->item.interface.addr,
+				request->item.interface.port, zbx_strerror(errno)));
+		return FAIL;
+	}
+#else
+	/* poll descriptors are rebuilt from request states before every wait */
+	ZBX_UNUSED(poller);
+	ZBX_UNUSED(request);
+	ZBX_UNUSED(op);
+#endif
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: finishes request and moves it to the completed requests           *
+ *                                                                            *
+ ******************************************************************************/
+static void	agent_request_complete(zbx_agent_poller_t *poller, zbx_agent_request_t *request, int errcode)
+{
+	zbx_agent_request_t	*last;
+
+	if (-1 != request->fd)
+	{
+		/* closing the socket removes it from epoll set */
+		close(request->fd);
+		request->fd = -1;
+	}
+
+	zbx_free(request->buffer);
+	request->errcode = errcode;
+
+	if (-1 != request->index)
+	{
+		last = poller->requests[--poller->requests_num];
+		poller->requests[request->index] = last;
+		last->index = request->index;
+		request->index = -1;
+	}
+
+	zbx_vector_ptr_append(&poller->completed, request);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: starts non-blocking connection to the agent                       *
+ *                                                                            *
+ * Return value: SUCCEED - the connection is established or in progress       *
+ *               FAIL    - otherwise, error is set in request result          *
+ *                                                                            *
+ ******************************************************************************/
+static int	agent_request_connect(zbx_agent_request_t *request)
+{
+	struct addrinfo	hints, *ai = NULL, *ai_bind = NULL;
+	char		service[8];
+	const char	*addr = request->item.interface.addr;
+	unsigned short	port = request->item.interface.port;
+	int		ret = FAIL, flags;
+
+	zbx_snprintf(service, sizeof(service), "%hu", port);
+
+	memset(&hints, 0x00, sizeof(struct addrinfo));
+	hints.ai_family = PF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	if (0 != getaddrinfo(addr, service, &hints, &ai))
+	{
+		SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: cannot resolve [%s]",
+				addr));
+		goto out;
+	}
+
+	if (-1 == (request->fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)))
+	{
+		SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: cannot create"
+				" socket [[%s]:%hu]: %s", addr, port, zbx_strerror(errno)));
+		goto out;
+	}
+
+	if (-1 == fcntl(request->fd, F_SETFD, FD_CLOEXEC) || -1 == (flags = fcntl(request->fd, F_GETFL, 0)) ||
+			-1 == fcntl(request->fd, F_SETFL, flags | O_NONBLOCK))
+	{
+		SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: cannot set"
+				" non-blocking mode on socket [[%s]:%hu]: %s", addr, port, zbx_strerror(errno)));
+		goto out;
+	}
+
+	if (NULL != CONFIG_SOURCE_IP)
+	{
+		memset(&hints, 0x00, sizeof(struct addrinfo));
+		hints.ai_family = PF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_NUMERICHOST;
+
+		if (0 != getaddrinfo(CONFIG_SOURCE_IP, NULL, &hints, &ai_bind))
+		{
+			SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: invalid"
+					" source IP address [%s]", CONFIG_SOURCE_IP));
+			goto out;
+		}
+
+		if (0 != bind(request->fd, ai_bind->ai_addr, ai_bind->ai_addrlen))
+		{
+			SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: bind()"
+					" failed: %s", zbx_strerror(errno)));
+			goto out;
+		}
+	}
+
+	if (0 != connect(request->fd, ai->ai_addr, ai->ai_addrlen) && EINPROGRESS != errno)
+	{
+		SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: cannot connect to"
+				" [[%s]:%hu]: %s", addr, port, zbx_strerror(errno)));
+		goto out;
+	}
+
+	ret = SUCCEED;
+out:
+	if (NULL != ai)
+		freeaddrinfo(ai);
+
+	if (NULL != ai_bind)
+		freeaddrinfo(ai_bind);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: takes item from the queue and starts its check                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	agent_poller_start_request(zbx_agent_poller_t *poller, const DC_ITEM *item, double now)
+{
+	zbx_agent_request_t	*request;
+	zbx_uint32_t		len32_le;
+	size_t			key_len;
+
+	request = (zbx_agent_request_t *)zbx_malloc(NULL, sizeof(zbx_agent_request_t));
+	memcpy(&request->item, item, sizeof(DC_ITEM));
+
+	/* interface address points to the address fields of the copied item */
+	request->item.interface.addr = (1 == request->item.interface.useip ? request->item.interface.ip_orig :
+			request->item.interface.dns_orig);
+
+	request->fd = -1;
+	request->index = -1;
+	request->buffer = NULL;
+	request->buffer_alloc = 0;
+	request->buffer_offset = 0;
+	request->deadline = now + CONFIG_TIMEOUT;
+
+	zbx_prepare_items(&request->item, &request->errcode, 1, &request->result, MACRO_EXPAND_YES);
+
+	if (SUCCEED != request->errcode)
+	{
+		agent_request_complete(poller, request, request->errcode);
+		return;
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() host:'%s' addr:'%s' key:'%s' conn:'%s'", __func__,
+			request->item.host.host, request->item.interface.addr, request->item.key,
+			zbx_tcp_connection_type_name(request->item.host.tls_connect));
+
+	if (ZBX_TCP_SEC_UNENCRYPTED != request->item.host.tls_connect)
+	{
+		/* encrypted checks reach agent pollers only when regular pollers are disabled */
+		zbx_alarm_on(CONFIG_TIMEOUT);
+		request->errcode = get_value_agent(&request->item, &request->result);
+		zbx_alarm_off();
+
+		agent_request_complete(poller, request, request->errcode);
+		return;
+	}
+
+	if (SUCCEED != agent_request_connect(request))
+	{
+		agent_request_complete(poller, request, NETWORK_ERROR);
+		return;
+	}
+
+	/* prepare the request packet to be sent when connection is established */
+	key_len = strlen(request->item.key);
+	request->buffer_size = AGENT_POLLER_PACKET_HEADER_LEN + key_len;
+	request->buffer_alloc = request->buffer_size;
+	request->buffer = (char *)zbx_malloc(NULL, request->buffer_alloc);
+
+	memcpy(request->buffer, AGENT_POLLER_HEADER, AGENT_POLLER_HEADER_LEN);
+	request->buffer[AGENT_POLLER_HEADER_LEN] = ZBX_TCP_PROTOCOL;
+	len32_le = zbx_htole_uint32((zbx_uint32_t)key_len);
+	memcpy(request->buffer + AGENT_POLLER_HEADER_LEN + 1, &len32_le, sizeof(len32_le));
+	len32_le = 0;
+	memcpy(request->buffer + AGENT_POLLER_HEADER_LEN + 1 + sizeof(len32_le), &len32_le, sizeof(len32_le));
+	memcpy(request->buffer + AGENT_POLLER_PACKET_HEADER_LEN, request->item.key, key_len);
+
+	request->state = AGENT_POLLER_STATE_CONNECT;
+	request->index = poller->requests_num;
+	poller->requests[poller->requests_num++] = request;
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (SUCCEED != agent_poller_watch(poller, request, EPOLL_CTL_ADD))
+#else
+	if (SUCCEED != agent_poller_watch(poller, request, 0))
+#endif
+		agent_request_complete(poller, request, NETWORK_ERROR);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: parses agent response header and prepares buffer for the data     *
+ *                                                                            *
+ * Return value: SUCCEED - the header is valid                                *
+ *               FAIL    - otherwise, error is set in request result          *
+ *                                                                            *
+ ******************************************************************************/
+static int	agent_request_parse_header(zbx_agent_request_t *request)
+{
+	zbx_uint32_t	len32_le;
+
+	if (0 != strncmp(request->buffer, AGENT_POLLER_HEADER, AGENT_POLLER_HEADER_LEN))
+	{
+		SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: message from"
+				" [[%s]:%hu] is missing header", request->item.interface.addr,
+				request->item.interface.port));
+		return FAIL;
+	}
+
+	request->protocol = (unsigned char)request->buffer[AGENT_POLLER_HEADER_LEN];
+
+	if (0 == (request->protocol & ZBX_TCP_PROTOCOL) || request->protocol > (ZBX_TCP_PROTOCOL | ZBX_TCP_COMPRESS))
+	{
+		SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: message from"
+				" [[%s]:%hu] is using unsupported protocol version \"%d\"",
+				request->item.interface.addr, request->item.interface.port, (int)request->protocol));
+		return FAIL;
+	}
+
+	memcpy(&len32_le, request->buffer + AGENT_POLLER_HEADER_LEN + 1, sizeof(len32_le));
+	request->buffer_size = AGENT_POLLER_PACKET_HEADER_LEN + zbx_letoh_uint32(len32_le);
+
+	memcpy(&len32_le, request->buffer + AGENT_POLLER_HEADER_LEN + 1 + sizeof(len32_le), sizeof(len32_le));
+	request->reserved = zbx_letoh_uint32(len32_le);
+
+	if (ZBX_MAX_RECV_DATA_SIZE < request->buffer_size || ZBX_MAX_RECV_DATA_SIZE < request->reserved)
+	{
+		SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: message size from"
+				" [[%s]:%hu] exceeds the maximum size", request->item.interface.addr,
+				request->item.interface.port));
+		return FAIL;
+	}
+
+	if (request->buffer_alloc < request->buffer_size + 1)
+	{
+		request->buffer_alloc = request->buffer_size + 1;
+		request->buffer = (char *)zbx_realloc(request->buffer, request->buffer_alloc);
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: sets result from received agent response                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	agent_request_set_result(zbx_agent_request_t *request)
+{
+	char	*data;
+	size_t	data_len;
+
+	if (0 == request->buffer_offset)
+		return zbx_agent_handle_response("", 0, 0, request->item.interface.addr, &request->result);
+
+	if (0 == request->protocol)
+	{
+		SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: message from"
+				" [[%s]:%hu] is missing header", request->item.interface.addr,
+				request->item.interface.port));
+		return NETWORK_ERROR;
+	}
+
+	if (request->buffer_offset != request->buffer_size)
+	{
+		SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: message from"
+				" [[%s]:%hu] is shorter than expected", request->item.interface.addr,
+				request->item.interface.port));
+		return NETWORK_ERROR;
+	}
+
+	data = request->buffer + AGENT_POLLER_PACKET_HEADER_LEN;
+	data_len = request->buffer_size - AGENT_POLLER_PACKET_HEADER_LEN;
+	data[data_len] = '\0';
+
+	if (0 != (request->protocol & ZBX_TCP_COMPRESS))
+	{
+		char	*out;
+		size_t	out_size = request->reserved;
+		int	ret;
+
+		out = (char *)zbx_malloc(NULL, (size_t)request->reserved + 1);
+
+		if (FAIL == zbx_uncompress(data, data_len, out, &out_size) || out_size != request->reserved)
+		{
+			SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: cannot"
+					" uncompress data: %s", zbx_compress_strerror()));
+			zbx_free(out);
+			return NETWORK_ERROR;
+		}
+
+		out[out_size] = '\0';
+		ret = zbx_agent_handle_response(out, out_size, (ssize_t)request->buffer_offset,
+				request->item.interface.addr, &request->result);
+		zbx_free(out);
+
+		return ret;
+	}
+
+	return zbx_agent_handle_response(data, data_len, (ssize_t)request->buffer_offset,
+			request->item.interface.addr, &request->result);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: advances request on socket readiness                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	agent_request_process(zbx_agent_poller_t *poller, zbx_agent_request_t *request)
+{
+	ssize_t		n;
+	const char	*addr = request->item.interface.addr;
+	unsigned short	port = request->item.interface.port;
+
+	if (AGENT_POLLER_STATE_CONNECT == request->state)
+	{
+		int		error = 0;
+		socklen_t	len = sizeof(error);
+
+		if (0 != getsockopt(request->fd, SOL_SOCKET, SO_ERROR, &error, &len))
+			error = errno;
+
+		if (0 != error)
+		{
+			SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: cannot"
+					" connect to [[%s]:%hu]: %s", addr, port, zbx_strerror(error)));
+			agent_request_complete(poller, request, NETWORK_ERROR);
+			return;
+		}
+
+		zabbix_log(LOG_LEVEL_DEBUG, "Sending [%s]", request->item.key);
+		request->state = AGENT_POLLER_STATE_SEND;
+	}
+
+	if (AGENT_POLLER_STATE_SEND == request->state)
+	{
+		while (request->buffer_offset < request->buffer_size)
+		{
+			if (-1 == (n = write(request->fd, request->buffer + request->buffer_offset,
+					request->buffer_size - request->buffer_offset)))
+			{
+				if (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno)
+					return;
+
+				SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed:"
+						" cannot send to [[%s]:%hu]: %s", addr, port, zbx_strerror(errno)));
+				agent_request_complete(poller, request, NETWORK_ERROR);
+				return;
+			}
+
+			request->buffer_offset += (size_t)n;
+		}
+
+		request->state = AGENT_POLLER_STATE_RECV;
+		request->protocol = 0;
+		request->buffer_offset = 0;
+		request->buffer_size = AGENT_POLLER_PACKET_HEADER_LEN;
+
+#ifdef HAVE_SYS_EPOLL_H
+		if (SUCCEED != agent_poller_watch(poller, request, EPOLL_CTL_MOD))
+		{
+			agent_request_complete(poller, request, NETWORK_ERROR);
+			return;
+		}
+#endif
+		if (request->buffer_alloc < ZBX_STAT_BUF_LEN)
+		{
+			request->buffer_alloc = ZBX_STAT_BUF_LEN;
+			request->buffer = (char *)zbx_realloc(request->buffer, request->buffer_alloc);
+		}
+
+		/* wait for response */
+		return;
+	}
+
+	while (1)
+	{
+		if (-1 == (n = read(request->fd, request->buffer + request->buffer_offset,
+				request->buffer_size - request->buffer_offset)))
+		{
+			if (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno)
+				return;
+
+			SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: cannot read"
+					" message from [[%s]:%hu]: %s", addr, port, zbx_strerror(errno)));
+			agent_request_complete(poller, request, NETWORK_ERROR);
+			return;
+		}
+
+		if (0 == n)
+			break;
+
+		if ((request->buffer_offset += (size_t)n) < request->buffer_size)
+			continue;
+
+		/* the whole message is received */
+		if (0 != request->protocol)
+			break;
+
+		if (SUCCEED != agent_request_parse_header(request))
+		{
+			agent_request_complete(poller, request, NETWORK_ERROR);
+			return;
+		}
+
+		if (request->buffer_offset == request->buffer_size)
+			break;
+	}
+
+	agent_request_complete(poller, request, agent_request_set_result(request));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: fails requests that have not finished in time                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	agent_poller_check_timeouts(zbx_agent_poller_t *poller, double now)
+{
+	int	i;
+
+	for (i = poller->requests_num - 1; 0 <= i; i--)
+	{
+		zbx_agent_request_t	*request = poller->requests[i];
+		int			errcode;
+
+		if (request->deadline > now)
+			continue;
+
+		if (AGENT_POLLER_STATE_RECV == request->state)
+		{
+			SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: timed out"
+					" while reading message from [[%s]:%hu]", request->item.interface.addr,
+					request->item.interface.port));
+			errcode = TIMEOUT_ERROR;
+		}
+		else
+		{
+			SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Get value from agent failed: cannot"
+					" connect to [[%s]:%hu]: timed out", request->item.interface.addr,
+					request->item.interface.port));
+			errcode = NETWORK_ERROR;
+		}
+
+		agent_request_complete(poller, request, errcode);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: waits for socket events and advances the ready requests           *
+ *                                                                            *
+ * Parameters: poller  - [IN] the agent poller                                *
+ *             timeout - [IN] the maximum time to wait in milliseconds        *
+ *                                                                            *
+ ******************************************************************************/
+static void	agent_poller_wait(zbx_agent_poller_t *poller, int timeout)
+{
+	int	i, num;
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (-1 == (num = epoll_wait(poller->epoll_fd, poller->events, poller->requests_max, timeout)))
+	{
+		if (EINTR != errno)
+			zabbix_log(LOG_LEVEL_WARNING, "epoll_wait() failed: %s", zbx_strerror(errno));
+		return;
+	}
+
+	for (i = 0; i < num; i++)
+		agent_request_process(poller, (zbx_agent_request_t *)poller->events[i].data.ptr);
+#else
+	int	polled_num = poller->requests_num;
+
+	for (i = 0; i < polled_num; i++)
+	{
+		poller->polled[i] = poller->requests[i];
+		poller->pollfds[i].fd = poller->requests[i]->fd;
+		poller->pollfds[i].events = (AGENT_POLLER_STATE_RECV == poller->requests[i]->state ? POLLIN : POLLOUT);
+		poller->pollfds[i].revents = 0;
+	}
+
+	if (-1 == (num = poll(poller->pollfds, (nfds_t)polled_num, timeout)))
+	{
+		if (EINTR != errno)
+			zabbix_log(LOG_LEVEL_WARNING, "poll() failed: %s", zbx_strerror(errno));
+		return;
+	}
+
+	for (i = 0; i < polled_num && 0 < num; i++)
+	{
+		if (0 == poller->pollfds[i].revents)
+			continue;
+
+		num--;
+		agent_request_process(poller, poller->polled[i]);
+	}
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: processes values of the completed requests and returns items to   *
+ *          queue                                                             *
+ *                                                                            *
+ * Parameters: poller    - [IN] the agent poller                              *
+ *             nextcheck - [OUT] the next check time of agent poller queue    *
+ *                                                                            *
+ * Return value: the number of processed values                               *
+ *                                                                            *
+ ******************************************************************************/
+static int	agent_poller_flush(zbx_agent_poller_t *poller, int *nextcheck)
+{
+	zbx_timespec_t	timespec;
+	zbx_uint64_t	*itemids;
+	int		*lastclocks, *errcodes, i, num;
+	unsigned char	*data = NULL;
+	size_t		data_alloc = 0, data_offset = 0;
+
+	if (0 == (num = poller->completed.values_num))
+		return 0;
+
+	itemids = (zbx_uint64_t *)zbx_malloc(NULL, sizeof(zbx_uint64_t) * (size_t)num);
+	lastclocks = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)num);
+	errcodes = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)num);
+
+	zbx_timespec(&timespec);
+
+	for (i = 0; i < num; i++)
+	{
+		zbx_agent_request_t	*request = (zbx_agent_request_t *)poller->completed.values[i];
+		DC_ITEM			*item = &request->item;
+
+		switch (request->errcode)
+		{
+			case SUCCEED:
+			case NOTSUPPORTED:
+			case AGENT_ERROR:
+				zbx_activate_item_interface(&timespec, item, &data, &data_alloc, &data_offset);
+				break;
+			case NETWORK_ERROR:
+			case GATEWAY_ERROR:
+			case TIMEOUT_ERROR:
+				zbx_deactivate_item_interface(&timespec, item, &data, &data_alloc, &data_offset,
+						request->result.msg);
+				break;
+			case CONFIG_ERROR:
+				/* nothing to do */
+				break;
+			case SIG_ERROR:
+				/* nothing to do, execution was forcibly interrupted by signal */
+				break;
+			default:
+				zbx_error("unknown response code returned: %d", request->errcode);
+				THIS_SHOULD_NEVER_HAPPEN;
+		}
+
+		if (SUCCEED == request->errcode)
+		{
+			item->state = ITEM_STATE_NORMAL;
+			zbx_preprocess_item_value(item->itemid, item->host.hostid, item->value_type, item->flags,
+					&request->result, &timespec, item->state, NULL);
+		}
+		else if (NOTSUPPORTED == request->errcode || AGENT_ERROR == request->errcode ||
+				CONFIG_ERROR == request->errcode)
+		{
+			item->state = ITEM_STATE_NOTSUPPORTED;
+			zbx_preprocess_item_value(item->itemid, item->host.hostid, item->value_type, item->flags, NULL,
+					&timespec, item->state, request->result.msg);
+		}
+
+		itemids[i] = item->itemid;
+		lastclocks[i] = timespec.sec;
+		errcodes[i] = request->errcode;
+	}
+
+	DCpoller_requeue_items(itemids, lastclocks, errcodes, (size_t)num, ZBX_POLLER_TYPE_AGENT, nextcheck);
+	zbx_preprocessor_flush();
+
+	for (i = 0; i < num; i++)
+	{
+		zbx_agent_request_t	*request = (zbx_agent_request_t *)poller->completed.values[i];
+
+		zbx_clean_items(&request->item, 1, &request->result);
+		DCconfig_clean_items(&request->item, NULL, 1);
+		zbx_free(request);
+	}
+
+	zbx_vector_ptr_clear(&poller->completed);
+
+	if (NULL != data)
+	{
+		zbx_availability_send(ZBX_IPC_AVAILABILITY_REQUEST, data, (zbx_uint32_t)data_offset, NULL);
+		zbx_free(data);
+	}
+
+	zbx_free(errcodes);
+	zbx_free(lastclocks);
+	zbx_free(itemids);
+
+	return num;
+}
+
+ZBX_THREAD_ENTRY(agent_poller_thread, args)
+{
+	zbx_agent_poller_t	poller;
+	DC_ITEM			*items;
+	int			processed = 0, nextcheck, next_fetch = 0, items_max;
+	double			now, total_sec = 0.0, last_rtc = 0.0;
+	time_t			last_stat_time;
+	zbx_ipc_async_socket_t	rtc;
+
+#define	STAT_INTERVAL	5	/* if a process is busy and does not sleep then update status not faster than */
+				/* once in STAT_INTERVAL seconds */
+
+	process_type = ((zbx_thread_args_t *)args)->process_type;
+	server_num = ((zbx_thread_args_t *)args)->server_num;
+	process_num = ((zbx_thread_args_t *)args)->process_num;
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "%s #%d started [%s #%d]", get_program_type_string(program_type),
+			server_num, get_process_type_string(process_type), process_num);
+
+	update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+#if defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
+	zbx_tls_init_child();
+#endif
+	agent_poller_init(&poller, agent_poller_get_requests_max(CONFIG_MAX_CONCURRENT_CHECKS));
+
+	items_max = MIN(poller.requests_max, AGENT_POLLER_FETCH_MAX);
+	items = (DC_ITEM *)zbx_malloc(NULL, sizeof(DC_ITEM) * (size_t)items_max);
+
+	zbx_setproctitle("%s #%d started", get_process_type_string(process_type), process_num);
+	last_stat_time = time(NULL);
+
+	zbx_rtc_subscribe(&rtc, process_type, process_num);
+
+	while (ZBX_IS_RUNNING())
+	{
+		zbx_uint32_t	rtc_cmd;
+		unsigned char	*rtc_data;
+		int		timeout;
+		double		sec;
+
+		sec = now = zbx_time();
+		zbx_update_env(now);
+
+		/* take due items while there are free request slots */
+		while (poller.requests_num < poller.requests_max && (int)now >= next_fetch)
+		{
+			int	i, num, max_items;
+
+			max_items = MIN(items_max, poller.requests_max - poller.requests_num);
+
+			num = DCconfig_get_agent_poller_items(items, max_items);
+
+			for (i = 0; i < num; i++)
+				agent_poller_start_request(&poller, &items[i], now);
+
+			if (num < max_items)
+			{
+				if (FAIL == (next_fetch = DCconfig_get_poller_nextcheck(ZBX_POLLER_TYPE_AGENT)))
+					next_fetch = (int)now + POLLER_DELAY;
+				break;
+			}
+		}
+
+		if (0 != poller.requests_num)
+		{
+			if (poller.requests_num < poller.requests_max)
+				timeout = (int)((next_fetch - now) * 1000);
+			else
+				timeout = 1000;
+
+			timeout = MAX(MIN(timeout, 1000), 0);
+
+			update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
+			agent_poller_wait(&poller, timeout);
+			update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+			now = zbx_time();
+			agent_poller_check_timeouts(&poller, now);
+		}
+
+		if (0 != poller.completed.values_num)
+		{
+			processed += agent_poller_flush(&poller, &nextcheck);
+
+			if (FAIL != nextcheck && nextcheck < next_fetch)
+				next_fetch = nextcheck;
+		}
+
+		total_sec += zbx_time() - sec;
+
+		if (STAT_INTERVAL <= time(NULL) - last_stat_time)
+		{
+			zbx_setproctitle("%s #%d [got %d values in " ZBX_FS_DBL " sec, %d checks in progress]",
+					get_process_type_string(process_type), process_num, processed, total_sec,
+					poller.requests_num);
+			processed = 0;
+			total_sec = 0.0;
+			last_stat_time = time(NULL);
+		}
+
+		if (0 == poller.requests_num)
+		{
+			timeout = calculate_sleeptime(next_fetch, POLLER_DELAY);
+		}
+		else if (1.0 <= now - last_rtc)
+		{
+			timeout = 0;
+		}
+		else
+			continue;
+
+		last_rtc = now;
+
+		if (SUCCEED == zbx_rtc_wait(&rtc, &rtc_cmd, &rtc_data, timeout) && 0 != rtc_cmd)
+		{
+			if (ZBX_RTC_SHUTDOWN == rtc_cmd)
+				break;
+		}
+	}
+
+	zbx_setproctitle("%s #%d [terminated]", get_process_type_string(process_type), process_num);
+
+	while (1)
+		zbx_sleep(SEC_PER_MIN);
+#undef STAT_INTERVAL
+}
@@ -181,16 +181,57 @@ static void	http_output_json(unsigned char retrieve_mode, char **buffer, zbx_htt
 	zbx_json_free(&json);
 }
 
-int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: initializes HTTP agent request context                            *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_http_context_init(zbx_http_context_t *context)
+{
+	memset(context, 0, sizeof(zbx_http_context_t));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: releases resources allocated by HTTP agent request context        *
+ *                                                                            *
+ * Comments: The easy handle must be removed from multi handle, if any,       *
+ *           before calling this function.                                    *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_http_context_clean(zbx_http_context_t *context)
+{
+	curl_slist_free_all(context->headers_slist);	/* must be called after curl_easy_perform() */
+	context->headers_slist = NULL;
+
+	if (NULL != context->easyhandle)
+	{
+		curl_easy_cleanup(context->easyhandle);
+		context->easyhandle = NULL;
+	}
+
+	zbx_free(context->body.data);
+	zbx_free(context->header.data);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: creates and configures cURL easy handle for HTTP agent item       *
+ *                                                                            *
+ * Parameters: context - [IN/OUT] the request context                         *
+ *             item    - [IN] the HTTP agent item                             *
+ *             result  - [OUT] the error message on failure                   *
+ *                                                                            *
+ * Return value: SUCCEED      - the request is ready to be performed          *
+ *               NOTSUPPORTED - otherwise                                     *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_http_request_prepare(zbx_http_context_t *context, const DC_ITEM *item, AGENT_RESULT *result)
 {
 	CURL			*easyhandle;
 	CURLcode		err;
-	char			url[ITEM_URL_LEN_MAX], errbuf[CURL_ERROR_SIZE], *error = NULL, *headers, *line, *buffer;
+	char			url[ITEM_URL_LEN_MAX], *error = NULL, *headers, *line;
 	int			ret = NOTSUPPORTED, timeout_seconds, found = FAIL;
-	long			response_code;
-	struct curl_slist	*headers_slist = NULL;
-	struct zbx_json		json;
-	zbx_http_response_t	body = {0}, header = {0};
 	zbx_curl_cb_t		curl_body_cb;
 	char			application_json[] = {"Content-Type: application/json"};
 	char			application_xml[] = {"Content-Type: application/xml"};
@@ -199,10 +240,10 @@ int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
 			__func__, zbx_request_string(item->request_method), item->url, item->query_fields,
 			item->headers, item->posts);
 
-	if (NULL == (easyhandle = curl_easy_init()))
+	if (NULL == (context->easyhandle = easyhandle = curl_easy_init()))
 	{
 		SET_MSG_RESULT(result, zbx_strdup(NULL, "Cannot initialize cURL library"));
-		goto clean;
+		goto out;
 	}
 
 	switch (item->retrieve_mode)
@@ -217,27 +258,27 @@ int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
 		default:
 			THIS_SHOULD_NEVER_HAPPEN;
 			SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Invalid retrieve mode"));
-			goto clean;
+			goto out;
 	}
 
-	if (SUCCEED != zbx_http_prepare_callbacks(easyhandle, &header, &body, zbx_curl_write_cb, curl_body_cb, errbuf,
-			&error))
+	if (SUCCEED != zbx_http_prepare_callbacks(easyhandle, &context->header, &context->body, zbx_curl_write_cb,
+			curl_body_cb, context->errbuf, &error))
 	{
 		SET_MSG_RESULT(result, error);
-		goto clean;
+		goto out;
 	}
 
 	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_PROXY, item->http_proxy)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot set proxy: %s", curl_easy_strerror(err)));
-		goto clean;
+		goto out;
 	}
 
 	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_FOLLOWLOCATION,
 			0 == item->follow_redirects ? 0L : 1L)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot set follow redirects: %s", curl_easy_strerror(err)));
-		goto clean;
+		goto out;
 	}
 
 	if (0 != item->follow_redirects &&
@@ -245,44 +286,44 @@ int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot set number of redirects allowed: %s",
 				curl_easy_strerror(err)));
-		goto clean;
+		goto out;
 	}
 
 	if (FAIL == is_time_suffix(item->timeout, &timeout_seconds, strlen(item->timeout)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Invalid timeout: %s", item->timeout));
-		goto clean;
+		goto out;
 	}
 
 	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_TIMEOUT, (long)timeout_seconds)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot specify timeout: %s", curl_easy_strerror(err)));
-		goto clean;
+		goto out;
 	}
 
 	if (SUCCEED != zbx_http_prepare_ssl(easyhandle, item->ssl_cert_file, item->ssl_key_file, item->ssl_key_password,
 			item->verify_peer, item->verify_host, &error))
 	{
 		SET_MSG_RESULT(result, error);
-		goto clean;
+		goto out;
 	}
 
 	if (SUCCEED != zbx_http_prepare_auth(easyhandle, item->authtype, item->username, item->password, &error))
 	{
 		SET_MSG_RESULT(result, error);
-		goto clean;
+		goto out;
 	}
 
 	if (SUCCEED != http_prepare_request(easyhandle, item->posts, item->request_method, &error))
 	{
 		SET_MSG_RESULT(result, error);
-		goto clean;
+		goto out;
 	}
 
 	headers = item->headers;
 	while (NULL != (line = zbx_http_parse_header(&headers)))
 	{
-		headers_slist = curl_slist_append(headers_slist, line);
+		context->headers_slist = curl_slist_append(context->headers_slist, line);
 
 		if (FAIL == found && 0 == strncmp(line, "Content-Type:", ZBX_CONST_STRLEN("Content-Type:")))
 			found = SUCCEED;
@@ -293,15 +334,15 @@ int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
 	if (FAIL == found)
 	{
 		if (ZBX_POSTTYPE_JSON == item->post_type)
-			headers_slist = curl_slist_append(headers_slist, application_json);
+			context->headers_slist = curl_slist_append(context->headers_slist, application_json);
 		else if (ZBX_POSTTYPE_XML == item->post_type)
-			headers_slist = curl_slist_append(headers_slist, application_xml);
+			context->headers_slist = curl_slist_append(context->headers_slist, application_xml);
 	}
 
-	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_HTTPHEADER, headers_slist)))
+	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_HTTPHEADER, context->headers_slist)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot specify headers: %s", curl_easy_strerror(err)));
-		goto clean;
+		goto out;
 	}
 
 #if LIBCURL_VERSION_NUM >= 0x071304
@@ -309,7 +350,7 @@ int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
 	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_PROTOCOLS, CURLPROTO_HTTP | CURLPROTO_HTTPS)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot set allowed protocols: %s", curl_easy_strerror(err)));
-		goto clean;
+		goto out;
 	}
 #endif
 
@@ -317,19 +358,46 @@ int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
 	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_URL, url)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot specify URL: %s", curl_easy_strerror(err)));
-		goto clean;
+		goto out;
 	}
 
 	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, ZBX_CURLOPT_ACCEPT_ENCODING, "")))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot set cURL encoding option: %s",
 				curl_easy_strerror(err)));
-		goto clean;
+		goto out;
 	}
 
-	*errbuf = '\0';
+	*context->errbuf = '\0';
+	ret = SUCCEED;
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 
-	if (CURLE_OK != (err = curl_easy_perform(easyhandle)))
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: converts the response of performed HTTP agent request to result   *
+ *                                                                            *
+ * Parameters: context - [IN/OUT] the request context                         *
+ *             item    - [IN] the HTTP agent item                             *
+ *             err     - [IN] the transfer result code                        *
+ *             result  - [OUT] the item value or error message                *
+ *                                                                            *
+ * Return value: SUCCEED      - the value was retrieved                       *
+ *               NOTSUPPORTED - otherwise                                     *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_http_handle_response(zbx_http_context_t *context, const DC_ITEM *item, CURLcode err, AGENT_RESULT *result)
+{
+	char			*headers, *line, *buffer;
+	int			ret = NOTSUPPORTED;
+	long			response_code;
+	struct zbx_json		json;
+	zbx_http_response_t	*body = &context->body, *header = &context->header;
+
+	if (CURLE_OK != err)
 	{
 		if (CURLE_WRITE_ERROR == err)
 		{
@@ -338,68 +406,68 @@ int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
 		else
 		{
 			SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot perform request: %s",
-					'\0' == *errbuf ? curl_easy_strerror(err) : errbuf));
+					'\0' == *context->errbuf ? curl_easy_strerror(err) : context->errbuf));
 		}
-		goto clean;
+		goto out;
 	}
 
-	if (CURLE_OK != (err = curl_easy_getinfo(easyhandle, CURLINFO_RESPONSE_CODE, &response_code)))
+	if (CURLE_OK != (err = curl_easy_getinfo(context->easyhandle, CURLINFO_RESPONSE_CODE, &response_code)))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot get the response code: %s", curl_easy_strerror(err)));
-		goto clean;
+		goto out;
 	}
 
 	if ('\0' != *item->status_codes && FAIL == int_in_list(item->status_codes, response_code))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Response code \"%ld\" did not match any of the"
 				" required status codes \"%s\"", response_code, item->status_codes));
-		goto clean;
+		goto out;
 	}
 
-	if (NULL == header.data)
+	if (NULL == header->data)
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Server returned empty header"));
-		goto clean;
+		goto out;
 	}
 
 	switch (item->retrieve_mode)
 	{
 		case ZBX_RETRIEVE_MODE_CONTENT:
-			if (NULL == body.data)
+			if (NULL == body->data)
 			{
 				SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Server returned empty content"));
-				goto clean;
+				goto out;
 			}
 
-			if (FAIL == zbx_is_utf8(body.data))
+			if (FAIL == zbx_is_utf8(body->data))
 			{
 				SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Server returned invalid UTF-8 sequence"));
-				goto clean;
+				goto out;
 			}
 
 			if (HTTP_STORE_JSON == item->output_format)
 			{
-				http_output_json(item->retrieve_mode, &buffer, &header, &body);
+				http_output_json(item->retrieve_mode, &buffer, header, body);
 				SET_TEXT_RESULT(result, buffer);
 			}
 			else
 			{
-				SET_TEXT_RESULT(result, body.data);
-				body.data = NULL;
+				SET_TEXT_RESULT(result, body->data);
+				body->data = NULL;
 			}
 			break;
 		case ZBX_RETRIEVE_MODE_HEADERS:
-			if (FAIL == zbx_is_utf8(header.data))
+			if (FAIL == zbx_is_utf8(header->data))
 			{
 				SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Server returned invalid UTF-8 sequence"));
-				goto clean;
+				goto out;
 			}
 
 			if (HTTP_STORE_JSON == item->output_format)
 			{
 				zbx_json_init(&json, ZBX_JSON_STAT_BUF_LEN);
 				zbx_json_addobject(&json, "header");
-				headers = header.data;
+				headers = header->data;
 				while (NULL != (line = zbx_http_parse_header(&headers)))
 				{
 					http_add_json_header(&json, line);
@@ -410,40 +478,51 @@ int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
 			}
 			else
 			{
-				SET_TEXT_RESULT(result, header.data);
-				header.data = NULL;
+				SET_TEXT_RESULT(result, header->data);
+				header->data = NULL;
 			}
 			break;
 		case ZBX_RETRIEVE_MODE_BOTH:
-			if (FAIL == zbx_is_utf8(header.data) || (NULL != body.data && FAIL == zbx_is_utf8(body.data)))
+			if (FAIL == zbx_is_utf8(header->data) || (NULL != body->data && FAIL == zbx_is_utf8(body->data)))
 			{
 				SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Server returned invalid UTF-8 sequence"));
-				goto clean;
+				goto out;
 			}
 
 			if (HTTP_STORE_JSON == item->output_format)
 			{
-				http_output_json(item->retrieve_mode, &buffer, &header, &body);
+				http_output_json(item->retrieve_mode, &buffer, header, body);
 				SET_TEXT_RESULT(result, buffer);
 			}
 			else
 			{
-				zbx_strncpy_alloc(&header.data, &header.allocated, &header.offset,
-						body.data, body.offset);
-				SET_TEXT_RESULT(result, header.data);
-				header.data = NULL;
+				zbx_strncpy_alloc(&header->data, &header->allocated, &header->offset,
+						body->data, body->offset);
+				SET_TEXT_RESULT(result, header->data);
+				header->data = NULL;
 			}
 			break;
 	}
 
 	ret = SUCCEED;
-clean:
-	curl_slist_free_all(headers_slist);	/* must be called after curl_easy_perform() */
-	curl_easy_cleanup(easyhandle);
-	zbx_free(body.data);
-	zbx_free(header.data);
+out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
 
 	return ret;
 }
+
+int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result)
+{
+	zbx_http_context_t	context;
+	int			ret;
+
+	zbx_http_context_init(&context);
+
+	if (SUCCEED == (ret = zbx_http_request_prepare(&context, item, result)))
+		ret = zbx_http_handle_response(&context, item, curl_easy_perform(context.easyhandle), result);
+
+	zbx_http_context_clean(&context);
+
+	return ret;
+}
 #endif
@@ -25,6 +25,23 @@
 
 #ifdef HAVE_LIBCURL
 #include "dbcache.h"
+#include "zbxhttp.h"
+
+/* HTTP agent request data that must persist until the transfer is completed */
+typedef struct
+{
+	CURL			*easyhandle;
+	struct curl_slist	*headers_slist;
+	zbx_http_response_t	body;
+	zbx_http_response_t	header;
+	char			errbuf[CURL_ERROR_SIZE];
+}
+zbx_http_context_t;
+
+void	zbx_http_context_init(zbx_http_context_t *context);
+void	zbx_http_context_clean(zbx_http_context_t *context);
+int	zbx_http_request_prepare(zbx_http_context_t *context, const DC_ITEM *item, AGENT_RESULT *result);
+int	zbx_http_handle_response(zbx_http_context_t *context, const DC_ITEM *item, CURLcode err, AGENT_RESULT *result);
 
 int	get_value_http(const DC_ITEM *item, AGENT_RESULT *result);
 #endif
@@ -29,6 +29,7 @@
 #include "zbxcomms.h"
 #include "zbxalgo.h"
 #include "zbxjson.h"
+#include "snmp_walk_cache.h"
 
 /*
  * SNMP Dynamic Index Cache
@@ -69,6 +70,8 @@
  * The cache is implemented using hash tables. In ERD:
  * zbx_snmpidx_main_key_t -------------------------------------------0< zbx_snmpidx_mapping_t
  * (OID, host, <v2c: community|v3: (context, security name)>)           (index, value)
+ *
+ * Results of whole walks are shared between items by the SNMP walk cache, see snmp_walk_cache.c.
  */
 
 /******************************************************************************
@@ -447,17 +450,29 @@ static int	zbx_get_snmp_response_error(const struct snmp_session *ss, const DC_I
 	return ret;
 }
 
-static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *error, size_t max_error_len)
+/******************************************************************************
+ *                                                                            *
+ * Purpose: initializes SNMP session parameters for the item                  *
+ *                                                                            *
+ * Parameters: item          - [IN] the item                                  *
+ *             session       - [OUT] the session parameters                   *
+ *             addr          - [OUT] the peer name buffer, referenced by      *
+ *                                   session                                  *
+ *             addr_len      - [IN] the peer name buffer size                 *
+ *             error         - [OUT] the error message                        *
+ *             max_error_len - [IN] the error message buffer size             *
+ *                                                                            *
+ * Return value: SUCCEED - the session parameters were initialized            *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_snmp_init_session(const DC_ITEM *item, struct snmp_session *session, char *addr, size_t addr_len,
+		char *error, size_t max_error_len)
 {
-	struct snmp_session	session, *ss = NULL;
-	char			addr[128];
 #ifdef HAVE_IPV6
-	int			family;
+	int	family;
 #endif
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
-
-	snmp_sess_init(&session);
+	snmp_sess_init(session);
 
 	/* Allow using sub-OIDs higher than MAX_INT, like in 'snmpwalk -Ir'. */
 	/* Disables the validation of varbind values against the MIB definition for the relevant OID. */
@@ -471,109 +486,109 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 	switch (item->snmp_version)
 	{
 		case ZBX_IF_SNMP_VERSION_1:
-			session.version = SNMP_VERSION_1;
+			session->version = SNMP_VERSION_1;
 			break;
 		case ZBX_IF_SNMP_VERSION_2:
-			session.version = SNMP_VERSION_2c;
+			session->version = SNMP_VERSION_2c;
 			break;
 		case ZBX_IF_SNMP_VERSION_3:
-			session.version = SNMP_VERSION_3;
+			session->version = SNMP_VERSION_3;
 			break;
 		default:
 			THIS_SHOULD_NEVER_HAPPEN;
 			break;
 	}
 
-	session.timeout = CONFIG_TIMEOUT * 1000 * 1000;	/* timeout of one attempt in microseconds */
+	session->timeout = CONFIG_TIMEOUT * 1000 * 1000;	/* timeout of one attempt in microseconds */
 							/* (net-snmp default = 1 second) */
 
 #ifdef HAVE_IPV6
 	if (SUCCEED != get_address_family(item->interface.addr, &family, error, max_error_len))
-		goto end;
+		return FAIL;
 
 	if (PF_INET == family)
 	{
-		zbx_snprintf(addr, sizeof(addr), "%s:%hu", item->interface.addr, item->interface.port);
+		zbx_snprintf(addr, addr_len, "%s:%hu", item->interface.addr, item->interface.port);
 	}
 	else
 	{
 		if (item->interface.useip)
-			zbx_snprintf(addr, sizeof(addr), "udp6:[%s]:%hu", item->interface.addr, item->interface.port);
+			zbx_snprintf(addr, addr_len, "udp6:[%s]:%hu", item->interface.addr, item->interface.port);
 		else
-			zbx_snprintf(addr, sizeof(addr), "udp6:%s:%hu", item->interface.addr, item->interface.port);
+			zbx_snprintf(addr, addr_len, "udp6:%s:%hu", item->interface.addr, item->interface.port);
 	}
 #else
-	zbx_snprintf(addr, sizeof(addr), "%s:%hu", item->interface.addr, item->interface.port);
+	zbx_snprintf(addr, addr_len, "%s:%hu", item->interface.addr, item->interface.port);
 #endif
-	session.peername = addr;
+	session->peername = addr;
 
-	if (SNMP_VERSION_1 == session.version || SNMP_VERSION_2c == session.version)
+	if (SNMP_VERSION_1 == session->version || SNMP_VERSION_2c == session->version)
 	{
-		session.community = (u_char *)item->snmp_community;
-		session.community_len = strlen((char *)session.community);
-		zabbix_log(LOG_LEVEL_DEBUG, "SNMP [%s@%s]", session.community, session.peername);
+		session->community = (u_char *)item->snmp_community;
+		session->community_len = strlen((char *)session->community);
+		zabbix_log(LOG_LEVEL_DEBUG, "SNMP [%s@%s]", session->community, session->peername);
 	}
-	else if (SNMP_VERSION_3 == session.version)
+	else if (SNMP_VERSION_3 == session->version)
 	{
 		/* set the SNMPv3 user name */
-		session.securityName = item->snmpv3_securityname;
-		session.securityNameLen = strlen(session.securityName);
+		session->securityName = item->snmpv3_securityname;
+		session->securityNameLen = strlen(session->securityName);
 
 		/* set the SNMPv3 context if specified */
 		if ('\0' != *item->snmpv3_contextname)
 		{
-			session.contextName = item->snmpv3_contextname;
-			session.contextNameLen = strlen(session.contextName);
+			session->contextName = item->snmpv3_contextname;
+			session->contextNameLen = strlen(session->contextName);
 		}
 
 		/* set the security level to authenticated, but not encrypted */
 		switch (item->snmpv3_securitylevel)
 		{
 			case ITEM_SNMPV3_SECURITYLEVEL_NOAUTHNOPRIV:
-				session.securityLevel = SNMP_SEC_LEVEL_NOAUTH;
+				session->securityLevel = SNMP_SEC_LEVEL_NOAUTH;
 				break;
 			case ITEM_SNMPV3_SECURITYLEVEL_AUTHNOPRIV:
-				session.securityLevel = SNMP_SEC_LEVEL_AUTHNOPRIV;
+				session->securityLevel = SNMP_SEC_LEVEL_AUTHNOPRIV;
 
-				if (FAIL == zbx_snmpv3_set_auth_protocol(item, &session))
+				if (FAIL == zbx_snmpv3_set_auth_protocol(item, session))
 				{
 					zbx_snprintf(error, max_error_len, "Unsupported authentication protocol [%d]",
 							item->snmpv3_authprotocol);
-					goto end;
+					return FAIL;
 				}
 
-				session.securityAuthKeyLen = USM_AUTH_KU_LEN;
+				session->securityAuthKeyLen = USM_AUTH_KU_LEN;
 
-				if (SNMPERR_SUCCESS != generate_Ku(session.securityAuthProto,
-						session.securityAuthProtoLen, (u_char *)item->snmpv3_authpassphrase,
-						strlen(item->snmpv3_authpassphrase), session.securityAuthKey,
-						&session.securityAuthKeyLen))
+				if (SNMPERR_SUCCESS != generate_Ku(session->securityAuthProto,
+						session->securityAuthProtoLen, (u_char *)item->snmpv3_authpassphrase,
+						strlen(item->snmpv3_authpassphrase), session->securityAuthKey,
+						&session->securityAuthKeyLen))
 				{
 					zbx_strlcpy(error, "Error generating Ku from authentication pass phrase",
 							max_error_len);
-					goto end;
+					return FAIL;
 				}
 				break;
 			case ITEM_SNMPV3_SECURITYLEVEL_AUTHPRIV:
-				session.securityLevel = SNMP_SEC_LEVEL_AUTHPRIV;
+				session->securityLevel = SNMP_SEC_LEVEL_AUTHPRIV;
 
-				if (FAIL == zbx_snmpv3_set_auth_protocol(item, &session))
+				if (FAIL == zbx_snmpv3_set_auth_protocol(item, session))
 				{
 					zbx_snprintf(error, max_error_len, "Unsupported authentication protocol [%d]",
 							item->snmpv3_authprotocol);
-					goto end;
+					return FAIL;
 				}
 
-				session.securityAuthKeyLen = USM_AUTH_KU_LEN;
+				session->securityAuthKeyLen = USM_AUTH_KU_LEN;
 
-				if (SNMPERR_SUCCESS != generate_Ku(session.securityAuthProto,
-						session.securityAuthProtoLen, (u_char *)item->snmpv3_authpassphrase,
-						strlen(item->snmpv3_authpassphrase), session.securityAuthKey,
-						&session.securityAuthKeyLen))
+				if (SNMPERR_SUCCESS != generate_Ku(session->securityAuthProto,
+						session->securityAuthProtoLen, (u_char *)item->snmpv3_authpassphrase,
+						strlen(item->snmpv3_authpassphrase), session->securityAuthKey,
+						&session->securityAuthKeyLen))
 				{
 					zbx_strlcpy(error, "Error generating Ku from authentication pass phrase",
 							max_error_len);
-					goto end;
+					return FAIL;
 				}
 
 				switch (item->snmpv3_privprotocol)
@@ -581,59 +596,59 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 #ifdef HAVE_NETSNMP_SESSION_DES
 					case ITEM_SNMPV3_PRIVPROTOCOL_DES:
 						/* set the privacy protocol to DES */
-						session.securityPrivProto = usmDESPrivProtocol;
-						session.securityPrivProtoLen = USM_PRIV_PROTO_DES_LEN;
+						session->securityPrivProto = usmDESPrivProtocol;
+						session->securityPrivProtoLen = USM_PRIV_PROTO_DES_LEN;
 						break;
 #endif
 					case ITEM_SNMPV3_PRIVPROTOCOL_AES128:
 						/* set the privacy protocol to AES128 */
-						session.securityPrivProto = usmAESPrivProtocol;
-						session.securityPrivProtoLen = USM_PRIV_PROTO_AES_LEN;
+						session->securityPrivProto = usmAESPrivProtocol;
+						session->securityPrivProtoLen = USM_PRIV_PROTO_AES_LEN;
 						break;
 #ifdef HAVE_NETSNMP_STRONG_PRIV
 					case ITEM_SNMPV3_PRIVPROTOCOL_AES192:
 						/* set the privacy protocol to AES192 */
-						session.securityPrivProto = usmAES192PrivProtocol;
-						session.securityPrivProtoLen = OID_LENGTH(usmAES192PrivProtocol);
+						session->securityPrivProto = usmAES192PrivProtocol;
+						session->securityPrivProtoLen = OID_LENGTH(usmAES192PrivProtocol);
 						break;
 					case ITEM_SNMPV3_PRIVPROTOCOL_AES256:
 						/* set the privacy protocol to AES256 */
-						session.securityPrivProto = usmAES256PrivProtocol;
-						session.securityPrivProtoLen = OID_LENGTH(usmAES256PrivProtocol);
+						session->securityPrivProto = usmAES256PrivProtocol;
+						session->securityPrivProtoLen = OID_LENGTH(usmAES256PrivProtocol);
 						break;
 					case ITEM_SNMPV3_PRIVPROTOCOL_AES192C:
 						/* set the privacy protocol to AES192 (Cisco version) */
-						session.securityPrivProto = usmAES192CiscoPrivProtocol;
-						session.securityPrivProtoLen = OID_LENGTH(usmAES192CiscoPrivProtocol);
+						session->securityPrivProto = usmAES192CiscoPrivProtocol;
+						session->securityPrivProtoLen = OID_LENGTH(usmAES192CiscoPrivProtocol);
 						break;
 					case ITEM_SNMPV3_PRIVPROTOCOL_AES256C:
 						/* set the privacy protocol to AES256 (Cisco version) */
-						session.securityPrivProto = usmAES256CiscoPrivProtocol;
-						session.securityPrivProtoLen = OID_LENGTH(usmAES256CiscoPrivProtocol);
+						session->securityPrivProto = usmAES256CiscoPrivProtocol;
+						session->securityPrivProtoLen = OID_LENGTH(usmAES256CiscoPrivProtocol);
 						break;
 #endif
 					default:
 						zbx_snprintf(error, max_error_len,
 								"Unsupported privacy protocol [%d]",
 								item->snmpv3_privprotocol);
-						goto end;
+						return FAIL;
 				}
 
-				session.securityPrivKeyLen = USM_PRIV_KU_LEN;
+				session->securityPrivKeyLen = USM_PRIV_KU_LEN;
 
-				if (SNMPERR_SUCCESS != generate_Ku(session.securityAuthProto,
-						session.securityAuthProtoLen, (u_char *)item->snmpv3_privpassphrase,
-						strlen(item->snmpv3_privpassphrase), session.securityPrivKey,
-						&session.securityPrivKeyLen))
+				if (SNMPERR_SUCCESS != generate_Ku(session->securityAuthProto,
+						session->securityAuthProtoLen, (u_char *)item->snmpv3_privpassphrase,
+						strlen(item->snmpv3_privpassphrase), session->securityPrivKey,
+						&session->securityPrivKeyLen))
 				{
 					zbx_strlcpy(error, "Error generating Ku from privacy pass phrase",
 							max_error_len);
-					goto end;
+					return FAIL;
 				}
 				break;
 		}
 
-		zabbix_log(LOG_LEVEL_DEBUG, "SNMPv3 [%s@%s]", session.securityName, session.peername);
+		zabbix_log(LOG_LEVEL_DEBUG, "SNMPv3 [%s@%s]", session->securityName, session->peername);
 	}
 
 #ifdef HAVE_NETSNMP_SESSION_LOCALNAME
@@ -646,10 +661,23 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 		static char	localname[64];
 
 		zbx_snprintf(localname, sizeof(localname), "%s:0", CONFIG_SOURCE_IP);
-		session.localname = localname;
+		session->localname = localname;
 	}
 #endif
 
+	return SUCCEED;
+}
+
+static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *error, size_t max_error_len)
+{
+	struct snmp_session	session, *ss = NULL;
+	char			addr[128];
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __func__);
+
+	if (SUCCEED != zbx_snmp_init_session(item, &session, addr, sizeof(addr), error, max_error_len))
+		goto end;
+
 	SOCK_STARTUP;
 
 	if (NULL == (ss = snmp_open(&session)))
@@ -1284,6 +1312,93 @@ out:
 	return ret;
 }
 
+/* helper data structure used to store walk results in the walk cache */
+typedef struct
+{
+	zbx_snmpwalk_t		*walk;
+	zbx_snmp_walk_cb_func	*walk_cb_func;
+	void			*walk_cb_arg;
+}
+zbx_snmpwalk_store_t;
+
+static void	zbx_snmp_walk_store_cb(void *arg, const char *snmp_oid, const char *index, const char *value)
+{
+	zbx_snmpwalk_store_t	*store = (zbx_snmpwalk_store_t *)arg;
+
+	zbx_snmp_walk_cache_add(store->walk, index, value);
+	store->walk_cb_func(store->walk_cb_arg, snmp_oid, index, value);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: retrieves data by walking the OID tree or reuses results of the   *
+ *          same walk recently done for another item of the device            *
+ *                                                                            *
+ * Parameters: see zbx_snmp_walk()                                            *
+ *                                                                            *
+ * Return value: see zbx_snmp_walk()                                          *
+ *                                                                            *
+ * Comments: Only results of successful walks are cached.                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_snmp_walk_cached(struct snmp_session *ss, const DC_ITEM *item, const char *snmp_oid, char *error,
+		size_t max_error_len, int *max_succeed, int *min_fail, int max_vars, int bulk,
+		zbx_snmp_walk_cb_func walk_cb_func, void *walk_cb_arg)
+{
+	zbx_snmpwalk_t		*walk, walk_local;
+	zbx_snmpwalk_store_t	store;
+	int			i, now, ttl, ret;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() OID:'%s'", __func__, snmp_oid);
+
+	/* item delay has user macros expanded by configuration cache */
+	if (0 == (ttl = zbx_snmp_walk_cache_ttl(item->delay)))
+	{
+		ret = zbx_snmp_walk(ss, item, snmp_oid, error, max_error_len, max_succeed, min_fail, max_vars, bulk,
+				walk_cb_func, walk_cb_arg);
+		goto out;
+	}
+
+	now = (int)time(NULL);
+
+	walk_local.addr = item->interface.addr;
+	walk_local.port = item->interface.port;
+	walk_local.oid = (char *)snmp_oid;
+	walk_local.community_context = get_item_community_context(item);
+	walk_local.security_name = get_item_security_name(item);
+
+	if (NULL != (walk = zbx_snmp_walk_cache_get(&walk_local, ttl, now)))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() reusing %d values walked at %d", __func__,
+				walk->values.values_num, walk->lastwalk);
+
+		for (i = 0; i < walk->values.values_num; i++)
+		{
+			walk_cb_func(walk_cb_arg, snmp_oid, (const char *)walk->values.values[i].first,
+					(const char *)walk->values.values[i].second);
+		}
+
+		ret = SUCCEED;
+		goto out;
+	}
+
+	store.walk = zbx_snmp_walk_cache_prepare(&walk_local);
+	store.walk_cb_func = walk_cb_func;
+	store.walk_cb_arg = walk_cb_arg;
+
+	if (SUCCEED == (ret = zbx_snmp_walk(ss, item, snmp_oid, error, max_error_len, max_succeed, min_fail, max_vars,
+			bulk, zbx_snmp_walk_store_cb, (void *)&store)))
+	{
+		zbx_snmp_walk_cache_set(store.walk, now);
+	}
+	else
+		zbx_snmp_walk_cache_remove(store.walk);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+
+	return ret;
+}
+
 static int	zbx_snmp_get_values(struct snmp_session *ss, const DC_ITEM *items, char oids[][ITEM_SNMP_OID_LEN_MAX],
 		AGENT_RESULT *results, int *errcodes, unsigned char *query_and_ignore_type, int num, int level,
 		char *error, size_t max_error_len, int *max_succeed, int *min_fail, unsigned char poller_type)
@@ -1801,7 +1916,7 @@ static int	zbx_snmp_process_discovery(struct snmp_session *ss, const DC_ITEM *it
 	{
 		zbx_snmp_translate(oid_translated, data.request.params[data.num * 2 + 1], sizeof(oid_translated));
 
-		if (SUCCEED != (ret = zbx_snmp_walk(ss, item, oid_translated, error, max_error_len,
+		if (SUCCEED != (ret = zbx_snmp_walk_cached(ss, item, oid_translated, error, max_error_len,
 				max_succeed, min_fail, max_vars, bulk, zbx_snmp_walk_discovery_cb, (void *)&data)))
 		{
 			goto clean;
@@ -1979,8 +2094,8 @@ static int	zbx_snmp_process_dynamic(struct snmp_session *ss, const DC_ITEM *item
 
 			cache_del_snmp_index_subtree(&items[j], oids_translated[j]);
 
-			errcode = zbx_snmp_walk(ss, &items[j], oids_translated[j], error, max_error_len, max_succeed,
-					min_fail, num, bulk, zbx_snmp_walk_cache_cb, (void *)&items[j]);
+			errcode = zbx_snmp_walk_cached(ss, &items[j], oids_translated[j], error, max_error_len,
+					max_succeed, min_fail, num, bulk, zbx_snmp_walk_cache_cb, (void *)&items[j]);
 
 			if (NETWORK_ERROR == errcode)
 			{
@@ -2184,6 +2299,599 @@ out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __func__);
 }
 
+#define ZBX_SNMP_REQUEST_QUEUED	0
+#define ZBX_SNMP_REQUEST_SENT	1
+#define ZBX_SNMP_REQUEST_DONE	2
+
+typedef struct
+{
+	zbx_snmp_context_t	*context;
+	int			mapping[MAX_SNMP_ITEMS];	/* indexes of the items queried by request */
+	int			mapping_num;
+	int			level;				/* see zbx_snmp_get_values() */
+	unsigned char		state;
+}
+zbx_snmp_request_t;
+
+struct zbx_snmp_context
+{
+	void			*sessp;
+	int			fd;
+	const DC_ITEM		*items;
+	AGENT_RESULT		*results;
+	int			*errcodes;
+	int			num;
+	int			reference;	/* index of the item the session was opened for */
+	oid			**oids;
+	size_t			*oid_lens;
+	zbx_vector_ptr_t	requests;
+	int			requests_sent;	/* number of requests taken from the queue */
+	int			pending_num;	/* number of queued and sent requests without response */
+	int			max_succeed;
+	int			min_fail;
+	unsigned char		failed;
+};
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: fails all items of the context that have not failed yet           *
+ *                                                                            *
+ * Comments: Same as synchronous get_values_snmp() the items that already     *
+ *           received values are failed too.                                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_snmp_context_fail(zbx_snmp_context_t *ctx, int err, const char *error)
+{
+	int	i;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "getting SNMP values failed: %s", error);
+
+	for (i = ctx->reference; i < ctx->num; i++)
+	{
+		if (SUCCEED != ctx->errcodes[i])
+			continue;
+
+		SET_MSG_RESULT(&ctx->results[i], zbx_strdup(NULL, error));
+		ctx->errcodes[i] = err;
+	}
+
+	ctx->failed = 1;
+	ctx->pending_num = 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: queues GET request for the specified context items                *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_snmp_context_add_request(zbx_snmp_context_t *ctx, const int *mapping, int mapping_num, int level)
+{
+	zbx_snmp_request_t	*request;
+
+	request = (zbx_snmp_request_t *)zbx_malloc(NULL, sizeof(zbx_snmp_request_t));
+	request->context = ctx;
+	memcpy(request->mapping, mapping, sizeof(int) * (size_t)mapping_num);
+	request->mapping_num = mapping_num;
+	request->level = level;
+	request->state = ZBX_SNMP_REQUEST_QUEUED;
+
+	zbx_vector_ptr_append(&ctx->requests, request);
+	ctx->pending_num++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: processes response to the asynchronous GET request                *
+ *                                                                            *
+ * Parameters: request  - [IN] the request                                    *
+ *             ss       - [IN] the session the request was sent with          *
+ *             status   - [IN] the request status (STAT_*)                    *
+ *             response - [IN] the response PDU, NULL if not received         *
+ *                                                                            *
+ * Comments: Follows zbx_snmp_get_values() logic, except that the requests    *
+ *           for the split batches are queued instead of being sent in        *
+ *           sequence.                                                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_snmp_request_process(zbx_snmp_request_t *request, const struct snmp_session *ss, int status,
+		const struct snmp_pdu *response)
+{
+	zbx_snmp_context_t	*ctx = request->context;
+	const DC_ITEM		*item = &ctx->items[ctx->reference];
+	struct variable_list	*var;
+	unsigned char		val_type;
+	char			error[MAX_STRING_LEN];
+	int			i, j, ret = SUCCEED;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() status:%d s_snmp_errno:%d errstat:%ld mapping_num:%d level:%d",
+			__func__, status, ss->s_snmp_errno, NULL == response ? (long)-1 : response->errstat,
+			request->mapping_num, request->level);
+
+	request->state = ZBX_SNMP_REQUEST_DONE;
+	ctx->pending_num--;
+
+	if (STAT_SUCCESS == status && SNMP_ERR_NOERROR == response->errstat)
+	{
+		for (i = 0, var = response->variables;; i++, var = var->next_variable)
+		{
+			/* check that response variable binding matches the request variable binding */
+
+			if (i == request->mapping_num)
+			{
+				if (NULL != var)
+				{
+					zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
+							" too many variable bindings", item->host.host);
+
+					if (1 != request->mapping_num)	/* give device a chance to handle a smaller request */
+						goto halve;
+
+					zbx_strlcpy(error, "Invalid SNMP response: too many variable bindings.",
+							sizeof(error));
+
+					ret = NOTSUPPORTED;
+				}
+
+				break;
+			}
+
+			if (NULL == var)
+			{
+				zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
+						" too few variable bindings", item->host.host);
+
+				if (1 != request->mapping_num)	/* give device a chance to handle a smaller request */
+					goto halve;
+
+				zbx_strlcpy(error, "Invalid SNMP response: too few variable bindings.", sizeof(error));
+
+				ret = NOTSUPPORTED;
+				break;
+			}
+
+			j = request->mapping[i];
+
+			if (ctx->oid_lens[j] != var->name_length ||
+					0 != memcmp(ctx->oids[j], var->name, ctx->oid_lens[j] * sizeof(oid)))
+			{
+				char	sent_oid[ITEM_SNMP_OID_LEN_MAX], received_oid[ITEM_SNMP_OID_LEN_MAX];
+
+				zbx_snmp_dump_oid(sent_oid, sizeof(sent_oid), ctx->oids[j], ctx->oid_lens[j]);
+				zbx_snmp_dump_oid(received_oid, sizeof(received_oid), var->name, var->name_length);
+
+				if (1 != request->mapping_num)
+				{
+					zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
+							" variable bindings that do not match the request:"
+							" sent \"%s\", received \"%s\"",
+							item->host.host, sent_oid, received_oid);
+
+					goto halve;	/* give device a chance to handle a smaller request */
+				}
+				else
+				{
+					zabbix_log(LOG_LEVEL_DEBUG, "SNMP response from host \"%s\" contains"
+							" variable bindings that do not match the request:"
+							" sent \"%s\", received \"%s\"",
+							item->host.host, sent_oid, received_oid);
+				}
+			}
+
+			/* process received data */
+
+			ctx->errcodes[j] = zbx_snmp_set_result(var, &ctx->results[j], &val_type);
+
+			if (ISSET_TEXT(&ctx->results[j]) && ZBX_SNMP_STR_HEX == val_type)
+				zbx_remove_chars(ctx->results[j].text, "\r\n");
+		}
+
+		if (SUCCEED == ret)
+		{
+			if (ctx->max_succeed < request->mapping_num)
+				ctx->max_succeed = request->mapping_num;
+		}
+	}
+	else if (STAT_SUCCESS == status && SNMP_ERR_NOSUCHNAME == response->errstat && 0 != response->errindex)
+	{
+		/* see zbx_snmp_get_values() for the explanation, the bad variable is removed and the rest are */
+		/* queried again */
+
+		i = response->errindex - 1;
+
+		if (0 > i || i >= request->mapping_num)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
+					" an out of bounds error index: %ld", item->host.host, response->errindex);
+
+			zbx_strlcpy(error, "Invalid SNMP response: error index out of bounds.", sizeof(error));
+
+			ret = NOTSUPPORTED;
+			goto out;
+		}
+
+		j = request->mapping[i];
+
+		ctx->errcodes[j] = zbx_get_snmp_response_error(ss, &item->interface, status, response, error,
+				sizeof(error));
+		SET_MSG_RESULT(&ctx->results[j], zbx_strdup(NULL, error));
+
+		if (1 < request->mapping_num)
+		{
+			memmove(request->mapping + i, request->mapping + i + 1,
+					sizeof(int) * (size_t)(request->mapping_num - i - 1));
+
+			zbx_snmp_context_add_request(ctx, request->mapping, request->mapping_num - 1, request->level);
+		}
+	}
+	else if (1 < request->mapping_num &&
+			((STAT_SUCCESS == status && SNMP_ERR_TOOBIG == response->errstat) || STAT_TIMEOUT == status ||
+			(STAT_ERROR == status && SNMPERR_TOO_LONG == ss->s_snmp_errno)))
+	{
+		/* see zbx_snmp_get_values() for the explanation */
+halve:
+		if (ctx->min_fail > request->mapping_num)
+			ctx->min_fail = request->mapping_num;
+
+		if (0 == request->level)
+		{
+			/* halve the number of items */
+
+			int	base = request->mapping_num / 2;
+
+			zbx_snmp_context_add_request(ctx, request->mapping, base, 1);
+			zbx_snmp_context_add_request(ctx, request->mapping + base, request->mapping_num - base, 1);
+		}
+		else if (1 == request->level)
+		{
+			/* resort to querying items one by one */
+
+			for (i = 0; i < request->mapping_num; i++)
+				zbx_snmp_context_add_request(ctx, request->mapping + i, 1, 2);
+		}
+	}
+	else
+		ret = zbx_get_snmp_response_error(ss, &item->interface, status, response, error, sizeof(error));
+out:
+	if (SUCCEED != ret)
+		zbx_snmp_context_fail(ctx, ret, error);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __func__, zbx_result_string(ret));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: net-snmp callback for the asynchronous GET requests               *
+ *                                                                            *
+ * Comments: Status is derived the same way as net-snmp does it for           *
+ *           synchronous requests.                                            *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_snmp_async_cb(int operation, struct snmp_session *ss, int reqid, struct snmp_pdu *pdu,
+		void *magic)
+{
+	zbx_snmp_request_t	*request = (zbx_snmp_request_t *)magic;
+	int			status;
+
+	ZBX_UNUSED(reqid);
+
+	if (ZBX_SNMP_REQUEST_SENT != request->state || 0 != request->context->failed)
+		return 1;
+
+	switch (operation)
+	{
+		case NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE:
+			if (SNMP_MSG_REPORT == pdu->command)
+			{
+				ss->s_snmp_errno = snmpv3_get_report_type(pdu);
+				status = STAT_ERROR;
+			}
+			else
+				status = STAT_SUCCESS;
+			break;
+		case NETSNMP_CALLBACK_OP_TIMED_OUT:
+			ss->s_snmp_errno = SNMPERR_TIMEOUT;
+			status = STAT_TIMEOUT;
+			break;
+#ifdef NETSNMP_CALLBACK_OP_SEND_FAILED
+		case NETSNMP_CALLBACK_OP_SEND_FAILED:
+			status = STAT_ERROR;
+			break;
+#endif
+		default:
+			return 1;
+	}
+
+	zbx_snmp_request_process(request, ss, status, STAT_SUCCESS == status ? pdu : NULL);
+
+	return 1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: sends the queued requests of the context                          *
+ *                                                                            *
+ * Comments: Requests are queued from net-snmp callbacks and sent after the   *
+ *           library returns, so the session is never re-entered.             *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_snmp_context_send(zbx_snmp_context_t *ctx)
+{
+	struct snmp_pdu	*pdu;
+	int		i, j, mapping_num;
+
+	for (; ctx->requests_sent < ctx->requests.values_num && 0 == ctx->failed; ctx->requests_sent++)
+	{
+		zbx_snmp_request_t	*request = (zbx_snmp_request_t *)ctx->requests.values[ctx->requests_sent];
+
+		if (NULL == (pdu = snmp_pdu_create(SNMP_MSG_GET)))
+		{
+			zbx_snmp_context_fail(ctx, CONFIG_ERROR, "snmp_pdu_create(): cannot create PDU object.");
+			break;
+		}
+
+		for (i = 0, mapping_num = 0; i < request->mapping_num; i++)
+		{
+			j = request->mapping[i];
+
+			if (SUCCEED != ctx->errcodes[j])
+				continue;
+
+			if (NULL == snmp_add_null_var(pdu, ctx->oids[j], ctx->oid_lens[j]))
+			{
+				SET_MSG_RESULT(&ctx->results[j], zbx_strdup(NULL,
+						"snmp_add_null_var(): cannot add null variable."));
+				ctx->errcodes[j] = CONFIG_ERROR;
+				continue;
+			}
+
+			request->mapping[mapping_num++] = j;
+		}
+
+		if (0 == (request->mapping_num = mapping_num))
+		{
+			snmp_free_pdu(pdu);
+			request->state = ZBX_SNMP_REQUEST_DONE;
+			ctx->pending_num--;
+			continue;
+		}
+
+		request->state = ZBX_SNMP_REQUEST_SENT;
+
+		if (0 == snmp_sess_async_send(ctx->sessp, pdu, zbx_snmp_async_cb, request))
+		{
+			snmp_free_pdu(pdu);
+			zbx_snmp_request_process(request, snmp_sess_session(ctx->sessp), STAT_ERROR, NULL);
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: starts asynchronous GET requests for the items of one interface   *
+ *                                                                            *
+ * Parameters: items    - [IN] the items, must stay valid until the context   *
+ *                             is freed                                       *
+ *             results  - [OUT] the item values                               *
+ *             errcodes - [IN/OUT] the item error codes, only the items with  *
+ *                                 SUCCEED error code are queried             *
+ *             num      - [IN] the number of items, up to MAX_SNMP_ITEMS      *
+ *                                                                            *
+ * Return value: the SNMP context                                             *
+ *                                                                            *
+ * Comments: Only the items with plain OIDs are supported. All items are      *
+ *           queried with multi-variable GET requests that are split on       *
+ *           failure in the same way as with get_values_snmp().               *
+ *                                                                            *
+ ******************************************************************************/
+zbx_snmp_context_t	*zbx_snmp_context_create(const DC_ITEM *items, AGENT_RESULT *results, int *errcodes, int num)
+{
+	zbx_snmp_context_t	*ctx;
+	struct snmp_session	session;
+	netsnmp_transport	*transport;
+	char			addr[128], error[MAX_STRING_LEN], oid_translated[ITEM_SNMP_OID_LEN_MAX];
+	oid			parsed_oid[MAX_OID_LEN];
+	int			i, mapping[MAX_SNMP_ITEMS], mapping_num = 0;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() host:'%s' addr:'%s' num:%d",
+			__func__, items[0].host.host, items[0].interface.addr, num);
+
+	ctx = (zbx_snmp_context_t *)zbx_malloc(NULL, sizeof(zbx_snmp_context_t));
+	memset(ctx, 0, sizeof(zbx_snmp_context_t));
+	ctx->fd = -1;
+	ctx->items = items;
+	ctx->results = results;
+	ctx->errcodes = errcodes;
+	ctx->num = num;
+	ctx->min_fail = MAX_SNMP_ITEMS + 1;
+	zbx_vector_ptr_create(&ctx->requests);
+
+	zbx_init_snmp();	/* avoid high CPU usage by only initializing SNMP once used */
+
+	for (ctx->reference = 0; ctx->reference < num; ctx->reference++)	/* locate first supported item */
+	{
+		if (SUCCEED == errcodes[ctx->reference])
+			break;
+	}
+
+	if (ctx->reference == num)	/* all items already NOTSUPPORTED (with invalid key, port or SNMP parameters) */
+		goto out;
+
+	if (SUCCEED != zbx_snmp_init_session(&items[ctx->reference], &session, addr, sizeof(addr), error,
+			sizeof(error)))
+	{
+		zbx_snmp_context_fail(ctx, NETWORK_ERROR, error);
+		goto out;
+	}
+
+	SOCK_STARTUP;
+
+	if (NULL == (ctx->sessp = snmp_sess_open(&session)))
+	{
+		SOCK_CLEANUP;
+
+		zbx_snmp_context_fail(ctx, NETWORK_ERROR, "Cannot open SNMP session");
+		goto out;
+	}
+
+	if (NULL == (transport = snmp_sess_transport(ctx->sessp)) || 0 > transport->sock ||
+			FD_SETSIZE <= transport->sock)
+	{
+		zbx_snmp_context_fail(ctx, NETWORK_ERROR, "Cannot use SNMP session socket");
+		goto out;
+	}
+
+	ctx->fd = transport->sock;
+	ctx->oids = (oid **)zbx_malloc(NULL, sizeof(oid *) * (size_t)num);
+	ctx->oid_lens = (size_t *)zbx_malloc(NULL, sizeof(size_t) * (size_t)num);
+
+	for (i = 0; i < num; i++)
+	{
+		ctx->oids[i] = NULL;
+
+		if (SUCCEED != errcodes[i])
+			continue;
+
+		if (0 != num_key_param(items[i].snmp_oid))
+		{
+			SET_MSG_RESULT(&results[i], zbx_dsprintf(NULL, "OID \"%s\" contains unsupported parameters.",
+					items[i].snmp_oid));
+			errcodes[i] = CONFIG_ERROR;
+			continue;
+		}
+
+		zbx_snmp_translate(oid_translated, items[i].snmp_oid, sizeof(oid_translated));
+
+		ctx->oid_lens[i] = MAX_OID_LEN;
+
+		if (NULL == snmp_parse_oid(oid_translated, parsed_oid, &ctx->oid_lens[i]))
+		{
+			SET_MSG_RESULT(&results[i], zbx_dsprintf(NULL, "snmp_parse_oid(): cannot parse OID \"%s\".",
+					oid_translated));
+			errcodes[i] = CONFIG_ERROR;
+			continue;
+		}
+
+		ctx->oids[i] = (oid *)zbx_malloc(NULL, sizeof(oid) * ctx->oid_lens[i]);
+		memcpy(ctx->oids[i], parsed_oid, sizeof(oid) * ctx->oid_lens[i]);
+
+		mapping[mapping_num++] = i;
+	}
+
+	if (0 == mapping_num)
+		goto out;
+
+	/* session parameters are shared by all requests, retry only when querying a single item */
+	snmp_sess_session(ctx->sessp)->retries = (1 == mapping_num ? 1 : 0);
+
+	zbx_snmp_context_add_request(ctx, mapping, mapping_num, 0);
+	zbx_snmp_context_send(ctx);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() pending:%d", __func__, ctx->pending_num);
+
+	return ctx;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns socket the context is waiting responses on                *
+ *                                                                            *
+ * Return value: the socket or -1 if the context is not waiting responses     *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_snmp_context_get_fd(const zbx_snmp_context_t *ctx)
+{
+	if (0 != ctx->failed || 0 == ctx->pending_num)
+		return -1;
+
+	return ctx->fd;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads and processes the responses available on context socket     *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_snmp_context_read(zbx_snmp_context_t *ctx)
+{
+	fd_set	fdset;
+
+	if (-1 == zbx_snmp_context_get_fd(ctx))
+		return;
+
+	FD_ZERO(&fdset);
+	FD_SET(ctx->fd, &fdset);
+
+	(void)snmp_sess_read(ctx->sessp, &fdset);
+	zbx_snmp_context_send(ctx);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: resends or times out the context requests without response        *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_snmp_context_check_timeout(zbx_snmp_context_t *ctx)
+{
+	if (-1 == zbx_snmp_context_get_fd(ctx))
+		return;
+
+	snmp_sess_timeout(ctx->sessp);
+	zbx_snmp_context_send(ctx);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: checks if all context items have their values or errors set       *
+ *                                                                            *
+ * Return value: SUCCEED - the context is finished                            *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_snmp_context_finished(const zbx_snmp_context_t *ctx)
+{
+	return 0 == ctx->pending_num ? SUCCEED : FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: closes context session, updates interface SNMP statistics and     *
+ *          frees the context                                                 *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_snmp_context_free(zbx_snmp_context_t *ctx)
+{
+	int	i;
+
+	if (NULL != ctx->sessp)
+	{
+		/* requests still in progress are not processed during close */
+		for (i = 0; i < ctx->requests.values_num; i++)
+			((zbx_snmp_request_t *)ctx->requests.values[i])->state = ZBX_SNMP_REQUEST_DONE;
+
+		snmp_sess_close(ctx->sessp);
+		SOCK_CLEANUP;
+	}
+
+	if (0 == ctx->failed && (0 != ctx->max_succeed || MAX_SNMP_ITEMS + 1 != ctx->min_fail))
+	{
+		DCconfig_update_interface_snmp_stats(ctx->items[ctx->reference].interface.interfaceid,
+				ctx->max_succeed, ctx->min_fail);
+	}
+
+	if (NULL != ctx->oids)
+	{
+		for (i = 0; i < ctx->num; i++)
+			zbx_free(ctx->oids[i]);
+
+		zbx_free(ctx->oids);
+	}
+
+	zbx_free(ctx->oid_lens);
+	zbx_vector_ptr_clear_ext(&ctx->requests, zbx_ptr_free);
+	zbx_vector_ptr_destroy(&ctx->requests);
+	zbx_free(ctx);
+}
+
 static void	zbx_shutdown_snmp(void)
 {
 	sigset_t	mask, orig_mask;
@@ -2206,6 +2914,8 @@ void	zbx_clear_cache_snmp(unsigned char process_type, int process_num)
 	zabbix_log(LOG_LEVEL_WARNING, "forced reloading of the snmp cache on [%s #%d]", get_process_type_string(process_type),
 			process_num);
 
+	zbx_snmp_walk_cache_destroy();
+
 	if (0 == zbx_snmp_init_done)
 		return;
 
@@ -39,6 +39,15 @@ extern int	CONFIG_TIMEOUT;
 int	get_value_snmp(const DC_ITEM *item, AGENT_RESULT *result, unsigned char poller_type);
 void	get_values_snmp(const DC_ITEM *items, AGENT_RESULT *results, int *errcodes, int num, unsigned char poller_type);
 void	zbx_clear_cache_snmp(unsigned char process_type, int process_num);
+
+typedef struct zbx_snmp_context	zbx_snmp_context_t;
+
+zbx_snmp_context_t	*zbx_snmp_context_create(const DC_ITEM *items, AGENT_RESULT *results, int *errcodes, int num);
+int	zbx_snmp_context_get_fd(const zbx_snmp_context_t *ctx);
+void	zbx_snmp_context_read(zbx_snmp_context_t *ctx);
+void	zbx_snmp_context_check_timeout(zbx_snmp_context_t *ctx);
+int	zbx_snmp_context_finished(const zbx_snmp_context_t *ctx);
+void	zbx_snmp_context_free(zbx_snmp_context_t *ctx);
 #endif
 
 #endif
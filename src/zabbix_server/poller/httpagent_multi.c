@@ -0,0 +1,196 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "httpagent_multi.h"
+
+#ifdef ZBX_HAVE_HTTPAGENT_POLLER
+
+#include "log.h"
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: creates multi handle sharing connections between requests         *
+ *                                                                            *
+ * Parameters: multi             - [OUT] the multi handle                     *
+ *             requests_max      - [IN] the maximum number of concurrent      *
+ *                                      requests                              *
+ *             host_requests_max - [IN] the maximum number of connections to  *
+ *                                      one host, 0 - unlimited               *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_httpagent_multi_init(zbx_httpagent_multi_t *multi, int requests_max, int host_requests_max)
+{
+	CURLMcode	code;
+
+	if (NULL == (multi->multi = curl_multi_init()))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot initialize cURL multi handle");
+		exit(EXIT_FAILURE);
+	}
+
+	/* keep idle connections open for reuse by the next checks of the same scheme, host and port */
+	if (CURLM_OK != (code = curl_multi_setopt(multi->multi, CURLMOPT_MAXCONNECTS, (long)requests_max)))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot set cURL connection cache size: %s",
+				curl_multi_strerror(code));
+	}
+
+	if (0 != host_requests_max)
+	{
+#if LIBCURL_VERSION_NUM >= 0x071e00
+		/* CURLMOPT_MAX_HOST_CONNECTIONS is supported starting with version 7.30.0 (0x071e00) */
+		if (CURLM_OK != (code = curl_multi_setopt(multi->multi, CURLMOPT_MAX_HOST_CONNECTIONS,
+				(long)host_requests_max)))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot limit cURL connections per host: %s",
+					curl_multi_strerror(code));
+		}
+#else
+		zabbix_log(LOG_LEVEL_WARNING, "cURL library 7.30.0 or newer is required to limit concurrent checks"
+				" per host");
+#endif
+	}
+
+	multi->requests_max = requests_max;
+	multi->requests_num = 0;
+	zbx_vector_ptr_create(&multi->completed);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: releases multi handle                                             *
+ *                                                                            *
+ * Comments: All requests must be completed and taken by the caller before.   *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_httpagent_multi_destroy(zbx_httpagent_multi_t *multi)
+{
+	curl_multi_cleanup(multi->multi);
+	zbx_vector_ptr_destroy(&multi->completed);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: starts HTTP agent check                                           *
+ *                                                                            *
+ * Parameters: multi   - [IN/OUT] the multi handle                            *
+ *             request - [IN] the request with item macros already expanded   *
+ *                            and result initialized                          *
+ *                                                                            *
+ * Comments: The request is moved to completed requests right away if it      *
+ *           cannot be started.                                               *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_httpagent_multi_add(zbx_httpagent_multi_t *multi, zbx_httpagent_request_t *request)
+{
+	CURLMcode	code;
+
+	zbx_http_context_init(&request->context);
+
+	if (SUCCEED != (request->errcode = zbx_http_request_prepare(&request->context, &request->item,
+			&request->result)))
+	{
+		goto out;
+	}
+
+	curl_easy_setopt(request->context.easyhandle, CURLOPT_PRIVATE, request);
+#if LIBCURL_VERSION_NUM >= 0x071900
+	/* CURLOPT_TCP_KEEPALIVE is supported starting with version 7.25.0 (0x071900) */
+	curl_easy_setopt(request->context.easyhandle, CURLOPT_TCP_KEEPALIVE, 1L);
+#endif
+	if (CURLM_OK != (code = curl_multi_add_handle(multi->multi, request->context.easyhandle)))
+	{
+		SET_MSG_RESULT(&request->result, zbx_dsprintf(NULL, "Cannot add request to cURL multi handle: %s",
+				curl_multi_strerror(code)));
+		request->errcode = NOTSUPPORTED;
+		goto out;
+	}
+
+	multi->requests_num++;
+
+	return;
+out:
+	zbx_http_context_clean(&request->context);
+	zbx_vector_ptr_append(&multi->completed, request);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: advances transfers and moves the finished requests to completed   *
+ *          requests                                                          *
+ *                                                                            *
+ * Comments: Transfers that exceed the item timeout are finished by cURL with *
+ *           CURLE_OPERATION_TIMEDOUT during this call.                       *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_httpagent_multi_perform(zbx_httpagent_multi_t *multi)
+{
+	CURLMcode	code;
+	CURLMsg		*msg;
+	int		running, msgs_num;
+
+	if (CURLM_OK != (code = curl_multi_perform(multi->multi, &running)))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot perform on cURL multi handle: %s", curl_multi_strerror(code));
+		return;
+	}
+
+	while (NULL != (msg = curl_multi_info_read(multi->multi, &msgs_num)))
+	{
+		zbx_httpagent_request_t	*request;
+		CURL			*easyhandle;
+		CURLcode		err;
+		char			*private = NULL;
+
+		if (CURLMSG_DONE != msg->msg)
+			continue;
+
+		/* message data is released when the handle is removed */
+		easyhandle = msg->easy_handle;
+		err = msg->data.result;
+
+		curl_easy_getinfo(easyhandle, CURLINFO_PRIVATE, &private);
+		curl_multi_remove_handle(multi->multi, easyhandle);
+		multi->requests_num--;
+
+		request = (zbx_httpagent_request_t *)private;
+		request->errcode = zbx_http_handle_response(&request->context, &request->item, err, &request->result);
+		zbx_http_context_clean(&request->context);
+
+		zbx_vector_ptr_append(&multi->completed, request);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: waits for socket events or transfer timeouts                      *
+ *                                                                            *
+ * Parameters: multi   - [IN] the multi handle                                *
+ *             timeout - [IN] the maximum time to wait in milliseconds        *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_httpagent_multi_wait(zbx_httpagent_multi_t *multi, int timeout)
+{
+	CURLMcode	code;
+
+	if (CURLM_OK != (code = curl_multi_wait(multi->multi, NULL, 0, timeout, NULL)))
+		zabbix_log(LOG_LEVEL_WARNING, "cannot wait on cURL multi handle: %s", curl_multi_strerror(code));
+}
+
+#endif
@@ -0,0 +1,56 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_HTTPAGENT_MULTI_H
+#define ZABBIX_HTTPAGENT_MULTI_H
+
+#include "httpagent_poller.h"
+
+#ifdef ZBX_HAVE_HTTPAGENT_POLLER
+
+#include "checks_http.h"
+
+typedef struct
+{
+	DC_ITEM			item;
+	AGENT_RESULT		result;
+	int			errcode;
+	zbx_http_context_t	context;
+}
+zbx_httpagent_request_t;
+
+/* HTTP agent checks performed concurrently on a single cURL multi handle */
+typedef struct
+{
+	CURLM			*multi;
+	int			requests_num;	/* requests added to multi handle */
+	int			requests_max;
+	zbx_vector_ptr_t	completed;	/* requests with result or error set */
+}
+zbx_httpagent_multi_t;
+
+void	zbx_httpagent_multi_init(zbx_httpagent_multi_t *multi, int requests_max, int host_requests_max);
+void	zbx_httpagent_multi_destroy(zbx_httpagent_multi_t *multi);
+void	zbx_httpagent_multi_add(zbx_httpagent_multi_t *multi, zbx_httpagent_request_t *request);
+void	zbx_httpagent_multi_perform(zbx_httpagent_multi_t *multi);
+void	zbx_httpagent_multi_wait(zbx_httpagent_multi_t *multi, int timeout);
+
+#endif
+
+#endif
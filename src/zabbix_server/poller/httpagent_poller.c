@@ -0,0 +1,316 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "httpagent_poller.h"
+
+#ifdef ZBX_HAVE_HTTPAGENT_POLLER
+
+#include "httpagent_multi.h"
+#include "poller.h"
+#include "zbxserver.h"
+#include "zbxnix.h"
+#include "zbxself.h"
+#include "preproc.h"
+#include "zbxrtc.h"
+#include "log.h"
+
+extern ZBX_THREAD_LOCAL unsigned char	process_type;
+extern unsigned char			program_type;
+extern ZBX_THREAD_LOCAL int		server_num, process_num;
+
+#define HTTPAGENT_POLLER_FETCH_MAX	128	/* maximum number of items taken from queue at once */
+#define HTTPAGENT_POLLER_RESERVED_FDS	64	/* file descriptors left for logs, IPC and database */
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: limits the number of concurrent checks by the open files limit    *
+ *                                                                            *
+ * Parameters: requests_max - [IN] the configured number of concurrent checks *
+ *                                                                            *
+ * Return value: the number of concurrent checks the process can handle       *
+ *                                                                            *
+ ******************************************************************************/
+static int	httpagent_poller_get_requests_max(int requests_max)
+{
+	struct rlimit	rlim;
+	rlim_t		required = (rlim_t)requests_max + HTTPAGENT_POLLER_RESERVED_FDS;
+	int		limit;
+
+	if (0 != getrlimit(RLIMIT_NOFILE, &rlim))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot get open files limit: %s", zbx_strerror(errno));
+		return requests_max;
+	}
+
+	if (rlim.rlim_cur >= required)
+		return requests_max;
+
+	if (RLIM_INFINITY == rlim.rlim_max || rlim.rlim_max >= required)
+		rlim.rlim_cur = required;
+	else
+		rlim.rlim_cur = rlim.rlim_max;
+
+	if (0 != setrlimit(RLIMIT_NOFILE, &rlim) && 0 != getrlimit(RLIMIT_NOFILE, &rlim))
+		return requests_max;
+
+	if (rlim.rlim_cur >= required)
+		return requests_max;
+
+	limit = (HTTPAGENT_POLLER_RESERVED_FDS + 1 < rlim.rlim_cur ?
+			(int)(rlim.rlim_cur - HTTPAGENT_POLLER_RESERVED_FDS) : 1);
+
+	zabbix_log(LOG_LEVEL_WARNING, "open files limit " ZBX_FS_UI64 " is too low for %d concurrent checks,"
+			" http agent poller will perform up to %d concurrent checks", (zbx_uint64_t)rlim.rlim_cur,
+			requests_max, limit);
+
+	return limit;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: takes item from the queue and starts its check                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	httpagent_poller_start_request(zbx_httpagent_multi_t *poller, const DC_ITEM *item)
+{
+	zbx_httpagent_request_t	*request;
+
+	request = (zbx_httpagent_request_t *)zbx_malloc(NULL, sizeof(zbx_httpagent_request_t));
+	memcpy(&request->item, item, sizeof(DC_ITEM));
+
+	/* interface address points to the address fields of the copied item */
+	request->item.interface.addr = (1 == request->item.interface.useip ? request->item.interface.ip_orig :
+			request->item.interface.dns_orig);
+
+	zbx_prepare_items(&request->item, &request->errcode, 1, &request->result, MACRO_EXPAND_YES);
+
+	if (SUCCEED != request->errcode)
+	{
+		zbx_vector_ptr_append(&poller->completed, request);
+		return;
+	}
+
+	zbx_httpagent_multi_add(poller, request);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: passes values of the completed requests to preprocessing and      *
+ *          returns items to queue                                            *
+ *                                                                            *
+ * Parameters: poller    - [IN] the HTTP agent poller                         *
+ *             nextcheck - [OUT] the next check time of HTTP agent poller     *
+ *                               queue                                        *
+ *                                                                            *
+ * Return value: the number of processed values                               *
+ *                                                                            *
+ * Comments: HTTP agent checks do not affect interface availability.          *
+ *                                                                            *
+ ******************************************************************************/
+static int	httpagent_poller_flush(zbx_httpagent_multi_t *poller, int *nextcheck)
+{
+	zbx_timespec_t	timespec;
+	zbx_uint64_t	*itemids;
+	int		*lastclocks, *errcodes, i, num;
+
+	if (0 == (num = poller->completed.values_num))
+		return 0;
+
+	itemids = (zbx_uint64_t *)zbx_malloc(NULL, sizeof(zbx_uint64_t) * (size_t)num);
+	lastclocks = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)num);
+	errcodes = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)num);
+
+	zbx_timespec(&timespec);
+
+	for (i = 0; i < num; i++)
+	{
+		zbx_httpagent_request_t	*request = (zbx_httpagent_request_t *)poller->completed.values[i];
+		DC_ITEM			*item = &request->item;
+
+		if (SUCCEED == request->errcode)
+		{
+			item->state = ITEM_STATE_NORMAL;
+			zbx_preprocess_item_value(item->itemid, item->host.hostid, item->value_type, item->flags,
+					&request->result, &timespec, item->state, NULL);
+		}
+		else
+		{
+			if (!ISSET_MSG(&request->result))
+				SET_MSG_RESULT(&request->result, zbx_strdup(NULL, ZBX_NOTSUPPORTED_MSG));
+
+			item->state = ITEM_STATE_NOTSUPPORTED;
+			zbx_preprocess_item_value(item->itemid, item->host.hostid, item->value_type, item->flags, NULL,
+					&timespec, item->state, request->result.msg);
+		}
+
+		itemids[i] = item->itemid;
+		lastclocks[i] = timespec.sec;
+		errcodes[i] = request->errcode;
+	}
+
+	DCpoller_requeue_items(itemids, lastclocks, errcodes, (size_t)num, ZBX_POLLER_TYPE_HTTPAGENT, nextcheck);
+	zbx_preprocessor_flush();
+
+	for (i = 0; i < num; i++)
+	{
+		zbx_httpagent_request_t	*request = (zbx_httpagent_request_t *)poller->completed.values[i];
+
+		zbx_clean_items(&request->item, 1, &request->result);
+		DCconfig_clean_items(&request->item, NULL, 1);
+		zbx_free(request);
+	}
+
+	zbx_vector_ptr_clear(&poller->completed);
+
+	zbx_free(errcodes);
+	zbx_free(lastclocks);
+	zbx_free(itemids);
+
+	return num;
+}
+
+ZBX_THREAD_ENTRY(httpagent_poller_thread, args)
+{
+	zbx_httpagent_multi_t	poller;
+	DC_ITEM			*items;
+	int			processed = 0, nextcheck, next_fetch = 0, items_max;
+	double			now, total_sec = 0.0, last_rtc = 0.0;
+	time_t			last_stat_time;
+	zbx_ipc_async_socket_t	rtc;
+
+#define	STAT_INTERVAL	5	/* if a process is busy and does not sleep then update status not faster than */
+				/* once in STAT_INTERVAL seconds */
+
+	process_type = ((zbx_thread_args_t *)args)->process_type;
+	server_num = ((zbx_thread_args_t *)args)->server_num;
+	process_num = ((zbx_thread_args_t *)args)->process_num;
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "%s #%d started [%s #%d]", get_program_type_string(program_type),
+			server_num, get_process_type_string(process_type), process_num);
+
+	update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+	zbx_httpagent_multi_init(&poller, httpagent_poller_get_requests_max(CONFIG_MAX_CONCURRENT_CHECKS),
+			CONFIG_MAX_CONCURRENT_HTTP_HOST_CHECKS);
+
+	items_max = MIN(poller.requests_max, HTTPAGENT_POLLER_FETCH_MAX);
+	items = (DC_ITEM *)zbx_malloc(NULL, sizeof(DC_ITEM) * (size_t)items_max);
+
+	zbx_setproctitle("%s #%d started", get_process_type_string(process_type), process_num);
+	last_stat_time = time(NULL);
+
+	zbx_rtc_subscribe(&rtc, process_type, process_num);
+
+	while (ZBX_IS_RUNNING())
+	{
+		zbx_uint32_t	rtc_cmd;
+		unsigned char	*rtc_data;
+		int		timeout;
+		double		sec;
+
+		sec = now = zbx_time();
+		zbx_update_env(now);
+
+		/* take due items while there are free request slots */
+		while (poller.requests_num < poller.requests_max && (int)now >= next_fetch)
+		{
+			int	i, num, max_items;
+
+			max_items = MIN(items_max, poller.requests_max - poller.requests_num);
+
+			num = DCconfig_get_httpagent_poller_items(items, max_items);
+
+			for (i = 0; i < num; i++)
+				httpagent_poller_start_request(&poller, &items[i]);
+
+			if (num < max_items)
+			{
+				if (FAIL == (next_fetch = DCconfig_get_poller_nextcheck(ZBX_POLLER_TYPE_HTTPAGENT)))
+					next_fetch = (int)now + POLLER_DELAY;
+				break;
+			}
+		}
+
+		if (0 != poller.requests_num)
+		{
+			zbx_httpagent_multi_perform(&poller);
+
+			if (poller.requests_num < poller.requests_max)
+				timeout = (int)((next_fetch - now) * 1000);
+			else
+				timeout = 1000;
+
+			timeout = MAX(MIN(timeout, 1000), 0);
+
+			update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
+			zbx_httpagent_multi_wait(&poller, timeout);
+			update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+			zbx_httpagent_multi_perform(&poller);
+			now = zbx_time();
+		}
+
+		if (0 != poller.completed.values_num)
+		{
+			processed += httpagent_poller_flush(&poller, &nextcheck);
+
+			if (FAIL != nextcheck && nextcheck < next_fetch)
+				next_fetch = nextcheck;
+		}
+
+		total_sec += zbx_time() - sec;
+
+		if (STAT_INTERVAL <= time(NULL) - last_stat_time)
+		{
+			zbx_setproctitle("%s #%d [got %d values in " ZBX_FS_DBL " sec, %d checks in progress]",
+					get_process_type_string(process_type), process_num, processed, total_sec,
+					poller.requests_num);
+			processed = 0;
+			total_sec = 0.0;
+			last_stat_time = time(NULL);
+		}
+
+		if (0 == poller.requests_num)
+		{
+			timeout = calculate_sleeptime(next_fetch, POLLER_DELAY);
+		}
+		else if (1.0 <= now - last_rtc)
+		{
+			timeout = 0;
+		}
+		else
+			continue;
+
+		last_rtc = now;
+
+		if (SUCCEED == zbx_rtc_wait(&rtc, &rtc_cmd, &rtc_data, timeout) && 0 != rtc_cmd)
+		{
+			if (ZBX_RTC_SHUTDOWN == rtc_cmd)
+				break;
+		}
+	}
+
+	zbx_setproctitle("%s #%d [terminated]", get_process_type_string(process_type), process_num);
+
+	while (1)
+		zbx_sleep(SEC_PER_MIN);
+#undef STAT_INTERVAL
+}
+
+#endif
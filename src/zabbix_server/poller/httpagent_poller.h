@@ -0,0 +1,41 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_HTTPAGENT_POLLER_H
+#define ZABBIX_HTTPAGENT_POLLER_H
+
+#include "common.h"
+
+/* curl_multi_wait() is supported starting with version 7.28.0 (0x071c00) */
+#if defined(HAVE_LIBCURL) && LIBCURL_VERSION_NUM >= 0x071c00
+#	define ZBX_HAVE_HTTPAGENT_POLLER
+#endif
+
+#ifdef ZBX_HAVE_HTTPAGENT_POLLER
+
+#include "zbxthreads.h"
+
+extern int	CONFIG_MAX_CONCURRENT_CHECKS;
+extern int	CONFIG_MAX_CONCURRENT_HTTP_HOST_CHECKS;
+
+ZBX_THREAD_ENTRY(httpagent_poller_thread, args);
+
+#endif
+
+#endif
@@ -0,0 +1,462 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "snmp_poller.h"
+
+#ifdef HAVE_NETSNMP
+
+#include "poller.h"
+#include "checks_snmp.h"
+#include "zbxserver.h"
+#include "zbxnix.h"
+#include "zbxself.h"
+#include "preproc.h"
+#include "zbxrtc.h"
+#include "log.h"
+#include "zbxavailability.h"
+
+extern ZBX_THREAD_LOCAL unsigned char	process_type;
+extern unsigned char			program_type;
+extern ZBX_THREAD_LOCAL int		server_num, process_num;
+
+#define SNMP_POLLER_RESERVED_FDS	64	/* file descriptors left for logs, IPC and database */
+#define SNMP_POLLER_TIMEOUT_CHECK	0.1	/* interval of resending and timing out requests in seconds */
+
+/* items of one interface queried with a single SNMP session */
+typedef struct
+{
+	DC_ITEM			*items;
+	AGENT_RESULT		*results;
+	int			*errcodes;
+	int			num;
+	zbx_snmp_context_t	*context;
+}
+zbx_snmp_batch_t;
+
+typedef struct
+{
+	zbx_snmp_batch_t	**batches;	/* batches in progress */
+	int			batches_num;
+	int			batches_max;
+	zbx_vector_ptr_t	completed;
+	struct pollfd		*pollfds;
+}
+zbx_snmp_poller_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: limits the number of concurrent sessions by the open files limit  *
+ *          and the descriptors net-snmp can read                             *
+ *                                                                            *
+ * Parameters: batches_max - [IN] the configured number of concurrent checks  *
+ *                                                                            *
+ * Return value: the number of sessions the process can keep open             *
+ *                                                                            *
+ ******************************************************************************/
+static int	snmp_poller_get_batches_max(int batches_max)
+{
+	struct rlimit	rlim;
+	int		limit = FD_SETSIZE - SNMP_POLLER_RESERVED_FDS;
+
+	/* session sockets are read with fd_set based snmp_sess_read() */
+	if (0 == getrlimit(RLIMIT_NOFILE, &rlim) && RLIM_INFINITY != rlim.rlim_cur &&
+			rlim.rlim_cur < (rlim_t)limit + SNMP_POLLER_RESERVED_FDS)
+	{
+		limit = (SNMP_POLLER_RESERVED_FDS + 1 < rlim.rlim_cur ?
+				(int)(rlim.rlim_cur - SNMP_POLLER_RESERVED_FDS) : 1);
+	}
+
+	if (batches_max <= limit)
+		return batches_max;
+
+	zabbix_log(LOG_LEVEL_WARNING, "cannot open sessions for %d concurrent checks, snmp poller will query"
+			" up to %d interfaces at the same time", batches_max, limit);
+
+	return limit;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: takes items of one interface from the queue and starts querying   *
+ *          them                                                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	snmp_poller_start_batch(zbx_snmp_poller_t *poller, const DC_ITEM *items, int num)
+{
+	zbx_snmp_batch_t	*batch;
+	int			i;
+
+	batch = (zbx_snmp_batch_t *)zbx_malloc(NULL, sizeof(zbx_snmp_batch_t));
+	batch->num = num;
+	batch->items = (DC_ITEM *)zbx_malloc(NULL, sizeof(DC_ITEM) * (size_t)num);
+	batch->results = (AGENT_RESULT *)zbx_malloc(NULL, sizeof(AGENT_RESULT) * (size_t)num);
+	batch->errcodes = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)num);
+
+	memcpy(batch->items, items, sizeof(DC_ITEM) * (size_t)num);
+
+	/* interface address points to the address fields of the copied item */
+	for (i = 0; i < num; i++)
+	{
+		DC_INTERFACE	*interface = &batch->items[i].interface;
+
+		interface->addr = (1 == interface->useip ? interface->ip_orig : interface->dns_orig);
+	}
+
+	zbx_prepare_items(batch->items, batch->errcodes, num, batch->results, MACRO_EXPAND_YES);
+
+	batch->context = zbx_snmp_context_create(batch->items, batch->results, batch->errcodes, num);
+
+	if (SUCCEED == zbx_snmp_context_finished(batch->context))
+		zbx_vector_ptr_append(&poller->completed, batch);
+	else
+		poller->batches[poller->batches_num++] = batch;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: waits for SNMP responses and processes them                       *
+ *                                                                            *
+ * Parameters: poller  - [IN] the SNMP poller                                 *
+ *             timeout - [IN] the maximum time to wait in milliseconds        *
+ *                                                                            *
+ ******************************************************************************/
+static void	snmp_poller_wait(zbx_snmp_poller_t *poller, int timeout)
+{
+	int	i, num;
+
+	for (i = 0; i < poller->batches_num; i++)
+	{
+		poller->pollfds[i].fd = zbx_snmp_context_get_fd(poller->batches[i]->context);
+		poller->pollfds[i].events = POLLIN;
+		poller->pollfds[i].revents = 0;
+	}
+
+	if (-1 == (num = poll(poller->pollfds, (nfds_t)poller->batches_num, timeout)))
+	{
+		if (EINTR != errno)
+			zabbix_log(LOG_LEVEL_WARNING, "poll() failed: %s", zbx_strerror(errno));
+		return;
+	}
+
+	for (i = 0; i < poller->batches_num && 0 < num; i++)
+	{
+		if (0 == poller->pollfds[i].revents)
+			continue;
+
+		num--;
+		zbx_snmp_context_read(poller->batches[i]->context);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: resends or times out requests without response                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	snmp_poller_check_timeouts(zbx_snmp_poller_t *poller)
+{
+	int	i;
+
+	for (i = 0; i < poller->batches_num; i++)
+		zbx_snmp_context_check_timeout(poller->batches[i]->context);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: moves the batches with all values received to completed batches   *
+ *                                                                            *
+ ******************************************************************************/
+static void	snmp_poller_collect_completed(zbx_snmp_poller_t *poller)
+{
+	int	i;
+
+	for (i = poller->batches_num - 1; 0 <= i; i--)
+	{
+		zbx_snmp_batch_t	*batch = poller->batches[i];
+
+		if (SUCCEED != zbx_snmp_context_finished(batch->context))
+			continue;
+
+		poller->batches[i] = poller->batches[--poller->batches_num];
+		zbx_vector_ptr_append(&poller->completed, batch);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: processes values of the completed batches and returns items to    *
+ *          queue                                                             *
+ *                                                                            *
+ * Parameters: poller    - [IN] the SNMP poller                               *
+ *             nextcheck - [OUT] the next check time of SNMP poller queue     *
+ *                                                                            *
+ * Return value: the number of processed values                               *
+ *                                                                            *
+ ******************************************************************************/
+static int	snmp_poller_flush(zbx_snmp_poller_t *poller, int *nextcheck)
+{
+	zbx_timespec_t	timespec;
+	zbx_uint64_t	*itemids;
+	int		*lastclocks, *errcodes, i, j, num = 0;
+	unsigned char	*data = NULL;
+	size_t		data_alloc = 0, data_offset = 0;
+
+	for (i = 0; i < poller->completed.values_num; i++)
+		num += ((zbx_snmp_batch_t *)poller->completed.values[i])->num;
+
+	itemids = (zbx_uint64_t *)zbx_malloc(NULL, sizeof(zbx_uint64_t) * (size_t)num);
+	lastclocks = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)num);
+	errcodes = (int *)zbx_malloc(NULL, sizeof(int) * (size_t)num);
+
+	zbx_timespec(&timespec);
+
+	for (i = 0, num = 0; i < poller->completed.values_num; i++)
+	{
+		zbx_snmp_batch_t	*batch = (zbx_snmp_batch_t *)poller->completed.values[i];
+		int			last_available = INTERFACE_AVAILABLE_UNKNOWN;
+
+		for (j = 0; j < batch->num; j++)
+		{
+			DC_ITEM		*item = &batch->items[j];
+			AGENT_RESULT	*result = &batch->results[j];
+
+			switch (batch->errcodes[j])
+			{
+				case SUCCEED:
+				case NOTSUPPORTED:
+				case AGENT_ERROR:
+					if (INTERFACE_AVAILABLE_TRUE != last_available)
+					{
+						zbx_activate_item_interface(&timespec, item, &data, &data_alloc,
+								&data_offset);
+						last_available = INTERFACE_AVAILABLE_TRUE;
+					}
+					break;
+				case NETWORK_ERROR:
+				case GATEWAY_ERROR:
+				case TIMEOUT_ERROR:
+					if (INTERFACE_AVAILABLE_FALSE != last_available)
+					{
+						zbx_deactivate_item_interface(&timespec, item, &data, &data_alloc,
+								&data_offset, result->msg);
+						last_available = INTERFACE_AVAILABLE_FALSE;
+					}
+					break;
+				case CONFIG_ERROR:
+					/* nothing to do */
+					break;
+				case SIG_ERROR:
+					/* nothing to do, execution was forcibly interrupted by signal */
+					break;
+				default:
+					zbx_error("unknown response code returned: %d", batch->errcodes[j]);
+					THIS_SHOULD_NEVER_HAPPEN;
+			}
+
+			if (SUCCEED == batch->errcodes[j])
+			{
+				item->state = ITEM_STATE_NORMAL;
+				zbx_preprocess_item_value(item->itemid, item->host.hostid, item->value_type,
+						item->flags, result, &timespec, item->state, NULL);
+			}
+			else if (NOTSUPPORTED == batch->errcodes[j] || AGENT_ERROR == batch->errcodes[j] ||
+					CONFIG_ERROR == batch->errcodes[j])
+			{
+				item->state = ITEM_STATE_NOTSUPPORTED;
+				zbx_preprocess_item_value(item->itemid, item->host.hostid, item->value_type,
+						item->flags, NULL, &timespec, item->state, result->msg);
+			}
+
+			itemids[num] = item->itemid;
+			lastclocks[num] = timespec.sec;
+			errcodes[num++] = batch->errcodes[j];
+		}
+	}
+
+	DCpoller_requeue_items(itemids, lastclocks, errcodes, (size_t)num, ZBX_POLLER_TYPE_SNMP, nextcheck);
+	zbx_preprocessor_flush();
+
+	for (i = 0; i < poller->completed.values_num; i++)
+	{
+		zbx_snmp_batch_t	*batch = (zbx_snmp_batch_t *)poller->completed.values[i];
+
+		/* context refers to the batch items and updates interface statistics when freed */
+		zbx_snmp_context_free(batch->context);
+
+		zbx_clean_items(batch->items, batch->num, batch->results);
+		DCconfig_clean_items(batch->items, NULL, (size_t)batch->num);
+		zbx_free(batch->errcodes);
+		zbx_free(batch->results);
+		zbx_free(batch->items);
+		zbx_free(batch);
+	}
+
+	zbx_vector_ptr_clear(&poller->completed);
+
+	if (NULL != data)
+	{
+		zbx_availability_send(ZBX_IPC_AVAILABILITY_REQUEST, data, (zbx_uint32_t)data_offset, NULL);
+		zbx_free(data);
+	}
+
+	zbx_free(errcodes);
+	zbx_free(lastclocks);
+	zbx_free(itemids);
+
+	return num;
+}
+
+ZBX_THREAD_ENTRY(snmp_poller_thread, args)
+{
+	zbx_snmp_poller_t	poller;
+	DC_ITEM			*items;
+	int			processed = 0, nextcheck, next_fetch = 0, cache_reload = 0;
+	double			now, total_sec = 0.0, last_rtc = 0.0, last_timeout_check = 0.0;
+	time_t			last_stat_time;
+	zbx_ipc_async_socket_t	rtc;
+
+#define	STAT_INTERVAL	5	/* if a process is busy and does not sleep then update status not faster than */
+				/* once in STAT_INTERVAL seconds */
+
+	process_type = ((zbx_thread_args_t *)args)->process_type;
+	server_num = ((zbx_thread_args_t *)args)->server_num;
+	process_num = ((zbx_thread_args_t *)args)->process_num;
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "%s #%d started [%s #%d]", get_program_type_string(program_type),
+			server_num, get_process_type_string(process_type), process_num);
+
+	update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+	poller.batches_max = snmp_poller_get_batches_max(CONFIG_MAX_CONCURRENT_CHECKS);
+	poller.batches_num = 0;
+	poller.batches = (zbx_snmp_batch_t **)zbx_malloc(NULL, sizeof(zbx_snmp_batch_t *) *
+			(size_t)poller.batches_max);
+	poller.pollfds = (struct pollfd *)zbx_malloc(NULL, sizeof(struct pollfd) * (size_t)poller.batches_max);
+	zbx_vector_ptr_create(&poller.completed);
+
+	items = (DC_ITEM *)zbx_malloc(NULL, sizeof(DC_ITEM) * MAX_SNMP_ITEMS);
+
+	zbx_setproctitle("%s #%d started", get_process_type_string(process_type), process_num);
+	last_stat_time = time(NULL);
+
+	zbx_rtc_subscribe(&rtc, process_type, process_num);
+
+	while (ZBX_IS_RUNNING())
+	{
+		zbx_uint32_t	rtc_cmd;
+		unsigned char	*rtc_data;
+		int		timeout;
+		double		sec;
+
+		sec = now = zbx_time();
+		zbx_update_env(now);
+
+		/* net-snmp library state must not be reset while sessions are open */
+		if (0 != cache_reload && 0 == poller.batches_num)
+		{
+			zbx_clear_cache_snmp(process_type, process_num);
+			cache_reload = 0;
+		}
+
+		/* take due items while there are free session slots, one interface at a time */
+		while (0 == cache_reload && poller.batches_num < poller.batches_max && (int)now >= next_fetch)
+		{
+			int	num;
+
+			if (0 == (num = DCconfig_get_snmp_poller_items(items, MAX_SNMP_ITEMS)))
+			{
+				if (FAIL == (next_fetch = DCconfig_get_poller_nextcheck(ZBX_POLLER_TYPE_SNMP)))
+					next_fetch = (int)now + POLLER_DELAY;
+				break;
+			}
+
+			snmp_poller_start_batch(&poller, items, num);
+		}
+
+		if (0 != poller.batches_num)
+		{
+			timeout = (int)(SNMP_POLLER_TIMEOUT_CHECK * 1000);
+
+			if (poller.batches_num < poller.batches_max && 0 == cache_reload)
+				timeout = MAX(MIN(timeout, (int)((next_fetch - now) * 1000)), 0);
+
+			update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
+			snmp_poller_wait(&poller, timeout);
+			update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+
+			if (SNMP_POLLER_TIMEOUT_CHECK <= (now = zbx_time()) - last_timeout_check)
+			{
+				snmp_poller_check_timeouts(&poller);
+				last_timeout_check = now;
+			}
+
+			snmp_poller_collect_completed(&poller);
+		}
+
+		if (0 != poller.completed.values_num)
+		{
+			processed += snmp_poller_flush(&poller, &nextcheck);
+
+			if (FAIL != nextcheck && nextcheck < next_fetch)
+				next_fetch = nextcheck;
+		}
+
+		total_sec += zbx_time() - sec;
+
+		if (STAT_INTERVAL <= time(NULL) - last_stat_time)
+		{
+			zbx_setproctitle("%s #%d [got %d values in " ZBX_FS_DBL " sec, %d interfaces in progress]",
+					get_process_type_string(process_type), process_num, processed, total_sec,
+					poller.batches_num);
+			processed = 0;
+			total_sec = 0.0;
+			last_stat_time = time(NULL);
+		}
+
+		if (0 == poller.batches_num)
+		{
+			timeout = (0 == cache_reload ? calculate_sleeptime(next_fetch, POLLER_DELAY) : 0);
+		}
+		else if (1.0 <= now - last_rtc)
+		{
+			timeout = 0;
+		}
+		else
+			continue;
+
+		last_rtc = now;
+
+		if (SUCCEED == zbx_rtc_wait(&rtc, &rtc_cmd, &rtc_data, timeout) && 0 != rtc_cmd)
+		{
+			if (ZBX_RTC_SNMP_CACHE_RELOAD == rtc_cmd)
+				cache_reload = 1;
+
+			if (ZBX_RTC_SHUTDOWN == rtc_cmd)
+				break;
+		}
+	}
+
+	zbx_setproctitle("%s #%d [terminated]", get_process_type_string(process_type), process_num);
+
+	while (1)
+		zbx_sleep(SEC_PER_MIN);
+#undef STAT_INTERVAL
+}
+
+#endif
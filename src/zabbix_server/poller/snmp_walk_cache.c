@@ -0,0 +1,251 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "snmp_walk_cache.h"
+
+/*
+ * SNMP Walk Cache
+ * ===============
+ *
+ * Several discovery rules and dynamic index items of the same device often walk the same subtrees (for example
+ * ifDescr, ifType of IF-MIB::ifTable). Results of each successful walk are kept for a short time using the same
+ * key as the dynamic index cache, so that the subtree is walked once per device instead of once per item.
+ *
+ * A walk result is reused for half of the update interval of the item requesting it, but no longer than
+ * ZBX_SNMP_WALK_CACHE_TTL_MAX seconds. This way items checked in the same poller cycle share one walk while an item
+ * never gets its own previous walk back on its next check. Items whose update interval is not a plain interval
+ * (flexible or scheduling intervals, unresolved user macros) neither reuse nor store walk results, because the time
+ * of their next check is not known.
+ */
+
+static zbx_hashset_t	snmpwalk;
+static int		snmpwalk_nextpurge;
+
+static zbx_hash_t	__snmpwalk_hash(const void *data)
+{
+	const zbx_snmpwalk_t	*walk = (const zbx_snmpwalk_t *)data;
+
+	zbx_hash_t		hash;
+
+	hash = ZBX_DEFAULT_STRING_HASH_FUNC(walk->addr);
+	hash = ZBX_DEFAULT_STRING_HASH_ALGO(&walk->port, sizeof(walk->port), hash);
+	hash = ZBX_DEFAULT_STRING_HASH_ALGO(walk->oid, strlen(walk->oid), hash);
+	hash = ZBX_DEFAULT_STRING_HASH_ALGO(walk->community_context, strlen(walk->community_context), hash);
+	hash = ZBX_DEFAULT_STRING_HASH_ALGO(walk->security_name, strlen(walk->security_name), hash);
+
+	return hash;
+}
+
+static int	__snmpwalk_compare(const void *d1, const void *d2)
+{
+	const zbx_snmpwalk_t	*walk1 = (const zbx_snmpwalk_t *)d1;
+	const zbx_snmpwalk_t	*walk2 = (const zbx_snmpwalk_t *)d2;
+
+	int			ret;
+
+	if (0 != (ret = strcmp(walk1->addr, walk2->addr)))
+		return ret;
+
+	ZBX_RETURN_IF_NOT_EQUAL(walk1->port, walk2->port);
+
+	if (0 != (ret = strcmp(walk1->community_context, walk2->community_context)))
+		return ret;
+
+	if (0 != (ret = strcmp(walk1->security_name, walk2->security_name)))
+		return ret;
+
+	return strcmp(walk1->oid, walk2->oid);
+}
+
+static void	__snmpwalk_values_clear(zbx_vector_ptr_pair_t *values)
+{
+	int	i;
+
+	for (i = 0; i < values->values_num; i++)
+	{
+		zbx_free(values->values[i].first);
+		zbx_free(values->values[i].second);
+	}
+
+	zbx_vector_ptr_pair_clear(values);
+}
+
+static void	__snmpwalk_clean(void *data)
+{
+	zbx_snmpwalk_t	*walk = (zbx_snmpwalk_t *)data;
+
+	zbx_free(walk->addr);
+	zbx_free(walk->oid);
+	zbx_free(walk->community_context);
+	zbx_free(walk->security_name);
+	__snmpwalk_values_clear(&walk->values);
+	zbx_vector_ptr_pair_destroy(&walk->values);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: removes walk results that cannot be reused by any item anymore    *
+ *                                                                            *
+ ******************************************************************************/
+static void	snmp_walk_cache_purge(int now)
+{
+	zbx_hashset_iter_t	iter;
+	zbx_snmpwalk_t		*walk;
+
+	zbx_hashset_iter_reset(&snmpwalk, &iter);
+	while (NULL != (walk = (zbx_snmpwalk_t *)zbx_hashset_iter_next(&iter)))
+	{
+		if (walk->lastwalk > now || walk->lastwalk + ZBX_SNMP_WALK_CACHE_TTL_MAX <= now)
+			zbx_hashset_iter_remove(&iter);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: returns how long walk results may be reused for the item          *
+ *                                                                            *
+ * Parameters: delay - [IN] the item update interval with expanded macros     *
+ *                                                                            *
+ * Return value: the number of seconds walk results can be reused for,        *
+ *               0 - walk results must not be cached for the item             *
+ *                                                                            *
+ * Comments: Half of the item update interval is used so that the item never  *
+ *           gets back results of its own previous walk.                      *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_snmp_walk_cache_ttl(const char *delay)
+{
+	int	simple_interval;
+
+	/* the next check time of items with custom intervals or unresolved macros is not known */
+	if (NULL == delay || NULL != strchr(delay, ';') ||
+			SUCCEED != zbx_interval_preproc(delay, &simple_interval, NULL, NULL) || 0 >= simple_interval)
+	{
+		return 0;
+	}
+
+	return MIN(MAX(simple_interval / 2, 1), ZBX_SNMP_WALK_CACHE_TTL_MAX);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: finds walk results that can be reused                             *
+ *                                                                            *
+ * Parameters: key - [IN] the device, credentials and root OID of the walk    *
+ *             ttl - [IN] the requesting item walk cache ttl, see             *
+ *                        zbx_snmp_walk_cache_ttl()                           *
+ *             now - [IN] the current time                                    *
+ *                                                                            *
+ * Return value: the walk results or NULL if the subtree must be walked       *
+ *                                                                            *
+ ******************************************************************************/
+zbx_snmpwalk_t	*zbx_snmp_walk_cache_get(const zbx_snmpwalk_t *key, int ttl, int now)
+{
+	zbx_snmpwalk_t	*walk;
+
+	if (NULL == snmpwalk.slots)
+	{
+		zbx_hashset_create_ext(&snmpwalk, 100, __snmpwalk_hash, __snmpwalk_compare, __snmpwalk_clean,
+				ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
+		snmpwalk_nextpurge = now + ZBX_SNMP_WALK_CACHE_TTL_MAX;
+	}
+	else if (now >= snmpwalk_nextpurge)
+	{
+		snmp_walk_cache_purge(now);
+		snmpwalk_nextpurge = now + ZBX_SNMP_WALK_CACHE_TTL_MAX;
+	}
+
+	if (0 == ttl || NULL == (walk = (zbx_snmpwalk_t *)zbx_hashset_search(&snmpwalk, key)))
+		return NULL;
+
+	/* the entry is being filled by the caller, it was not walked yet */
+	if (0 == walk->lastwalk)
+		return NULL;
+
+	if (walk->lastwalk > now || now >= walk->lastwalk + ttl)
+		return NULL;
+
+	return walk;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: gets empty cache entry to store results of a new walk             *
+ *                                                                            *
+ * Parameters: key - [IN] the device, credentials and root OID of the walk    *
+ *                                                                            *
+ * Return value: the cache entry, it must be either set with                  *
+ *               zbx_snmp_walk_cache_set() or removed after the walk          *
+ *                                                                            *
+ * Comments: The cache is created by zbx_snmp_walk_cache_get(), which must be *
+ *           called first.                                                    *
+ *                                                                            *
+ ******************************************************************************/
+zbx_snmpwalk_t	*zbx_snmp_walk_cache_prepare(const zbx_snmpwalk_t *key)
+{
+	zbx_snmpwalk_t	*walk, walk_local;
+
+	if (NULL != (walk = (zbx_snmpwalk_t *)zbx_hashset_search(&snmpwalk, key)))
+	{
+		__snmpwalk_values_clear(&walk->values);
+		walk->lastwalk = 0;
+
+		return walk;
+	}
+
+	walk_local.addr = zbx_strdup(NULL, key->addr);
+	walk_local.port = key->port;
+	walk_local.oid = zbx_strdup(NULL, key->oid);
+	walk_local.community_context = zbx_strdup(NULL, key->community_context);
+	walk_local.security_name = zbx_strdup(NULL, key->security_name);
+	walk_local.lastwalk = 0;
+	zbx_vector_ptr_pair_create(&walk_local.values);
+
+	return (zbx_snmpwalk_t *)zbx_hashset_insert(&snmpwalk, &walk_local, sizeof(walk_local));
+}
+
+void	zbx_snmp_walk_cache_add(zbx_snmpwalk_t *walk, const char *index, const char *value)
+{
+	zbx_ptr_pair_t	pair;
+
+	pair.first = zbx_strdup(NULL, index);
+	pair.second = zbx_strdup(NULL, value);
+	zbx_vector_ptr_pair_append(&walk->values, pair);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: makes results of successful walk available to other items         *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_snmp_walk_cache_set(zbx_snmpwalk_t *walk, int now)
+{
+	walk->lastwalk = now;
+}
+
+void	zbx_snmp_walk_cache_remove(zbx_snmpwalk_t *walk)
+{
+	zbx_hashset_remove_direct(&snmpwalk, walk);
+}
+
+void	zbx_snmp_walk_cache_destroy(void)
+{
+	if (NULL != snmpwalk.slots)
+		zbx_hashset_destroy(&snmpwalk);
+}
@@ -0,0 +1,48 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#ifndef ZABBIX_SNMP_WALK_CACHE_H
+#define ZABBIX_SNMP_WALK_CACHE_H
+
+#include "common.h"
+#include "zbxalgo.h"
+
+#define ZBX_SNMP_WALK_CACHE_TTL_MAX	SEC_PER_MIN
+
+typedef struct
+{
+	char			*addr;
+	unsigned short		port;
+	char			*oid;
+	char			*community_context;	/* community (SNMPv1 or v2c) or contextName (SNMPv3) */
+	char			*security_name;		/* only SNMPv3, empty string in case of other versions */
+	int			lastwalk;
+	zbx_vector_ptr_pair_t	values;			/* walked (index, value) pairs in the order received */
+}
+zbx_snmpwalk_t;
+
+int		zbx_snmp_walk_cache_ttl(const char *delay);
+zbx_snmpwalk_t	*zbx_snmp_walk_cache_get(const zbx_snmpwalk_t *key, int ttl, int now);
+zbx_snmpwalk_t	*zbx_snmp_walk_cache_prepare(const zbx_snmpwalk_t *key);
+void		zbx_snmp_walk_cache_add(zbx_snmpwalk_t *walk, const char *index, const char *value);
+void		zbx_snmp_walk_cache_set(zbx_snmpwalk_t *walk, int now);
+void		zbx_snmp_walk_cache_remove(zbx_snmpwalk_t *walk);
+void		zbx_snmp_walk_cache_destroy(void);
+
+#endif
@@ -44,6 +44,9 @@
 #include "housekeeper/housekeeper.h"
 #include "pinger/pinger.h"
 #include "poller/poller.h"
+#include "poller/agent_poller.h"
+#include "poller/snmp_poller.h"
+#include "poller/httpagent_poller.h"
 #include "timer/timer.h"
 #include "trapper/trapper.h"
 #include "snmptrapper/snmptrapper.h"
@@ -220,6 +223,11 @@ int	CONFIG_REPORTWRITER_FORKS	= 0;
 int	CONFIG_SERVICEMAN_FORKS		= 1;
 int	CONFIG_TRIGGERHOUSEKEEPER_FORKS = 1;
 int	CONFIG_ODBCPOLLER_FORKS		= 1;
+int	CONFIG_AGENTPOLLER_FORKS	= 1;
+int	CONFIG_SNMPPOLLER_FORKS		= 0;
+int	CONFIG_HTTPAGENTPOLLER_FORKS	= 0;
+int	CONFIG_MAX_CONCURRENT_CHECKS	= 1000;
+int	CONFIG_MAX_CONCURRENT_HTTP_HOST_CHECKS	= 0;
 
 int	CONFIG_LISTEN_PORT		= ZBX_DEFAULT_SERVER_PORT;
 char	*CONFIG_LISTEN_IP		= NULL;
@@ -231,8 +239,12 @@ int	CONFIG_HOUSEKEEPING_FREQUENCY	= 1;
 int	CONFIG_MAX_HOUSEKEEPER_DELETE	= 5000;		/* applies for every separate field value */
 int	CONFIG_HISTSYNCER_FORKS		= 4;
 int	CONFIG_HISTSYNCER_FREQUENCY	= 1;
+int	CONFIG_HISTORY_WRITERS		= 0;
 int	CONFIG_CONFSYNCER_FORKS		= 1;
 int	CONFIG_CONFSYNCER_FREQUENCY	= 60;
+int	CONFIG_CONFSYNCER_FULL_FREQUENCY = 0;
+int	CONFIG_CONFSYNCER_WORKERS	= 0;
+int	CONFIG_SCHEDULER_SMOOTHING_WINDOW = 0;
 
 int	CONFIG_PROBLEMHOUSEKEEPING_FREQUENCY = 60;
 
@@ -244,9 +256,17 @@ int	CONFIG_VMWARE_TIMEOUT		= 10;
 zbx_uint64_t	CONFIG_CONF_CACHE_SIZE		= 32 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_HISTORY_CACHE_SIZE	= 16 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_HISTORY_INDEX_CACHE_SIZE	= 4 * ZBX_MEBIBYTE;
+int		CONFIG_HISTORY_CACHE_SHARDS	= 1;
 zbx_uint64_t	CONFIG_TRENDS_CACHE_SIZE	= 4 * ZBX_MEBIBYTE;
+int		CONFIG_TRENDS_FLUSH_PERIOD	= 0;
 static zbx_uint64_t	CONFIG_TREND_FUNC_CACHE_SIZE	= 4 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE		= 8 * ZBX_MEBIBYTE;
+static char	*CONFIG_CACHE_SNAPSHOT_FILE		= NULL;
+static char	*CONFIG_VALUE_CACHE_SNAPSHOT_FILE	= NULL;
+static char	*CONFIG_TREND_FUNC_CACHE_SNAPSHOT_FILE	= NULL;
+int		CONFIG_VALUE_CACHE_COMPRESSION	= 0;
+int		CONFIG_SHMEM_HUGE_PAGES		= 0;
+char		*CONFIG_SHMEM_NUMA_POLICY	= NULL;
 zbx_uint64_t	CONFIG_VMWARE_CACHE_SIZE	= 8 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_EXPORT_FILE_SIZE		= ZBX_GIBIBYTE;
 
@@ -259,6 +279,8 @@ char	*CONFIG_EXTERNALSCRIPTS		= NULL;
 char	*CONFIG_TMPDIR			= NULL;
 char	*CONFIG_FPING_LOCATION		= NULL;
 char	*CONFIG_FPING6_LOCATION		= NULL;
+int	CONFIG_NATIVE_ICMP_PING		= 0;
+int	CONFIG_NATIVE_ICMP_PING_RATE	= 10000;
 char	*CONFIG_DBHOST			= NULL;
 char	*CONFIG_DBNAME			= NULL;
 char	*CONFIG_DBSCHEMA		= NULL;
@@ -537,6 +559,21 @@ int	get_process_info_by_thread(int local_server_num, unsigned char *local_proces
 		*local_process_type = ZBX_PROCESS_TYPE_ODBCPOLLER;
 		*local_process_num = local_server_num - server_count + CONFIG_ODBCPOLLER_FORKS;
 	}
+	else if (local_server_num <= (server_count += CONFIG_AGENTPOLLER_FORKS))
+	{
+		*local_process_type = ZBX_PROCESS_TYPE_AGENT_POLLER;
+		*local_process_num = local_server_num - server_count + CONFIG_AGENTPOLLER_FORKS;
+	}
+	else if (local_server_num <= (server_count += CONFIG_SNMPPOLLER_FORKS))
+	{
+		*local_process_type = ZBX_PROCESS_TYPE_SNMP_POLLER;
+		*local_process_num = local_server_num - server_count + CONFIG_SNMPPOLLER_FORKS;
+	}
+	else if (local_server_num <= (server_count += CONFIG_HTTPAGENTPOLLER_FORKS))
+	{
+		*local_process_type = ZBX_PROCESS_TYPE_HTTPAGENT_POLLER;
+		*local_process_num = local_server_num - server_count + CONFIG_HTTPAGENTPOLLER_FORKS;
+	}
 	else
 		return FAIL;
 
@@ -623,10 +660,11 @@ static void	zbx_validate_config(ZBX_TASK_EX *task)
 	int		err = 0;
 	unsigned short	port;
 
-	if (0 == CONFIG_UNREACHABLE_POLLER_FORKS && 0 != CONFIG_POLLER_FORKS + CONFIG_JAVAPOLLER_FORKS)
+	if (0 == CONFIG_UNREACHABLE_POLLER_FORKS && 0 != CONFIG_POLLER_FORKS + CONFIG_JAVAPOLLER_FORKS +
+			CONFIG_AGENTPOLLER_FORKS + CONFIG_SNMPPOLLER_FORKS)
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "\"StartPollersUnreachable\" configuration parameter must not be 0"
-				" if regular or Java pollers are started");
+				" if regular, Java, agent or SNMP pollers are started");
 		err = 1;
 	}
 
@@ -636,6 +674,13 @@ static void	zbx_validate_config(ZBX_TASK_EX *task)
 		err = 1;
 	}
 
+	if (CONFIG_HISTORY_WRITERS >= CONFIG_HISTSYNCER_FORKS)
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "\"HistoryWriters\" configuration parameter must be less than"
+				" \"StartDBSyncers\"");
+		err = 1;
+	}
+
 	if (0 != CONFIG_VALUE_CACHE_SIZE && 128 * ZBX_KIBIBYTE > CONFIG_VALUE_CACHE_SIZE)
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "\"ValueCacheSize\" configuration parameter must be either 0"
@@ -726,6 +771,13 @@ static void	zbx_validate_config(ZBX_TASK_EX *task)
 #if !defined(HAVE_OPENIPMI)
 	err |= (FAIL == check_cfg_feature_int("StartIPMIPollers", CONFIG_IPMIPOLLER_FORKS, "IPMI support"));
 #endif
+#if !defined(HAVE_NETSNMP)
+	err |= (FAIL == check_cfg_feature_int("StartSNMPPollers", CONFIG_SNMPPOLLER_FORKS, "SNMP support"));
+#endif
+#if !defined(ZBX_HAVE_HTTPAGENT_POLLER)
+	err |= (FAIL == check_cfg_feature_int("StartHTTPAgentPollers", CONFIG_HTTPAGENTPOLLER_FORKS,
+			"cURL library 7.28.0 or newer"));
+#endif
 
 	err |= (FAIL == zbx_db_validate_config_features());
 
@@ -784,18 +836,42 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			1},
 		{"CacheSize",			&CONFIG_CONF_CACHE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(64) * ZBX_GIBIBYTE},
+		{"CacheSnapshotFile",		&CONFIG_CACHE_SNAPSHOT_FILE,		TYPE_STRING,
+			PARM_OPT,	0,			0},
+		{"SharedMemoryHugePages",	&CONFIG_SHMEM_HUGE_PAGES,		TYPE_INT,
+			PARM_OPT,	0,			1},
+		{"SharedMemoryNUMAPolicy",	&CONFIG_SHMEM_NUMA_POLICY,		TYPE_STRING,
+			PARM_OPT,	0,			0},
 		{"HistoryCacheSize",		&CONFIG_HISTORY_CACHE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
 		{"HistoryIndexCacheSize",	&CONFIG_HISTORY_INDEX_CACHE_SIZE,	TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
+		{"HistoryCacheShards",		&CONFIG_HISTORY_CACHE_SHARDS,		TYPE_INT,
+			PARM_OPT,	1,			ZBX_HC_SHARDS_MAX},
+		{"HistoryWriters",		&CONFIG_HISTORY_WRITERS,		TYPE_INT,
+			PARM_OPT,	0,			99},
 		{"TrendCacheSize",		&CONFIG_TRENDS_CACHE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
+		{"TrendFlushPeriod",		&CONFIG_TRENDS_FLUSH_PERIOD,		TYPE_INT,
+			PARM_OPT,	0,			SEC_PER_HOUR * 50 / 60},
 		{"TrendFunctionCacheSize",	&CONFIG_TREND_FUNC_CACHE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	0,			__UINT64_C(2) * ZBX_GIBIBYTE},
+		{"TrendFunctionCacheSnapshotFile",	&CONFIG_TREND_FUNC_CACHE_SNAPSHOT_FILE,	TYPE_STRING,
+			PARM_OPT,	0,			0},
 		{"ValueCacheSize",		&CONFIG_VALUE_CACHE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	0,			__UINT64_C(64) * ZBX_GIBIBYTE},
+		{"ValueCacheSnapshotFile",	&CONFIG_VALUE_CACHE_SNAPSHOT_FILE,	TYPE_STRING,
+			PARM_OPT,	0,			0},
+		{"ValueCacheCompression",	&CONFIG_VALUE_CACHE_COMPRESSION,	TYPE_INT,
+			PARM_OPT,	0,			1},
 		{"CacheUpdateFrequency",	&CONFIG_CONFSYNCER_FREQUENCY,		TYPE_INT,
 			PARM_OPT,	1,			SEC_PER_HOUR},
+		{"CacheFullUpdateFrequency",	&CONFIG_CONFSYNCER_FULL_FREQUENCY,	TYPE_INT,
+			PARM_OPT,	0,			SEC_PER_DAY},
+		{"CacheUpdateWorkers",		&CONFIG_CONFSYNCER_WORKERS,		TYPE_INT,
+			PARM_OPT,	0,			16},
+		{"SchedulerSmoothingWindow",	&CONFIG_SCHEDULER_SMOOTHING_WINDOW,	TYPE_INT,
+			PARM_OPT,	0,			SEC_PER_HOUR},
 		{"HousekeepingFrequency",	&CONFIG_HOUSEKEEPING_FREQUENCY,		TYPE_INT,
 			PARM_OPT,	0,			24},
 		{"MaxHousekeeperDelete",	&CONFIG_MAX_HOUSEKEEPER_DELETE,		TYPE_INT,
@@ -806,6 +882,10 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"Fping6Location",		&CONFIG_FPING6_LOCATION,		TYPE_STRING,
 			PARM_OPT,	0,			0},
+		{"NativeICMPPing",		&CONFIG_NATIVE_ICMP_PING,		TYPE_INT,
+			PARM_OPT,	0,			1},
+		{"NativeICMPPingRate",		&CONFIG_NATIVE_ICMP_PING_RATE,		TYPE_INT,
+			PARM_OPT,	0,			1000000},
 		{"Timeout",			&CONFIG_TIMEOUT,			TYPE_INT,
 			PARM_OPT,	1,			30},
 		{"TrapperTimeout",		&CONFIG_TRAPPER_TIMEOUT,		TYPE_INT,
@@ -970,6 +1050,16 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"StartODBCPollers",		&CONFIG_ODBCPOLLER_FORKS,		TYPE_INT,
 			PARM_OPT,	0,			1000},
+		{"StartAgentPollers",		&CONFIG_AGENTPOLLER_FORKS,		TYPE_INT,
+			PARM_OPT,	0,			1000},
+		{"StartSNMPPollers",		&CONFIG_SNMPPOLLER_FORKS,		TYPE_INT,
+			PARM_OPT,	0,			1000},
+		{"StartHTTPAgentPollers",	&CONFIG_HTTPAGENTPOLLER_FORKS,		TYPE_INT,
+			PARM_OPT,	0,			1000},
+		{"MaxConcurrentChecksPerPoller",	&CONFIG_MAX_CONCURRENT_CHECKS,	TYPE_INT,
+			PARM_OPT,	1,			100000},
+		{"MaxConcurrentHTTPChecksPerHost",	&CONFIG_MAX_CONCURRENT_HTTP_HOST_CHECKS,	TYPE_INT,
+			PARM_OPT,	0,			1000},
 		{NULL}
 	};
 
@@ -1033,6 +1123,30 @@ static void	zbx_on_exit(int ret)
 		DBconnect(ZBX_DB_CONNECT_EXIT);
 		free_database_cache(ZBX_SYNC_ALL);
 		DBclose();
+
+		/* configuration cache can be inconsistent if processes were terminated abnormally */
+		if (NULL != CONFIG_CACHE_SNAPSHOT_FILE && SUCCEED == ret &&
+				SUCCEED != zbx_dc_save_snapshot(CONFIG_CACHE_SNAPSHOT_FILE, &error))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot save configuration cache snapshot: %s", error);
+			zbx_free(error);
+		}
+
+		/* value cache can be left mid-update by history syncers terminated abnormally */
+		if (NULL != CONFIG_VALUE_CACHE_SNAPSHOT_FILE && SUCCEED == ret &&
+				SUCCEED != zbx_vc_save_snapshot(CONFIG_VALUE_CACHE_SNAPSHOT_FILE, &error))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot save value cache snapshot: %s", error);
+			zbx_free(error);
+		}
+
+		/* trend function cache can be left mid-update by processes terminated abnormally */
+		if (NULL != CONFIG_TREND_FUNC_CACHE_SNAPSHOT_FILE && SUCCEED == ret &&
+				SUCCEED != zbx_tfc_save_snapshot(CONFIG_TREND_FUNC_CACHE_SNAPSHOT_FILE, &error))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot save trend function cache snapshot: %s", error);
+			zbx_free(error);
+		}
 	}
 
 	if (SUCCEED != zbx_ha_stop(&error))
@@ -1270,6 +1384,36 @@ static void	zbx_check_db(void)
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Purpose: check if value cache or trend function cache snapshot can be used *
+ *                                                                            *
+ * Parameters: saved - [IN] the snapshot write time                           *
+ *                                                                            *
+ * Return value: SUCCEED - the snapshot can be used                           *
+ *               FAIL    - another cluster node could have written history    *
+ *                         or trends since the snapshot was saved             *
+ *                                                                            *
+ ******************************************************************************/
+static int	server_validate_snapshot(int saved)
+{
+	DB_RESULT	result;
+	char		*name_esc;
+	int		ret;
+
+	name_esc = DBdyn_escape_string(ZBX_NULL2EMPTY_STR(CONFIG_HA_NODE_NAME));
+
+	result = DBselect("select null from ha_node where name<>'%s' and status<>%d and lastaccess>=%d",
+			name_esc, ZBX_NODE_STATUS_STANDBY, saved);
+
+	ret = (NULL == result || NULL != DBfetch(result) ? FAIL : SUCCEED);
+
+	DBfree_result(result);
+	zbx_free(name_esc);
+
+	return ret;
+}
+
 /******************************************************************************
  *                                                                            *
  * Purpose: initialize shared resources and start processes                   *
@@ -1294,6 +1438,19 @@ static int	server_startup(zbx_socket_t *listen_sock, int *ha_stat, int *ha_failo
 		return FAIL;
 	}
 
+	if (NULL != CONFIG_CACHE_SNAPSHOT_FILE)
+	{
+		DBconnect(ZBX_DB_CONNECT_NORMAL);
+
+		if (SUCCEED != zbx_dc_load_snapshot(CONFIG_CACHE_SNAPSHOT_FILE, server_validate_snapshot, &error))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot load configuration cache snapshot: %s", error);
+			zbx_free(error);
+		}
+
+		DBclose();
+	}
+
 	if (SUCCEED != init_selfmon_collector(&error))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "cannot initialize self-monitoring: %s", error);
@@ -1342,7 +1499,8 @@ static int	server_startup(zbx_socket_t *listen_sock, int *ha_stat, int *ha_failo
 			+ CONFIG_LLDMANAGER_FORKS + CONFIG_LLDWORKER_FORKS + CONFIG_ALERTDB_FORKS
 			+ CONFIG_HISTORYPOLLER_FORKS + CONFIG_AVAILMAN_FORKS + CONFIG_REPORTMANAGER_FORKS
 			+ CONFIG_REPORTWRITER_FORKS + CONFIG_SERVICEMAN_FORKS + CONFIG_TRIGGERHOUSEKEEPER_FORKS
-			+ CONFIG_ODBCPOLLER_FORKS;
+			+ CONFIG_ODBCPOLLER_FORKS + CONFIG_AGENTPOLLER_FORKS + CONFIG_SNMPPOLLER_FORKS
+			+ CONFIG_HTTPAGENTPOLLER_FORKS;
 	threads = (pid_t *)zbx_calloc(threads, (size_t)threads_num, sizeof(pid_t));
 	threads_flags = (int *)zbx_calloc(threads_flags, (size_t)threads_num, sizeof(int));
 
@@ -1401,6 +1559,23 @@ static int	server_startup(zbx_socket_t *listen_sock, int *ha_stat, int *ha_failo
 				/* update maintenance states */
 				zbx_dc_update_maintenances();
 
+				if (NULL != CONFIG_VALUE_CACHE_SNAPSHOT_FILE && SUCCEED != zbx_vc_load_snapshot(
+						CONFIG_VALUE_CACHE_SNAPSHOT_FILE, server_validate_snapshot, &error))
+				{
+					zabbix_log(LOG_LEVEL_WARNING, "cannot load value cache snapshot: %s", error);
+					zbx_free(error);
+				}
+
+				/* trend function cache can be left mid-update by processes terminated abnormally */
+		if (NULL != CONFIG_TREND_FUNC_CACHE_SNAPSHOT_FILE && SUCCEED == ret &&
+						SUCCEED != zbx_tfc_load_snapshot(CONFIG_TREND_FUNC_CACHE_SNAPSHOT_FILE,
+						server_validate_snapshot, &error))
+				{
+					zabbix_log(LOG_LEVEL_WARNING, "cannot load trend function cache snapshot: %s",
+							error);
+					zbx_free(error);
+				}
+
 				DBclose();
 
 				zbx_vc_enable();
@@ -1513,6 +1688,19 @@ static int	server_startup(zbx_socket_t *listen_sock, int *ha_stat, int *ha_failo
 				thread_args.args = &poller_type;
 				zbx_thread_start(poller_thread, &thread_args, &threads[i]);
 				break;
+			case ZBX_PROCESS_TYPE_AGENT_POLLER:
+				zbx_thread_start(agent_poller_thread, &thread_args, &threads[i]);
+				break;
+#ifdef HAVE_NETSNMP
+			case ZBX_PROCESS_TYPE_SNMP_POLLER:
+				zbx_thread_start(snmp_poller_thread, &thread_args, &threads[i]);
+				break;
+#endif
+#ifdef ZBX_HAVE_HTTPAGENT_POLLER
+			case ZBX_PROCESS_TYPE_HTTPAGENT_POLLER:
+				zbx_thread_start(httpagent_poller_thread, &thread_args, &threads[i]);
+				break;
+#endif
 		}
 	}
 
@@ -77,6 +77,7 @@ void	zbx_get_zabbix_stats_ext(struct zbx_json *json)
 		zbx_json_adduint64(json, "hits", vc_stats.hits);
 		zbx_json_adduint64(json, "misses", vc_stats.misses);
 		zbx_json_addint64(json, "mode", vc_stats.mode);
+		zbx_json_addfloat(json, "compression", vc_stats.compression_ratio);
 		zbx_json_close(json);
 
 		zbx_json_close(json);
@@ -32,6 +32,7 @@ AC_DEFUN([CONF_TESTS],
 		tests/libs/zbxdbhigh/Makefile
 		tests/libs/zbxeval/Makefile
 		tests/libs/zbxhistory/Makefile
+		tests/libs/zbxicmpping/Makefile
 		tests/libs/zbxjson/Makefile
 		tests/libs/zbxprometheus/Makefile
 		tests/libs/zbxregexp/Makefile
@@ -40,6 +41,7 @@ AC_DEFUN([CONF_TESTS],
 		tests/libs/zbxsysinfo/common/Makefile
 		tests/libs/zbxtrends/Makefile
 		tests/zabbix_server/Makefile
+		tests/zabbix_server/poller/Makefile
 		tests/zabbix_server/preprocessor/Makefile
 		tests/zabbix_server/service/Makefile
 		tests/zabbix_server/trapper/Makefile
@@ -0,0 +1,186 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "zbxalgo.h"
+
+typedef struct
+{
+	zbx_uint64_t	key;
+	int		time;
+}
+zbx_tw_element_t;
+
+static int	tw_element_compare(const void *d1, const void *d2)
+{
+	const zbx_binary_heap_elem_t	*e1 = (const zbx_binary_heap_elem_t *)d1;
+	const zbx_binary_heap_elem_t	*e2 = (const zbx_binary_heap_elem_t *)d2;
+
+	const zbx_tw_element_t		*el1 = (const zbx_tw_element_t *)e1->data;
+	const zbx_tw_element_t		*el2 = (const zbx_tw_element_t *)e2->data;
+
+	ZBX_RETURN_IF_NOT_EQUAL(el1->time, el2->time);
+	ZBX_RETURN_IF_NOT_EQUAL(el1->key, el2->key);
+
+	return 0;
+}
+
+static zbx_tw_element_t	*tw_get_element(zbx_hashset_t *elements, zbx_uint64_t key)
+{
+	zbx_tw_element_t	*element;
+
+	if (NULL == (element = (zbx_tw_element_t *)zbx_hashset_search(elements, &key)))
+		fail_msg("unknown element " ZBX_FS_UI64, key);
+
+	return element;
+}
+
+static void	tw_check_due(zbx_timing_wheel_t *wheel, zbx_hashset_t *elements, zbx_mock_handle_t hkeys)
+{
+	zbx_mock_handle_t	hkey;
+	zbx_mock_error_t	err;
+	zbx_binary_heap_elem_t	*elem;
+	zbx_uint64_t		key;
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = (zbx_mock_vector_element(hkeys, &hkey))))
+	{
+		if (ZBX_MOCK_SUCCESS != err || ZBX_MOCK_SUCCESS != (err = zbx_mock_uint64(hkey, &key)))
+			fail_msg("Cannot read due element key: %s", zbx_mock_error_string(err));
+
+		if (NULL == (elem = zbx_timing_wheel_find_due(wheel)))
+			fail_msg("expected due element " ZBX_FS_UI64 " but there are no due elements", key);
+
+		zbx_mock_assert_uint64_eq("due element key", key, elem->key);
+		zbx_timing_wheel_remove_due(wheel);
+		zbx_hashset_remove(elements, &key);
+	}
+
+	if (NULL != (elem = zbx_timing_wheel_find_due(wheel)))
+		fail_msg("unexpected due element " ZBX_FS_UI64, elem->key);
+}
+
+static void	tw_check_slots(const zbx_timing_wheel_t *wheel, zbx_mock_handle_t hslots)
+{
+	zbx_mock_handle_t	hslot;
+	zbx_mock_error_t	err;
+	zbx_uint64_t		slots_used[ZBX_TIMING_WHEEL_LEVELS] = {0};
+	int			level, index;
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = (zbx_mock_vector_element(hslots, &hslot))))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read slot: %s", zbx_mock_error_string(err));
+
+		level = zbx_mock_get_object_member_int(hslot, "level");
+		index = zbx_mock_get_object_member_int(hslot, "index");
+
+		if (ZBX_TIMING_WHEEL_LEVELS <= level || ZBX_TIMING_WHEEL_SLOTS <= index)
+			fail_msg("invalid slot %d:%d", level, index);
+
+		slots_used[level] |= (zbx_uint64_t)1 << index;
+	}
+
+	for (level = 0; level < ZBX_TIMING_WHEEL_LEVELS; level++)
+		zbx_mock_assert_uint64_eq("used slots", slots_used[level], wheel->slots_used[level]);
+}
+
+static void	tw_check_nexttime(zbx_timing_wheel_t *wheel, zbx_mock_handle_t hstep)
+{
+	int	ret, time;
+
+	ret = zbx_timing_wheel_get_nexttime(wheel, &time);
+	zbx_mock_assert_result_eq("get_nexttime result",
+			zbx_mock_str_to_return_code(zbx_mock_get_object_member_string(hstep, "return")), ret);
+
+	if (SUCCEED == ret)
+		zbx_mock_assert_int_eq("next time", zbx_mock_get_object_member_int(hstep, "time"), time);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_timing_wheel_t	wheel;
+	zbx_hashset_t		elements;
+	zbx_tw_element_t	element_local, *element;
+	zbx_mock_handle_t	hsteps, hstep;
+	zbx_mock_error_t	err;
+	const char		*action;
+
+	ZBX_UNUSED(state);
+
+	zbx_hashset_create(&elements, 100, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_timing_wheel_create(&wheel, tw_element_compare, (int)zbx_mock_get_parameter_uint64("in.time"));
+
+	hsteps = zbx_mock_get_parameter_handle("in.steps");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = (zbx_mock_vector_element(hsteps, &hstep))))
+	{
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("Cannot read step: %s", zbx_mock_error_string(err));
+
+		action = zbx_mock_get_object_member_string(hstep, "action");
+
+		if (0 == strcmp(action, "insert"))
+		{
+			element_local.key = zbx_mock_get_object_member_uint64(hstep, "key");
+			element_local.time = zbx_mock_get_object_member_int(hstep, "time");
+			element = (zbx_tw_element_t *)zbx_hashset_insert(&elements, &element_local,
+					sizeof(element_local));
+
+			zbx_timing_wheel_insert(&wheel, element->key, element, element->time);
+		}
+		else if (0 == strcmp(action, "update"))
+		{
+			element = tw_get_element(&elements, zbx_mock_get_object_member_uint64(hstep, "key"));
+			element->time = zbx_mock_get_object_member_int(hstep, "time");
+
+			zbx_timing_wheel_update(&wheel, element->key, element->time);
+		}
+		else if (0 == strcmp(action, "remove"))
+		{
+			element = tw_get_element(&elements, zbx_mock_get_object_member_uint64(hstep, "key"));
+
+			zbx_timing_wheel_remove(&wheel, element->key);
+			zbx_hashset_remove_direct(&elements, element);
+		}
+		else if (0 == strcmp(action, "clear"))
+		{
+			zbx_timing_wheel_clear(&wheel, zbx_mock_get_object_member_int(hstep, "now"));
+			zbx_hashset_clear(&elements);
+		}
+		else if (0 == strcmp(action, "advance"))
+			zbx_timing_wheel_advance(&wheel, zbx_mock_get_object_member_int(hstep, "now"));
+		else if (0 == strcmp(action, "due"))
+			tw_check_due(&wheel, &elements, zbx_mock_get_object_member_handle(hstep, "keys"));
+		else if (0 == strcmp(action, "slots"))
+			tw_check_slots(&wheel, zbx_mock_get_object_member_handle(hstep, "used"));
+		else if (0 == strcmp(action, "nexttime"))
+			tw_check_nexttime(&wheel, hstep);
+		else
+			fail_msg("unknown action: %s", action);
+
+		zbx_mock_assert_int_eq("number of elements", elements.num_data, zbx_timing_wheel_num(&wheel));
+	}
+
+	zbx_timing_wheel_destroy(&wheel);
+	zbx_hashset_destroy(&elements);
+}
@@ -94,6 +94,8 @@ static unsigned char str2pollertype(const char *str)
 		_ZBX_MKMAP(ZBX_POLLER_TYPE_UNREACHABLE),	_ZBX_MKMAP(ZBX_POLLER_TYPE_IPMI),
 		_ZBX_MKMAP(ZBX_POLLER_TYPE_PINGER),		_ZBX_MKMAP(ZBX_POLLER_TYPE_JAVA),
 		_ZBX_MKMAP(ZBX_POLLER_TYPE_HISTORY), _ZBX_MKMAP(ZBX_POLLER_TYPE_ODBC),
+		_ZBX_MKMAP(ZBX_POLLER_TYPE_AGENT),		_ZBX_MKMAP(ZBX_POLLER_TYPE_SNMP),
+		_ZBX_MKMAP(ZBX_POLLER_TYPE_HTTPAGENT),
 		{ 0 }
 	};
 
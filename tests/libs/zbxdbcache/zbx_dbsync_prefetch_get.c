@@ -0,0 +1,391 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "db.h"
+#include "dbsync_prefetch.h"
+
+#ifdef ZBX_DBSYNC_PREFETCH
+
+#define MOCK_QUERIES_MAX	32
+#define MOCK_IDLE_PERIOD	50000	/* microseconds without worker activity to consider workers idle */
+#define MOCK_IDLE_CHECKS	100	/* number of periods before the test gives up waiting for workers */
+
+#define MOCK_QUERY_NONE		0	/* query is not queued */
+#define MOCK_QUERY_SUCCEED	1	/* query returns result */
+#define MOCK_QUERY_FAIL		2	/* query fails */
+#define MOCK_QUERY_DOWN		3	/* database connection is lost during query */
+
+struct zbx_db_result
+{
+	int	query;
+};
+
+static pthread_mutex_t	mock_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int	mock_queries[MOCK_QUERIES_MAX];
+static int	mock_connect_results[MOCK_QUERIES_MAX];
+static int	mock_connect_results_num;
+
+static int	mock_connects_num;
+static int	mock_connections_num;
+static int	mock_selects_num;
+static int	mock_selects_running;
+static int	mock_results_num;
+static int	mock_results_max;
+static int	mock_workers_num;
+static int	mock_violations_num;
+
+static ZBX_THREAD_LOCAL int	mock_worker;
+static ZBX_THREAD_LOCAL int	mock_connected;
+
+/* assertions cannot be made from worker threads, violations are counted and checked by the test instead */
+static void	mock_violation(void)
+{
+	pthread_mutex_lock(&mock_lock);
+	mock_violations_num++;
+	pthread_mutex_unlock(&mock_lock);
+}
+
+void	zbx_db_init_worker_options(void)
+{
+	mock_worker = 1;
+
+	pthread_mutex_lock(&mock_lock);
+	mock_workers_num++;
+	pthread_mutex_unlock(&mock_lock);
+}
+
+int	DBconnect(int flag)
+{
+	int	ret;
+
+	if (ZBX_DB_CONNECT_ONCE != flag || 0 == mock_worker || 0 != mock_connected)
+		mock_violation();
+
+	pthread_mutex_lock(&mock_lock);
+
+	/* the last result is repeated */
+	ret = mock_connect_results[MIN(mock_connects_num, mock_connect_results_num - 1)];
+	mock_connects_num++;
+
+	if (ZBX_DB_OK == ret)
+		mock_connections_num++;
+
+	pthread_mutex_unlock(&mock_lock);
+
+	if (ZBX_DB_OK == ret)
+		mock_connected = 1;
+
+	return ret;
+}
+
+void	DBclose(void)
+{
+	if (0 == mock_connected)
+		mock_violation();
+
+	mock_connected = 0;
+
+	pthread_mutex_lock(&mock_lock);
+	mock_connections_num--;
+	pthread_mutex_unlock(&mock_lock);
+}
+
+DB_RESULT	DBselect_once(const char *fmt, ...)
+{
+	va_list		args;
+	char		*sql;
+	int		query;
+	DB_RESULT	result;
+
+	va_start(args, fmt);
+	sql = zbx_dvsprintf(NULL, fmt, args);
+	va_end(args);
+
+	if (0 == mock_connected || 1 != sscanf(sql, "query %d", &query) || 0 > query || MOCK_QUERIES_MAX <= query)
+	{
+		mock_violation();
+		zbx_free(sql);
+		return NULL;
+	}
+
+	zbx_free(sql);
+
+	pthread_mutex_lock(&mock_lock);
+	mock_selects_num++;
+	mock_selects_running++;
+	pthread_mutex_unlock(&mock_lock);
+
+	/* give configuration syncer a chance to run while the query is executed */
+	usleep(1000);
+
+	switch (mock_queries[query])
+	{
+		case MOCK_QUERY_SUCCEED:
+			result = (DB_RESULT)zbx_malloc(NULL, sizeof(struct zbx_db_result));
+			result->query = query;
+			break;
+		case MOCK_QUERY_DOWN:
+			result = (DB_RESULT)ZBX_DB_DOWN;
+			break;
+		default:
+			result = NULL;
+	}
+
+	pthread_mutex_lock(&mock_lock);
+
+	mock_selects_running--;
+
+	if (NULL != result && (DB_RESULT)ZBX_DB_DOWN != result)
+	{
+		/* includes the result taken by configuration syncer and not freed yet */
+		if (++mock_results_num > mock_results_max)
+			mock_results_max = mock_results_num;
+	}
+
+	pthread_mutex_unlock(&mock_lock);
+
+	return result;
+}
+
+void	DBfree_result(DB_RESULT result)
+{
+	if (NULL == result)
+		return;
+
+	zbx_free(result);
+
+	pthread_mutex_lock(&mock_lock);
+	mock_results_num--;
+	pthread_mutex_unlock(&mock_lock);
+}
+
+static void	mock_get_sql(int query, char **sql, size_t *sql_alloc, size_t *sql_offset)
+{
+	zbx_snprintf_alloc(sql, sql_alloc, sql_offset, "query %d", query);
+}
+
+static int	mock_str_to_query(const char *str)
+{
+	if (0 == strcmp(str, "NONE"))
+		return MOCK_QUERY_NONE;
+
+	if (0 == strcmp(str, "SUCCEED"))
+		return MOCK_QUERY_SUCCEED;
+
+	if (0 == strcmp(str, "FAIL"))
+		return MOCK_QUERY_FAIL;
+
+	if (0 == strcmp(str, "DOWN"))
+		return MOCK_QUERY_DOWN;
+
+	fail_msg("unknown query result \"%s\"", str);
+	return FAIL;
+}
+
+static int	mock_str_to_db_code(const char *str)
+{
+	if (0 == strcmp(str, "ZBX_DB_OK"))
+		return ZBX_DB_OK;
+
+	if (0 == strcmp(str, "ZBX_DB_DOWN"))
+		return ZBX_DB_DOWN;
+
+	if (0 == strcmp(str, "ZBX_DB_FAIL"))
+		return ZBX_DB_FAIL;
+
+	fail_msg("unknown database result code \"%s\"", str);
+	return FAIL;
+}
+
+static int	mock_read_strings(const char *path, int (*str_to_int)(const char *), int *values)
+{
+	zbx_mock_handle_t	hvalues, hvalue;
+	zbx_mock_error_t	err;
+	const char		*str;
+	int			values_num = 0;
+
+	hvalues = zbx_mock_get_parameter_handle(path);
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hvalues, &hvalue)))
+	{
+		if (ZBX_MOCK_SUCCESS != err || ZBX_MOCK_SUCCESS != (err = zbx_mock_string(hvalue, &str)))
+			fail_msg("cannot read \"%s\": %s", path, zbx_mock_error_string(err));
+
+		if (MOCK_QUERIES_MAX <= values_num)
+			fail_msg("too many values in \"%s\"", path);
+
+		values[values_num++] = str_to_int(str);
+	}
+
+	return values_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: waits until workers have executed all queries they can start      *
+ *                                                                            *
+ * Return value: the number of queries executed by workers                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	mock_wait_idle(void)
+{
+	int	i, connects_num, selects_num;
+
+	pthread_mutex_lock(&mock_lock);
+	connects_num = mock_connects_num;
+	selects_num = mock_selects_num;
+	pthread_mutex_unlock(&mock_lock);
+
+	for (i = 0; i < MOCK_IDLE_CHECKS; i++)
+	{
+		int	idle;
+
+		usleep(MOCK_IDLE_PERIOD);
+
+		pthread_mutex_lock(&mock_lock);
+
+		idle = (connects_num == mock_connects_num && selects_num == mock_selects_num &&
+				0 == mock_selects_running);
+
+		connects_num = mock_connects_num;
+		selects_num = mock_selects_num;
+
+		pthread_mutex_unlock(&mock_lock);
+
+		if (0 != idle)
+			return selects_num;
+	}
+
+	fail_msg("workers did not become idle");
+	return FAIL;
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_mock_handle_t	hsteps, hstep, hvalue;
+	zbx_mock_error_t	err;
+	unsigned char		queued[MOCK_QUERIES_MAX];
+	int			i, workers_num, queries_num, syncs_num = 1, sync, selects_base;
+
+	ZBX_UNUSED(state);
+
+	workers_num = (int)zbx_mock_get_parameter_uint64("in.workers");
+	queries_num = mock_read_strings("in.queries", mock_str_to_query, mock_queries);
+	mock_connect_results_num = mock_read_strings("in.connect", mock_str_to_db_code, mock_connect_results);
+
+	if (0 == mock_connect_results_num)
+		fail_msg("at least one connection result must be specified");
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter("in.syncs", &hvalue))
+		syncs_num = (int)zbx_mock_get_parameter_uint64("in.syncs");
+
+	for (i = 0; i < queries_num; i++)
+		queued[i] = (MOCK_QUERY_NONE != mock_queries[i]);
+
+	/* results are not prefetched before workers are started */
+	zbx_mock_assert_ptr_eq("result without workers", NULL, zbx_dbsync_prefetch_get(0));
+
+	zbx_mock_assert_int_eq("started workers", workers_num, zbx_dbsync_prefetch_init(workers_num, queries_num,
+			mock_get_sql));
+
+	for (sync = 0; sync < syncs_num; sync++)
+	{
+		selects_base = mock_wait_idle();
+		zbx_dbsync_prefetch_start(queued);
+
+		hsteps = zbx_mock_get_parameter_handle("in.steps");
+
+		while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hsteps, &hstep)))
+		{
+			DB_RESULT	result;
+			int		query;
+			const char	*expected;
+
+			if (ZBX_MOCK_SUCCESS != err)
+				fail_msg("cannot read step: %s", zbx_mock_error_string(err));
+
+			query = zbx_mock_get_object_member_int(hstep, "get");
+			expected = zbx_mock_get_object_member_string(hstep, "result");
+
+			zbx_mock_assert_int_eq("queries executed by workers before getting result",
+					zbx_mock_get_object_member_int(hstep, "selects"), mock_wait_idle() - selects_base);
+
+			result = zbx_dbsync_prefetch_get(query);
+
+			if (0 == strcmp(expected, "prefetched"))
+			{
+				zbx_mock_assert_ptr_ne("prefetched result", NULL, result);
+				zbx_mock_assert_int_eq("prefetched result query", query, result->query);
+			}
+			else if (0 == strcmp(expected, "none"))
+				zbx_mock_assert_ptr_eq("prefetched result", NULL, result);
+			else
+				fail_msg("unknown expected result \"%s\"", expected);
+
+			DBfree_result(result);
+		}
+
+		if (ZBX_MOCK_SUCCESS == zbx_mock_parameter("in.teardown", &hvalue))
+			break;
+
+		zbx_dbsync_prefetch_clear();
+		zbx_mock_assert_int_eq("results left after clearing", 0, mock_results_num);
+	}
+
+	zbx_dbsync_prefetch_destroy();
+
+	zbx_mock_assert_int_eq("results left after teardown", 0, mock_results_num);
+	zbx_mock_assert_int_eq("connections left after teardown", 0, mock_connections_num);
+	zbx_mock_assert_int_eq("workers using settings of main connection", workers_num, mock_workers_num);
+	zbx_mock_assert_int_eq("database API misuse by workers", 0, mock_violations_num);
+
+	/* each worker keeps at most one result ahead of the result being compared */
+	if (mock_results_max > workers_num + 1)
+	{
+		fail_msg("%d results were prefetched at the same time, expected at most %d", mock_results_max,
+				workers_num + 1);
+	}
+
+	if (ZBX_MOCK_SUCCESS == zbx_mock_parameter("out.connects", &hvalue))
+	{
+		zbx_mock_assert_int_eq("database connections", (int)zbx_mock_get_parameter_uint64("out.connects"),
+				mock_connects_num);
+	}
+
+	/* configuration syncer executes queries itself after workers are stopped */
+	zbx_mock_assert_ptr_eq("result after teardown", NULL, zbx_dbsync_prefetch_get(0));
+}
+
+#else
+
+void	zbx_mock_test_entry(void **state)
+{
+	ZBX_UNUSED(state);
+
+	skip();
+}
+
+#endif
@@ -0,0 +1,223 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "../../../src/libs/zbxicmpping/icmpengine.h"
+
+typedef struct
+{
+	double	time;
+	int	target;
+	int	packet;
+}
+mock_reply_t;
+
+ZBX_PTR_VECTOR_DECL(mock_reply, mock_reply_t *)
+ZBX_PTR_VECTOR_IMPL(mock_reply, mock_reply_t *)
+
+static int	mock_reply_compare(const void *d1, const void *d2)
+{
+	const mock_reply_t	*r1 = *(const mock_reply_t * const *)d1;
+	const mock_reply_t	*r2 = *(const mock_reply_t * const *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(r1->time, r2->time);
+
+	return 0;
+}
+
+static void	mock_reply_free(mock_reply_t *reply)
+{
+	zbx_free(reply);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: reads reply delay of the packet, negative delay means the packet  *
+ *          is lost                                                           *
+ *                                                                            *
+ ******************************************************************************/
+static double	mock_get_reply_delay(zbx_mock_handle_t htarget, int packet)
+{
+	zbx_mock_handle_t	hreplies, hdelay;
+	zbx_mock_error_t	err;
+	double			delay = -1;
+	int			i;
+
+	if (ZBX_MOCK_SUCCESS != zbx_mock_object_member(htarget, "replies", &hreplies))
+		return -1;
+
+	for (i = 0; i <= packet; i++)
+	{
+		if (ZBX_MOCK_SUCCESS != (err = zbx_mock_vector_element(hreplies, &hdelay)))
+			return -1;
+	}
+
+	if (ZBX_MOCK_SUCCESS != (err = zbx_mock_float(hdelay, &delay)))
+		fail_msg("Cannot read reply delay: %s", zbx_mock_error_string(err));
+
+	return delay;
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_icmp_engine_t		engine;
+	ZBX_FPING_HOST			*hosts;
+	zbx_mock_handle_t		htargets, htarget, hschedule, hsend, hhosts, hhost;
+	zbx_mock_error_t		err;
+	zbx_vector_mock_reply_t		replies;
+	zbx_vector_ptr_pair_t		sends;
+	int				i, hosts_num = 0, index, count;
+	double				now = 0, at;
+
+	ZBX_UNUSED(state);
+
+	zbx_vector_mock_reply_create(&replies);
+	zbx_vector_ptr_pair_create(&sends);
+
+	htargets = zbx_mock_get_parameter_handle("in.targets");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(htargets, &htarget)))
+		hosts_num++;
+
+	hosts = (ZBX_FPING_HOST *)zbx_calloc(NULL, (size_t)MAX(hosts_num, 1), sizeof(ZBX_FPING_HOST));
+	count = (int)zbx_mock_get_parameter_uint64("in.count");
+
+	zbx_icmp_engine_init(&engine, hosts, hosts_num, count, (int)zbx_mock_get_parameter_uint64("in.period"),
+			0, (int)zbx_mock_get_parameter_uint64("in.timeout"), (int)zbx_mock_get_parameter_uint64("in.rate"),
+			0);
+
+	htargets = zbx_mock_get_parameter_handle("in.targets");
+
+	for (i = 0; i < hosts_num; i++)
+	{
+		zbx_mock_vector_element(htargets, &htarget);
+		hosts[i].addr = (char *)zbx_mock_get_object_member_string(htarget, "address");
+		engine.targets[i].resolved = (0 == strcmp(zbx_mock_get_object_member_string(htarget, "resolved"),
+				"yes") ? 1 : 0);
+	}
+
+	zbx_icmp_engine_start(&engine);
+
+	/* simulate sockets with virtual clock */
+	while (1)
+	{
+		double	wakeup;
+
+		while (FAIL != (index = zbx_icmp_engine_next(&engine, &at)) && at <= now)
+		{
+			zbx_ptr_pair_t	pair;
+			double		delay;
+
+			htargets = zbx_mock_get_parameter_handle("in.targets");
+
+			for (i = 0; i <= index; i++)
+				zbx_mock_vector_element(htargets, &htarget);
+
+			if (0 <= (delay = mock_get_reply_delay(htarget, engine.round)))
+			{
+				mock_reply_t	*reply;
+
+				reply = (mock_reply_t *)zbx_malloc(NULL, sizeof(mock_reply_t));
+				reply->time = now + delay;
+				reply->target = index;
+				reply->packet = engine.round;
+				zbx_vector_mock_reply_append(&replies, reply);
+				zbx_vector_mock_reply_sort(&replies, mock_reply_compare);
+			}
+
+			pair.first = (void *)(intptr_t)index;
+			pair.second = zbx_malloc(NULL, sizeof(double));
+			*(double *)pair.second = now;
+			zbx_vector_ptr_pair_append(&sends, pair);
+
+			zbx_icmp_engine_sent(&engine, at, now);
+		}
+
+		if (SUCCEED == zbx_icmp_engine_done(&engine, now))
+			break;
+
+		wakeup = (FAIL != index ? at : zbx_icmp_engine_deadline(&engine));
+
+		if (0 != replies.values_num && replies.values[0]->time < wakeup)
+			wakeup = replies.values[0]->time;
+
+		now = wakeup;
+
+		while (0 != replies.values_num && replies.values[0]->time <= now)
+		{
+			mock_reply_t	*reply = replies.values[0];
+
+			zbx_icmp_engine_reply(&engine, reply->target, reply->packet, reply->time);
+			zbx_vector_mock_reply_remove(&replies, 0);
+			mock_reply_free(reply);
+		}
+	}
+
+	zbx_icmp_engine_finish(&engine);
+
+	hschedule = zbx_mock_get_parameter_handle("out.schedule");
+
+	for (i = 0; ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hschedule, &hsend)); i++)
+	{
+		if (i >= sends.values_num)
+			fail_msg("expected more than %d packets to be sent", sends.values_num);
+
+		zbx_mock_assert_int_eq("target", zbx_mock_get_object_member_int(hsend, "target"),
+				(int)(intptr_t)sends.values[i].first);
+		zbx_mock_assert_double_eq("send time", zbx_mock_get_object_member_float(hsend, "time"),
+				*(double *)sends.values[i].second);
+	}
+
+	zbx_mock_assert_int_eq("number of sent packets", i, sends.values_num);
+	zbx_mock_assert_double_eq("end time", zbx_mock_get_parameter_float("out.end"), now);
+
+	hhosts = zbx_mock_get_parameter_handle("out.hosts");
+
+	for (i = 0; ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hhosts, &hhost)); i++)
+	{
+		if (i >= hosts_num)
+			fail_msg("expected more than %d hosts", hosts_num);
+
+		zbx_mock_assert_int_eq("cnt", zbx_mock_get_object_member_int(hhost, "cnt"), hosts[i].cnt);
+		zbx_mock_assert_int_eq("rcv", zbx_mock_get_object_member_int(hhost, "rcv"), hosts[i].rcv);
+
+		if (0 != hosts[i].rcv)
+		{
+			zbx_mock_assert_double_eq("min", zbx_mock_get_object_member_float(hhost, "min"), hosts[i].min);
+			zbx_mock_assert_double_eq("max", zbx_mock_get_object_member_float(hhost, "max"), hosts[i].max);
+			zbx_mock_assert_double_eq("sum", zbx_mock_get_object_member_float(hhost, "sum"), hosts[i].sum);
+		}
+	}
+
+	zbx_mock_assert_int_eq("number of hosts", i, hosts_num);
+
+	for (i = 0; i < sends.values_num; i++)
+		zbx_free(sends.values[i].second);
+
+	zbx_vector_ptr_pair_destroy(&sends);
+	zbx_vector_mock_reply_clear_ext(&replies, mock_reply_free);
+	zbx_vector_mock_reply_destroy(&replies);
+	zbx_icmp_engine_clear(&engine);
+	zbx_free(hosts);
+}
@@ -0,0 +1,88 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "../../../src/libs/zbxicmpping/icmpengine.h"
+
+#define MOCK_IP_HEADER_LEN	20
+
+void	zbx_mock_test_entry(void **state)
+{
+	unsigned char	*buf, *reply;
+	size_t		len;
+	int		family, target = -1, packet = -1, expected_ret, returned_ret;
+	unsigned short	checksum;
+
+	ZBX_UNUSED(state);
+
+	family = zbx_mock_str_to_family(zbx_mock_get_parameter_string("in.family"));
+
+	buf = (unsigned char *)zbx_malloc(NULL, MOCK_IP_HEADER_LEN + ZBX_ICMP_HEADER_LEN + ZBX_KIBIBYTE);
+	reply = buf + MOCK_IP_HEADER_LEN;
+
+	len = zbx_icmp_build_echo(reply, family, 1, 2, (zbx_uint32_t)zbx_mock_get_parameter_uint64("in.request_tag"),
+			(int)zbx_mock_get_parameter_uint64("in.target"), (int)zbx_mock_get_parameter_uint64("in.packet"),
+			(int)zbx_mock_get_parameter_uint64("in.size"));
+
+	zbx_mock_assert_uint64_eq("packet length", zbx_mock_get_parameter_uint64("out.length"), len);
+
+	/* turn the request into reply the way a responder does */
+	if (AF_INET == family)
+	{
+		zbx_mock_assert_int_eq("request checksum", 0, zbx_icmp_checksum(reply, len));
+
+		reply[0] = 0;
+		reply[2] = reply[3] = 0;
+		checksum = zbx_icmp_checksum(reply, len);
+		reply[2] = (unsigned char)(checksum >> 8);
+		reply[3] = (unsigned char)checksum;
+	}
+	else
+		reply[0] = 129;
+
+	if (0 == strcmp(zbx_mock_get_parameter_string("in.corrupt"), "yes"))
+		reply[len - 1] ^= 0xff;
+
+	if (0 == strcmp(zbx_mock_get_parameter_string("in.ip_header"), "yes"))
+	{
+		memset(buf, 0, MOCK_IP_HEADER_LEN);
+		buf[0] = 0x45;
+		reply = buf;
+		len += MOCK_IP_HEADER_LEN;
+	}
+
+	expected_ret = zbx_mock_str_to_return_code(zbx_mock_get_parameter_string("out.return"));
+	returned_ret = zbx_icmp_parse_echo_reply(reply, len, family,
+			(zbx_uint32_t)zbx_mock_get_parameter_uint64("in.reply_tag"), &target, &packet);
+
+	zbx_mock_assert_result_eq("zbx_icmp_parse_echo_reply()", expected_ret, returned_ret);
+
+	if (SUCCEED == returned_ret)
+	{
+		zbx_mock_assert_int_eq("target", (int)zbx_mock_get_parameter_uint64("in.target"), target);
+		zbx_mock_assert_int_eq("packet", (int)zbx_mock_get_parameter_uint64("in.packet"), packet);
+	}
+
+	zbx_free(buf);
+}
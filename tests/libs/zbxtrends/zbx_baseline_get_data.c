@@ -30,8 +30,8 @@
 int	__wrap_DBis_null(const char *field);
 DB_ROW	__wrap_DBfetch(DB_RESULT result);
 DB_RESULT	__wrap_DBselect(const char *fmt, ...);
-zbx_trend_state_t	__wrap_zbx_trends_get_avg(const char *table, zbx_uint64_t itemid, int start, int end,
-		double *value);
+void	__wrap_zbx_trends_get_avg_multi(const char *table, zbx_uint64_t itemid, zbx_trend_period_t *periods,
+		int periods_num);
 
 int	__wrap_DBis_null(const char *field)
 {
@@ -54,31 +54,43 @@ DB_RESULT	__wrap_DBselect(const char *fmt, ...)
 static	zbx_mock_handle_t	hout;
 static int			iteration;
 
-zbx_trend_state_t	__wrap_zbx_trends_get_avg(const char *table, zbx_uint64_t itemid, int start, int end, double *value)
+void	__wrap_zbx_trends_get_avg_multi(const char *table, zbx_uint64_t itemid, zbx_trend_period_t *periods,
+		int periods_num)
 {
-	zbx_mock_handle_t	htime;
-	zbx_timespec_t		start_exp, end_exp, start_ret = {start, 0}, end_ret = {end, 0};
+	int	i;
 
 	ZBX_UNUSED(table);
 	ZBX_UNUSED(itemid);
 
-	*value = 0;
+	for (i = 0; i < periods_num; i++)
+	{
+		zbx_mock_handle_t	htime;
+		zbx_timespec_t		start_exp, end_exp, start_ret = {periods[i].start, 0},
+					end_ret = {periods[i].end, 0};
 
-	printf("iteration: %d\n", ++iteration);
+		periods[i].value = 0;
+		periods[i].state = ZBX_TREND_STATE_NORMAL;
 
-	if (ZBX_MOCK_SUCCESS != zbx_mock_vector_element(hout, &htime))
-		fail_msg("got more data than expected");
+		printf("iteration: %d\n", ++iteration);
 
-	if (ZBX_MOCK_SUCCESS != zbx_strtime_to_timespec(zbx_mock_get_object_member_string(htime, "start"), &start_exp))
-		fail_msg("invalid start time format");
+		if (ZBX_MOCK_SUCCESS != zbx_mock_vector_element(hout, &htime))
+			fail_msg("got more data than expected");
 
-	if (ZBX_MOCK_SUCCESS != zbx_strtime_to_timespec(zbx_mock_get_object_member_string(htime, "end"), &end_exp))
-		fail_msg("invalid end time format");
+		if (ZBX_MOCK_SUCCESS != zbx_strtime_to_timespec(zbx_mock_get_object_member_string(htime, "start"),
+				&start_exp))
+		{
+			fail_msg("invalid start time format");
+		}
 
-	zbx_mock_assert_timespec_eq("start time", &start_exp, &start_ret);
-	zbx_mock_assert_timespec_eq("end time", &end_exp, &end_ret);
+		if (ZBX_MOCK_SUCCESS != zbx_strtime_to_timespec(zbx_mock_get_object_member_string(htime, "end"),
+				&end_exp))
+		{
+			fail_msg("invalid end time format");
+		}
 
-	return ZBX_TREND_STATE_NORMAL;
+		zbx_mock_assert_timespec_eq("start time", &start_exp, &start_ret);
+		zbx_mock_assert_timespec_eq("end time", &end_exp, &end_ret);
+	}
 }
 
 void	zbx_mock_test_entry(void **state)
@@ -0,0 +1,331 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "../../../src/zabbix_server/poller/httpagent_multi.h"
+
+#ifdef ZBX_HAVE_HTTPAGENT_POLLER
+
+#define MOCK_DURATION_MAX	10	/* seconds before the test gives up waiting for the transfers */
+#define MOCK_WAIT_TIMEOUT	10	/* milliseconds to wait for transfers between serving local listeners */
+
+#define MOCK_SERVER_REPLY	0	/* accepts connection and responds after the request headers */
+#define MOCK_SERVER_SILENT	1	/* accepts connection and reads the request without responding */
+#define MOCK_SERVER_REFUSE	2	/* bound socket without listening, connections are refused */
+
+/* local listener serving one request */
+typedef struct
+{
+	int		mode;
+	int		socket;
+	int		client;
+	int		status;
+	const char	*body;
+	char		request[ZBX_KIBIBYTE];
+	size_t		request_len;
+	unsigned short	port;
+}
+mock_server_t;
+
+static int	mock_str_to_server_mode(const char *str)
+{
+	if (0 == strcmp(str, "reply"))
+		return MOCK_SERVER_REPLY;
+
+	if (0 == strcmp(str, "silent"))
+		return MOCK_SERVER_SILENT;
+
+	if (0 == strcmp(str, "refuse"))
+		return MOCK_SERVER_REFUSE;
+
+	fail_msg("unknown server mode \"%s\"", str);
+	return FAIL;
+}
+
+static void	mock_server_open(mock_server_t *server)
+{
+	struct sockaddr_in	addr;
+	socklen_t		addr_len = sizeof(addr);
+
+	if (-1 == (server->socket = socket(AF_INET, SOCK_STREAM, 0)))
+		fail_msg("cannot create socket: %s", zbx_strerror(errno));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (0 != bind(server->socket, (struct sockaddr *)&addr, sizeof(addr)))
+		fail_msg("cannot bind socket: %s", zbx_strerror(errno));
+
+	if (0 != getsockname(server->socket, (struct sockaddr *)&addr, &addr_len))
+		fail_msg("cannot get socket address: %s", zbx_strerror(errno));
+
+	server->port = ntohs(addr.sin_port);
+	server->client = -1;
+	server->request_len = 0;
+
+	if (MOCK_SERVER_REFUSE == server->mode)
+		return;
+
+	if (0 != listen(server->socket, 1))
+		fail_msg("cannot listen on socket: %s", zbx_strerror(errno));
+
+	if (-1 == fcntl(server->socket, F_SETFL, O_NONBLOCK | fcntl(server->socket, F_GETFL)))
+		fail_msg("cannot set socket non-blocking mode: %s", zbx_strerror(errno));
+}
+
+static void	mock_server_close(mock_server_t *server)
+{
+	if (-1 != server->client)
+		close(server->client);
+
+	close(server->socket);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: accepts connection, reads request and responds without blocking   *
+ *                                                                            *
+ ******************************************************************************/
+static void	mock_server_serve(mock_server_t *server)
+{
+	ssize_t	n;
+	char	*response;
+
+	if (MOCK_SERVER_REFUSE == server->mode)
+		return;
+
+	if (-1 == server->client)
+	{
+		if (-1 == (server->client = accept(server->socket, NULL, NULL)))
+			return;
+
+		if (-1 == fcntl(server->client, F_SETFL, O_NONBLOCK | fcntl(server->client, F_GETFL)))
+			fail_msg("cannot set socket non-blocking mode: %s", zbx_strerror(errno));
+	}
+
+	while (sizeof(server->request) - 1 > server->request_len && 0 < (n = recv(server->client,
+			server->request + server->request_len, sizeof(server->request) - 1 - server->request_len, 0)))
+	{
+		server->request_len += (size_t)n;
+	}
+
+	server->request[server->request_len] = '\0';
+
+	if (MOCK_SERVER_REPLY != server->mode || NULL == strstr(server->request, "\r\n\r\n"))
+		return;
+
+	response = zbx_dsprintf(NULL, "HTTP/1.1 %d Status\r\nContent-Length: " ZBX_FS_SIZE_T "\r\n"
+			"Connection: close\r\n\r\n%s", server->status, (zbx_fs_size_t)strlen(server->body),
+			server->body);
+
+	if ((ssize_t)strlen(response) != send(server->client, response, strlen(response), 0))
+		fail_msg("cannot send response: %s", zbx_strerror(errno));
+
+	zbx_free(response);
+
+	/* responded, further requests to this server are refused */
+	close(server->client);
+	server->client = -1;
+	server->mode = MOCK_SERVER_REFUSE;
+}
+
+static void	mock_request_init(zbx_httpagent_request_t *request, zbx_uint64_t itemid, unsigned short port,
+		const char *timeout, const char *status_codes)
+{
+	DC_ITEM	*item = &request->item;
+
+	/* GET request without authentication, redirects and proxy, storing raw content */
+	memset(request, 0, sizeof(zbx_httpagent_request_t));
+
+	item->itemid = itemid;
+	item->retrieve_mode = ZBX_RETRIEVE_MODE_CONTENT;
+
+	zbx_snprintf(item->url_orig, sizeof(item->url_orig), "http://127.0.0.1:%hu/", port);
+	item->url = item->url_orig;
+	zbx_strlcpy(item->timeout_orig, timeout, sizeof(item->timeout_orig));
+	item->timeout = item->timeout_orig;
+	zbx_strlcpy(item->status_codes_orig, status_codes, sizeof(item->status_codes_orig));
+	item->status_codes = item->status_codes_orig;
+
+	item->query_fields = item->query_fields_orig;
+	item->http_proxy = item->http_proxy_orig;
+	item->ssl_cert_file = item->ssl_cert_file_orig;
+	item->ssl_key_file = item->ssl_key_file_orig;
+	item->ssl_key_password = item->ssl_key_password_orig;
+	item->username = item->username_orig;
+	item->password = item->password_orig;
+	item->posts = zbx_strdup(NULL, "");
+	item->headers = zbx_strdup(NULL, "");
+}
+
+static void	mock_request_free(zbx_httpagent_request_t *request)
+{
+	zbx_free(request->item.posts);
+	zbx_free(request->item.headers);
+	zbx_free(request->result.text);
+	zbx_free(request->result.msg);
+	zbx_free(request);
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_httpagent_multi_t	multi;
+	zbx_httpagent_request_t	*request;
+	zbx_mock_handle_t	hrequests, hrequest, horder, hitemid;
+	zbx_mock_error_t	err;
+	mock_server_t		*servers;
+	const char		*timeout, *status_codes, *expected;
+	int			i, servers_num = 0, completed_num = 0;
+	double			time_start, duration;
+
+	ZBX_UNUSED(state);
+
+	timeout = zbx_mock_get_parameter_string("in.timeout");
+	status_codes = zbx_mock_get_parameter_string("in.status_codes");
+
+	hrequests = zbx_mock_get_parameter_handle("in.requests");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hrequests, &hrequest)))
+		servers_num++;
+
+	servers = (mock_server_t *)zbx_calloc(NULL, (size_t)servers_num, sizeof(mock_server_t));
+	zbx_httpagent_multi_init(&multi, servers_num, 0);
+
+	hrequests = zbx_mock_get_parameter_handle("in.requests");
+	time_start = zbx_time();
+
+	for (i = 0; i < servers_num; i++)
+	{
+		mock_server_t	*server = &servers[i];
+
+		zbx_mock_vector_element(hrequests, &hrequest);
+		server->mode = mock_str_to_server_mode(zbx_mock_get_object_member_string(hrequest, "server"));
+
+		if (MOCK_SERVER_REPLY == server->mode)
+		{
+			server->status = zbx_mock_get_object_member_int(hrequest, "status");
+			server->body = zbx_mock_get_object_member_string(hrequest, "body");
+		}
+
+		mock_server_open(server);
+
+		request = (zbx_httpagent_request_t *)zbx_malloc(NULL, sizeof(zbx_httpagent_request_t));
+		mock_request_init(request, (zbx_uint64_t)i, server->port, timeout, status_codes);
+		zbx_httpagent_multi_add(&multi, request);
+	}
+
+	while (0 != multi.requests_num && MOCK_DURATION_MAX > zbx_time() - time_start)
+	{
+		for (i = 0; i < servers_num; i++)
+			mock_server_serve(&servers[i]);
+
+		zbx_httpagent_multi_perform(&multi);
+		zbx_httpagent_multi_wait(&multi, MOCK_WAIT_TIMEOUT);
+	}
+
+	duration = zbx_time() - time_start;
+
+	zbx_mock_assert_int_eq("requests in progress", 0, multi.requests_num);
+	zbx_mock_assert_int_eq("completed requests", servers_num, multi.completed.values_num);
+
+	if (duration > zbx_mock_get_parameter_float("out.duration_max"))
+		fail_msg("transfers completed in " ZBX_FS_DBL " seconds, expected at most " ZBX_FS_DBL, duration,
+				zbx_mock_get_parameter_float("out.duration_max"));
+
+	/* requests are completed in the order of server responses, not in the order they were started */
+	horder = zbx_mock_get_parameter_handle("out.order");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(horder, &hitemid)))
+	{
+		zbx_uint64_t	itemid;
+
+		if (ZBX_MOCK_SUCCESS != err || ZBX_MOCK_SUCCESS != (err = zbx_mock_uint64(hitemid, &itemid)))
+			fail_msg("cannot read completion order: %s", zbx_mock_error_string(err));
+
+		if (completed_num >= multi.completed.values_num)
+			fail_msg("expected more than %d completed requests", multi.completed.values_num);
+
+		request = (zbx_httpagent_request_t *)multi.completed.values[completed_num++];
+		zbx_mock_assert_uint64_eq("completed itemid", itemid, request->item.itemid);
+	}
+
+	zbx_mock_assert_int_eq("number of completed requests", completed_num, multi.completed.values_num);
+
+	hrequests = zbx_mock_get_parameter_handle("out.requests");
+
+	for (i = 0; i < servers_num; i++)
+	{
+		int	j;
+
+		zbx_mock_vector_element(hrequests, &hrequest);
+
+		for (j = 0; (zbx_uint64_t)i != ((zbx_httpagent_request_t *)multi.completed.values[j])->item.itemid; j++)
+			;
+
+		request = (zbx_httpagent_request_t *)multi.completed.values[j];
+
+		zbx_mock_assert_result_eq("request result", zbx_mock_str_to_return_code(
+				zbx_mock_get_object_member_string(hrequest, "return")), request->errcode);
+
+		if (SUCCEED == request->errcode)
+		{
+			zbx_mock_assert_ptr_ne("value", NULL, request->result.text);
+			zbx_mock_assert_str_eq("value", zbx_mock_get_object_member_string(hrequest, "value"),
+					request->result.text);
+		}
+		else
+		{
+			expected = zbx_mock_get_object_member_string(hrequest, "error");
+
+			zbx_mock_assert_ptr_ne("error", NULL, request->result.msg);
+
+			if (0 != strncmp(request->result.msg, expected, strlen(expected)))
+				fail_msg("expected error starting with \"%s\" while got \"%s\"", expected,
+						request->result.msg);
+		}
+	}
+
+	for (i = 0; i < multi.completed.values_num; i++)
+		mock_request_free((zbx_httpagent_request_t *)multi.completed.values[i]);
+
+	zbx_vector_ptr_clear(&multi.completed);
+	zbx_httpagent_multi_destroy(&multi);
+
+	for (i = 0; i < servers_num; i++)
+		mock_server_close(&servers[i]);
+
+	zbx_free(servers);
+}
+
+#else
+
+void	zbx_mock_test_entry(void **state)
+{
+	ZBX_UNUSED(state);
+
+	skip();
+}
+
+#endif
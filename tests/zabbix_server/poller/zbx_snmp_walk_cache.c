@@ -0,0 +1,104 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2022 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "zbxmocktest.h"
+#include "zbxmockdata.h"
+#include "zbxmockassert.h"
+#include "zbxmockutil.h"
+
+#include "common.h"
+#include "../../../src/zabbix_server/poller/snmp_walk_cache.h"
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: checks item against the walk cache the same way SNMP poller does  *
+ *          and returns the step which walked the returned values             *
+ *                                                                            *
+ ******************************************************************************/
+static int	mock_walk_cached(int step, const char *delay, const char *oid, int now, int walk_ret, int *ttl)
+{
+	zbx_snmpwalk_t	*walk, walk_local;
+	char		value[MAX_ID_LEN + 1];
+
+	if (0 == (*ttl = zbx_snmp_walk_cache_ttl(delay)))
+		return step;
+
+	walk_local.addr = "127.0.0.1";
+	walk_local.port = 161;
+	walk_local.oid = (char *)oid;
+	walk_local.community_context = "public";
+	walk_local.security_name = "";
+
+	if (NULL != (walk = zbx_snmp_walk_cache_get(&walk_local, *ttl, now)))
+	{
+		zbx_mock_assert_int_eq("number of cached values", 1, walk->values.values_num);
+
+		return atoi((const char *)walk->values.values[0].second);
+	}
+
+	walk = zbx_snmp_walk_cache_prepare(&walk_local);
+	zbx_snprintf(value, sizeof(value), "%d", step);
+	zbx_snmp_walk_cache_add(walk, "1", value);
+
+	if (SUCCEED == walk_ret)
+		zbx_snmp_walk_cache_set(walk, now);
+	else
+		zbx_snmp_walk_cache_remove(walk);
+
+	return step;
+}
+
+void	zbx_mock_test_entry(void **state)
+{
+	zbx_mock_handle_t	hsteps, hstep;
+	zbx_mock_error_t	err;
+	int			step = 0;
+
+	ZBX_UNUSED(state);
+
+	hsteps = zbx_mock_get_parameter_handle("in.steps");
+
+	while (ZBX_MOCK_END_OF_VECTOR != (err = zbx_mock_vector_element(hsteps, &hstep)))
+	{
+		zbx_mock_handle_t	hwalk;
+		const char		*walk;
+		int			ttl, source, walk_ret = SUCCEED;
+
+		if (ZBX_MOCK_SUCCESS != err)
+			fail_msg("cannot read step #%d: %s", step, zbx_mock_error_string(err));
+
+		if (ZBX_MOCK_SUCCESS == zbx_mock_object_member(hstep, "walk", &hwalk) &&
+				ZBX_MOCK_SUCCESS == zbx_mock_string(hwalk, &walk))
+		{
+			walk_ret = zbx_mock_str_to_return_code(walk);
+		}
+
+		source = mock_walk_cached(step, zbx_mock_get_object_member_string(hstep, "delay"),
+				zbx_mock_get_object_member_string(hstep, "oid"),
+				zbx_mock_get_object_member_int(hstep, "time"), walk_ret, &ttl);
+
+		zbx_mock_assert_int_eq("walk cache ttl", zbx_mock_get_object_member_int(hstep, "ttl"), ttl);
+		zbx_mock_assert_int_eq("step that walked returned values",
+				zbx_mock_get_object_member_int(hstep, "source"), source);
+
+		step++;
+	}
+
+	zbx_snmp_walk_cache_destroy();
+}
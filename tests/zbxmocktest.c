@@ -59,6 +59,11 @@ int	CONFIG_AVAILMAN_FORKS		= 1;
 int	CONFIG_SERVICEMAN_FORKS		= 0;
 int	CONFIG_TRIGGERHOUSEKEEPER_FORKS = 0;
 int	CONFIG_ODBCPOLLER_FORKS		= 5;
+int	CONFIG_AGENTPOLLER_FORKS	= 0;
+int	CONFIG_SNMPPOLLER_FORKS		= 0;
+int	CONFIG_HTTPAGENTPOLLER_FORKS	= 0;
+int	CONFIG_MAX_CONCURRENT_CHECKS	= 1000;
+int	CONFIG_MAX_CONCURRENT_HTTP_HOST_CHECKS	= 0;
 
 int	CONFIG_LISTEN_PORT		= 0;
 char	*CONFIG_LISTEN_IP		= NULL;
@@ -71,6 +76,9 @@ int	CONFIG_HISTSYNCER_FORKS		= 4;
 int	CONFIG_HISTSYNCER_FREQUENCY	= 1;
 int	CONFIG_CONFSYNCER_FORKS		= 1;
 int	CONFIG_CONFSYNCER_FREQUENCY	= 60;
+int	CONFIG_CONFSYNCER_FULL_FREQUENCY = 0;
+int	CONFIG_CONFSYNCER_WORKERS	= 0;
+int	CONFIG_SCHEDULER_SMOOTHING_WINDOW = 0;
 int	CONFIG_PROBLEMHOUSEKEEPING_FREQUENCY = 60;
 
 int	CONFIG_VMWARE_FORKS		= 0;
@@ -81,8 +89,13 @@ int	CONFIG_VMWARE_TIMEOUT		= 10;
 zbx_uint64_t	CONFIG_CONF_CACHE_SIZE		= 8 * 0;
 zbx_uint64_t	CONFIG_HISTORY_CACHE_SIZE	= 16 * 0;
 zbx_uint64_t	CONFIG_HISTORY_INDEX_CACHE_SIZE	= 4 * 0;
+int		CONFIG_HISTORY_CACHE_SHARDS	= 1;
 zbx_uint64_t	CONFIG_TRENDS_CACHE_SIZE	= 4 * 0;
+int		CONFIG_TRENDS_FLUSH_PERIOD	= 0;
 zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE		= 8 * 0;
+int		CONFIG_SHMEM_HUGE_PAGES		= 0;
+char		*CONFIG_SHMEM_NUMA_POLICY	= NULL;
+int		CONFIG_VALUE_CACHE_COMPRESSION	= 0;
 zbx_uint64_t	CONFIG_VMWARE_CACHE_SIZE	= 8 * 0;
 zbx_uint64_t	CONFIG_EXPORT_FILE_SIZE;
 zbx_uint64_t	CONFIG_TREND_FUNC_CACHE_SIZE	= 0;
@@ -96,6 +109,8 @@ char	*CONFIG_EXTERNALSCRIPTS		= NULL;
 char	*CONFIG_TMPDIR			= NULL;
 char	*CONFIG_FPING_LOCATION		= NULL;
 char	*CONFIG_FPING6_LOCATION		= NULL;
+int	CONFIG_NATIVE_ICMP_PING		= 0;
+int	CONFIG_NATIVE_ICMP_PING_RATE	= 10000;
 char	*CONFIG_DBHOST			= NULL;
 char	*CONFIG_DBNAME			= NULL;
 char	*CONFIG_DBSCHEMA		= NULL;
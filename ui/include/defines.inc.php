@@ -22,7 +22,7 @@ define('ZABBIX_VERSION',		'6.2.0rc1');
 define('ZABBIX_API_VERSION',	'6.2.0');
 define('ZABBIX_EXPORT_VERSION',	'6.2');
 
-define('ZABBIX_DB_VERSION',		6010023);
+define('ZABBIX_DB_VERSION',		6010025);
 
 define('DB_VERSION_SUPPORTED',				0);
 define('DB_VERSION_LOWER_THAN_MINIMUM',		1);